@@ -0,0 +1,450 @@
+/*!
+ * 1 compares parsing every response twice, as checkError() and getJsonResultArray() did, with one Response::parse(),
+ * 2 counts the heap allocations of the old parsing, a Response into a picojson tree and a Response into a reused arena,
+ * 3 compares the wall time of getSettingsSnapshot() over the snapshot connections with the same requests one after another,
+ *   against the simulator with several response latencies,
+ * 4 checks startBurst() and stopBurst() against the simulator with capture latencies below and above its await threshold,
+ *   + and - change the response latency of the simulator for these checks,
+ * r records getEvent, getAvailableApiList and getMethodTypes of the camera at 10.0.0.1 to data/payloads.
+ * The payloads in data/payloads are assembled from the example responses of the API reference, recorded ones are added next to them.
+ * The results are printed to the console as well.
+ */
+#include "testApp.h"
+
+static const char* const PAYLOAD_DIRECTORY("payloads");
+static const int ITERATIONS(2000);
+static const int SIMULATOR_PORT(10100);	//!< away from the port of a camera
+static const unsigned long long SNAPSHOT_LATENCIES[] = {0, 20, 50, 100};	//!< ms
+static const int SNAPSHOT_LATENCY_NUM(sizeof(SNAPSHOT_LATENCIES) / sizeof(SNAPSHOT_LATENCIES[0]));
+static const int SNAPSHOT_RUNS(5);
+static const unsigned long long BURST_TIMEOUT(60000);	//!< ms, a burst which runs longer fails its check
+static const unsigned long long MAX_STOP_MILLIS(1000);	//!< stopBurst() returns within this time while a capture is in flight
+
+//////////////////////////////////////////////////////////////////////////////
+// Allocation counter
+//////////////////////////////////////////////////////////////////////////////
+
+// counts the allocations of all threads, the benchmarks run while no camera is connected
+static unsigned long sAllocationCount(0);
+
+void* operator new(std::size_t size) throw(std::bad_alloc)
+{
+	++sAllocationCount;
+	void* p(malloc(size ? size : 1));
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) throw()
+{
+	free(p);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Parsing of the first version of ofxSonyRemoteCamera, for comparison
+//////////////////////////////////////////////////////////////////////////////
+
+static picojson::value parse(const std::string& json)
+{
+	picojson::value v;
+	const char* m(json.c_str());
+	std::string err;
+	picojson::parse(v, m, m+strlen(m), &err);
+	return v;
+}
+
+static int checkError(const std::string& json)
+{
+	const picojson::value v = parse(json);
+	if (!v.is<picojson::object>()) return -1;
+	const picojson::value::object& obj(v.get<picojson::object>());
+	int errcode(0);
+	for (picojson::value::object::const_iterator it=obj.begin(); it!=obj.end(); ++it) {
+		if ( (it->first).compare("error") == 0) {
+			picojson::array a(it->second.get<picojson::array>());
+			errcode = a[0].get<double>();
+		}
+	}
+	return errcode;
+}
+
+static bool getJsonResultArray(picojson::array& outArray, const std::string& json)
+{
+	const picojson::value v = parse(json);
+	if (!v.is<picojson::object>()) return false;
+	const picojson::value::object& obj(v.get<picojson::object>());
+	for (picojson::value::object::const_iterator it=obj.begin(); it!=obj.end(); ++it) {
+		if ( (it->first).compare("result") == 0 || (it->first).compare("results") == 0) {
+			outArray = it->second.get<picojson::array>();
+			return true;
+		}
+	}
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// testApp
+//////////////////////////////////////////////////////////////////////////////
+
+//--------------------------------------------------------------
+void testApp::setup(){
+	ofSetFrameRate(30);
+	mIterations = ITERATIONS;
+	mBurstResponseLatencyMillis = 0;
+	loadPayloads();
+}
+
+//--------------------------------------------------------------
+void testApp::loadPayloads(){
+	mPayloadNames.clear();
+	mPayloads.clear();
+	ofDirectory dir;
+	dir.allowExt("json");
+	dir.listDir(PAYLOAD_DIRECTORY);
+	dir.sort();
+	for (unsigned int i(0); i<dir.numFiles(); ++i) {
+		const ofBuffer buffer(ofBufferFromFile(dir.getPath(i)));
+		std::string payload(buffer.getBinaryBuffer(), buffer.size());
+		// the files end with a line feed, the camera does not send one
+		while (!payload.empty() && isspace(static_cast<unsigned char>(payload[payload.size() - 1]))) {
+			payload.erase(payload.size() - 1);
+		}
+		mPayloadNames.push_back(dir.getName(i));
+		mPayloads.push_back(payload);
+	}
+	mMessage = ofToString(mPayloads.size()) + " payloads in data/" + PAYLOAD_DIRECTORY;
+}
+
+//--------------------------------------------------------------
+void testApp::recordPayloads(){
+	ofxSonyRemoteCamera camera;
+	camera.setup();
+	std::string messages;
+	const char* const names[] = {"recorded_getEvent.json", "recorded_getAvailableApiList.json", "recorded_getMethodTypes.json"};
+	for (int i(0); i<3; ++i) {
+		std::string json;
+		ofxSonyRemoteCamera::SRCError err(ofxSonyRemoteCamera::SRC_OK);
+		switch (i) {
+		case 0: err = camera.getEvent(json, false); break;
+		case 1: err = camera.getAvailableApiList(json); break;
+		default: err = camera.getMethodTypes(json); break;
+		}
+		if (err != ofxSonyRemoteCamera::SRC_OK) {
+			messages += std::string(names[i]) + ": " + camera.getErrorString(err) + "\n";
+			continue;
+		}
+		ofBuffer buffer(json.c_str(), json.size());
+		ofBufferToFile(std::string(PAYLOAD_DIRECTORY) + "/" + names[i], buffer);
+		messages += std::string(names[i]) + ": " + ofToString(json.size()) + " bytes\n";
+	}
+	camera.exit();
+	loadPayloads();
+	mMessage = messages + mMessage;
+}
+
+//--------------------------------------------------------------
+void testApp::runParseBenchmark(){
+	mParseResults.clear();
+	for (size_t i(0); i<mPayloads.size(); ++i) {
+		const std::string& payload(mPayloads[i]);
+		ParseResult result;
+		result.name = mPayloadNames[i];
+		result.bytes = payload.size();
+
+		// the sums keep the compiler from dropping the parses
+		size_t sum(0);
+		unsigned long long startMicros(ofGetElapsedTimeMicros());
+		for (int n(0); n<mIterations; ++n) {
+			picojson::array resultArray;
+			sum += checkError(payload);
+			if (getJsonResultArray(resultArray, payload)) sum += resultArray.size();
+		}
+		result.doubleParseMicros = (ofGetElapsedTimeMicros() - startMicros) / static_cast<double>(mIterations);
+
+		startMicros = ofGetElapsedTimeMicros();
+		for (int n(0); n<mIterations; ++n) {
+			ofxSonyRemoteCamera::Response response;
+			if (response.parse(payload.data(), payload.data() + payload.size())) {
+				sum += response.getErrorCode() + response.getResultArray().size();
+			}
+		}
+		result.singleParseMicros = (ofGetElapsedTimeMicros() - startMicros) / static_cast<double>(mIterations);
+
+		if (sum == 0) ofLogWarning(result.name + " has no result");
+		mParseResults.push_back(result);
+	}
+
+	mMessage = "parse (1), " + ofToString(mIterations) + " iterations, us per response: parsed twice -> parsed once\n";
+	for (std::vector<ParseResult>::const_iterator it=mParseResults.begin(); it!=mParseResults.end(); ++it) {
+		mMessage += "  " + it->name + " (" + ofToString(it->bytes) + " B): " + ofToString(it->doubleParseMicros, 2) + " -> " + ofToString(it->singleParseMicros, 2) + "\n";
+	}
+	std::cout << mMessage << std::endl;
+}
+
+//--------------------------------------------------------------
+void testApp::runAllocationBenchmark(){
+	mAllocationResults.clear();
+	ofxSonyRemoteCamera::JsonArena arena;
+	for (size_t i(0); i<mPayloads.size(); ++i) {
+		const std::string& payload(mPayloads[i]);
+		const char* const begin(payload.data());
+		const char* const end(payload.data() + payload.size());
+		AllocationResult result;
+		result.name = mPayloadNames[i];
+		result.bytes = payload.size();
+
+		size_t sum(0);
+		unsigned long startCount(sAllocationCount);
+		for (int n(0); n<mIterations; ++n) {
+			picojson::array resultArray;
+			sum += checkError(payload);
+			if (getJsonResultArray(resultArray, payload)) sum += resultArray.size();
+		}
+		result.doubleParseAllocations = (sAllocationCount - startCount) / static_cast<double>(mIterations);
+
+		startCount = sAllocationCount;
+		unsigned long long startMicros(ofGetElapsedTimeMicros());
+		for (int n(0); n<mIterations; ++n) {
+			ofxSonyRemoteCamera::Response response;
+			if (response.parse(begin, end)) sum += response.getResultArray().size();
+		}
+		result.treeMicros = (ofGetElapsedTimeMicros() - startMicros) / static_cast<double>(mIterations);
+		result.treeAllocations = (sAllocationCount - startCount) / static_cast<double>(mIterations);
+
+		// the first parse grows the arena to the payload, like the first response of a camera
+		ofxSonyRemoteCamera::Response arenaResponse(&arena);
+		arenaResponse.parse(begin, end);
+		startCount = sAllocationCount;
+		startMicros = ofGetElapsedTimeMicros();
+		for (int n(0); n<mIterations; ++n) {
+			if (arenaResponse.parse(begin, end)) sum += arenaResponse.getResultNode().size();
+		}
+		result.arenaMicros = (ofGetElapsedTimeMicros() - startMicros) / static_cast<double>(mIterations);
+		result.arenaAllocations = (sAllocationCount - startCount) / static_cast<double>(mIterations);
+		result.arenaNodes = arena.getNodeCount();
+		result.arenaCapacityBytes = arena.getCapacityBytes();
+
+		ofxSonyRemoteCamera::Response treeResponse;
+		treeResponse.parse(begin, end);
+		// picojson sorts the members and prints numbers with decimals, so the arena output is compared after a parse
+		std::string arenaJson;
+		arenaResponse.getResultNode().serialize(arenaJson);
+		picojson::value arenaValue;
+		std::string err;
+		picojson::parse(arenaValue, arenaJson.data(), arenaJson.data() + arenaJson.size(), &err);
+		result.isArenaEqual = (arenaValue.serialize() == picojson::value(treeResponse.getResultArray()).serialize());
+
+		if (sum == 0) ofLogWarning(result.name + " has no result");
+		mAllocationResults.push_back(result);
+	}
+
+	mMessage = "allocations (2), " + ofToString(mIterations) + " iterations, per response: parsed twice / tree / arena, us tree -> arena\n";
+	for (std::vector<AllocationResult>::const_iterator it=mAllocationResults.begin(); it!=mAllocationResults.end(); ++it) {
+		mMessage += "  " + it->name + " (" + ofToString(it->bytes) + " B): " + ofToString(it->doubleParseAllocations, 1) + " / " + ofToString(it->treeAllocations, 1)
+			+ " / " + ofToString(it->arenaAllocations, 1) + ", " + ofToString(it->treeMicros, 2) + " -> " + ofToString(it->arenaMicros, 2) + " us, "
+			+ ofToString(it->arenaNodes) + " nodes in " + ofToString(it->arenaCapacityBytes) + " B" + (it->isArenaEqual ? "" : ", ARENA DIFFERS") + "\n";
+	}
+	std::cout << mMessage << std::endl;
+}
+
+//--------------------------------------------------------------
+void testApp::runSnapshotBenchmark(){
+	mSnapshotResults.clear();
+	for (int i(0); i<SNAPSHOT_LATENCY_NUM; ++i) {
+		ofxSonyRemoteCameraSimulator simulator;
+		ofxSonyRemoteCameraSimulator::Settings settings;
+		settings.port = SIMULATOR_PORT;
+		settings.responseLatencyMillis = SNAPSHOT_LATENCIES[i];
+		if (!simulator.start(settings)) {
+			mMessage = "the simulator cannot listen on port " + ofToString(SIMULATOR_PORT);
+			return;
+		}
+		ofxSonyRemoteCamera camera;
+		camera.setup(simulator.getHost(), simulator.getPort());
+
+		SnapshotResult result;
+		result.responseLatencyMillis = SNAPSHOT_LATENCIES[i];
+		result.connections = camera.getSnapshotConcurrency();
+		for (int mode(0); mode<2; ++mode) {
+			const bool isConcurrent(mode == 1);
+			// the first snapshot opens the connections
+			ofxSonyRemoteCamera::SettingsSnapshot snapshot;
+			camera.getSettingsSnapshot(snapshot, isConcurrent);
+			unsigned long long totalMicros(0);
+			for (int n(0); n<SNAPSHOT_RUNS; ++n) {
+				if (camera.getSettingsSnapshot(snapshot, isConcurrent) != ofxSonyRemoteCamera::SRC_OK) ++result.failures;
+				totalMicros += snapshot.elapsedMicros;
+			}
+			if (isConcurrent) {
+				result.concurrentMillis = totalMicros / 1000.0 / SNAPSHOT_RUNS;
+			} else {
+				result.serialMillis = totalMicros / 1000.0 / SNAPSHOT_RUNS;
+			}
+		}
+		camera.exit();
+		simulator.stop();
+		mSnapshotResults.push_back(result);
+	}
+
+	mMessage = "snapshot (3), " + ofToString(ofxSonyRemoteCamera::SNAPSHOT_FIELD_NUM) + " fields, mean of " + ofToString(SNAPSHOT_RUNS) + " snapshots: serial -> concurrent\n";
+	for (std::vector<SnapshotResult>::const_iterator it=mSnapshotResults.begin(); it!=mSnapshotResults.end(); ++it) {
+		mMessage += "  response latency " + ofToString(it->responseLatencyMillis) + " ms: " + ofToString(it->serialMillis, 1) + " ms -> " + ofToString(it->concurrentMillis, 1) + " ms over " + ofToString(it->connections) + " connections"
+			+ (it->failures ? ", " + ofToString(it->failures) + " failed" : std::string()) + "\n";
+	}
+	std::cout << mMessage << std::endl;
+}
+
+//--------------------------------------------------------------
+bool testApp::runBurst(const ofxSonyRemoteCameraSimulator::Settings& settings, const ofxSonyRemoteCamera::BurstOptions& options, unsigned long long stopAfterMillis,
+	ofxSonyRemoteCamera::BurstReport& report, int& captureCount, unsigned long long& stopMicros){
+	ofxSonyRemoteCameraSimulator simulator;
+	if (!simulator.start(settings)) return false;
+	ofxSonyRemoteCamera camera;
+	camera.setup(simulator.getHost(), simulator.getPort());
+	// only the captures are checked
+	ofxSonyRemoteCamera::PostViewOptions postViewOptions;
+	postViewOptions.isAutoFetch = false;
+	camera.setPostViewOptions(postViewOptions);
+
+	bool isOk(camera.startBurst(options));
+	const unsigned long long startMillis(ofGetElapsedTimeMillis());
+	while (isOk && camera.isBurstRunning()) {
+		const unsigned long long elapsedMillis(ofGetElapsedTimeMillis() - startMillis);
+		if (stopAfterMillis > 0 && elapsedMillis >= stopAfterMillis) break;
+		if (elapsedMillis >= BURST_TIMEOUT) isOk = false;
+		ofSleepMillis(10);
+	}
+	// joins the workers of a finished burst as well
+	const unsigned long long stopStartMicros(ofGetElapsedTimeMicros());
+	camera.stopBurst();
+	stopMicros = ofGetElapsedTimeMicros() - stopStartMicros;
+	camera.getBurstReport(report);
+	captureCount = simulator.getCaptureCount();
+	camera.exit();
+	simulator.stop();
+	return isOk && report.isFinished;
+}
+
+//--------------------------------------------------------------
+void testApp::runBurstChecks(){
+	mBurstChecks.clear();
+	ofxSonyRemoteCameraSimulator::Settings settings;
+	settings.port = SIMULATOR_PORT;
+	settings.responseLatencyMillis = mBurstResponseLatencyMillis;
+	ofxSonyRemoteCamera::BurstOptions options;
+	ofxSonyRemoteCamera::BurstReport report;
+	int captureCount(0);
+	unsigned long long stopMicros(0);
+
+	for (int i(0); i<5; ++i) {
+		BurstCheck check;
+		bool isRun(false);
+		switch (i) {
+		case 0:
+			check.name = "every shot is taken once";
+			settings.captureLatencyMillis = 100;
+			settings.awaitThresholdMillis = 1000;
+			options = ofxSonyRemoteCamera::BurstOptions();
+			options.shotCount = 5;
+			isRun = runBurst(settings, options, 0, report, captureCount, stopMicros);
+			check.isPassed = isRun && report.shots == 5 && report.failures == 0 && report.awaitCalls == 0 && captureCount == 5;
+			break;
+		case 1:
+			check.name = "captures longer than the await threshold are awaited";
+			settings.captureLatencyMillis = 600;
+			settings.awaitThresholdMillis = 200;
+			options = ofxSonyRemoteCamera::BurstOptions();
+			options.shotCount = 3;
+			isRun = runBurst(settings, options, 0, report, captureCount, stopMicros);
+			check.isPassed = isRun && report.shots == 3 && report.failures == 0 && report.awaitCalls == 3;
+			break;
+		case 2:
+			check.name = "a camera which is not ready lowers the in-flight limit";
+			settings.captureLatencyMillis = 200;
+			settings.awaitThresholdMillis = 1000;
+			options = ofxSonyRemoteCamera::BurstOptions();
+			options.shotCount = 4;
+			options.maxInFlight = 3;
+			isRun = runBurst(settings, options, 0, report, captureCount, stopMicros);
+			check.isPassed = isRun && report.shots == 4 && report.failures == 0 && report.notReadyCount > 0 && report.inFlightLimit < 3;
+			break;
+		case 3:
+			{
+				check.name = "the shot rate follows the capture latency";
+				settings.captureLatencyMillis = 200;
+				settings.awaitThresholdMillis = 1000;
+				options = ofxSonyRemoteCamera::BurstOptions();
+				options.shotCount = 5;
+				isRun = runBurst(settings, options, 0, report, captureCount, stopMicros);
+				// one capture at a time, each request waits for the response latency as well
+				const float maxRate(1000.0f / settings.captureLatencyMillis * 1.1f);
+				const float minRate(1000.0f / (settings.captureLatencyMillis + 2 * settings.responseLatencyMillis) * 0.5f);
+				check.isPassed = isRun && report.shots == 5 && minRate <= report.shotsPerSecond && report.shotsPerSecond <= maxRate;
+			}
+			break;
+		default:
+			check.name = "stopBurst() aborts a capture in flight";
+			settings.captureLatencyMillis = 5000;
+			settings.awaitThresholdMillis = 10000;
+			options = ofxSonyRemoteCamera::BurstOptions();
+			options.shotCount = 0;
+			isRun = runBurst(settings, options, 300, report, captureCount, stopMicros);
+			check.isPassed = isRun && stopMicros < MAX_STOP_MILLIS * 1000 && report.shots == 0 && report.lastError == ofxSonyRemoteCamera::SRC_ERROR_CANCELLED;
+			break;
+		}
+		check.detail = isRun ? ofToString(report.shots) + " shots, " + ofToString(report.failures) + " failures, " + ofToString(report.awaitCalls) + " awaits, "
+			+ ofToString(report.notReadyCount) + " not ready, limit " + ofToString(report.inFlightLimit) + ", " + ofToString(report.shotsPerSecond, 2) + " shots/s, "
+			+ ofToString(captureCount) + " captures, stopBurst " + ofToString(stopMicros / 1000.0, 1) + " ms" : "the burst did not start or end";
+		mBurstChecks.push_back(check);
+	}
+
+	int passed(0);
+	std::string lines;
+	for (std::vector<BurstCheck>::const_iterator it=mBurstChecks.begin(); it!=mBurstChecks.end(); ++it) {
+		if (it->isPassed) ++passed;
+		lines += std::string(it->isPassed ? "  PASS " : "  FAIL ") + it->name + ": " + it->detail + "\n";
+	}
+	mMessage = "burst (4), response latency " + ofToString(mBurstResponseLatencyMillis) + " ms: " + ofToString(passed) + "/" + ofToString(mBurstChecks.size()) + " passed\n" + lines;
+	std::cout << mMessage << std::endl;
+}
+
+//--------------------------------------------------------------
+void testApp::update(){
+}
+
+//--------------------------------------------------------------
+void testApp::draw(){
+	ofBackground(0);
+	ofSetColor(255);
+	ofDrawBitmapString("1: parse, 2: allocations, 3: snapshot, 4: burst checks, +/-: response latency of the burst checks ("
+		+ ofToString(mBurstResponseLatencyMillis) + " ms), r: record payloads from the camera\n\n" + mMessage, 20, 20);
+}
+
+//--------------------------------------------------------------
+void testApp::keyPressed(int key){
+	switch (key) {
+	case '1':
+		runParseBenchmark();
+		break;
+	case '2':
+		runAllocationBenchmark();
+		break;
+	case '3':
+		runSnapshotBenchmark();
+		break;
+	case '4':
+		runBurstChecks();
+		break;
+	case '+':
+		mBurstResponseLatencyMillis += 10;
+		break;
+	case '-':
+		if (mBurstResponseLatencyMillis >= 10) mBurstResponseLatencyMillis -= 10;
+		break;
+	case 'r':
+		recordPayloads();
+		break;
+	default:
+		break;
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxSonyRemoteCamera.h"
+#include "ofxSonyRemoteCameraSimulator.h"
+
+/*!
+ * Benchmarks of ofxSonyRemoteCamera against recorded camera responses and ofxSonyRemoteCameraSimulator.
+ */
+class testApp : public ofBaseApp{
+public:
+	struct ParseResult
+	{
+		ParseResult(): bytes(0), doubleParseMicros(0), singleParseMicros(0) {}
+		std::string name;			//!< of the payload file
+		size_t bytes;
+		double doubleParseMicros;	//!< per response, parsed by checkError and again by getJsonResultArray
+		double singleParseMicros;	//!< per response, parsed once by Response
+	};
+	struct AllocationResult
+	{
+		AllocationResult(): bytes(0), doubleParseAllocations(0), treeAllocations(0), arenaAllocations(0), treeMicros(0), arenaMicros(0), arenaNodes(0), arenaCapacityBytes(0), isArenaEqual(false) {}
+		std::string name;
+		size_t bytes;
+		double doubleParseAllocations;	//!< per response
+		double treeAllocations;			//!< per response, Response into a picojson tree
+		double arenaAllocations;		//!< per response, Response into a reused arena
+		double treeMicros;
+		double arenaMicros;
+		size_t arenaNodes;
+		size_t arenaCapacityBytes;
+		bool isArenaEqual;				//!< the arena serializes to the same JSON as the tree
+	};
+	struct SnapshotResult
+	{
+		SnapshotResult(): responseLatencyMillis(0), connections(0), serialMillis(0), concurrentMillis(0), failures(0) {}
+		unsigned long long responseLatencyMillis;	//!< of the simulator
+		int connections;			//!< of the concurrent snapshot
+		double serialMillis;		//!< mean wall time of a snapshot over one connection
+		double concurrentMillis;	//!< mean wall time of a snapshot over the snapshot connections
+		int failures;				//!< snapshots which did not return SRC_OK
+	};
+	struct BurstCheck
+	{
+		BurstCheck(): isPassed(false) {}
+		std::string name;
+		bool isPassed;
+		std::string detail;			//!< of the report
+	};
+
+	void setup();
+	void update();
+	void draw();
+
+	void keyPressed(int key);
+
+	void loadPayloads();
+	//! saves the responses of the camera at its default address to data/payloads
+	void recordPayloads();
+	void runParseBenchmark();
+	void runAllocationBenchmark();
+	void runSnapshotBenchmark();
+	void runBurstChecks();
+	/*!
+		Runs a burst against a new simulator.
+		@params stopAfterMillis stopBurst() is called after this time, 0 waits for the end of the burst
+		@return false if the burst did not start or end
+	*/
+	bool runBurst(const ofxSonyRemoteCameraSimulator::Settings& settings, const ofxSonyRemoteCamera::BurstOptions& options, unsigned long long stopAfterMillis,
+		ofxSonyRemoteCamera::BurstReport& report, int& captureCount, unsigned long long& stopMicros);
+
+private:
+	std::vector<std::string> mPayloadNames;
+	std::vector<std::string> mPayloads;
+	int mIterations;
+
+	std::vector<ParseResult> mParseResults;
+	std::vector<AllocationResult> mAllocationResults;
+	std::vector<SnapshotResult> mSnapshotResults;
+	std::vector<BurstCheck> mBurstChecks;
+	unsigned long long mBurstResponseLatencyMillis;	//!< of the simulator in the burst checks, +/- change it
+	std::string mMessage;
+};
@@ -0,0 +1,377 @@
+/*!
+ * Keys 1-7 start the benchmark with 1, 2, 4, 8, 16, 32 or 64 simulated cameras,
+ * t broadcasts actTakePicture to all cameras, z broadcasts a 1shot zoom to the even cameras,
+ * r switches between liveview threads per camera and one reactor thread,
+ * s takes a picture on all cameras with the synchronized trigger, blocking until all cameras responded,
+ * m switches between decoding every camera and composing one mosaic,
+ * c runs a zoom and burst script on every camera,
+ * d switches between the known simulator ports and SSDP discovery, the second discovery answers from the cache,
+ * a runs 1 to 64 cameras in turn with the current switches and writes the results to data/manager_benchmark.csv, any other key stops it.
+ */
+#include "testApp.h"
+
+static const int CAMERA_COUNTS[] = {1, 2, 4, 8, 16, 32, 64};
+static const int CAMERA_COUNT_NUM(sizeof(CAMERA_COUNTS) / sizeof(CAMERA_COUNTS[0]));
+static const int FIRST_PORT(10000);
+static const int FIRST_SSDP_PORT(11900);	//!< one per simulator, so that the search does not need multicast
+static const unsigned long long SWEEP_STREAMING_TIMEOUT(20000);	//!< ms, the sweep measures anyway after it
+static const unsigned long long SWEEP_MEASURING_MILLIS(5000);
+static const unsigned long long SWEEP_BROADCAST_TIMEOUT(30000);	//!< ms
+static const char* SWEEP_FILE("manager_benchmark.csv");
+
+//--------------------------------------------------------------
+void testApp::setup(){
+	ofSetFrameRate(60);
+	mpManager = 0;
+	mpMosaic = 0;
+	mCameraCount = 0;
+	mIsReactor = false;
+	mIsMosaic = false;
+	mIsDiscovery = false;
+	mDiscoveryMicros = 0;
+	mDiscoveredCameras = 0;
+	mCachedCameras = 0;
+	mUpdateMillis = 0;
+	mLastBroadcastMicros = 0;
+	mLastBroadcastMaxCameraMicros = 0;
+	mLastBroadcastErrors = 0;
+	mLastTriggerSendSpreadMicros = 0;
+	mLastTriggerAckSpreadMicros = 0;
+	mLastTriggerErrors = 0;
+	mFinishedScripts = 0;
+	mFailedScripts = 0;
+	mStartMicros = 0;
+	mSweepPhase = SWEEP_OFF;
+	mSweepIndex = 0;
+	mSweepPhaseMillis = 0;
+	mSweepStreamingMillis = 0;
+	mSweepDecodedFrames = 0;
+	mSweepMaxUpdateMillis = 0;
+	mSweepTotalUpdateMillis = 0;
+	mSweepUpdates = 0;
+	mSweepBroadcastId = -1;
+	mIsSweepBroadcastFinished = false;
+	startBenchmark(CAMERA_COUNTS[0]);
+}
+
+//--------------------------------------------------------------
+void testApp::exit(){
+	stopBenchmark();
+	for (std::vector<ofxSonyRemoteCameraSimulator*>::iterator it=mSimulators.begin(); it!=mSimulators.end(); ++it) {
+		delete *it;
+	}
+	mSimulators.clear();
+}
+
+//--------------------------------------------------------------
+void testApp::startBenchmark(int cameraCount){
+	stopBenchmark();
+	const unsigned long long startMicros(ofGetElapsedTimeMicros());
+
+	// one simulator per camera, on consecutive ports
+	ofxSonyRemoteCameraSimulator::Settings settings;
+	settings.responseLatencyMillis = 20;
+	settings.captureLatencyMillis = 300;
+	while (static_cast<int>(mSimulators.size()) < cameraCount) {
+		settings.port = FIRST_PORT + mSimulators.size();
+		settings.ssdpPort = FIRST_SSDP_PORT + mSimulators.size();
+		mSimulators.push_back(new ofxSonyRemoteCameraSimulator());
+		mSimulators.back()->start(settings);
+	}
+
+	std::vector<ofxSonyRemoteCamera::Endpoints> endpoints;
+	if (mIsDiscovery) {
+		ofxSonyRemoteCameraDiscovery::Settings discoverySettings;
+		discoverySettings.searchAddresses.clear();
+		for (int i(0); i<cameraCount; ++i) {
+			discoverySettings.searchAddresses.push_back("127.0.0.1:" + ofToString(FIRST_SSDP_PORT + i));
+		}
+		discoverySettings.expectedDevices = cameraCount;
+		std::vector<ofxSonyRemoteCameraDiscovery::Device> devices;
+		const unsigned long long startMicros(ofGetElapsedTimeMicros());
+		mDiscovery.discover(devices, discoverySettings);
+		mDiscoveryMicros = ofGetElapsedTimeMicros() - startMicros;
+		mDiscoveredCameras = devices.size();
+		mCachedCameras = 0;
+		for (size_t i(0); i<devices.size() && static_cast<int>(i)<cameraCount; ++i) {
+			if (devices[i].isCached) ++mCachedCameras;
+			endpoints.push_back(devices[i].endpoints);
+		}
+		cameraCount = endpoints.size();
+	} else {
+		for (int i(0); i<cameraCount; ++i) {
+			endpoints.push_back(ofxSonyRemoteCamera::Endpoints());
+			endpoints.back().host = mSimulators[i]->getHost();
+			endpoints.back().port = mSimulators[i]->getPort();
+		}
+	}
+
+	mpManager = new ofxSonyRemoteCameraManager();
+	ofxSonyRemoteCameraManager::Settings managerSettings;
+	managerSettings.isReactor = mIsReactor;
+	mpManager->setup(managerSettings);
+	for (int i(0); i<cameraCount; ++i) {
+		mpManager->addCamera(endpoints[i]);
+	}
+	ofAddListener(mpManager->broadcastFinished, this, &testApp::broadcastFinished);
+	ofAddListener(mpManager->scriptFinished, this, &testApp::scriptFinished);
+	if (mIsMosaic) {
+		// the mosaic replaces the decoding of the manager
+		mpMosaic = new ofxSonyRemoteCameraMosaic();
+		for (int i(0); i<cameraCount; ++i) {
+			mpMosaic->addCamera(mpManager->getCamera(i));
+		}
+		mpMosaic->start();
+	}
+	mpManager->broadcast(new ofxSonyRemoteCameraManager::LiveViewCommand(true));
+
+	mCameraCount = cameraCount;
+	mLiveViewImages.clear();
+	mLiveViewImages.resize(cameraCount);
+	mLastBroadcastMicros = 0;
+	mLastBroadcastMaxCameraMicros = 0;
+	mLastBroadcastErrors = 0;
+	mFinishedScripts = 0;
+	mFailedScripts = 0;
+	mStartMicros = ofGetElapsedTimeMicros() - startMicros;
+}
+
+//--------------------------------------------------------------
+void testApp::stopBenchmark(){
+	if (!mpManager) return;
+	if (mpMosaic) {
+		mpMosaic->stop();
+		delete mpMosaic;
+		mpMosaic = 0;
+	}
+	ofRemoveListener(mpManager->broadcastFinished, this, &testApp::broadcastFinished);
+	ofRemoveListener(mpManager->scriptFinished, this, &testApp::scriptFinished);
+	mpManager->exit();
+	delete mpManager;
+	mpManager = 0;
+}
+
+//--------------------------------------------------------------
+void testApp::startSweep(){
+	mSweepReport = "cameras,reactor,mosaic,start ms,streaming ms,streaming,threads,liveview fps,decoded fps,dropped,mean update ms,max update ms,"
+		"broadcast ms,slowest camera ms,broadcast errors\n";
+	mSweepIndex = 0;
+	startBenchmark(CAMERA_COUNTS[mSweepIndex]);
+	mSweepPhase = SWEEP_STREAMING;
+	mSweepPhaseMillis = ofGetElapsedTimeMillis();
+}
+
+//--------------------------------------------------------------
+void testApp::updateSweep(){
+	if (!mpManager) return;
+	const unsigned long long elapsedMillis(ofGetElapsedTimeMillis() - mSweepPhaseMillis);
+	ofxSonyRemoteCameraManager::Health health;
+	switch (mSweepPhase) {
+	case SWEEP_STREAMING:
+		mpManager->getHealth(health);
+		if (health.streaming < mCameraCount && elapsedMillis < SWEEP_STREAMING_TIMEOUT) return;
+		mSweepStreamingMillis = elapsedMillis;
+		mSweepDecodedFrames = health.decodedFrames;
+		mSweepMaxUpdateMillis = 0;
+		mSweepTotalUpdateMillis = 0;
+		mSweepUpdates = 0;
+		mSweepPhase = SWEEP_MEASURING;
+		mSweepPhaseMillis = ofGetElapsedTimeMillis();
+		break;
+	case SWEEP_MEASURING:
+		// of the previous update()
+		mSweepMaxUpdateMillis = std::max(mSweepMaxUpdateMillis, mUpdateMillis);
+		mSweepTotalUpdateMillis += mUpdateMillis;
+		++mSweepUpdates;
+		if (elapsedMillis < SWEEP_MEASURING_MILLIS) return;
+		mpManager->getHealth(health);
+		mSweepReport += ofToString(mCameraCount) + "," + ofToString(mIsReactor) + "," + ofToString(mIsMosaic) + "," + ofToString(mStartMicros / 1000.0, 1) + ","
+			+ ofToString(mSweepStreamingMillis) + "," + ofToString(health.streaming) + "," + ofToString(health.threads) + "," + ofToString(health.liveViewFps, 1) + ","
+			+ ofToString((health.decodedFrames - mSweepDecodedFrames) * 1000.0f / elapsedMillis, 1) + "," + ofToString(health.droppedFrames) + ","
+			+ ofToString(mSweepTotalUpdateMillis / std::max(1, mSweepUpdates), 2) + "," + ofToString(mSweepMaxUpdateMillis, 2) + ",";
+		mIsSweepBroadcastFinished = false;
+		mSweepBroadcastId = mpManager->broadcast(new ofxSonyRemoteCameraManager::TakePictureCommand());
+		mSweepPhase = SWEEP_BROADCAST;
+		mSweepPhaseMillis = ofGetElapsedTimeMillis();
+		break;
+	case SWEEP_BROADCAST:
+		if (!mIsSweepBroadcastFinished && elapsedMillis < SWEEP_BROADCAST_TIMEOUT) return;
+		if (mIsSweepBroadcastFinished) {
+			mSweepReport += ofToString(mLastBroadcastMicros / 1000.0, 1) + "," + ofToString(mLastBroadcastMaxCameraMicros / 1000.0, 1) + ","
+				+ ofToString(mLastBroadcastErrors) + "\n";
+		} else {
+			mSweepReport += "timeout,timeout," + ofToString(mCameraCount) + "\n";
+		}
+		if (++mSweepIndex < CAMERA_COUNT_NUM) {
+			startBenchmark(CAMERA_COUNTS[mSweepIndex]);
+			mSweepPhase = SWEEP_STREAMING;
+			mSweepPhaseMillis = ofGetElapsedTimeMillis();
+			break;
+		}
+		{
+			std::ofstream file(ofToDataPath(SWEEP_FILE).c_str());
+			file << mSweepReport;
+		}
+		std::cout << mSweepReport << std::endl;
+		mSweepPhase = SWEEP_OFF;
+		break;
+	default:
+		break;
+	}
+}
+
+//--------------------------------------------------------------
+void testApp::update(){
+	if (mSweepPhase != SWEEP_OFF) updateSweep();
+	if (!mpManager) return;
+	const unsigned long long startMicros(ofGetElapsedTimeMicros());
+	mpManager->update();
+	if (mpMosaic) {
+		if (mpMosaic->isFrameNew()) {
+			mpMosaic->getFrame(mMosaicImage.getPixelsRef());
+			mMosaicImage.update();
+		}
+		mUpdateMillis = (ofGetElapsedTimeMicros() - startMicros) / 1000.0f;
+		return;
+	}
+	for (int i(0); i<mCameraCount; ++i) {
+		ofxSonyRemoteCamera& camera(mpManager->getCamera(i));
+		if (!camera.isLiveViewFrameNew()) continue;
+		int timestamp(0);
+		camera.getLiveViewImage(mLiveViewImages[i].getPixelsRef(), timestamp);
+		mLiveViewImages[i].update();
+	}
+	mUpdateMillis = (ofGetElapsedTimeMicros() - startMicros) / 1000.0f;
+}
+
+//--------------------------------------------------------------
+void testApp::draw(){
+	ofBackground(0);
+	if (!mpManager) return;
+
+	// thumbnails in a square grid
+	const int columns(static_cast<int>(ceil(sqrt(static_cast<float>(mCameraCount)))));
+	const float width(ofGetWidth() / static_cast<float>(columns));
+	const float height(width * 9 / 16);
+	ofSetColor(255);
+	if (mpMosaic && mMosaicImage.isAllocated()) {
+		mMosaicImage.draw(0, 0, ofGetWidth(), ofGetWidth() * mMosaicImage.getHeight() / mMosaicImage.getWidth());
+	}
+	for (int i(0); i<mCameraCount && !mpMosaic; ++i) {
+		if (!mLiveViewImages[i].isAllocated()) continue;
+		mLiveViewImages[i].draw((i % columns) * width, (i / columns) * height, width, height);
+	}
+
+	ofxSonyRemoteCameraManager::Health health;
+	mpManager->getHealth(health);
+	std::string text;
+	if (mpMosaic) {
+		ofxSonyRemoteCameraMosaic::Stats mosaicStats;
+		mpMosaic->getStats(mosaicStats);
+		text += "mosaic (m): " + ofToString(mosaicStats.frames) + " frames, tick " + ofToString(mosaicStats.lastTickMicros / 1000.0, 2) + " ms, slowest "
+			+ ofToString(mosaicStats.maxTickMicros / 1000.0, 2) + " ms, late " + ofToString(mosaicStats.lateTicks) + "\n";
+	} else {
+		text += "mosaic (m): off\n";
+	}
+	if (mIsDiscovery) {
+		text += "discovery (d): " + ofToString(mDiscoveredCameras) + " cameras in " + ofToString(mDiscoveryMicros / 1000.0, 1) + " ms, "
+			+ ofToString(mCachedCameras) + " from the cache\n";
+	} else {
+		text += "discovery (d): off\n";
+	}
+	if (mSweepPhase != SWEEP_OFF) {
+		text += "sweep (a): " + ofToString(mCameraCount) + " cameras, " + (mSweepPhase == SWEEP_STREAMING ? "starting" : mSweepPhase == SWEEP_MEASURING ? "measuring" : "broadcasting") + "\n";
+	} else {
+		text += "sweep (a): off, the last one is in data/" + std::string(SWEEP_FILE) + "\n";
+	}
+	text += "cameras: " + ofToString(health.cameras) + " (keys 1-7, started in " + ofToString(mStartMicros / 1000.0, 1) + " ms), healthy: " + ofToString(health.healthy) + ", streaming: " + ofToString(health.streaming) + "\n";
+	text += "threads: " + ofToString(health.threads) + ", pending commands: " + ofToString(health.pendingCommands) + "\n";
+	if (mIsReactor) {
+		const ofxSonyRemoteCameraReactor::Stats& reactor(health.reactorStats);
+		text += "reactor (r): " + ofToString(reactor.connections) + " sockets, " + ofToString(reactor.loops) + " loops, slowest " + ofToString(reactor.maxLoopMicros / 1000.0, 2)
+			+ " ms, " + ofToString(reactor.reconnects) + " reconnects\n";
+	} else {
+		text += "reactor (r): off\n";
+	}
+	text += "liveview: " + ofToString(health.liveViewFps, 1) + " fps total, decoded " + ofToString(health.decodedFrames) + ", dropped " + ofToString(health.droppedFrames) + "\n";
+	text += "update: " + ofToString(mUpdateMillis, 2) + " ms, app: " + ofToString(ofGetFrameRate(), 1) + " fps\n";
+	text += "last broadcast (t, z): " + ofToString(mLastBroadcastMicros / 1000) + " ms, slowest camera " + ofToString(mLastBroadcastMaxCameraMicros / 1000)
+		+ " ms, errors " + ofToString(mLastBroadcastErrors) + "\n";
+	text += "last trigger (s): send spread " + ofToString(mLastTriggerSendSpreadMicros) + " us, ack spread " + ofToString(mLastTriggerAckSpreadMicros / 1000.0, 2)
+		+ " ms, errors " + ofToString(mLastTriggerErrors) + "\n";
+	text += "scripts (c): " + ofToString(mpManager->getRunningScriptCount()) + " running, " + ofToString(mFinishedScripts) + " finished, "
+		+ ofToString(mFailedScripts) + " failed\n";
+	for (std::map<std::string, ofxSonyRemoteCamera::MethodStats>::iterator it=health.methodStats.begin(); it!=health.methodStats.end(); ++it) {
+		const ofxSonyRemoteCamera::MethodStats& stats(it->second);
+		if (stats.calls == 0) continue;
+		text += it->first + ": " + ofToString(stats.calls) + " calls, " + ofToString(stats.totalRoundTripMicros / stats.calls / 1000.0, 1) + " ms, "
+			+ ofToString(stats.errors) + " errors\n";
+	}
+	ofDrawBitmapStringHighlight(text, 10, 20);
+}
+
+//--------------------------------------------------------------
+void testApp::keyPressed(int key){
+	if (key == 'a') {
+		startSweep();
+		return;
+	}
+	mSweepPhase = SWEEP_OFF;
+	if ('1' <= key && key < '1' + CAMERA_COUNT_NUM) {
+		startBenchmark(CAMERA_COUNTS[key - '1']);
+	} else if (key == 'r') {
+		mIsReactor = !mIsReactor;
+		startBenchmark(mCameraCount > 0 ? mCameraCount : CAMERA_COUNTS[0]);
+	} else if (key == 'd') {
+		mIsDiscovery = !mIsDiscovery;
+		startBenchmark(mCameraCount > 0 ? mCameraCount : CAMERA_COUNTS[0]);
+	} else if (key == 'm') {
+		mIsMosaic = !mIsMosaic;
+		startBenchmark(mCameraCount > 0 ? mCameraCount : CAMERA_COUNTS[0]);
+	} else if (key == 's' && mpManager) {
+		ofxSonyRemoteCameraManager::TriggerResult result;
+		mpManager->trigger(ofxSonyRemoteCamera::TRIGGER_TAKE_PICTURE, result);
+		mLastTriggerSendSpreadMicros = result.sendSpreadMicros;
+		mLastTriggerAckSpreadMicros = result.ackSpreadMicros;
+		mLastTriggerErrors = 0;
+		for (size_t i(0); i<result.errors.size(); ++i) {
+			if (result.errors[i] != ofxSonyRemoteCamera::SRC_OK) ++mLastTriggerErrors;
+		}
+	} else if (key == 'c' && mpManager) {
+		// zoom in, take a burst and zoom back out on every camera, all waiting without a thread
+		for (int i(0); i<mCameraCount; ++i) {
+			ofxSonyRemoteCameraScript* pScript(new ofxSonyRemoteCameraScript());
+			pScript->then(new ofxSonyRemoteCameraScript::ZoomStep(50))
+				.then(new ofxSonyRemoteCameraScript::TakePictureStep(3, 500))
+				.then(new ofxSonyRemoteCameraScript::WaitStep(1000))
+				.then(new ofxSonyRemoteCameraScript::ZoomStep(0));
+			mpManager->runScript(i, pScript);
+		}
+	} else if (key == 't' && mpManager) {
+		mpManager->broadcast(new ofxSonyRemoteCameraManager::TakePictureCommand());
+	} else if (key == 'z' && mpManager) {
+		std::vector<int> cameraIndices;
+		for (int i(0); i<mCameraCount; i+=2) {
+			cameraIndices.push_back(i);
+		}
+		mpManager->broadcast(new ofxSonyRemoteCameraManager::ZoomCommand("in", "1shot"), cameraIndices);
+	}
+}
+
+//--------------------------------------------------------------
+void testApp::broadcastFinished(ofxSonyRemoteCameraManager::BroadcastResult& result){
+	if (result.id == mSweepBroadcastId) mIsSweepBroadcastFinished = true;
+	mLastBroadcastMicros = result.totalMicros;
+	mLastBroadcastMaxCameraMicros = 0;
+	mLastBroadcastErrors = 0;
+	for (size_t i(0); i<result.errors.size(); ++i) {
+		mLastBroadcastMaxCameraMicros = std::max(mLastBroadcastMaxCameraMicros, result.elapsedMicros[i]);
+		if (result.errors[i] != ofxSonyRemoteCamera::SRC_OK) ++mLastBroadcastErrors;
+	}
+}
+
+//--------------------------------------------------------------
+void testApp::scriptFinished(ofxSonyRemoteCameraManager::ScriptResult& result){
+	++mFinishedScripts;
+	if (result.err != ofxSonyRemoteCamera::SRC_OK) ++mFailedScripts;
+}
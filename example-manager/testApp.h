@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxSonyRemoteCameraManager.h"
+#include "ofxSonyRemoteCameraDiscovery.h"
+#include "ofxSonyRemoteCameraMosaic.h"
+#include "ofxSonyRemoteCameraSimulator.h"
+
+/*!
+ * Benchmark of ofxSonyRemoteCameraManager with 1 to 64 simulated cameras on localhost.
+ */
+class testApp : public ofBaseApp{
+public:
+	enum SweepPhase
+	{
+		SWEEP_OFF,
+		SWEEP_STREAMING,	//!< waiting until every camera streams
+		SWEEP_MEASURING,	//!< liveview and update times of a fixed period
+		SWEEP_BROADCAST,	//!< waiting for actTakePicture on all cameras
+	};
+
+	void setup();
+	void exit();
+	void update();
+	void draw();
+
+	void keyPressed(int key);
+
+	// my callback func.
+	void broadcastFinished(ofxSonyRemoteCameraManager::BroadcastResult& result);
+	void scriptFinished(ofxSonyRemoteCameraManager::ScriptResult& result);
+
+	void startBenchmark(int cameraCount);
+	void stopBenchmark();
+	//! runs every camera count in turn and writes a row of each to data/manager_benchmark.csv
+	void startSweep();
+	void updateSweep();
+
+private:
+	std::vector<ofxSonyRemoteCameraSimulator*> mSimulators;
+	ofxSonyRemoteCameraManager* mpManager;
+	ofxSonyRemoteCameraMosaic* mpMosaic;
+	ofxSonyRemoteCameraDiscovery mDiscovery;
+	std::vector<ofImage> mLiveViewImages;
+	ofImage mMosaicImage;
+
+	int mCameraCount;
+	bool mIsReactor;		//!< liveview of all cameras on one thread
+	bool mIsMosaic;			//!< one composed image instead of an image per camera
+	bool mIsDiscovery;		//!< cameras are found with SSDP instead of their known ports
+	unsigned long long mDiscoveryMicros;
+	int mDiscoveredCameras;
+	int mCachedCameras;		//!< of mDiscoveredCameras
+	float mUpdateMillis;			//!< of the last update()
+	unsigned long long mLastBroadcastMicros;
+	unsigned long long mLastBroadcastMaxCameraMicros;
+	int mLastBroadcastErrors;
+	long long mLastTriggerSendSpreadMicros;
+	long long mLastTriggerAckSpreadMicros;
+	int mLastTriggerErrors;
+	int mFinishedScripts;
+	int mFailedScripts;
+	unsigned long long mStartMicros;	//!< of the last startBenchmark()
+	// sweep
+	SweepPhase mSweepPhase;
+	int mSweepIndex;				//!< of CAMERA_COUNTS
+	unsigned long long mSweepPhaseMillis;	//!< start of the phase
+	unsigned long long mSweepStreamingMillis;	//!< until every camera streamed
+	unsigned int mSweepDecodedFrames;	//!< at the start of the measuring phase
+	float mSweepMaxUpdateMillis;
+	float mSweepTotalUpdateMillis;
+	int mSweepUpdates;
+	int mSweepBroadcastId;
+	bool mIsSweepBroadcastFinished;
+	std::string mSweepReport;		//!< csv
+};
@@ -6,8 +6,6 @@
 #include "testApp.h"
 
 static const int MSG_LIST_SIZE(7);
-static const unsigned long long WAIT_TIME_OUT(5000);
-static const unsigned long long WAIT_MSG_INTERVAL(500);
 
 
 //--------------------------------------------------------------
@@ -20,49 +18,88 @@ void testApp::setup(){
 
 	mRemoteCam.setup();
 	ofAddListener(mRemoteCam.imageSizeUpdated, this, &testApp::imageSizeUpdated);
-	
-	ofxSonyRemoteCamera::SRCError err(ofxSonyRemoteCamera::SRC_OK);
-	err = mRemoteCam.startLiveView();
-	if (err != ofxSonyRemoteCamera::SRC_OK) mMsgList.push_back(getErrorMsg(err));
-	
-	// wait untill LiveViewImage packets are received
-	bool isSuccessed(true);
-	unsigned long long lastMsgTimestamp(0);
-	while (!mRemoteCam.isLiveViewFrameNew()) {
-		mRemoteCam.update();
-		const unsigned long long timestamp(ofGetElapsedTimeMillis());
-		if (timestamp - lastMsgTimestamp > WAIT_MSG_INTERVAL) {
-			std::cout << "wait untill liveview images are updated" << std::endl;
-			lastMsgTimestamp = timestamp;
-		} else if (timestamp > WAIT_TIME_OUT) {
-			std::cout << "connect server error. pleae check your Wi-Fi connection" << std::endl;
-			isSuccessed = false;
-			break;
-		}
-		ofSleepMillis(1);
-	}
+	ofAddListener(mRemoteCam.startUpFinished, this, &testApp::startUpFinished);
 
-	if (isSuccessed) {
-		err = mRemoteCam.getShootMode(mShootMode);
-		if (err != ofxSonyRemoteCamera::SRC_OK) mMsgList.push_back(getErrorMsg(err));
-	}
+	// the last 5 seconds of liveview, dumped with p
+	mPreRoll.start();
+	mRemoteCam.setLiveViewRecorder(&mPreRoll);
+	ofAddListener(mPreRoll.dumpFinished, this, &testApp::preRollDumped);
+
+	// decode scale and liveview size follow the load, toggled with a
+	mAdaptiveLiveView.setup(mRemoteCam);
+	ofAddListener(mAdaptiveLiveView.stateChanged, this, &testApp::adaptiveStateChanged);
+
+	// the files on the memory card are downloaded with c, sharing the Wi-Fi with the liveview
+	mTransfer.setup(mRemoteCam);
+	mTransfer.start();
+	ofAddListener(mTransfer.transferFinished, this, &testApp::transferFinished);
+
+	// liveview and settings are brought up in the background, see startUpFinished()
+	mShootMode = ofxSonyRemoteCamera::SHOOT_MODE_STILL;
+	mRemoteCam.beginStartUp();
 
 	mAPIType = TYPE_GET_AVAILABLE_API_LIST;
 	mIsRecording = false;
 	mIsDebug = true;
 }
 
+//--------------------------------------------------------------
+void testApp::startUpFinished(ofxSonyRemoteCamera::StartUpReport& report){
+	static const char* PHASE_NAMES[] = {"method table", "startRecMode", "startLiveview", "liveview connection", "first frame", "settings"};
+	for (int i(0); i<ofxSonyRemoteCamera::STARTUP_PHASE_NUM; ++i) {
+		std::cout << PHASE_NAMES[i] << ": " << report.beginMicros[i]/1000 << "-" << report.endMicros[i]/1000 << " ms "
+			<< mRemoteCam.getErrorString(report.errors[i]) << std::endl;
+	}
+	std::cout << "start up: " << report.totalMicros/1000 << " ms" << std::endl;
+
+	if (report.errors[ofxSonyRemoteCamera::STARTUP_FIRST_FRAME] != ofxSonyRemoteCamera::SRC_OK) {
+		std::cout << "connect server error. pleae check your Wi-Fi connection" << std::endl;
+		mMsgList.push_back(getErrorMsg(report.errors[ofxSonyRemoteCamera::STARTUP_FIRST_FRAME]));
+	}
+	if (report.settings.errors[ofxSonyRemoteCamera::SNAPSHOT_SHOOT_MODE] == ofxSonyRemoteCamera::SRC_OK) {
+		mShootMode = report.settings.shootMode;
+	} else {
+		mMsgList.push_back(getErrorMsg(report.settings.errors[ofxSonyRemoteCamera::SNAPSHOT_SHOOT_MODE]));
+	}
+}
+
+//--------------------------------------------------------------
+void testApp::preRollDumped(ofxSonyRemoteCameraPreRoll::DumpReport& report){
+	mMsgList.push_back("pre-roll: " + ofToString(report.writtenFrames) + "/" + ofToString(report.frames) + " frames in "
+		+ ofToString(report.elapsedMicros / 1000) + " ms to " + report.directory);
+}
+
+//--------------------------------------------------------------
+void testApp::adaptiveStateChanged(ofxSonyRemoteCameraAdaptiveLiveView::State& state){
+	static const char* REASON_NAMES[] = {"start", "decode", "transport", "drops", "recovered"};
+	mMsgList.push_back("adaptive liveview: 1/" + ofToString(state.decodeScale) + " " + state.liveViewSize
+		+ " (" + REASON_NAMES[state.reason] + ", " + ofToString(state.latencyMillis, 0) + " ms)");
+}
+
+//--------------------------------------------------------------
+void testApp::transferFinished(ofxSonyRemoteCameraTransfer::Report& report){
+	mMsgList.push_back("transfer: " + report.path + " " + ofToString(report.bytes) + " bytes, "
+		+ ofToString(report.bytesPerSecond / 1024.f, 0) + " KB/s " + mRemoteCam.getErrorString(report.err));
+}
+
 //--------------------------------------------------------------
 void testApp::exit(){
+	mTransfer.stop();
+	mRemoteCam.setLiveViewRecorder(0);
+	mAdaptiveLiveView.stop();
 	mRemoteCam.exit();
+	mPreRoll.stop();
 }
 
 //--------------------------------------------------------------
 void testApp::update(){
 	mRemoteCam.update();
+	mPreRoll.update();
+	mAdaptiveLiveView.update();
+	mTransfer.update();
 	if (mRemoteCam.isLiveViewFrameNew()) {
 		int timestamp(0);
-		mRemoteCam.getLiveViewImage(mLiveViewImage.getPixels(), timestamp);
+		mRemoteCam.getLiveViewImage(mLiveViewImage.getPixelsRef(), timestamp, mFrameInformation);
 		mLiveViewImage.update();
 
 		if (timestamp != mPrevTimestamp) {
@@ -82,7 +119,21 @@ void testApp::draw(){
 	const int height(ofGetHeight());
 	
 	ofSetColor(255,255,255);
-	mLiveViewImage.draw(0,0,width, width * mLiveViewImage.getHeight() / mLiveViewImage.getWidth());
+	const float liveViewHeight(width * mLiveViewImage.getHeight() / mLiveViewImage.getWidth());
+	mLiveViewImage.draw(0,0,width, liveViewHeight);
+
+	// focus and face frames of the image, on cameras which send them
+	ofPushStyle();
+	ofNoFill();
+	for (std::vector<ofxSonyRemoteCamera::FocusFrame>::const_iterator it=mFrameInformation.frames.begin(); it!=mFrameInformation.frames.end(); ++it) {
+		if (it->status == ofxSonyRemoteCamera::FOCUS_FRAME_STATUS_FOCUSED) {
+			ofSetColor(0,255,0);
+		} else {
+			ofSetColor(255,255,255);
+		}
+		ofRect(it->getRect(width, liveViewHeight));
+	}
+	ofPopStyle();
 
 	if (mIsDebug) {
 		drawDebug();
@@ -108,6 +159,17 @@ void testApp::keyPressed(int key){
 		err = mRemoteCam.getShootMode(mShootMode);
 		if (err == ofxSonyRemoteCamera::SRC_OK) msg += "Shoot Mode: " + mRemoteCam.getShootModeString(mShootMode);
 		break;
+	case 'a':
+		if (mAdaptiveLiveView.isRunning()) {
+			mAdaptiveLiveView.stop();
+			msg += "Adaptive Live View: off";
+		} else if (mAdaptiveLiveView.start()) {
+			msg += "Adaptive Live View: on";
+		}
+		break;
+	case 'c':
+		err = downloadContents(msg);
+		break;
 	case 'd':
 		mIsDebug = !mIsDebug;
 		break;
@@ -135,6 +197,9 @@ void testApp::keyPressed(int key){
 			mShootMode = ofxSonyRemoteCamera::SHOOT_MODE_STILL;
 		}
 		break;
+	case 'p':
+		if (mPreRoll.dumpPreRoll("preroll_" + ofGetTimestampString())) msg += "Dump Pre-roll";
+		break;
 	case 'q':
 		err = mRemoteCam.actZoom("in", "1shot");
 		break;
@@ -273,6 +338,28 @@ ofxSonyRemoteCamera::SRCError testApp::toggleRecording(std::string& msg)
 	return err;
 }
 
+//--------------------------------------------------------------
+ofxSonyRemoteCamera::SRCError testApp::downloadContents(std::string& msg)
+{
+	// cameras without avContent answer with an error
+	std::vector<std::string> sources;
+	ofxSonyRemoteCamera::SRCError err(mRemoteCam.getSourceList(sources));
+	if (err != ofxSonyRemoteCamera::SRC_OK) return err;
+	if (sources.empty()) {
+		msg += "No Storage";
+		return err;
+	}
+	std::vector<ofxSonyRemoteCamera::Content> contents;
+	err = mRemoteCam.listContents(sources[0], contents);
+	if (err != ofxSonyRemoteCamera::SRC_OK) return err;
+	int queued(0);
+	for (std::vector<ofxSonyRemoteCamera::Content>::const_iterator it=contents.begin(); it!=contents.end(); ++it) {
+		if (!it->isBrowsable && mTransfer.download(*it, "contents") >= 0) ++queued;
+	}
+	msg += "Download " + ofToString(queued) + " files";
+	return err;
+}
+
 //--------------------------------------------------------------
 std::string testApp::getErrorMsg(ofxSonyRemoteCamera::SRCError err)
 {
@@ -346,7 +433,7 @@ void testApp::drawDebug()
 		ofDrawBitmapString(
 			"ESC: exit" ", 1: startLiveView" ", 2: stopLiveView, 3: getShootMode , \n"
 			"d: show/hide debug info, f: toggleFullScreen" ", i: setShootMode IntervalStill" ", m: setShootMode Movie" ", s: setShootMode Still\n"
-			"space: toggle recording, up/down: select, q: zoom in, w: zoom out \n"
+			"space: toggle recording, up/down: select, q: zoom in, w: zoom out, p: dump pre-roll, c: download contents \n"
 			, 0, height - 40);
 		// draw msg
 		ofSetColor(0,0,0,150);
@@ -2,6 +2,9 @@
 
 #include "ofMain.h"
 #include "ofxSonyRemoteCamera.h"
+#include "ofxSonyRemoteCameraPreRoll.h"
+#include "ofxSonyRemoteCameraAdaptiveLiveView.h"
+#include "ofxSonyRemoteCameraTransfer.h"
 
 class testApp : public ofBaseApp{
 public:
@@ -46,9 +49,14 @@ public:
 
 	// my callback func.
 	void imageSizeUpdated(ofxSonyRemoteCamera::ImageSize& size);
+	void startUpFinished(ofxSonyRemoteCamera::StartUpReport& report);
+	void preRollDumped(ofxSonyRemoteCameraPreRoll::DumpReport& report);
+	void adaptiveStateChanged(ofxSonyRemoteCameraAdaptiveLiveView::State& state);
+	void transferFinished(ofxSonyRemoteCameraTransfer::Report& report);
 
 	// 
 	ofxSonyRemoteCamera::SRCError toggleRecording(std::string& msg);
+	ofxSonyRemoteCamera::SRCError downloadContents(std::string& msg);
 	std::string getErrorMsg(ofxSonyRemoteCamera::SRCError err);
 
 	void drawDebug();
@@ -58,8 +66,12 @@ public:
 	
 private:
 	ofxSonyRemoteCamera mRemoteCam;
+	ofxSonyRemoteCameraPreRoll mPreRoll;
+	ofxSonyRemoteCameraAdaptiveLiveView mAdaptiveLiveView;
+	ofxSonyRemoteCameraTransfer mTransfer;
 	ofxSonyRemoteCamera::ShootMode mShootMode;
 	ofImage mLiveViewImage;
+	ofxSonyRemoteCamera::FrameInformation mFrameInformation;	//!< of mLiveViewImage
 
 	std::list<std::string> mMsgList;
 	int mPrevTimestamp;
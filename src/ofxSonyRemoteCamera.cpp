@@ -3,55 +3,167 @@
 //  Created by Osamu Shigeta on 9/12/2013.
 //
 #include "ofxSonyRemoteCamera.h"
+#include "ofxSonyRemoteCameraReactor.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <limits>
 
-static const std::string VERSION("1.0");
 static const std::string ACTION_LIST_URL("sony");
 static const std::string SERVICE_TYPE_CAMERA("camera");
 static const std::string SERVICE_TYPE_GUIDE("guide");
 static const  std::string SERVICE_TYPE_ACCESS_CONTROL("accessControl");
+static const std::string SERVICE_TYPE_AV_CONTENT("avContent");
 static const int DEFAULT_ID(1);
 static const int COMMON_HEADER_SIZE(1+1+2+4);
 static const int PAYLOAD_HEADER_SIZE(4+3+1+4+1+115);
 static const BYTE COMMON_HEADER_START_BYTE(0xff);
 static const BYTE PAYLOAD_HEADER_START_BYTES[] = {0x24, 0x35, 0x68, 0x79};
+static const int FOCUS_FRAME_MIN_SIZE(2+2+2+2+1+1+1);
+static const size_t FRAME_INFORMATION_HISTORY(8);	//!< images and unmatched frame information kept
+static const int EVENT_POLLING_RETRY_INTERVAL(1000);	//!< ms
+static const int DEFAULT_SNAPSHOT_CONCURRENCY(4);
+static const std::string DEFAULT_CAPABILITY_CACHE_DIRECTORY("ofxSonyRemoteCamera");
+static const unsigned long long STARTUP_FIRST_FRAME_TIMEOUT(5000);	//!< ms
+static const unsigned long long DEFAULT_TIMEOUT(10000);	//!< ms
+static const unsigned long long TAKE_PICTURE_TIMEOUT(30000);	//!< ms
+static const unsigned long long EVENT_TIMEOUT(70000);	//!< ms, long enough for getEvent with polling=true
+static const size_t POSTVIEW_CHUNK_SIZE(16*1024);
+static const int MAX_AWAIT_CALLS(10);
+static const long BURST_NOT_READY_WAIT(100);	//!< ms before a shot is sent again after SRC_ERROR_CAMERA_NOT_READY
+static const int MAX_BURST_NOT_READY(20);	//!< in a row, then the shot fails
+static const int MAX_CONTENT_LIST_COUNT(100);	//!< of one getContentList
+static const int LATENCY_PROBES(3);
+static const int INTERVAL_LATENCY_PROBE_PERIOD(10);	//!< shots between latency measurements
+static const float INTERVAL_LATENCY_SMOOTHING(0.3f);
+static const float ZOOM_DEFAULT_SPEED(25.0f);	//!< positions per second
+static const float ZOOM_SMOOTHING(0.3f);
+static const int ZOOM_MIN_CONTINUOUS_DISTANCE(5);
+static const long ZOOM_SETTLE_WINDOW(300);	//!< ms without a position change
+static const int ZOOM_MAX_REVERSALS(4);
+static const int ZOOM_MAX_STUCK_STEPS(3);
 //static const unsigned long long SESSION_TIMEOUT(5000*1000);	//!< ms
 
+const char* ofxSonyRemoteCamera::VERSION("1.0");
+
 ofxSonyRemoteCamera::ofxSonyRemoteCamera()	
-{
+	: mLiveViewFrameCount(0)
+	, mpLiveViewDecoder(0)
+	, mpLiveViewRecorder(0)
+	, mDefaultTimeout(DEFAULT_TIMEOUT)
+	, mCapabilityCacheDirectory(DEFAULT_CAPABILITY_CACHE_DIRECTORY)
+	, mNextSnapshotField(0)
+	, mSnapshotConcurrency(DEFAULT_SNAPSHOT_CONCURRENCY)
+	, mIsPostViewRunning(false)
+	, mNextCaptureId(0)
+	, mBurstNotReadyInRow(0)
+	, mBurstStartedShots(0)
+	, mBurstInFlight(0)
+	, mBurstRunningWorkers(0)
+	, mIsBurstStopping(false)
+	, mIsBurstFinished(false)
+	, mIntervalRunnable(*this, &ofxSonyRemoteCamera::runIntervalCapture)
+	, mIntervalTotalAbsErrorMicros(0)
+	, mIsIntervalRunning(false)
+	, mIsIntervalStopping(false)
+	, mIsIntervalFinished(false)
+	, mZoomRunnable(*this, &ofxSonyRemoteCamera::runZoom)
+	, mZoomSpeed(ZOOM_DEFAULT_SPEED)
+	, mIsZoomRunning(false)
+	, mIsZoomStopping(false)
+	, mIsZoomFinished(false)
+	, mpTriggerMethodName(0)
+	, mStartUpRunnable(*this, &ofxSonyRemoteCamera::runStartUp)
+	, mStartUpSettingsRunnable(*this, &ofxSonyRemoteCamera::runStartUpSettings)
+	, mIsStartUpFinished(false)
+	, mEventPoller(*this)
+	, mpReactor(0)
+	, mIsReactorEventPolling(false)
+	, mChangedStateFields(0)
+{
+	mMethodTimeouts[method::actTakePicture::name()] = TAKE_PICTURE_TIMEOUT;
+	mMethodTimeouts[method::awaitTakePicture::name()] = TAKE_PICTURE_TIMEOUT;
+	mMethodTimeouts[method::getEvent::name()] = EVENT_TIMEOUT;
+
+	// exceptions of the get*, set* and act* naming
+	mMethodIdempotency[method::getEvent::name()] = false;
+	mMethodIdempotency[method::awaitTakePicture::name()] = true;
+	mMethodIdempotency[method::startRecMode::name()] = true;
+	mMethodIdempotency[method::stopRecMode::name()] = true;
+	mMethodIdempotency[method::startLiveview::name()] = true;
+	mMethodIdempotency[method::stopLiveview::name()] = true;
+	mMethodIdempotency[method::startLiveviewWithSize::name()] = true;
 }
 
 ofxSonyRemoteCamera::~ofxSonyRemoteCamera()
 {
 	exit();
+	for (std::vector<Channel*>::iterator it=mChannels.begin(); it!=mChannels.end(); ++it) {
+		delete *it;
+	}
 }
 
 bool ofxSonyRemoteCamera::setup( const std::string& host/*="10.0.0.1"*/, int port/*=10000*/ )
 {
-	mHost = host;
-	mPort = port;
+	Endpoints endpoints;
+	endpoints.host = host;
+	endpoints.port = port;
+	return setup(endpoints);
+}
+
+bool ofxSonyRemoteCamera::setup(const Endpoints& endpoints)
+{
+	mHost = endpoints.host;
+	mPort = endpoints.port;
 	mId = DEFAULT_ID;
 	mIsLiveViewStreaming = false;
 	mIsVerbose = true;
 	mLiveViewTimestamp = 0;
 	mLastLiveViewTimestamp = 0;
+	mLiveViewFrameId = -1;
 	mpLiveViewStream = 0;
 	mIsImageSizeUpdated = false;
+	setSettingsCacheMaxAge(0);
+	invalidateSettingsCache();
+	stopEventPolling();
+	mCameraState = CameraState();
+	mLastEventArena.clear();
+	mChangedStateFields = 0;
 
 	mSession.reset();
 	mSession.setHost(mHost);
-	mSession.setPort(port);
+	mSession.setPort(mPort);
 	mSession.setKeepAlive(true);
+	resetChannels();
 
-	mSessionCameraPath = "/" + ACTION_LIST_URL + "/" + SERVICE_TYPE_CAMERA;
-	mSessionGuidePath =  "/" + ACTION_LIST_URL + "/" + SERVICE_TYPE_GUIDE;
-	mSessionAccessControlPath =  "/" + ACTION_LIST_URL + "/" + SERVICE_TYPE_ACCESS_CONTROL;
+	mSessionCameraPath = endpoints.cameraPath.empty() ? "/" + ACTION_LIST_URL + "/" + SERVICE_TYPE_CAMERA : endpoints.cameraPath;
+	mSessionGuidePath = endpoints.guidePath.empty() ? "/" + ACTION_LIST_URL + "/" + SERVICE_TYPE_GUIDE : endpoints.guidePath;
+	mSessionAccessControlPath = endpoints.accessControlPath.empty() ? "/" + ACTION_LIST_URL + "/" + SERVICE_TYPE_ACCESS_CONTROL : endpoints.accessControlPath;
+	mSessionAvContentPath = endpoints.avContentPath.empty() ? "/" + ACTION_LIST_URL + "/" + SERVICE_TYPE_AV_CONTENT : endpoints.avContentPath;
+
+	{
+		ofMutex::ScopedLock capabilityLock(mCapabilityMutex);
+		mCapabilities = Capabilities();
+	}
 	return true;
 }
 
 void ofxSonyRemoteCamera::exit()
 {
+	waitForStartUp();
+	stopBurst();
+	stopIntervalCapture();
+	stopZoom();
+	stopPostViewWorkers();
+	stopEventPolling();
 	stopLiveView();
 	mSession.reset();
+	mTriggerChannel.session.reset();
+	ofMutex::ScopedLock snapshotRunLock(mSnapshotRunMutex);
+	for (std::vector<Channel*>::iterator it=mChannels.begin(); it!=mChannels.end(); ++it) {
+		(*it)->session.reset();
+	}
 }
 
 void ofxSonyRemoteCamera::update()
@@ -72,43 +184,162 @@ void ofxSonyRemoteCamera::update()
 		unlock();
 	}
 	*/
+	notifyCameraStateChanges();
+
+	StartUpReport report;
+	bool isStartUpFinished(false);
+	{
+		ofMutex::ScopedLock startUpLock(mStartUpMutex);
+		if (mIsStartUpFinished) {
+			report = mStartUpReport;
+			isStartUpFinished = true;
+			mIsStartUpFinished = false;
+		}
+	}
+	if (isStartUpFinished) ofNotifyEvent(startUpFinished, report);
+
+	BurstReport burstReport;
+	bool isBurstFinished(false);
+	{
+		ofMutex::ScopedLock burstLock(mBurstMutex);
+		if (mIsBurstFinished) {
+			burstReport = mBurstReport;
+			isBurstFinished = true;
+			mIsBurstFinished = false;
+		}
+	}
+	if (isBurstFinished) {
+		joinBurstWorkers();
+		ofNotifyEvent(burstFinished, burstReport);
+	}
+
+	std::deque<IntervalShot> intervalShots;
+	IntervalReport intervalReport;
+	bool isIntervalFinished(false);
+	{
+		ofMutex::ScopedLock intervalLock(mIntervalMutex);
+		intervalShots.swap(mIntervalShots);
+		if (mIsIntervalFinished) {
+			intervalReport = mIntervalReport;
+			isIntervalFinished = true;
+			mIsIntervalFinished = false;
+		}
+	}
+	for (std::deque<IntervalShot>::iterator it=intervalShots.begin(); it!=intervalShots.end(); ++it) {
+		ofNotifyEvent(intervalShotTaken, *it);
+	}
+	if (isIntervalFinished) ofNotifyEvent(intervalCaptureFinished, intervalReport);
+
+	ZoomReport zoomReport;
+	bool isZoomFinished(false);
+	{
+		ofMutex::ScopedLock zoomLock(mZoomMutex);
+		if (mIsZoomFinished) {
+			zoomReport = mZoomReport;
+			isZoomFinished = true;
+			mIsZoomFinished = false;
+		}
+	}
+	if (isZoomFinished) ofNotifyEvent(zoomFinished, zoomReport);
+
+	notifyPostViews();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Start up
+//////////////////////////////////////////////////////////////////////////
+bool ofxSonyRemoteCamera::beginStartUp()
+{
+	if (mStartUpThread.isRunning()) return false;
+	waitForStartUp();
+	{
+		ofMutex::ScopedLock startUpLock(mStartUpMutex);
+		mStartUpReport = StartUpReport();
+		mStartUpTime.update();
+		mIsStartUpFinished = false;
+	}
+	mStartUpThread.start(mStartUpRunnable);
+	return true;
+}
+
+bool ofxSonyRemoteCamera::isStartUpRunning()
+{
+	return mStartUpThread.isRunning();
+}
+
+void ofxSonyRemoteCamera::waitForStartUp()
+{
+	mStartUpThread.join();
+}
+
+void ofxSonyRemoteCamera::getStartUpReport(StartUpReport& report)
+{
+	ofMutex::ScopedLock startUpLock(mStartUpMutex);
+	report = mStartUpReport;
 }
 
 //////////////////////////////////////////////////////////////////////////
 // LiveViewAPIs
 //////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCamera::setReactor(ofxSonyRemoteCameraReactor* pReactor)
+{
+	stopEventPolling();
+	if (mpReactor) {
+		mpReactor->closeLiveView(*this);
+		mIsLiveViewStreaming = false;
+	}
+	mpReactor = pReactor;
+}
+
 ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::startLiveView()
 {
-	waitForThread();
-	mIsLiveViewStreaming = false;
-	closeLiveViewSession();
+	std::string url;
+	SRCError err(requestLiveView(url));
+	if (err != SRC_OK) return err;
+	return connectLiveView(url);
+}
 
-	const std::string json(httpPost(createJson("startLiveview"), mSessionCameraPath));
-	SRCError err(checkError(json));
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::startLiveViewWithSize(const std::string& size)
+{
+	std::string url;
+	SRCError err(requestLiveView(url, size.c_str()));
 	if (err != SRC_OK) return err;
+	return connectLiveView(url);
+}
 
-	Poco::URI uri;
-	picojson::array resultArray;
-	if (getJsonResultArray(resultArray, json)) {
-		uri = resultArray[0].get<std::string>();
-	}
-	mLiveViewPath = uri.getPathAndQuery();
-	if (!openLiveViewSession(uri.getHost(), uri.getPort())) {
-		return SRC_ERROR_UNKNOWN;;
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSupportedLiveViewSize(std::vector<std::string>& sizes)
+{
+	// result is [["L","M"]]
+	sizes.clear();
+	Response response;
+	SRCError err(invoke<method::getSupportedLiveviewSize>(response));
+	if (err != SRC_OK) return err;
+	const picojson::array& resultArray(response.getResultArray());
+	if (resultArray.empty() || !resultArray[0].is<picojson::array>()) return SRC_ERROR_ILLEGAL_RESPONSE;
+	const picojson::array& values(resultArray[0].get<picojson::array>());
+	for (picojson::array::const_iterator it=values.begin(); it!=values.end(); ++it) {
+		if (it->is<std::string>()) sizes.push_back(it->get<std::string>());
 	}
-	mIsLiveViewStreaming = true;
-	startThread();
 	return SRC_OK;
 }
 
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getLiveViewSize(std::string& size)
+{
+	Response response;
+	SRCError err(invoke<method::getLiveviewSize>(response));
+	if (err != SRC_OK) return err;
+	return response.getString(0, size) ? SRC_OK : SRC_ERROR_ILLEGAL_RESPONSE;
+}
+
 ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::stopLiveView()
 {
 	waitForThread();
+	if (mpReactor) mpReactor->closeLiveView(*this);
 	mIsLiveViewStreaming = false;
 	closeLiveViewSession();
 
-	const std::string json(httpPost(createJson("stopLiveview"), mSessionCameraPath));
-	return checkError(json);
+	Response response;
+	return invoke<method::stopLiveview>(response);
 }
 
 bool ofxSonyRemoteCamera::isLiveViewFrameNew()
@@ -153,6 +384,26 @@ void ofxSonyRemoteCamera::getLiveViewImage( ofPixels& pixels, int& timestamp )
 	}
 }
 
+void ofxSonyRemoteCamera::getLiveViewImage(ofPixels& pixels, int& timestamp, FrameInformation& information)
+{
+	if (lock()) {
+		timestamp = mCommonHeader.timestamp;
+		pixels = mLiveViewPixels;
+		information = mLiveViewFrameInformation;
+		unlock();
+	} else if (mIsVerbose) {
+		std::cout << "cannot lock" << std::endl;
+	}
+}
+
+void ofxSonyRemoteCamera::getLiveViewFrameInformation(FrameInformation& information)
+{
+	if (lock()) {
+		information = mLiveViewFrameInformation;
+		unlock();
+	}
+}
+
 int ofxSonyRemoteCamera::getLiveViewImageWidth() const
 {
 	return mLiveViewPixels.getWidth();
@@ -171,673 +422,3356 @@ void ofxSonyRemoteCamera::getCommonHeader(CommonHeader& header)
 	}
 }
 
-void ofxSonyRemoteCamera::getPayloadHeader(PayloadHeader& header)
+unsigned int ofxSonyRemoteCamera::getLiveViewFrameCount()
 {
+	unsigned int count(0);
 	if (lock()) {
-		header = mPayloadHeader;
+		count = mLiveViewFrameCount;
 		unlock();
 	}
+	return count;
 }
-//////////////////////////////////////////////////////////////////////////
-// Still Capture
-//////////////////////////////////////////////////////////////////////////
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::actTakePicture()
+
+void ofxSonyRemoteCamera::setLiveViewDecoder(LiveViewDecoder* pDecoder)
 {
-	const std::string json(httpPost(createJson("actTakePicture"), mSessionCameraPath));
-	picojson::array resultArray;
-	if (getJsonResultArray(resultArray, json)) {
-		mPostViewPath = resultArray[0].get<std::string>();
+	if (lock()) {
+		mpLiveViewDecoder = pDecoder;
+		unlock();
 	}
-	return checkError(json);
-	/*
-	httpPostAsync(createJson("actTakePicture"), mSessionCameraPath);
-	return SRC_OK;
-	*/
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::awaitTakePicture()
+ofxSonyRemoteCamera::LiveViewDecoder* ofxSonyRemoteCamera::getLiveViewDecoder()
 {
-	const std::string json(httpPost(createJson("awaitTakePicture"), mSessionCameraPath));
-	return checkError(json);	
+	LiveViewDecoder* pDecoder(0);
+	if (lock()) {
+		pDecoder = mpLiveViewDecoder;
+		unlock();
+	}
+	return pDecoder;
 }
-//////////////////////////////////////////////////////////////////////////
-// Movie recording
-//////////////////////////////////////////////////////////////////////////
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::startMovieRec()
+
+void ofxSonyRemoteCamera::setLiveViewRecorder(LiveViewRecorder* pRecorder)
 {
-	const std::string json(httpPost(createJson("startMovieRec"), mSessionCameraPath));
-	return checkError(json);
+	if (lock()) {
+		mpLiveViewRecorder = pRecorder;
+		unlock();
+	}
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::stopMovieRec()
+void ofxSonyRemoteCamera::setLiveViewFrame(ofPixels& pixels, int timestamp, int frameId)
 {
-	const std::string json(httpPost(createJson("stopMovieRec"), mSessionCameraPath));
-	return checkError(json);	
+	if (lock()) {
+		mLiveViewPixels.swap(pixels);
+		mLiveViewTimestamp = timestamp;
+		publishFrameInformation(frameId);
+		if ( (mLiveViewPixels.getWidth() != mImageSize.width) || (mLiveViewPixels.getHeight() != mImageSize.height)) {
+			mImageSize.width = mLiveViewPixels.getWidth();
+			mImageSize.height = mLiveViewPixels.getHeight();
+			mIsImageSizeUpdated = true;
+		}
+		unlock();
+	}
 }
-//////////////////////////////////////////////////////////////////////////
-// Zoom
-//////////////////////////////////////////////////////////////////////////
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::actZoom(const std::string& direction, const std::string& movement)
+
+void ofxSonyRemoteCamera::getPayloadHeader(PayloadHeader& header)
 {
-	std::vector<picojson::value> params(2);
-	params[0] = static_cast<picojson::value>(static_cast<std::string>(direction));
-	params[1] = static_cast<picojson::value>(static_cast<std::string>(movement));
-	
-	const std::string json(httpPost(createJson("actZoom", params), mSessionCameraPath));
-	return checkError(json);
-	/*
-	httpPostAsync(createJson("actZoom", params), mSessionCameraPath);
-	return SRC_OK;
-	*/
+	if (lock()) {
+		header = mPayloadHeader;
+		unlock();
+	}
 }
 //////////////////////////////////////////////////////////////////////////
-// Self-timer
+// Event polling
 //////////////////////////////////////////////////////////////////////////
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSupportedSelfTimer( std::string& json )
+bool ofxSonyRemoteCamera::startEventPolling()
 {
-	json = httpPost(createJson("getSupportedSelfTimer"), mSessionCameraPath);
-	return checkError(json);
+	if (isEventPolling()) return true;
+	if (mpReactor) {
+		mIsReactorEventPolling = mpReactor->openEventPolling(*this);
+		return mIsReactorEventPolling;
+	}
+	mEventPoller.setup(mHost, mPort);
+	mEventPoller.startThread(true, false);
+	return true;
 }
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableSelfTimer( std::string& json )
+
+void ofxSonyRemoteCamera::stopEventPolling()
 {
-	json = httpPost(createJson("getAvailableSelfTimer"), mSessionCameraPath);
-	return checkError(json);
+	if (mIsReactorEventPolling) {
+		mpReactor->closeEventPolling(*this);
+		mIsReactorEventPolling = false;
+	}
+	if (!mEventPoller.isThreadRunning()) return;
+	mEventPoller.stopThread();
+	// unblock the pending long poll
+	mEventPoller.abort();
+	mEventPoller.waitForThread();
 }
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSelfTimer(int& second)
+
+bool ofxSonyRemoteCamera::isEventPolling()
 {
-	const std::string json(httpPost(createJson("getSelfTimer"), mSessionCameraPath));
-	SRCError err(checkError(json));
-	if (err != SRC_OK) return err;
+	return mIsReactorEventPolling || mEventPoller.isThreadRunning();
+}
 
-	picojson::array resultArray;
-	if (getJsonResultArray(resultArray, json)) {
-		second = resultArray[0].get<double>();
-		return SRC_OK;
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::refreshCameraState(const CallOptions& options/*=CallOptions()*/)
+{
+	if (isEventPolling()) return SRC_OK;
+	try {
+		return pollEvent(mSession, mRequestWriter, mJsonArena, false, options);
+	} catch (Poco::Exception& e) {
+		ofLogError("getEvent: " + e.displayText());
+		mSession.reset();
+		return SRC_ERROR_UNKNOWN;
 	}
-	return SRC_ERROR_UNKNOWN;	
 }
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::setSelfTimer(int second)
+
+void ofxSonyRemoteCamera::getCameraState(CameraState& state)
 {
-	std::vector<picojson::value> params(1);
-	params[0] = static_cast<picojson::value>(static_cast<double>(second));
-	const std::string json(httpPost(createJson("setSelfTimer", params), mSessionCameraPath));
-	return checkError(json);	
+	ofMutex::ScopedLock eventLock(mEventMutex);
+	state = mCameraState;
 }
+
 //////////////////////////////////////////////////////////////////////////
-// Postview image size
+// Settings cache
 //////////////////////////////////////////////////////////////////////////
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSupportedPostViewImageSize( std::string& json )
+void ofxSonyRemoteCamera::setSettingsCacheMaxAge(unsigned long long millis)
 {
-	json = httpPost(createJson("getSupportedPostviewImageSize"), mSessionCameraPath);
-	return checkError(json);
+	ofMutex::ScopedLock cacheLock(mCacheMutex);
+	mSettingsCacheMaxAge = millis;
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailablePostViewImageSize( std::string& json )
+void ofxSonyRemoteCamera::invalidateSettingsCache()
 {
-	json = httpPost(createJson("getAvailablePostviewImageSize"), mSessionCameraPath);
-	return checkError(json);
+	ofMutex::ScopedLock cacheLock(mCacheMutex);
+	mSettingsCache = SettingsCache();
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getPostViewImageSize(PostViewImageSize& size)
+void ofxSonyRemoteCamera::getSettingsCache(SettingsCache& cache)
 {
-	const std::string json(httpPost(createJson("getPostviewImageSize"), mSessionCameraPath));
-	SRCError err(checkError(json));
-	if (err != SRC_OK) return err;
+	ofMutex::ScopedLock cacheLock(mCacheMutex);
+	cache = mSettingsCache;
+}
 
-	picojson::array resultArray;
-	if (getJsonResultArray(resultArray, json)) {
-		if (resultArray[0].get<std::string>().compare("Original") == 0) {
-			size = POST_VIEW_IMG_SIZE_ORIGINAL;
-			return SRC_OK;
-		} else if (resultArray[0].get<std::string>().compare("2M") == 0) {
-			size = POST_VIEW_IMG_SIZE_2M;
-			return SRC_OK;
-		} else {
-			ofLogError("not implemented yet.");
+//////////////////////////////////////////////////////////////////////////
+// Settings snapshot
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSettingsSnapshot(SettingsSnapshot& snapshot, bool isConcurrent/*=true*/)
+{
+	// a second caller, e.g. the start-up thread, waits for the running snapshot
+	ofMutex::ScopedLock snapshotRunLock(mSnapshotRunMutex);
+	Poco::Timestamp startTime;
+	snapshot = SettingsSnapshot();
+	{
+		ofMutex::ScopedLock snapshotLock(mSnapshotMutex);
+		mNextSnapshotField = 0;
+	}
+
+	if (mChannels.empty()) {
+		// not set up, the fields keep SRC_ERROR_UNKNOWN
+	} else if (isConcurrent) {
+		// each worker takes the next field until all fields are fetched
+		std::vector<SnapshotWorker*> workers;
+		for (std::vector<Channel*>::iterator it=mChannels.begin(); it!=mChannels.end(); ++it) {
+			workers.push_back(new SnapshotWorker(*this, **it, snapshot));
+			workers.back()->thread.start(*workers.back());
+		}
+		for (std::vector<SnapshotWorker*>::iterator it=workers.begin(); it!=workers.end(); ++it) {
+			(*it)->thread.join();
+			delete *it;
+		}
+	} else {
+		// the main session belongs to the other calls and the event poller
+		Channel& channel(*mChannels.front());
+		for (int field(0); field<SNAPSHOT_FIELD_NUM; ++field) {
+			fetchSnapshotField(channel.session, channel.writer, channel.arena, field, snapshot);
 		}
 	}
-	return SRC_ERROR_UNKNOWN;	
+	snapshot.elapsedMicros = startTime.elapsed();
+
+	for (int field(0); field<SNAPSHOT_FIELD_NUM; ++field) {
+		if (snapshot.errors[field] != SRC_OK) return snapshot.errors[field];
+	}
+	return SRC_OK;
 }
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::setPostViewImageSize(PostViewImageSize size)
-{
 
-	std::vector<picojson::value> params(1);
-	switch (size) {
-		case POST_VIEW_IMG_SIZE_ORIGINAL:
-			params[0] = static_cast<picojson::value>(static_cast<std::string>("Original"));
-			break;
-		case POST_VIEW_IMG_SIZE_2M:
-			params[0] = static_cast<picojson::value>(static_cast<std::string>("2M"));
-			break;
-		default:
-			ofLogError("not implemented yet.");
-			break;
-		}
+void ofxSonyRemoteCamera::setSnapshotConcurrency(int connections)
+{
+	{
+		ofMutex::ScopedLock snapshotRunLock(mSnapshotRunMutex);
+		mSnapshotConcurrency = ofClamp(connections, 1, static_cast<int>(SNAPSHOT_FIELD_NUM));
+	}
+	resetChannels();
+}
 
-	const std::string json(httpPost(createJson("setShootMode", params), mSessionCameraPath));
-	return checkError(json);
+int ofxSonyRemoteCamera::getSnapshotConcurrency() const
+{
+	return mSnapshotConcurrency;
 }
 
 //////////////////////////////////////////////////////////////////////////
-// Shoot mode
+// Capabilities
 //////////////////////////////////////////////////////////////////////////
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSupportedShootMode( std::string& json )
+void ofxSonyRemoteCamera::setCapabilityCacheDirectory(const std::string& directory)
 {
-	json = httpPost(createJson("getSupportedShootMode"), mSessionCameraPath);
-	return checkError(json);
+	mCapabilityCacheDirectory = directory;
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableShootMode( std::string& json )
+bool ofxSonyRemoteCamera::loadCapabilities(bool forceRefresh/*=false*/)
 {
-	json = httpPost(createJson("getAvailableShootMode"), mSessionCameraPath);
-	return checkError(json);
+	Capabilities capabilities;
+	try {
+		// getApplicationInfo identifies the table, so it is always sent
+		Response response;
+		if (invoke<method::getApplicationInfo>(response) != SRC_OK
+			|| !response.getString(0, capabilities.applicationName)
+			|| !response.getString(1, capabilities.applicationVersion)) {
+			return false;
+		}
+		const std::string path(getCapabilityCachePath(capabilities));
+		if (forceRefresh || path.empty() || !readCapabilities(path, capabilities)) {
+			if (!fetchCapabilities(capabilities)) return false;
+			if (!path.empty() && !writeCapabilities(path, capabilities)) {
+				ofLogWarning("cannot write " + path);
+			}
+		}
+	} catch (Poco::Exception& e) {
+		ofLogError(e.displayText());
+		return false;
+	}
+	std::sort(capabilities.methods.begin(), capabilities.methods.end());
+	capabilities.methods.erase(std::unique(capabilities.methods.begin(), capabilities.methods.end()), capabilities.methods.end());
+	capabilities.isValid = true;
+
+	ofMutex::ScopedLock capabilityLock(mCapabilityMutex);
+	mCapabilities = capabilities;
+	return true;
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getShootMode(ShootMode& mode)
+void ofxSonyRemoteCamera::getCapabilities(Capabilities& capabilities)
 {
-	const std::string json(httpPost(createJson("getShootMode"), mSessionCameraPath));
-	SRCError err(checkError(json));
-	if (err != SRC_OK) return err;
+	ofMutex::ScopedLock capabilityLock(mCapabilityMutex);
+	capabilities = mCapabilities;
+}
 
-	picojson::array resultArray;
-	if (getJsonResultArray(resultArray, json)) {
-		if (resultArray[0].get<std::string>().compare("movie") == 0) {
-			mode = SHOOT_MODE_MOVIE;
-			return SRC_OK;
-		} else if (resultArray[0].get<std::string>().compare("still") == 0) {
-			mode = SHOOT_MODE_STILL;
-			return SRC_OK;
-		} else if (resultArray[0].get<std::string>().compare("intervalstill") == 0) {
-			mode = SHOOT_MODE_INTERVAL_STILL;
-			return SRC_OK;
+bool ofxSonyRemoteCamera::isMethodSupported(const char* method)
+{
+	ofMutex::ScopedLock capabilityLock(mCapabilityMutex);
+	if (!mCapabilities.isValid) return true;
+	// binary search without constructing a string for the method name
+	size_t first(0), last(mCapabilities.methods.size());
+	while (first < last) {
+		const size_t middle((first + last) / 2);
+		const int cmp(strcmp(mCapabilities.methods[middle].c_str(), method));
+		if (cmp == 0) return true;
+		if (cmp < 0) {
+			first = middle + 1;
 		} else {
-			ofLogError("not implemented yet.");
+			last = middle;
 		}
 	}
-	return SRC_ERROR_UNKNOWN;	
+	return false;
 }
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::setShootMode(ShootMode mode)
-{
-
-	std::vector<picojson::value> params(1);
-	switch (mode) {
-		case SHOOT_MODE_MOVIE:
-			params[0] = static_cast<picojson::value>(static_cast<std::string>("movie"));
-			break;
-		case SHOOT_MODE_STILL:
-			params[0] = static_cast<picojson::value>(static_cast<std::string>("still"));
-			break;
-		case SHOOT_MODE_INTERVAL_STILL:
-			params[0] = static_cast<picojson::value>(static_cast<std::string>("intervalstill"));
-			break;
-		default:
-			ofLogError("not implemented yet.");
-			break;
-		}
 
-	const std::string json(httpPost(createJson("setShootMode", params), mSessionCameraPath));
-	return checkError(json);
-}
 //////////////////////////////////////////////////////////////////////////
-// Event notification
+// Still Capture
 //////////////////////////////////////////////////////////////////////////
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getEvent( std::string& json, bool pollingFlag )
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::actTakePicture(const CallOptions& options/*=CallOptions()*/)
 {
-	std::vector<picojson::value> params(1);
-	params[0] = static_cast<picojson::value>(static_cast<bool>(pollingFlag));
-	json = httpPost(createJson("getEvent", params), mSessionCameraPath);
-	return checkError(json);
+	int captureId(-1);
+	return actTakePicture(captureId, options);
 }
-//////////////////////////////////////////////////////////////////////////
-// Camera setup
-//////////////////////////////////////////////////////////////////////////
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::startRecMode()
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::awaitTakePicture(const CallOptions& options/*=CallOptions()*/)
+{
+	int captureId(-1);
+	return awaitTakePicture(captureId, options);
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::actTakePicture(int& captureId, const CallOptions& options/*=CallOptions()*/)
 {
-	const std::string json(httpPost(createJson("startRecMode"), mSessionCameraPath));
-	return checkError(json);
+	captureId = -1;
+	Response response;
+	SRCError err(invoke<method::actTakePicture>(response, options));
+	if (err != SRC_OK) return err;
+	captureId = takePictureResult(response);
+	return SRC_OK;
+	/*
+	httpPostAsync(createJson("actTakePicture"), mSessionCameraPath);
+	return SRC_OK;
+	*/
 }
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::stopRecMode()
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::awaitTakePicture(int& captureId, const CallOptions& options/*=CallOptions()*/)
 {
-	const std::string json(httpPost(createJson("stopRecMode"), mSessionCameraPath));
-	return checkError(json);
+	captureId = -1;
+	Response response;
+	SRCError err(invoke<method::awaitTakePicture>(response, options));
+	if (err != SRC_OK) return err;
+	captureId = takePictureResult(response);
+	return SRC_OK;
 }
+
 //////////////////////////////////////////////////////////////////////////
-// Server information
+// Burst capture
 //////////////////////////////////////////////////////////////////////////
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableApiList( std::string& json )
-{
-	json = httpPost(createJson("getAvailableApiList"), mSessionCameraPath);
-	return checkError(json);
+bool ofxSonyRemoteCamera::startBurst(const BurstOptions& options/*=BurstOptions()*/)
+{
+	if (isBurstRunning()) return false;
+	// the workers of the last burst have finished, but burstFinished may not be notified yet
+	joinBurstWorkers();
+
+	ofMutex::ScopedLock burstLock(mBurstMutex);
+	mBurstOptions = options;
+	mBurstOptions.maxInFlight = std::max(1, options.maxInFlight);
+	mBurstReport = BurstReport();
+	mBurstReport.inFlightLimit = mBurstOptions.maxInFlight;
+	mBurstShotTimes.clear();
+	mBurstStartTime.update();
+	mBurstResendTime.update();
+	mBurstNotReadyInRow = 0;
+	mBurstStartedShots = 0;
+	mBurstInFlight = 0;
+	mIsBurstStopping = false;
+	mIsBurstFinished = false;
+	mBurstRunningWorkers = mBurstOptions.maxInFlight;
+	for (int i(0); i<mBurstOptions.maxInFlight; ++i) {
+		BurstWorker* pWorker(new BurstWorker(*this));
+		pWorker->channel.session.setHost(mSession.getHost());
+		pWorker->channel.session.setPort(mSession.getPort());
+		pWorker->channel.session.setKeepAlive(true);
+		mBurstWorkers.push_back(pWorker);
+		pWorker->thread.start(*pWorker);
+	}
+	return true;
 }
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getMethodTypes( std::string& json )
+
+void ofxSonyRemoteCamera::stopBurst()
 {
-	std::vector<picojson::value> params(1);
-	params[0] = static_cast<picojson::value>(static_cast<std::string>(VERSION));
-	json = httpPost(createJson("getMethodTypes", params), mSessionCameraPath);
-	return checkError(json);
+	{
+		ofMutex::ScopedLock burstLock(mBurstMutex);
+		if (mBurstWorkers.empty()) return;
+		mIsBurstStopping = true;
+		mBurstCondition.broadcast();
+		// the connections of the shots in flight are closed, the capture itself can not be cancelled on the camera
+		for (std::vector<BurstWorker*>::iterator it=mBurstWorkers.begin(); it!=mBurstWorkers.end(); ++it) {
+			(*it)->abort();
+		}
+	}
+	joinBurstWorkers();
 }
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getVersions( std::string& json )
+
+bool ofxSonyRemoteCamera::isBurstRunning()
 {
-	json = httpPost(createJson("getVersions"), mSessionCameraPath);
-	return checkError(json);
+	ofMutex::ScopedLock burstLock(mBurstMutex);
+	return mBurstRunningWorkers > 0;
 }
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getApplicationInfo( std::string& json )
+
+void ofxSonyRemoteCamera::getBurstReport(BurstReport& report)
 {
-	json = httpPost(createJson("getApplicationInfo"), mSessionCameraPath);
-	return checkError(json);
+	ofMutex::ScopedLock burstLock(mBurstMutex);
+	report = mBurstReport;
+	report.elapsedMicros = report.isFinished ? report.elapsedMicros : mBurstStartTime.elapsed();
 }
+
 //////////////////////////////////////////////////////////////////////////
-// othrers
+// Interval capture
 //////////////////////////////////////////////////////////////////////////
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::startIntervalStillRec()
+bool ofxSonyRemoteCamera::startIntervalCapture(const IntervalOptions& options/*=IntervalOptions()*/)
 {
-	const std::string json(httpPost(createJson("startIntervalStillRec"), mSessionCameraPath));
-	return checkError(json);
-}
+	{
+		ofMutex::ScopedLock intervalLock(mIntervalMutex);
+		if (mIsIntervalRunning) return false;
+	}
+	// the thread of the last capture has finished
+	if (mIntervalThread.isRunning()) mIntervalThread.join();
+
+	ofMutex::ScopedLock intervalLock(mIntervalMutex);
+	mIntervalOptions = options;
+	mIntervalOptions.intervalMillis = std::max(static_cast<unsigned long long>(1), options.intervalMillis);
+	mIntervalReport = IntervalReport();
+	mIntervalTotalAbsErrorMicros = 0;
+	mIsIntervalRunning = true;
+	mIsIntervalStopping = false;
+	mIsIntervalFinished = false;
+	mIntervalToken.reset();
+	mIntervalChannel.session.reset();
+	mIntervalChannel.session.setHost(mSession.getHost());
+	mIntervalChannel.session.setPort(mSession.getPort());
+	mIntervalChannel.session.setKeepAlive(true);
+	mIntervalThread.start(mIntervalRunnable);
+	return true;
+}
+
+void ofxSonyRemoteCamera::stopIntervalCapture()
+{
+	{
+		ofMutex::ScopedLock intervalLock(mIntervalMutex);
+		mIsIntervalStopping = true;
+		mIntervalCondition.broadcast();
+	}
+	mIntervalToken.cancel();
+	if (mIntervalThread.isRunning()) mIntervalThread.join();
+}
+
+bool ofxSonyRemoteCamera::isIntervalCaptureRunning()
+{
+	ofMutex::ScopedLock intervalLock(mIntervalMutex);
+	return mIsIntervalRunning;
+}
+
+void ofxSonyRemoteCamera::getIntervalReport(IntervalReport& report)
+{
+	ofMutex::ScopedLock intervalLock(mIntervalMutex);
+	report = mIntervalReport;
+	if (mIsIntervalRunning) report.elapsedMicros = mIntervalStartTime.elapsed();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Synchronized trigger
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::prepareTrigger(TriggerMethod triggerMethod, long long& roundTripMicros)
+{
+	const char* name(method::actTakePicture::name());
+	if (triggerMethod == TRIGGER_START_MOVIE_REC) name = method::startMovieRec::name();
+	else if (triggerMethod == TRIGGER_STOP_MOVIE_REC) name = method::stopMovieRec::name();
+	mpTriggerMethodName = 0;
+	roundTripMicros = -1;
+	if (!isMethodSupported(name)) return SRC_ERROR_NO_SUCH_METHOD;
+
+	// the probes open the connection which the trigger is sent on
+	mTriggerChannel.session.reset();
+	mTriggerChannel.session.setHost(mSession.getHost());
+	mTriggerChannel.session.setPort(mSession.getPort());
+	mTriggerChannel.session.setKeepAlive(true);
+	roundTripMicros = measureRoundTrip(mTriggerChannel, 0);
+	if (roundTripMicros < 0) return SRC_ERROR_CONNECTION_FAILED;
+	try {
+		// the header and the body are sent without waiting for an ack in between
+		mTriggerChannel.session.socket().setNoDelay(true);
+		setSessionTimeout(mTriggerChannel.session, Poco::Timestamp() + static_cast<Poco::Timestamp::TimeDiff>(getMethodTimeout(name)) * 1000);
+	} catch (Poco::Exception& e) {
+		ofLogError(std::string(name) + ": " + e.displayText());
+		return SRC_ERROR_CONNECTION_FAILED;
+	}
+
+	mTriggerChannel.writer.begin(name);
+	mTriggerChannel.writer.end(mId, VERSION);
+	mTriggerRequest = Poco::Net::HTTPRequest(Poco::Net::HTTPRequest::HTTP_POST, mSessionCameraPath, Poco::Net::HTTPMessage::HTTP_1_1);
+	mTriggerRequest.setContentLength(mTriggerChannel.writer.size());
+	mTriggerRequest.setContentType("application/json");
+	mpTriggerMethodName = name;
+	return SRC_OK;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::sendTrigger(Poco::Timestamp& sentTime, Poco::Timestamp& ackTime, int& captureId)
+{
+	captureId = -1;
+	const char* name(mpTriggerMethodName);
+	if (name == 0) return SRC_ERROR_ILLEGAL_STATE;
+	mpTriggerMethodName = 0;
+
+	Poco::Net::HTTPClientSession& session(mTriggerChannel.session);
+	Response response;
+	SRCError err(SRC_OK);
+	try {
+		std::ostream& out(session.sendRequest(mTriggerRequest));
+		out.write(mTriggerChannel.writer.data(), mTriggerChannel.writer.size());
+		out.flush();
+		sentTime.update();
+
+		Poco::Net::HTTPResponse httpResponse;
+		std::istream& rs(session.receiveResponse(httpResponse));
+		ackTime.update();
+		const bool isParsed(response.read(rs));
+		rs.ignore((std::numeric_limits<std::streamsize>::max)());
+		if (!isParsed) {
+			ofLogError("JSON parse error: " + response.getParseError());
+			err = SRC_ERROR_ILLEGAL_RESPONSE;
+		} else if (response.getErrorCode() != 0) {
+			err = cvtError(response.getErrorCode());
+		}
+	} catch (Poco::TimeoutException&) {
+		err = SRC_ERROR_TIMEOUT;
+		session.reset();
+	} catch (Poco::Exception& e) {
+		ofLogError(std::string(name) + ": " + e.displayText());
+		err = SRC_ERROR_CONNECTION_FAILED;
+		session.reset();
+	}
+	if (std::string(name) != method::actTakePicture::name()) return err;
+
+	// the trigger is acknowledged, the rest of a long capture is awaited as usual
+	int awaitCalls(0);
+	try {
+		while (err == SRC_ERROR_STILL_CAPTURING_NOT_FINISHED && awaitCalls < MAX_AWAIT_CALLS) {
+			++awaitCalls;
+			err = invokeOn<method::awaitTakePicture>(session, mTriggerChannel.writer, response);
+		}
+	} catch (Poco::Exception& e) {
+		ofLogError("awaitTakePicture: " + e.displayText());
+		err = SRC_ERROR_UNKNOWN;
+		session.reset();
+	}
+	if (err == SRC_OK) captureId = takePictureResult(response);
+	return err;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Postview
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCamera::setPostViewOptions(const PostViewOptions& options)
+{
+	// the workers are started again with the new concurrency by the next download
+	stopPostViewWorkers();
+	ofMutex::ScopedLock postViewLock(mPostViewMutex);
+	mPostViewOptions = options;
+	mPostViewOptions.maxConcurrency = std::max(1, options.maxConcurrency);
+}
+
+void ofxSonyRemoteCamera::getPostViewOptions(PostViewOptions& options)
+{
+	ofMutex::ScopedLock postViewLock(mPostViewMutex);
+	options = mPostViewOptions;
+}
+
+int ofxSonyRemoteCamera::fetchPostView(const std::string& url)
+{
+	return enqueuePostView(url);
+}
+
+void ofxSonyRemoteCamera::cancelPendingPostViews()
+{
+	ofMutex::ScopedLock postViewLock(mPostViewMutex);
+	mPostViewJobs.clear();
+}
+
+int ofxSonyRemoteCamera::getPendingPostViewCount()
+{
+	ofMutex::ScopedLock postViewLock(mPostViewMutex);
+	return mPostViewJobs.size();
+}
+//////////////////////////////////////////////////////////////////////////
+// Movie recording
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::startMovieRec()
+{
+	Response response;
+	return invoke<method::startMovieRec>(response);
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::stopMovieRec()
+{
+	Response response;
+	return invoke<method::stopMovieRec>(response);
+}
+//////////////////////////////////////////////////////////////////////////
+// Zoom
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::actZoom(const std::string& direction, const std::string& movement)
+{
+	return invoke<method::actZoom>(direction.c_str(), movement.c_str());
+	/*
+	httpPostAsync(createJson("actZoom", params), mSessionCameraPath);
+	return SRC_OK;
+	*/
+}
+
+bool ofxSonyRemoteCamera::startZoomTo(int position, const ZoomOptions& options/*=ZoomOptions()*/)
+{
+	{
+		ofMutex::ScopedLock zoomLock(mZoomMutex);
+		if (mIsZoomRunning) return false;
+	}
+	if (mZoomThread.isRunning()) mZoomThread.join();
+	startEventPolling();
+
+	ofMutex::ScopedLock zoomLock(mZoomMutex);
+	mZoomOptions = options;
+	mZoomOptions.tolerance = std::max(0, options.tolerance);
+	mZoomOptions.maxCommandsPerSecond = std::max(0.1f, options.maxCommandsPerSecond);
+	mZoomReport = ZoomReport();
+	mZoomReport.target = std::max(0, std::min(100, position));
+	mIsZoomRunning = true;
+	mIsZoomStopping = false;
+	mIsZoomFinished = false;
+	mZoomToken.reset();
+	mZoomChannel.session.reset();
+	mZoomChannel.session.setHost(mSession.getHost());
+	mZoomChannel.session.setPort(mSession.getPort());
+	mZoomChannel.session.setKeepAlive(true);
+	mZoomThread.start(mZoomRunnable);
+	return true;
+}
+
+void ofxSonyRemoteCamera::stopZoom()
+{
+	{
+		ofMutex::ScopedLock zoomLock(mZoomMutex);
+		mIsZoomStopping = true;
+		mZoomCondition.broadcast();
+	}
+	mZoomToken.cancel();
+	if (mZoomThread.isRunning()) mZoomThread.join();
+}
+
+bool ofxSonyRemoteCamera::isZooming()
+{
+	ofMutex::ScopedLock zoomLock(mZoomMutex);
+	return mIsZoomRunning;
+}
+
+void ofxSonyRemoteCamera::getZoomReport(ZoomReport& report)
+{
+	ofMutex::ScopedLock zoomLock(mZoomMutex);
+	report = mZoomReport;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Self-timer
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSupportedSelfTimer( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getSupportedSelfTimer>(response));
+	json = response.getBody();
+	return err;
+}
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableSelfTimer( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getAvailableSelfTimer>(response));
+	json = response.getBody();
+	return err;
+}
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSelfTimer(int& second, bool forceRefresh/*=false*/)
+{
+	if (!forceRefresh && readCache(mSettingsCache.selfTimer, second)) return SRC_OK;
+
+	Response response;
+	SRCError err(invoke<method::getSelfTimer>(response));
+	if (err != SRC_OK) return err;
+
+	if (response.getInt(0, second)) {
+		writeCache(mSettingsCache.selfTimer, second);
+		return SRC_OK;
+	}
+	return SRC_ERROR_UNKNOWN;	
+}
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::setSelfTimer(int second)
+{
+	SRCError err(invoke<method::setSelfTimer>(second));
+	if (err == SRC_OK) writeCache(mSettingsCache.selfTimer, second);
+	return err;
+}
+//////////////////////////////////////////////////////////////////////////
+// Postview image size
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSupportedPostViewImageSize( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getSupportedPostviewImageSize>(response));
+	json = response.getBody();
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailablePostViewImageSize( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getAvailablePostviewImageSize>(response));
+	json = response.getBody();
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getPostViewImageSize(PostViewImageSize& size, bool forceRefresh/*=false*/)
+{
+	if (!forceRefresh && readCache(mSettingsCache.postViewImageSize, size)) return SRC_OK;
+
+	Response response;
+	SRCError err(invoke<method::getPostviewImageSize>(response));
+	if (err != SRC_OK) return err;
+
+	std::string result;
+	if (response.getString(0, result)) {
+		if (cvtPostViewImageSize(result, size)) {
+			writeCache(mSettingsCache.postViewImageSize, size);
+			return SRC_OK;
+		}
+		ofLogError("not implemented yet.");
+	}
+	return SRC_ERROR_UNKNOWN;	
+}
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::setPostViewImageSize(PostViewImageSize size)
+{
+
+	const char* param("");
+	switch (size) {
+		case POST_VIEW_IMG_SIZE_ORIGINAL:
+			param = "Original";
+			break;
+		case POST_VIEW_IMG_SIZE_2M:
+			param = "2M";
+			break;
+		default:
+			ofLogError("not implemented yet.");
+			break;
+		}
+
+	SRCError err(invoke<method::setPostviewImageSize>(param));
+	if (err == SRC_OK) writeCache(mSettingsCache.postViewImageSize, size);
+	return err;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Shoot mode
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSupportedShootMode( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getSupportedShootMode>(response));
+	json = response.getBody();
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableShootMode( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getAvailableShootMode>(response));
+	json = response.getBody();
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getShootMode(ShootMode& mode, bool forceRefresh/*=false*/)
+{
+	if (!forceRefresh && readCache(mSettingsCache.shootMode, mode)) return SRC_OK;
+
+	Response response;
+	SRCError err(invoke<method::getShootMode>(response));
+	if (err != SRC_OK) return err;
+
+	std::string result;
+	if (response.getString(0, result)) {
+		if (cvtShootMode(result, mode)) {
+			writeCache(mSettingsCache.shootMode, mode);
+			return SRC_OK;
+		}
+		ofLogError("not implemented yet.");
+	}
+	return SRC_ERROR_UNKNOWN;	
+}
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::setShootMode(ShootMode mode, const CallOptions& options/*=CallOptions()*/)
+{
+
+	const char* param("");
+	switch (mode) {
+		case SHOOT_MODE_MOVIE:
+			param = "movie";
+			break;
+		case SHOOT_MODE_STILL:
+			param = "still";
+			break;
+		case SHOOT_MODE_INTERVAL_STILL:
+			param = "intervalstill";
+			break;
+		default:
+			ofLogError("not implemented yet.");
+			break;
+		}
+
+	Response response;
+	SRCError err(invoke<method::setShootMode>(param, response, options));
+	if (err == SRC_OK) {
+		// other settings depend on the shoot mode
+		invalidateSettingsCache();
+		writeCache(mSettingsCache.shootMode, mode);
+	}
+	return err;
+}
+//////////////////////////////////////////////////////////////////////////
+// Event notification
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getEvent( std::string& json, bool pollingFlag, const CallOptions& options/*=CallOptions()*/ )
+{
+	if (isEventPolling()) {
+		ofMutex::ScopedLock eventLock(mEventMutex);
+		json = "{\"result\":";
+		mLastEventArena.getRoot().serialize(json);
+		json += ",\"id\":" + ofToString(mId) + "}";
+		return SRC_OK;
+	}
+
+	Response response(&mJsonArena);
+	SRCError err(invoke<method::getEvent>(pollingFlag, response, options));
+	json = response.getBody();
+	if (err != SRC_OK) return err;
+
+	updateSettingsCache(response.getResultNode());
+	return SRC_OK;
+}
+//////////////////////////////////////////////////////////////////////////
+// Camera setup
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::startRecMode(const CallOptions& options/*=CallOptions()*/)
+{
+	Response response;
+	SRCError err(invoke<method::startRecMode>(response, options));
+	if (err == SRC_OK) invalidateSettingsCache();
+	return err;
+}
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::stopRecMode(const CallOptions& options/*=CallOptions()*/)
+{
+	Response response;
+	SRCError err(invoke<method::stopRecMode>(response, options));
+	if (err == SRC_OK) invalidateSettingsCache();
+	return err;
+}
+//////////////////////////////////////////////////////////////////////////
+// Server information
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableApiList( std::string& json )
+{
+	Response response(&mJsonArena);
+	SRCError err(invoke<method::getAvailableApiList>(response));
+	json = response.getBody();
+	return err;
+}
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getMethodTypes( std::string& json )
+{
+	Response response(&mJsonArena);
+	SRCError err(invoke<method::getMethodTypes>(VERSION, response));
+	json = response.getBody();
+	return err;
+}
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getVersions( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getVersions>(response));
+	json = response.getBody();
+	return err;
+}
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getApplicationInfo( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getApplicationInfo>(response));
+	json = response.getBody();
+	return err;
+}
+//////////////////////////////////////////////////////////////////////////
+// othrers
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::startIntervalStillRec()
+{
+	Response response;
+	return invoke<method::startIntervalStillRec>(response);
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::stopIntervalStillRec()
+{
+	Response response;
+	return invoke<method::stopIntervalStillRec>(response);
+}
+
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSupportedViewAngle( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getSupportedViewAngle>(response));
+	json = response.getBody();
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableViewAngle( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getAvailableViewAngle>(response));
+	json = response.getBody();
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getViewAngle( int& angle, bool forceRefresh/*=false*/ )
+{
+	if (!forceRefresh && readCache(mSettingsCache.viewAngle, angle)) return SRC_OK;
+
+	Response response;
+	SRCError err(invoke<method::getViewAngle>(response));
+	if (err != SRC_OK) return err;
+
+	if (response.getInt(0, angle)) {
+		writeCache(mSettingsCache.viewAngle, angle);
+		return SRC_OK;
+	}
+	return SRC_ERROR_UNKNOWN;	
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::setViewAngle(int angle)
+{
+	SRCError err(invoke<method::setViewAngle>(angle));
+	if (err == SRC_OK) writeCache(mSettingsCache.viewAngle, angle);
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSupportedMovieQuality( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getSupportedMovieQuality>(response));
+	json = response.getBody();
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableMovieQuality( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getAvailableMovieQuality>(response));
+	json = response.getBody();
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getMovieQuality( std::string& quality, bool forceRefresh/*=false*/ )
+{
+	if (!forceRefresh && readCache(mSettingsCache.movieQuality, quality)) return SRC_OK;
+
+	Response response;
+	SRCError err(invoke<method::getMovieQuality>(response));
+	if (err != SRC_OK) return err;
+
+	if (response.getString(0, quality)) {
+		writeCache(mSettingsCache.movieQuality, quality);
+		return SRC_OK;
+	}
+	return SRC_ERROR_UNKNOWN;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::setMovieQuality( const std::string& quality )
+{
+	SRCError err(invoke<method::setMovieQuality>(quality.c_str()));
+	if (err == SRC_OK) writeCache(mSettingsCache.movieQuality, quality);
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSupportedSteadyMode( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getSupportedSteadyMode>(response));
+	json = response.getBody();
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableSteadyMode( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getAvailableSteadyMode>(response));
+	json = response.getBody();
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getStorageInformation( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getStorageInformation>(response));
+	json = response.getBody();
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableCameraFunction( std::string& json )
+{
+	Response response;
+	SRCError err(invoke<method::getAvailableCameraFunction>(response));
+	json = response.getBody();
+	return err;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Contents
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::setCameraFunction(const std::string& function)
+{
+	return invoke<method::setCameraFunction>(function.c_str());
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getCameraFunction(std::string& function)
+{
+	Response response;
+	SRCError err(invoke<method::getCameraFunction>(response));
+	if (err != SRC_OK) return err;
+	return response.getString(0, function) ? SRC_OK : SRC_ERROR_ILLEGAL_RESPONSE;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSourceList(std::vector<std::string>& sources, const std::string& scheme/*="storage"*/)
+{
+	// result is [[{"source":"storage:memoryCard1"}]]
+	sources.clear();
+	picojson::object params;
+	params["scheme"] = picojson::value(scheme);
+	Response response;
+	SRCError err(invoke<method::getSourceList>(picojson::value(params), response));
+	if (err != SRC_OK) return err;
+	const picojson::array& resultArray(response.getResultArray());
+	if (resultArray.empty() || !resultArray[0].is<picojson::array>()) return SRC_ERROR_ILLEGAL_RESPONSE;
+	const picojson::array& values(resultArray[0].get<picojson::array>());
+	for (picojson::array::const_iterator it=values.begin(); it!=values.end(); ++it) {
+		if (it->get("source").is<std::string>()) sources.push_back(it->get("source").get<std::string>());
+	}
+	return SRC_OK;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getContentCount(const std::string& uri, int& count)
+{
+	// result is [{"count":n}]
+	picojson::object params;
+	params["uri"] = picojson::value(uri);
+	params["view"] = picojson::value(std::string("flat"));
+	Response response;
+	SRCError err(invoke<method::getContentCount>(picojson::value(params), response));
+	if (err != SRC_OK) return err;
+	const picojson::array& resultArray(response.getResultArray());
+	if (resultArray.empty() || !resultArray[0].get("count").is<double>()) return SRC_ERROR_ILLEGAL_RESPONSE;
+	count = static_cast<int>(resultArray[0].get("count").get<double>());
+	return SRC_OK;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getContentList(const std::string& uri, int startIndex, int count, std::vector<Content>& contents)
+{
+	// result is [[{"uri":..., "content":{"original":[{"fileName":..., "url":...}], "thumbnailUrl":...}, ...}]]
+	picojson::object params;
+	params["uri"] = picojson::value(uri);
+	params["stIdx"] = picojson::value(static_cast<double>(startIndex));
+	params["cnt"] = picojson::value(static_cast<double>(std::min(count, MAX_CONTENT_LIST_COUNT)));
+	params["view"] = picojson::value(std::string("flat"));
+	Response response;
+	SRCError err(invoke<method::getContentList>(picojson::value(params), response));
+	if (err != SRC_OK) return err;
+	const picojson::array& resultArray(response.getResultArray());
+	if (resultArray.empty() || !resultArray[0].is<picojson::array>()) return SRC_ERROR_ILLEGAL_RESPONSE;
+	const picojson::array& values(resultArray[0].get<picojson::array>());
+	for (picojson::array::const_iterator it=values.begin(); it!=values.end(); ++it) {
+		Content content;
+		if (it->get("uri").is<std::string>()) content.uri = it->get("uri").get<std::string>();
+		if (it->get("title").is<std::string>()) content.title = it->get("title").get<std::string>();
+		if (it->get("contentKind").is<std::string>()) content.contentKind = it->get("contentKind").get<std::string>();
+		if (it->get("createdTime").is<std::string>()) content.createdTime = it->get("createdTime").get<std::string>();
+		// "true" or "false" as strings
+		content.isBrowsable = it->get("isBrowsable").is<std::string>() && it->get("isBrowsable").get<std::string>() == "true";
+		const picojson::value& files(it->get("content"));
+		if (files.get("original").is<picojson::array>() && !files.get("original").get<picojson::array>().empty()) {
+			const picojson::value& original(files.get("original").get<picojson::array>()[0]);
+			if (original.get("fileName").is<std::string>()) content.fileName = original.get("fileName").get<std::string>();
+			if (original.get("url").is<std::string>()) content.url = original.get("url").get<std::string>();
+		}
+		if (files.get("largeUrl").is<std::string>()) content.largeUrl = files.get("largeUrl").get<std::string>();
+		if (files.get("smallUrl").is<std::string>()) content.smallUrl = files.get("smallUrl").get<std::string>();
+		if (files.get("thumbnailUrl").is<std::string>()) content.thumbnailUrl = files.get("thumbnailUrl").get<std::string>();
+		contents.push_back(content);
+	}
+	return SRC_OK;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::listContents(const std::string& uri, std::vector<Content>& contents, int pageSize/*=100*/)
+{
+	int count(0);
+	SRCError err(getContentCount(uri, count));
+	if (err != SRC_OK) return err;
+	pageSize = std::max(1, std::min(pageSize, MAX_CONTENT_LIST_COUNT));
+	contents.reserve(contents.size() + count);
+	for (int startIndex(0); startIndex<count; startIndex+=pageSize) {
+		const size_t listed(contents.size());
+		err = getContentList(uri, startIndex, std::min(pageSize, count - startIndex), contents);
+		if (err != SRC_OK) return err;
+		// the count may have shrunk meanwhile
+		if (contents.size() == listed) break;
+	}
+	return SRC_OK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Statistics
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCamera::getMethodStats(std::map<std::string, MethodStats>& stats)
+{
+	ofMutex::ScopedLock statsLock(mStatsMutex);
+	stats = mMethodStats;
+}
+
+void ofxSonyRemoteCamera::resetMethodStats()
+{
+	ofMutex::ScopedLock statsLock(mStatsMutex);
+	mMethodStats.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Timeouts
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCamera::setDefaultTimeout(unsigned long long millis)
+{
+	ofMutex::ScopedLock timeoutLock(mTimeoutMutex);
+	mDefaultTimeout = millis;
+}
+
+void ofxSonyRemoteCamera::setMethodTimeout(const std::string& method, unsigned long long millis)
+{
+	ofMutex::ScopedLock timeoutLock(mTimeoutMutex);
+	mMethodTimeouts[method] = millis;
+}
+
+unsigned long long ofxSonyRemoteCamera::getMethodTimeout(const std::string& method)
+{
+	ofMutex::ScopedLock timeoutLock(mTimeoutMutex);
+	std::map<std::string, unsigned long long>::const_iterator it(mMethodTimeouts.find(method));
+	return (it != mMethodTimeouts.end()) ? it->second : mDefaultTimeout;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Retries
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCamera::setRetryPolicy(const RetryPolicy& policy)
+{
+	ofMutex::ScopedLock retryLock(mRetryMutex);
+	mRetryPolicy = policy;
+}
+
+void ofxSonyRemoteCamera::getRetryPolicy(RetryPolicy& policy)
+{
+	ofMutex::ScopedLock retryLock(mRetryMutex);
+	policy = mRetryPolicy;
+}
+
+void ofxSonyRemoteCamera::setMethodIdempotent(const std::string& method, bool isIdempotent)
+{
+	ofMutex::ScopedLock retryLock(mRetryMutex);
+	mMethodIdempotency[method] = isIdempotent;
+}
+
+bool ofxSonyRemoteCamera::isMethodIdempotent(const std::string& method)
+{
+	ofMutex::ScopedLock retryLock(mRetryMutex);
+	std::map<std::string, bool>::const_iterator it(mMethodIdempotency.find(method));
+	if (it != mMethodIdempotency.end()) return it->second;
+	return (method.compare(0, 3, "get") == 0) || (method.compare(0, 3, "set") == 0);
+}
+
+void ofxSonyRemoteCamera::CancellationToken::cancel()
+{
+	ofMutex::ScopedLock tokenLock(mMutex);
+	mIsCancelled = true;
+	if (mpSession) {
+		// wakes up the thread blocked in the call
+		try {
+			mpSession->abort();
+		} catch (Poco::Exception&) {
+		}
+	}
+}
+
+bool ofxSonyRemoteCamera::CancellationToken::isCancelled()
+{
+	ofMutex::ScopedLock tokenLock(mMutex);
+	return mIsCancelled;
+}
+
+void ofxSonyRemoteCamera::CancellationToken::reset()
+{
+	ofMutex::ScopedLock tokenLock(mMutex);
+	mIsCancelled = false;
+}
+
+bool ofxSonyRemoteCamera::CancellationToken::attach(Poco::Net::HTTPClientSession* pSession)
+{
+	ofMutex::ScopedLock tokenLock(mMutex);
+	if (mIsCancelled) return false;
+	mpSession = pSession;
+	return true;
+}
+
+void ofxSonyRemoteCamera::CancellationToken::detach()
+{
+	ofMutex::ScopedLock tokenLock(mMutex);
+	mpSession = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Helper Functions
+//////////////////////////////////////////////////////////////////////////
+std::string ofxSonyRemoteCamera::getErrorString(SRCError err) const
+{
+	switch (err) {
+	case SRC_OK:
+		return "OK";
+	case SRC_ERROR_ANY:
+		return "ERROR_ANY";
+	case SRC_ERROR_TIMEOUT:
+		return "ERROR_TIMEOUT";
+	case SRC_ERROR_ILLEGAL_ARGUMENT:
+		return "ERROR_ILLEGAL_ARGUMENT";
+	case SRC_ERROR_ILLEGAL_DATA_FORMAT:
+		return "ERROR_ILLEGAL_DATA_FORMAT";
+	case SRC_ERROR_ILLEGAL_REQUEST:
+		return "ERROR_ILLEGAL_REQUEST";
+	case SRC_ERROR_ILLEGAL_RESPONSE:
+		return "ERROR_ILLEGAL_RESPONSE";
+	case SRC_ERROR_ILLEGAL_STATE:
+		return "ERROR_ILLEGAL_STATE";
+	case SRC_ERROR_ILLEGAL_TYPE:
+		return "ERROR_ILLEGAL_TYPE";
+	case SRC_ERROR_INDEX_OUT_OF_BOUNDS:
+		return "ERROR_INDEX_OUT_OF_BOUNDS";
+	case SRC_ERROR_NO_SUCH_ELEMENT:
+		return "ERROR_NO_SUCH_ELEMENT";
+	case SRC_ERROR_NO_SUCH_FIELD:
+		return "ERROR_NO_SUCH_FIELD";
+	case SRC_ERROR_NO_SUCH_METHOD:
+		return "ERROR_NO_SUCH_METHOD";
+	case SRC_ERROR_NULL_POINTER:
+		return "ERROR_NULL_POINTER";
+	case SRC_ERROR_UNSUPPORTED_VERSION:
+		return "ERROR_UNSUPPORTED_VERSION";
+	case SRC_ERROR_UNSUPPORTED_OPERATION:
+		return "ERROR_UNSUPPORTED_OPERATION";
+	case SRC_ERROR_SHOOTING_FAIL:
+		return "ERROR_SHOOTING_FAIL";
+	case SRC_ERROR_CAMERA_NOT_READY:
+		return "ERROR_CAMERA_NOT_READY";
+	case SRC_ERROR_ALREADY_RUNNING_POLLING_API:
+		return "ERROR_ALREADY_RUNNING_POLLING_API";
+	case SRC_ERROR_STILL_CAPTURING_NOT_FINISHED:
+		return "ERROR_STILL_CAPTURING_NOT_FINISHED";
+	case SRC_ERROR_CANCELLED:
+		return "ERROR_CANCELLED";
+	case SRC_ERROR_CONNECTION_FAILED:
+		return "ERROR_CONNECTION_FAILED";
+	}
+	return "ERROR_UNKNOWN";
+}
+
+std::string ofxSonyRemoteCamera::getShootModeString(ShootMode mode) const
+{
+	switch (mode) {
+	case SHOOT_MODE_MOVIE:
+		return "MOVIE";
+	case SHOOT_MODE_STILL:
+		return "STILL";
+	case SHOOT_MODE_INTERVAL_STILL:
+		return "INTERVAL STILL";
+	}
+	return "UNKNOWN";
+}
+
+//////////////////////////////////////////////////////////////////////////
+// private functions
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCamera::EventPoller::setup(const std::string& host, int port)
+{
+	mSession.reset();
+	mSession.setHost(host);
+	mSession.setPort(port);
+	mSession.setKeepAlive(true);
+}
+
+void ofxSonyRemoteCamera::EventPoller::abort()
+{
+	try {
+		mSession.abort();
+	} catch (Poco::Exception&) {
+	}
+}
+
+void ofxSonyRemoteCamera::EventPoller::threadedFunction()
+{
+	// the first call returns the current state immediately, then wait for changes
+	bool pollingFlag(false);
+	while (isThreadRunning()) {
+		SRCError err(SRC_ERROR_UNKNOWN);
+		try {
+			err = mCamera.pollEvent(mSession, mRequestWriter, mJsonArena, pollingFlag);
+		} catch (Poco::Exception& e) {
+			if (!isThreadRunning()) break;
+			ofLogError("getEvent polling: " + e.displayText());
+			mSession.reset();
+		}
+		if (err == SRC_OK) {
+			pollingFlag = true;
+		} else if (err != SRC_ERROR_TIMEOUT && isThreadRunning()) {
+			// SRC_ERROR_TIMEOUT only means nothing changed
+			pollingFlag = false;
+			this->sleep(EVENT_POLLING_RETRY_INTERVAL);
+		}
+	}
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::pollEvent(Poco::Net::HTTPClientSession& session, RequestWriter& writer, JsonArena& arena, bool pollingFlag, const CallOptions& options/*=CallOptions()*/)
+{
+	Response response(&arena);
+	SRCError err(invokeOn<method::getEvent>(session, writer, pollingFlag, response, options));
+	if (err != SRC_OK) return err;
+	return applyEvent(response, arena);
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::applyEvent(const Response& response, JsonArena& arena)
+{
+	if (!response.hasResult()) return SRC_ERROR_ILLEGAL_RESPONSE;
+	updateSettingsCache(response.getResultNode());
+
+	ofMutex::ScopedLock eventLock(mEventMutex);
+	CameraState state(mCameraState);
+	parseCameraState(response.getResultNode(), state);
+	// keep this response for getEvent(), the previous one is reused by the next poll
+	arena.swap(mLastEventArena);
+	if (state.cameraStatus != mCameraState.cameraStatus) mChangedStateFields |= STATE_CAMERA_STATUS;
+	if (state.hasShootMode && (!mCameraState.hasShootMode || state.shootMode != mCameraState.shootMode)) mChangedStateFields |= STATE_SHOOT_MODE;
+	if (state.zoomPosition != mCameraState.zoomPosition) mChangedStateFields |= STATE_ZOOM_POSITION;
+	if (state.availableApiList != mCameraState.availableApiList) mChangedStateFields |= STATE_AVAILABLE_API_LIST;
+	if (state.storageInformation != mCameraState.storageInformation) mChangedStateFields |= STATE_STORAGE_INFORMATION;
+	mCameraState = state;
+	mEventCondition.broadcast();
+	return SRC_OK;
+}
+
+void ofxSonyRemoteCamera::parseCameraState(const JsonArena::Node& eventArray, CameraState& state) const
+{
+	// fields which are not reported (null) keep their previous value
+	JsonArena::Node element(eventArray.getFirstChild());
+	for (size_t i(0); i<eventArray.size(); ++i, element=element.getNextSibling()) {
+		if (element.is(JsonArena::TYPE_ARRAY)) {
+			// storageInformation is reported as an array of objects
+			std::vector<StorageInformation> storages;
+			parseStorageInformation(element, storages);
+			if (!storages.empty()) state.storageInformation = storages;
+			continue;
+		}
+		const JsonArena::Node type(element.get("type"));
+		if (type.equals("availableApiList")) {
+			const JsonArena::Node names(element.get("names"));
+			if (!names.is(JsonArena::TYPE_ARRAY)) continue;
+			// rebuild the list only when it differs
+			bool isSame(names.size() == state.availableApiList.size());
+			JsonArena::Node name(names.getFirstChild());
+			for (size_t j(0); isSame && j<names.size(); ++j, name=name.getNextSibling()) {
+				isSame = name.equals(state.availableApiList[j].c_str());
+			}
+			if (isSame) continue;
+			state.availableApiList.clear();
+			name = names.getFirstChild();
+			for (size_t j(0); j<names.size(); ++j, name=name.getNextSibling()) {
+				if (name.is(JsonArena::TYPE_STRING)) state.availableApiList.push_back(name.getString());
+			}
+		} else if (type.equals("cameraStatus")) {
+			const JsonArena::Node status(element.get("cameraStatus"));
+			if (status.is(JsonArena::TYPE_STRING) && !status.equals(state.cameraStatus.c_str())) {
+				state.cameraStatus = status.getString();
+			}
+		} else if (type.equals("zoomInformation")) {
+			const JsonArena::Node position(element.get("zoomPosition"));
+			if (position.is(JsonArena::TYPE_NUMBER)) {
+				state.zoomPosition = position.getInt();
+			}
+		} else if (type.equals("shootMode")) {
+			if (cvtShootMode(element.get("currentShootMode").getString(), state.shootMode)) {
+				state.hasShootMode = true;
+			}
+		}
+	}
+}
+
+void ofxSonyRemoteCamera::notifyCameraStateChanges()
+{
+	int changedFields(0);
+	CameraState state;
+	{
+		ofMutex::ScopedLock eventLock(mEventMutex);
+		if (mChangedStateFields == 0) return;
+		changedFields = mChangedStateFields;
+		mChangedStateFields = 0;
+		state = mCameraState;
+	}
+	// notify without holding the lock so that listeners can call getCameraState()
+	if (changedFields & STATE_CAMERA_STATUS) ofNotifyEvent(cameraStatusChanged, state.cameraStatus);
+	if (changedFields & STATE_SHOOT_MODE) ofNotifyEvent(shootModeChanged, state.shootMode);
+	if (changedFields & STATE_ZOOM_POSITION) ofNotifyEvent(zoomPositionChanged, state.zoomPosition);
+	if (changedFields & STATE_AVAILABLE_API_LIST) ofNotifyEvent(availableApiListChanged, state.availableApiList);
+	if (changedFields & STATE_STORAGE_INFORMATION) ofNotifyEvent(storageInformationChanged, state.storageInformation);
+}
+
+void ofxSonyRemoteCamera::threadedFunction()
+{
+	while (isThreadRunning()) {
+		if (!updateLiveView()) {
+			this->sleep(1);
+		}
+		//updateRequest();
+	}
+}
+
+bool ofxSonyRemoteCamera::openLiveViewSession( const std::string& host, int port )
+{
+	mLiveViewSession.reset();
+	mLiveViewSession.setHost(host);
+	mLiveViewSession.setPort(port);
+	mLiveViewSession.setKeepAlive(true);
+
+	Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, mLiveViewPath, Poco::Net::HTTPMessage::HTTP_1_1);
+	Poco::Net::HTTPResponse response;
+	mLiveViewSession.sendRequest(request);
+	istream& res = mLiveViewSession.receiveResponse(response);
+	if (response.getStatus() == Poco::Net::HTTPResponse::HTTP_OK)
+	{
+		mpLiveViewStream = &res;
+		return true;
+	}
+	return false;;
+}
+
+void ofxSonyRemoteCamera::closeLiveViewSession()
+{
+	mpLiveViewStream = 0;
+	mLiveViewSession.reset();
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::requestLiveView(std::string& url, const char* pSize/*=0*/)
+{
+	waitForThread();
+	if (mpReactor) mpReactor->closeLiveView(*this);
+	mIsLiveViewStreaming = false;
+	closeLiveViewSession();
+
+	Response response;
+	SRCError err(pSize ? invoke<method::startLiveviewWithSize>(pSize, response) : invoke<method::startLiveview>(response));
+	if (err != SRC_OK) return err;
+	if (!response.getString(0, url)) return SRC_ERROR_ILLEGAL_RESPONSE;
+	return SRC_OK;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::connectLiveView(const std::string& url)
+{
+	if (mpReactor) {
+		// the reactor thread connects, getLiveViewFrameCount() tells when the first frame arrived
+		if (lock()) {
+			mLiveViewFrameCount = 0;
+			unlock();
+		}
+		if (!mpReactor->openLiveView(*this, url)) {
+			return SRC_ERROR_UNKNOWN;
+		}
+		mIsLiveViewStreaming = true;
+		return SRC_OK;
+	}
+	const Poco::URI uri(url);
+	mLiveViewPath = uri.getPathAndQuery();
+	if (!openLiveViewSession(uri.getHost(), uri.getPort())) {
+		return SRC_ERROR_UNKNOWN;;
+	}
+	if (lock()) {
+		mLiveViewFrameCount = 0;
+		unlock();
+	}
+	mIsLiveViewStreaming = true;
+	startThread();
+	return SRC_OK;
+}
+
+void ofxSonyRemoteCamera::runStartUp()
+{
+	StartUpPhase phase(STARTUP_CAPABILITIES);
+	try {
+		beginStartUpPhase(phase);
+		bool isLoaded;
+		{
+			ofMutex::ScopedLock capabilityLock(mCapabilityMutex);
+			isLoaded = mCapabilities.isValid;
+		}
+		if (!isLoaded && !loadCapabilities()) {
+			ofLogWarning("method table is not loaded, all methods are sent to the camera");
+			endStartUpPhase(phase, SRC_ERROR_UNKNOWN);
+		} else {
+			endStartUpPhase(phase, SRC_OK);
+		}
+
+		// cameras without startRecMode reject it locally once the method table is loaded
+		phase = STARTUP_REC_MODE;
+		beginStartUpPhase(phase);
+		endStartUpPhase(phase, startRecMode());
+
+		// settings are read over the snapshot connections while the liveview is being opened
+		mStartUpSettingsThread.start(mStartUpSettingsRunnable);
+
+		std::string url;
+		phase = STARTUP_LIVEVIEW_REQUEST;
+		beginStartUpPhase(phase);
+		SRCError err(requestLiveView(url));
+		endStartUpPhase(phase, err);
+
+		if (err == SRC_OK) {
+			phase = STARTUP_LIVEVIEW_CONNECTION;
+			beginStartUpPhase(phase);
+			err = connectLiveView(url);
+			endStartUpPhase(phase, err);
+		}
+		if (err == SRC_OK) {
+			phase = STARTUP_FIRST_FRAME;
+			beginStartUpPhase(phase);
+			const unsigned long long startTime(ofGetElapsedTimeMillis());
+			{
+				ofMutex::ScopedLock threadLock(mutex);
+				while (mLiveViewFrameCount == 0) {
+					const unsigned long long elapsed(ofGetElapsedTimeMillis() - startTime);
+					if (elapsed >= STARTUP_FIRST_FRAME_TIMEOUT) break;
+					mLiveViewFrameCondition.tryWait(mutex, static_cast<long>(STARTUP_FIRST_FRAME_TIMEOUT - elapsed));
+				}
+				err = mLiveViewFrameCount > 0 ? SRC_OK : SRC_ERROR_TIMEOUT;
+			}
+			endStartUpPhase(phase, err);
+		}
+	} catch (Poco::TimeoutException& e) {
+		ofLogError(e.displayText());
+		endStartUpPhase(phase, SRC_ERROR_TIMEOUT);
+	} catch (Poco::Exception& e) {
+		ofLogError(e.displayText());
+		endStartUpPhase(phase, SRC_ERROR_UNKNOWN);
+	}
+	mStartUpSettingsThread.join();
+
+	ofMutex::ScopedLock startUpLock(mStartUpMutex);
+	mStartUpReport.totalMicros = mStartUpTime.elapsed();
+	mStartUpReport.isFinished = true;
+	mIsStartUpFinished = true;
+}
+
+void ofxSonyRemoteCamera::runStartUpSettings()
+{
+	SettingsSnapshot snapshot;
+	beginStartUpPhase(STARTUP_SETTINGS);
+	const SRCError err(getSettingsSnapshot(snapshot));
+	{
+		ofMutex::ScopedLock startUpLock(mStartUpMutex);
+		mStartUpReport.settings = snapshot;
+	}
+	endStartUpPhase(STARTUP_SETTINGS, err);
+}
+
+void ofxSonyRemoteCamera::beginStartUpPhase(StartUpPhase phase)
+{
+	ofMutex::ScopedLock startUpLock(mStartUpMutex);
+	mStartUpReport.beginMicros[phase] = mStartUpTime.elapsed();
+}
+
+void ofxSonyRemoteCamera::endStartUpPhase(StartUpPhase phase, SRCError err)
+{
+	ofMutex::ScopedLock startUpLock(mStartUpMutex);
+	mStartUpReport.endMicros[phase] = mStartUpTime.elapsed();
+	mStartUpReport.errors[phase] = err;
+}
+
+bool ofxSonyRemoteCamera::updateLiveView()
+{
+	CommonHeader commonHeader;
+	PayloadHeader payloadHeader;
+	if (!updateCommonHeader(commonHeader)) return false;
+	if (!updatePayloadHeader(payloadHeader)) return false;
+	if (!updatePayloadData(commonHeader, payloadHeader)) return false;
+	//++mLiveViewFrameId;
+	return true;
+}
+
+bool ofxSonyRemoteCamera::updateCommonHeader(CommonHeader& header)
+{
+	if (mpLiveViewStream == 0) return false;
+
+	BYTE commonHeaderBytes[COMMON_HEADER_SIZE];
+	mpLiveViewStream->read((char*)commonHeaderBytes, COMMON_HEADER_SIZE);
+	// check header
+	if ((mpLiveViewStream->gcount() != COMMON_HEADER_SIZE) ||
+		(commonHeaderBytes[0] != COMMON_HEADER_START_BYTE)
+		) {
+			return false;	
+	}
+	header.payLoadType = bytesToInt(commonHeaderBytes, 1, 1);
+	header.frameId = bytesToInt(commonHeaderBytes, 2, 2);
+	header.timestamp = bytesToInt(commonHeaderBytes, 4, 4);
+	/*
+	std::cout << "startByte: " << (int)commonHeaderBytes[0] << std::endl;
+	std::cout << "payLoadType: " << header.payLoadType << std::endl;
+	std::cout << "sequenceNumber: " << header.frameId << std::endl;
+	std::cout << "timestamp: " << header.timestamp << std::endl;
+	*/
+	return true;
+}
+
+bool ofxSonyRemoteCamera::updatePayloadHeader(PayloadHeader& header)
+{
+	if (mpLiveViewStream == 0) return false;
+
+	BYTE payloadHeaderBytes[PAYLOAD_HEADER_SIZE];
+	mpLiveViewStream->read((char*)payloadHeaderBytes, PAYLOAD_HEADER_SIZE);
+	// check header
+	if ((mpLiveViewStream->gcount() != PAYLOAD_HEADER_SIZE) ||
+		(payloadHeaderBytes[0] != PAYLOAD_HEADER_START_BYTES[0]) ||
+		(payloadHeaderBytes[1] != PAYLOAD_HEADER_START_BYTES[1]) ||
+		(payloadHeaderBytes[2] != PAYLOAD_HEADER_START_BYTES[2]) ||
+		(payloadHeaderBytes[3] != PAYLOAD_HEADER_START_BYTES[3])
+		) {
+			return false;	
+	}
+	readPayloadHeader(payloadHeaderBytes, header);
+	return true;
+}
+
+bool ofxSonyRemoteCamera::updatePayloadData(const CommonHeader& commonHeader, const PayloadHeader& payloadHeader)
+{
+	if (mpLiveViewStream == 0) return false;
+	
+	// the buffer is kept for the next payload and read into directly.
+	// ofBuffer ends with a terminating zero which size() does not count
+	const int dataSize(payloadHeader.jpegSize);
+	mPayloadData.allocate(dataSize + 1);
+	mpLiveViewStream->read(mPayloadData.getBinaryBuffer(), dataSize);
+	if (mpLiveViewStream->gcount() != dataSize) return false;
+	mpLiveViewStream->ignore(payloadHeader.paddingSize);
+	if (mpLiveViewStream->gcount() != payloadHeader.paddingSize) return false;
+
+	if (commonHeader.payLoadType == PAYLOAD_TYPE_IMAGE) {
+		receiveLiveViewFrame(commonHeader, payloadHeader, mPayloadData);
+	} else if (commonHeader.payLoadType == PAYLOAD_TYPE_FRAME_INFORMATION) {
+		receiveFrameInformation(commonHeader, payloadHeader, mPayloadData.getBinaryBuffer(), dataSize);
+	}
+	// other payloads are skipped
+	return true;
+}
+
+void ofxSonyRemoteCamera::readPayloadHeader(BYTE bytes[], PayloadHeader& header) const
+{
+	header.jpegSize = bytesToInt(bytes, 4, 3);
+	header.paddingSize = bytesToInt(bytes, 7, 1);
+	// frame information only, reserved in image payloads
+	header.frameCount = bytesToInt(bytes, 10, 2);
+	header.frameDataSize = bytesToInt(bytes, 12, 2);
+}
+
+bool ofxSonyRemoteCamera::decodeLiveViewFrame(const ofBuffer& jpeg, const CommonHeader& commonHeader, LiveViewDecoder* pDefaultDecoder/*=0*/)
+{
+	LiveViewDecoder* pDecoder(pDefaultDecoder);
+	if (lock()) {
+		if (mpLiveViewDecoder) pDecoder = mpLiveViewDecoder;
+		unlock();
+	}
+	if (pDecoder) {
+		pDecoder->decode(*this, jpeg, commonHeader.timestamp, commonHeader.frameId);
+		return true;
+	}
+	// cvt jpeg to bitmap
+	bool isDecoded(false);
+	if (lock()) {
+		isDecoded = ofLoadImage(mLiveViewPixels, jpeg);
+		mLiveViewTimestamp = commonHeader.timestamp;
+		publishFrameInformation(commonHeader.frameId);
+		if ( (mLiveViewPixels.getWidth() != mImageSize.width) || (mLiveViewPixels.getHeight() != mImageSize.height)) {
+			mImageSize.width = mLiveViewPixels.getWidth();
+			mImageSize.height = mLiveViewPixels.getHeight();
+			mIsImageSizeUpdated = true;
+		}
+		unlock();
+	} else if (mIsVerbose) {
+		std::cout << "cannot lock" << std::endl;
+	}
+	return isDecoded;
+}
+
+void ofxSonyRemoteCamera::recordLiveViewFrame(const CommonHeader& commonHeader, const ofBuffer& jpeg)
+{
+	LiveViewRecorder* pRecorder(0);
+	if (lock()) {
+		pRecorder = mpLiveViewRecorder;
+		unlock();
+	}
+	if (pRecorder) pRecorder->record(*this, commonHeader, jpeg.getBinaryBuffer(), jpeg.size());
+}
+
+void ofxSonyRemoteCamera::receiveLiveViewFrame(const CommonHeader& commonHeader, const PayloadHeader& payloadHeader, const ofBuffer& jpeg, LiveViewDecoder* pDefaultDecoder/*=0*/)
+{
+	if (lock()) {
+		mCommonHeader = commonHeader;
+		mPayloadHeader = payloadHeader;
+		unlock();
+	}
+	recordLiveViewFrame(commonHeader, jpeg);
+	decodeLiveViewFrame(jpeg, commonHeader, pDefaultDecoder);
+	if (lock()) {
+		++mLiveViewFrameCount;
+		mLiveViewFrameCondition.broadcast();
+		unlock();
+	}
+}
+
+void ofxSonyRemoteCamera::receiveFrameInformation(const CommonHeader& commonHeader, const PayloadHeader& payloadHeader, const char* data, int size)
+{
+	FrameInformation information;
+	information.frameId = commonHeader.frameId;
+	information.timestamp = commonHeader.timestamp;
+	if (!parseFrameInformation(payloadHeader, data, size, information.frames)) {
+		ofLogError("liveview: malformed frame information of frame " + ofToString(commonHeader.frameId));
+		return;
+	}
+	if (!lock()) return;
+	// the image may arrive later, or be shown already
+	if (information.frameId == mLiveViewFrameId) mLiveViewFrameInformation = information;
+	mRecentFrameInformation.push_back(FrameInformation());
+	mRecentFrameInformation.back().frameId = information.frameId;
+	mRecentFrameInformation.back().timestamp = information.timestamp;
+	mRecentFrameInformation.back().frames.swap(information.frames);
+	// a decoder shows the image a few frames later at most
+	if (mRecentFrameInformation.size() > FRAME_INFORMATION_HISTORY) mRecentFrameInformation.pop_front();
+	unlock();
+}
+
+void ofxSonyRemoteCamera::publishFrameInformation(int frameId)
+{
+	mLiveViewFrameId = frameId;
+	for (std::deque<FrameInformation>::reverse_iterator it=mRecentFrameInformation.rbegin(); it!=mRecentFrameInformation.rend(); ++it) {
+		if (it->frameId == frameId) {
+			mLiveViewFrameInformation = *it;
+			return;
+		}
+	}
+	// the camera sends frame information only with some images, the last one stays valid
+}
+
+bool ofxSonyRemoteCamera::parseFrameInformation(const PayloadHeader& header, const char* data, int size, std::vector<FocusFrame>& frames)
+{
+	// each frame is 16 bytes: left, top, right, bottom (2 bytes each), category, status, additional status and reserved bytes
+	frames.clear();
+	if (header.frameCount == 0) return true;
+	if (header.frameDataSize < FOCUS_FRAME_MIN_SIZE || header.frameCount * header.frameDataSize > size) return false;
+	frames.resize(header.frameCount);
+	const unsigned char* pFrame(reinterpret_cast<const unsigned char*>(data));
+	for (std::vector<FocusFrame>::iterator it=frames.begin(); it!=frames.end(); ++it, pFrame+=header.frameDataSize) {
+		it->left = (pFrame[0] << 8) | pFrame[1];
+		it->top = (pFrame[2] << 8) | pFrame[3];
+		it->right = (pFrame[4] << 8) | pFrame[5];
+		it->bottom = (pFrame[6] << 8) | pFrame[7];
+		it->category = pFrame[8];
+		it->status = pFrame[9];
+		it->additionalStatus = pFrame[10];
+	}
+	return true;
+}
+
+void ofxSonyRemoteCamera::updateRequest()
+{
+	lock();
+	mHttpPostList = mHttpPostListEntry;
+	mHttpPostListEntry.clear();
+	unlock();
+	while (mHttpPostList.size()) {
+		const MyHttpPostRequest& post(mHttpPostList.front());
+		// parsed from the stream like the calls of invoke(), only errors are reported
+		Response response;
+		const Poco::Timestamp deadline(Poco::Timestamp() + static_cast<Poco::Timestamp::TimeDiff>(getMethodTimeout("")) * 1000);
+		try {
+			if (!httpPost(mSession, post.json.data(), post.json.size(), post.path, response, deadline)) {
+				ofLogError("JSON parse error: " + response.getParseError());
+			} else if (response.getErrorCode() != 0) {
+				ofLogError("async post: " + getErrorString(cvtError(response.getErrorCode())));
+			}
+		} catch (Poco::Exception& e) {
+			ofLogError("async post: " + e.displayText());
+			mSession.reset();
+		}
+		mHttpPostList.pop_front();
+	}
+}
+
+bool ofxSonyRemoteCamera::httpPost( Poco::Net::HTTPClientSession& session, const char* data, size_t size, const std::string& path, Response& response, const Poco::Timestamp& deadline )
+{
+	Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_POST, path, Poco::Net::HTTPMessage::HTTP_1_1);
+	request.setContentLength(size);
+	request.setContentType("application/json");
+	setSessionTimeout(session, deadline);
+	session.sendRequest(request).write(data, size);
+
+	// the rest of the time is left for the response
+	setSessionTimeout(session, deadline);
+	Poco::Net::HTTPResponse httpResponse;
+	std::istream& rs = session.receiveResponse(httpResponse);
+	// the header lines may have arrived one by one, each within the socket timeout
+	if (deadline <= Poco::Timestamp()) throw Poco::TimeoutException();
+	DeadlineStreamBuf body(rs, session, deadline);
+	if (httpResponse.getStatus() == Poco::Net::HTTPResponse::HTTP_UNAUTHORIZED) {
+		body.drain();
+		return false;
+	}
+	// parse straight from the stream, then drain it so that the session can be reused
+	std::istream bodyStream(&body);
+	const bool isParsed(response.read(bodyStream));
+	body.drain();
+	return isParsed;
+}
+
+ofxSonyRemoteCamera::DeadlineStreamBuf::DeadlineStreamBuf(std::istream& source, Poco::Net::HTTPClientSession& session, const Poco::Timestamp& deadline)
+	: mpSource(source.rdbuf())
+	, mSession(session)
+	, mDeadline(deadline)
+{
+	setg(mBuffer, mBuffer, mBuffer);
+}
+
+void ofxSonyRemoteCamera::DeadlineStreamBuf::drain()
+{
+	while (!traits_type::eq_int_type(underflow(), traits_type::eof())) {
+		setg(mBuffer, egptr(), egptr());
+	}
+}
+
+ofxSonyRemoteCamera::DeadlineStreamBuf::int_type ofxSonyRemoteCamera::DeadlineStreamBuf::underflow()
+{
+	if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+	// the socket is read only when the buffer of the source is empty
+	if (mpSource->in_avail() <= 0) setSessionTimeout(mSession, mDeadline);
+	if (traits_type::eq_int_type(mpSource->sgetc(), traits_type::eof())) return traits_type::eof();
+	const std::streamsize available(std::min(std::max(mpSource->in_avail(), static_cast<std::streamsize>(1)), static_cast<std::streamsize>(sizeof(mBuffer))));
+	const std::streamsize count(mpSource->sgetn(mBuffer, available));
+	if (count <= 0) return traits_type::eof();
+	setg(mBuffer, mBuffer, mBuffer + count);
+	return traits_type::to_int_type(*gptr());
+}
+
+std::string ofxSonyRemoteCamera::httpPostAsync( const std::string& json, const std::string& path )
+{
+	MyHttpPostRequest r(json, path);
+	lock();
+	mHttpPostListEntry.push_back(r);
+	unlock();
+	return "";
+}
+
+void ofxSonyRemoteCamera::setSessionTimeout(Poco::Net::HTTPClientSession& session, const Poco::Timestamp& deadline)
+{
+	const Poco::Timestamp now;
+	if (deadline <= now) throw Poco::TimeoutException();
+	const Poco::Timespan timeout(deadline - now);
+	// setTimeout is applied when connecting, a kept-alive socket needs the timeout directly
+	session.setTimeout(timeout);
+	if (session.connected()) {
+		session.socket().setReceiveTimeout(timeout);
+		session.socket().setSendTimeout(timeout);
+	}
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::send(Poco::Net::HTTPClientSession& session, const char* method, Service service, const RequestWriter& request, Response& response, const CallOptions& options)
+{
+	// the method table is of the camera service
+	if (service == SERVICE_CAMERA && !isMethodSupported(method)) {
+		return SRC_ERROR_NO_SUCH_METHOD;
+	}
+	if (request.isOverflow()) {
+		ofLogError("request is too long: " + std::string(method));
+		return SRC_ERROR_ILLEGAL_ARGUMENT;
+	}
+	RetryPolicy policy;
+	getRetryPolicy(policy);
+	const bool isIdempotent(isMethodIdempotent(method));
+
+	// one deadline for all attempts and their backoff
+	Poco::Timestamp startTime;
+	const unsigned long long timeoutMillis(options.timeoutMillis > 0 ? options.timeoutMillis : getMethodTimeout(method));
+	const Poco::Timestamp deadline(startTime + static_cast<Poco::Timestamp::TimeDiff>(timeoutMillis) * 1000);
+	SRCError err(sendOnce(session, method, service, request, response, deadline, options.pCancellationToken));
+	const Poco::Timestamp::TimeDiff firstAttemptTime(startTime.elapsed());
+	int timeouts(err == SRC_ERROR_TIMEOUT ? 1 : 0);
+	const int maxRetries(options.maxRetries >= 0 ? options.maxRetries : policy.maxRetries);
+	int retries(0);
+	while (retries < maxRetries && isRetryable(err, isIdempotent)) {
+		const SRCError waitErr(waitForRetry(retries + 1, policy, deadline, options.pCancellationToken));
+		if (waitErr != SRC_OK) {
+			if (waitErr == SRC_ERROR_TIMEOUT) ++timeouts;
+			err = waitErr;
+			break;
+		}
+		++retries;
+		if (mIsVerbose) ofLogNotice(std::string(method) + ": retry " + ofToString(retries) + " after " + getErrorString(err));
+		err = sendOnce(session, method, service, request, response, deadline, options.pCancellationToken);
+		if (err == SRC_ERROR_TIMEOUT) ++timeouts;
+	}
+	const Poco::Timestamp::TimeDiff totalTime(startTime.elapsed());
+
+	ofMutex::ScopedLock statsLock(mStatsMutex);
+	MethodStats& stats(mMethodStats[method]);
+	++stats.calls;
+	if (err != SRC_OK) ++stats.errors;
+	stats.timeouts += timeouts;
+	stats.retries += retries;
+	stats.totalRoundTripMicros += totalTime;
+	stats.totalRetryMicros += totalTime - firstAttemptTime;
+	return err;
+}
+
+bool ofxSonyRemoteCamera::isRetryable(SRCError err, bool isIdempotent) const
+{
+	switch (err) {
+	case SRC_ERROR_CAMERA_NOT_READY:
+		// the camera refused the request without acting on it
+		return true;
+	case SRC_ERROR_TIMEOUT:
+	case SRC_ERROR_CONNECTION_FAILED:
+	case SRC_ERROR_STILL_CAPTURING_NOT_FINISHED:
+		// the request may have been executed
+		return isIdempotent;
+	default:
+		return false;
+	}
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::waitForRetry(int retry, const RetryPolicy& policy, const Poco::Timestamp& deadline, CancellationToken* pToken)
+{
+	unsigned long long backoff(policy.initialBackoffMillis);
+	for (int i(1); i<retry && backoff < policy.maxBackoffMillis; ++i) {
+		backoff *= 2;
+	}
+	backoff = std::min(backoff, policy.maxBackoffMillis);
+	const float jitter(ofClamp(policy.jitter, 0.f, 1.f));
+	const unsigned long long waitMillis(static_cast<unsigned long long>(backoff * ofRandom(1.f - jitter, 1.f + jitter)));
+	// the retry would start after the deadline of the call
+	const Poco::Timestamp::TimeDiff remainingMicros(deadline - Poco::Timestamp());
+	if (remainingMicros <= static_cast<Poco::Timestamp::TimeDiff>(waitMillis) * 1000) return SRC_ERROR_TIMEOUT;
+
+	// sleep in slices so that a cancellation is not delayed by the backoff
+	const unsigned long long startTime(ofGetElapsedTimeMillis());
+	while (ofGetElapsedTimeMillis() - startTime < waitMillis) {
+		if (pToken && pToken->isCancelled()) return SRC_ERROR_CANCELLED;
+		Poco::Thread::sleep(10);
+	}
+	return (pToken && pToken->isCancelled()) ? SRC_ERROR_CANCELLED : SRC_OK;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::sendOnce(Poco::Net::HTTPClientSession& session, const char* method, Service service, const RequestWriter& request, Response& response,
+	const Poco::Timestamp& deadline, CancellationToken* pToken)
+{
+	if (pToken && !pToken->attach(&session)) {
+		return SRC_ERROR_CANCELLED;
+	}
+	bool isParsed(false);
+	bool isAborted(false);
+	SRCError err(SRC_OK);
+	try {
+		isParsed = httpPost(session, request.data(), request.size(), (service == SERVICE_AV_CONTENT) ? mSessionAvContentPath : mSessionCameraPath, response, deadline);
+	} catch (Poco::TimeoutException&) {
+		err = SRC_ERROR_TIMEOUT;
+		isAborted = true;
+	} catch (Poco::IOException& e) {
+		// includes Poco::Net::NetException, e.g. connection refused or reset
+		if (mIsVerbose) ofLogError(std::string(method) + ": " + e.displayText());
+		err = SRC_ERROR_CONNECTION_FAILED;
+		isAborted = true;
+	} catch (Poco::Exception& e) {
+		if (mIsVerbose) ofLogError(std::string(method) + ": " + e.displayText());
+		err = SRC_ERROR_UNKNOWN;
+		isAborted = true;
+	}
+	if (pToken) {
+		pToken->detach();
+		// an aborted socket may also end the response early without an exception
+		if ((isAborted || !isParsed) && pToken->isCancelled()) {
+			err = SRC_ERROR_CANCELLED;
+			isAborted = true;
+		}
+	}
+	if (isAborted) {
+		// the rest of the response may still arrive, the connection cannot be reused
+		session.reset();
+	} else if (!isParsed) {
+		ofLogError("JSON parse error: " + response.getParseError());
+		err = SRC_ERROR_ILLEGAL_RESPONSE;
+	} else if (response.getErrorCode() != 0) {
+		if (mIsVerbose) {
+			std::cout << response.getBody() << std::endl;
+		}
+		err = cvtError(response.getErrorCode());
+	}
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::cvtError(int errorcode) const {
+
+	if (SRC_OK <= errorcode && errorcode <= SRC_ERROR_UNSUPPORTED_OPERATION) {
+		return static_cast<SRCError>(errorcode);
+	}
+	if (SRC_ERROR_SHOOTING_FAIL <= errorcode && errorcode <= SRC_ERROR_STILL_CAPTURING_NOT_FINISHED) {
+		return static_cast<SRCError>(errorcode);
+	}
+	if (mIsVerbose) {
+		ofLogError("Error code: " + ofToString(errorcode));
+		ofLogError("Error code is HTTP status code or Unknown.");
+
+	}
+	return SRC_ERROR_UNKNOWN;
+}
+
+bool ofxSonyRemoteCamera::cvtShootMode(const std::string& str, ShootMode& mode) const
+{
+	if (str.compare("movie") == 0) {
+		mode = SHOOT_MODE_MOVIE;
+	} else if (str.compare("still") == 0) {
+		mode = SHOOT_MODE_STILL;
+	} else if (str.compare("intervalstill") == 0) {
+		mode = SHOOT_MODE_INTERVAL_STILL;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+bool ofxSonyRemoteCamera::cvtPostViewImageSize(const std::string& str, PostViewImageSize& size) const
+{
+	if (str.compare("Original") == 0) {
+		size = POST_VIEW_IMG_SIZE_ORIGINAL;
+	} else if (str.compare("2M") == 0) {
+		size = POST_VIEW_IMG_SIZE_2M;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+template <typename T>
+bool ofxSonyRemoteCamera::readCache(const CachedSetting<T>& setting, T& value)
+{
+	ofMutex::ScopedLock cacheLock(mCacheMutex);
+	if (!setting.isValid) return false;
+	if (mSettingsCacheMaxAge > 0 && ofGetElapsedTimeMillis() - setting.updatedTime > mSettingsCacheMaxAge) return false;
+	value = setting.value;
+	return true;
+}
+
+template <typename T>
+void ofxSonyRemoteCamera::writeCache(CachedSetting<T>& setting, const T& value)
+{
+	ofMutex::ScopedLock cacheLock(mCacheMutex);
+	setting.value = value;
+	setting.isValid = true;
+	setting.updatedTime = ofGetElapsedTimeMillis();
+}
+
+void ofxSonyRemoteCamera::updateSettingsCache(const JsonArena::Node& eventArray)
+{
+	// each changed setting is reported as {"type":"shootMode","currentShootMode":"still",...}
+	JsonArena::Node element(eventArray.getFirstChild());
+	for (size_t i(0); i<eventArray.size(); ++i, element=element.getNextSibling()) {
+		const JsonArena::Node type(element.get("type"));
+		if (!type.is(JsonArena::TYPE_STRING)) continue;
+
+		if (type.equals("shootMode")) {
+			ShootMode mode;
+			if (cvtShootMode(element.get("currentShootMode").getString(), mode)) {
+				writeCache(mSettingsCache.shootMode, mode);
+			}
+		} else if (type.equals("selfTimer")) {
+			const JsonArena::Node current(element.get("currentSelfTimer"));
+			if (current.is(JsonArena::TYPE_NUMBER)) {
+				writeCache(mSettingsCache.selfTimer, current.getInt());
+			}
+		} else if (type.equals("viewAngle")) {
+			const JsonArena::Node current(element.get("currentViewAngle"));
+			if (current.is(JsonArena::TYPE_NUMBER)) {
+				writeCache(mSettingsCache.viewAngle, current.getInt());
+			}
+		} else if (type.equals("postviewImageSize")) {
+			PostViewImageSize size;
+			if (cvtPostViewImageSize(element.get("currentPostviewImageSize").getString(), size)) {
+				writeCache(mSettingsCache.postViewImageSize, size);
+			}
+		} else if (type.equals("movieQuality")) {
+			const JsonArena::Node current(element.get("currentMovieQuality"));
+			if (current.is(JsonArena::TYPE_STRING)) {
+				writeCache(mSettingsCache.movieQuality, current.getString());
+			}
+		}
+	}
+}
+
+bool ofxSonyRemoteCamera::fetchCapabilities(Capabilities& capabilities)
+{
+	Response response(&mJsonArena);
+	if (invoke<method::getVersions>(response) != SRC_OK) return false;
+	const JsonArena::Node versions(response.getResultNode()[0]);
+	JsonArena::Node version(versions.getFirstChild());
+	for (size_t i(0); i<versions.size(); ++i, version=version.getNextSibling()) {
+		if (version.is(JsonArena::TYPE_STRING)) capabilities.versions.push_back(version.getString());
+	}
+
+	// an empty version lists the methods of all versions
+	// each entry is [name, parameter types, result types, version]
+	if (invoke<method::getMethodTypes>("", response) != SRC_OK) return false;
+	const JsonArena::Node methods(response.getResultNode());
+	JsonArena::Node method(methods.getFirstChild());
+	for (size_t i(0); i<methods.size(); ++i, method=method.getNextSibling()) {
+		if (method[0].is(JsonArena::TYPE_STRING)) capabilities.methods.push_back(method[0].getString());
+	}
+	return !capabilities.methods.empty();
+}
+
+bool ofxSonyRemoteCamera::readCapabilities(const std::string& path, Capabilities& capabilities) const
+{
+	std::ifstream file(path.c_str());
+	if (!file) return false;
+	picojson::value root;
+	const std::string err(picojson::parse(root, file));
+	if (!err.empty() || !root.is<picojson::object>()) {
+		ofLogWarning("cannot parse " + path + ": " + err);
+		return false;
+	}
+	// the file name is derived from the key, check it anyway
+	if (!root.get("applicationName").is<std::string>() || root.get("applicationName").get<std::string>() != capabilities.applicationName
+		|| !root.get("applicationVersion").is<std::string>() || root.get("applicationVersion").get<std::string>() != capabilities.applicationVersion
+		|| !root.get("versions").is<picojson::array>() || !root.get("methods").is<picojson::array>()) {
+		return false;
+	}
+	const picojson::array& versions(root.get("versions").get<picojson::array>());
+	for (picojson::array::const_iterator it=versions.begin(); it!=versions.end(); ++it) {
+		if (it->is<std::string>()) capabilities.versions.push_back(it->get<std::string>());
+	}
+	const picojson::array& methods(root.get("methods").get<picojson::array>());
+	for (picojson::array::const_iterator it=methods.begin(); it!=methods.end(); ++it) {
+		if (it->is<std::string>()) capabilities.methods.push_back(it->get<std::string>());
+	}
+	return !capabilities.methods.empty();
+}
+
+bool ofxSonyRemoteCamera::writeCapabilities(const std::string& path, const Capabilities& capabilities) const
+{
+	picojson::object root;
+	root["applicationName"] = picojson::value(capabilities.applicationName);
+	root["applicationVersion"] = picojson::value(capabilities.applicationVersion);
+	picojson::array versions, methods;
+	for (std::vector<std::string>::const_iterator it=capabilities.versions.begin(); it!=capabilities.versions.end(); ++it) {
+		versions.push_back(picojson::value(*it));
+	}
+	for (std::vector<std::string>::const_iterator it=capabilities.methods.begin(); it!=capabilities.methods.end(); ++it) {
+		methods.push_back(picojson::value(*it));
+	}
+	root["versions"] = picojson::value(versions);
+	root["methods"] = picojson::value(methods);
+
+	try {
+		Poco::File(Poco::Path(path).parent()).createDirectories();
+	} catch (Poco::Exception& e) {
+		ofLogError(e.displayText());
+		return false;
+	}
+	std::ofstream file(path.c_str());
+	if (!file) return false;
+	file << picojson::value(root).serialize();
+	return file.good();
+}
+
+std::string ofxSonyRemoteCamera::getCapabilityCachePath(const Capabilities& capabilities) const
+{
+	if (mCapabilityCacheDirectory.empty()) return "";
+	std::string name("capabilities_" + capabilities.applicationName + "_" + capabilities.applicationVersion);
+	for (std::string::iterator it=name.begin(); it!=name.end(); ++it) {
+		if (!isalnum(static_cast<unsigned char>(*it)) && *it != '.' && *it != '-') *it = '_';
+	}
+	return ofToDataPath(mCapabilityCacheDirectory + "/" + name + ".json", true);
+}
+
+int ofxSonyRemoteCamera::takePictureResult(const Response& response)
+{
+	// result is [["http://.../postview.jpg"]]
+	std::string url;
+	const picojson::array& resultArray(response.getResultArray());
+	if (!resultArray.empty() && resultArray[0].is<picojson::array>()) {
+		const picojson::array& urls(resultArray[0].get<picojson::array>());
+		if (!urls.empty() && urls[0].is<std::string>()) url = urls[0].get<std::string>();
+	} else {
+		response.getString(0, url);
+	}
+	if (url.empty()) return -1;
+
+	bool isAutoFetch(false);
+	{
+		// also called from the burst workers
+		ofMutex::ScopedLock postViewLock(mPostViewMutex);
+		mPostViewPath = url;
+		isAutoFetch = mPostViewOptions.isAutoFetch;
+	}
+	if (isAutoFetch) return enqueuePostView(url);
+	ofMutex::ScopedLock postViewLock(mPostViewMutex);
+	return mNextCaptureId++;
+}
+
+int ofxSonyRemoteCamera::enqueuePostView(const std::string& url)
+{
+	startPostViewWorkers();
+	ofMutex::ScopedLock postViewLock(mPostViewMutex);
+	PostViewJob job;
+	job.captureId = mNextCaptureId++;
+	job.url = url;
+	mPostViewJobs.push_back(job);
+	mPostViewCondition.signal();
+	return job.captureId;
+}
+
+bool ofxSonyRemoteCamera::nextPostViewJob(PostViewJob& job)
+{
+	ofMutex::ScopedLock postViewLock(mPostViewMutex);
+	while (mIsPostViewRunning && mPostViewJobs.empty()) {
+		mPostViewCondition.wait(mPostViewMutex);
+	}
+	if (!mIsPostViewRunning) return false;
+	job = mPostViewJobs.front();
+	mPostViewJobs.pop_front();
+	return true;
+}
+
+void ofxSonyRemoteCamera::downloadPostView(Poco::Net::HTTPClientSession& session, const PostViewJob& job)
+{
+	PostViewOptions options;
+	getPostViewOptions(options);
+
+	PostViewResult result;
+	result.captureId = job.captureId;
+	result.url = job.url;
+	Poco::Timestamp startTime;
+	try {
+		const Poco::URI uri(job.url);
+		if (session.getHost() != uri.getHost() || session.getPort() != uri.getPort()) {
+			session.reset();
+			session.setHost(uri.getHost());
+			session.setPort(uri.getPort());
+			session.setKeepAlive(true);
+		}
+		session.setTimeout(Poco::Timespan(static_cast<Poco::Timespan::TimeDiff>(options.timeoutMillis) * 1000));
+		Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, uri.getPathAndQuery(), Poco::Net::HTTPMessage::HTTP_1_1);
+		session.sendRequest(request);
+		Poco::Net::HTTPResponse response;
+		std::istream& rs(session.receiveResponse(response));
+		if (response.getStatus() != Poco::Net::HTTPResponse::HTTP_OK) {
+			rs.ignore((std::numeric_limits<std::streamsize>::max)());
+			result.err = SRC_ERROR_ILLEGAL_RESPONSE;
+		} else {
+			// stream to the file or to memory, progress is reported for every chunk
+			std::ofstream file;
+			if (!options.directory.empty()) {
+				Poco::File(ofToDataPath(options.directory, true)).createDirectories();
+				result.filePath = ofToDataPath(options.directory + "/" + Poco::Path(uri.getPath()).getFileName(), true);
+				file.open(result.filePath.c_str(), std::ios::binary);
+			}
+			PostViewProgress progress;
+			progress.captureId = job.captureId;
+			progress.bytesReceived = 0;
+			progress.contentLength = response.getContentLength();
+			// memory mode reads straight into the result, a body of unknown length grows it by doubling
+			const bool isMemory(!file.is_open());
+			size_t capacity(0);
+			if (isMemory) {
+				capacity = (progress.contentLength > 0) ? static_cast<size_t>(progress.contentLength) : POSTVIEW_CHUNK_SIZE;
+				// ofBuffer ends with a terminating zero which size() does not count
+				result.data.allocate(capacity + 1);
+			}
+			char chunk[POSTVIEW_CHUNK_SIZE];
+			BYTE tail[2] = {0, 0};
+			while (rs) {
+				char* pDestination(chunk);
+				size_t room(sizeof(chunk));
+				if (isMemory) {
+					if (progress.bytesReceived == capacity) {
+						// the announced length is read, the body has to end here
+						if (progress.contentLength > 0) {
+							rs.peek();
+							break;
+						}
+						ofBuffer grown;
+						grown.allocate(capacity * 2 + 1);
+						memcpy(grown.getBinaryBuffer(), result.data.getBinaryBuffer(), progress.bytesReceived);
+						result.data = grown;
+						capacity *= 2;
+					}
+					pDestination = result.data.getBinaryBuffer() + progress.bytesReceived;
+					room = std::min(room, capacity - progress.bytesReceived);
+				}
+				rs.read(pDestination, static_cast<std::streamsize>(room));
+				const size_t size(static_cast<size_t>(rs.gcount()));
+				if (size == 0) break;
+				if (!isMemory) file.write(chunk, size);
+				tail[0] = (size > 1) ? static_cast<BYTE>(pDestination[size - 2]) : tail[1];
+				tail[1] = static_cast<BYTE>(pDestination[size - 1]);
+				progress.bytesReceived += size;
+				setPostViewProgress(progress);
+			}
+			// the stream keeps the exception of a failed read to itself, and without a length
+			// only the end of image marker of the jpeg tells a whole body from a cut one
+			bool isComplete(!rs.bad() && rs.eof());
+			if (progress.contentLength >= 0) {
+				isComplete = isComplete && static_cast<long long>(progress.bytesReceived) == progress.contentLength;
+			} else {
+				isComplete = isComplete && tail[0] == 0xff && tail[1] == 0xd9;
+			}
+			if (isMemory && isComplete && capacity != progress.bytesReceived) {
+				result.data = ofBuffer(result.data.getBinaryBuffer(), progress.bytesReceived);
+			}
+			if (!isComplete || (file.is_open() && !file.good())) {
+				if (!isComplete) ofLogError("postview: incomplete body of " + job.url);
+				result.err = SRC_ERROR_CONNECTION_FAILED;
+			} else {
+				result.err = SRC_OK;
+				if (options.isDecode && file.is_open()) {
+					file.close();
+					result.isDecoded = ofLoadImage(result.pixels, result.filePath);
+				} else if (options.isDecode) {
+					result.isDecoded = ofLoadImage(result.pixels, result.data);
+				}
+			}
+		}
+	} catch (Poco::TimeoutException& e) {
+		ofLogError("postview: " + e.displayText());
+		result.err = SRC_ERROR_TIMEOUT;
+		session.reset();
+	} catch (Poco::IOException& e) {
+		ofLogError("postview: " + e.displayText());
+		result.err = SRC_ERROR_CONNECTION_FAILED;
+		session.reset();
+	} catch (Poco::Exception& e) {
+		ofLogError("postview: " + e.displayText());
+		result.err = SRC_ERROR_UNKNOWN;
+		session.reset();
+	}
+	// no partial body is handed out
+	if (result.err != SRC_OK) result.data.clear();
+	result.elapsedMicros = startTime.elapsed();
+
+	ofMutex::ScopedLock postViewLock(mPostViewMutex);
+	mPostViewResults.push_back(result);
+}
+
+void ofxSonyRemoteCamera::setPostViewProgress(const PostViewProgress& progress)
+{
+	ofMutex::ScopedLock postViewLock(mPostViewMutex);
+	mPostViewProgresses[progress.captureId] = progress;
+}
+
+void ofxSonyRemoteCamera::startPostViewWorkers()
+{
+	ofMutex::ScopedLock postViewLock(mPostViewMutex);
+	if (mIsPostViewRunning) return;
+	mIsPostViewRunning = true;
+	for (int i(0); i<mPostViewOptions.maxConcurrency; ++i) {
+		mPostViewWorkers.push_back(new PostViewWorker(*this));
+		mPostViewWorkers.back()->thread.start(*mPostViewWorkers.back());
+	}
+}
+
+void ofxSonyRemoteCamera::stopPostViewWorkers()
+{
+	{
+		ofMutex::ScopedLock postViewLock(mPostViewMutex);
+		if (!mIsPostViewRunning) return;
+		// the queued downloads are kept for the next workers
+		mIsPostViewRunning = false;
+		mPostViewCondition.broadcast();
+	}
+	for (std::vector<PostViewWorker*>::iterator it=mPostViewWorkers.begin(); it!=mPostViewWorkers.end(); ++it) {
+		(*it)->abort();
+		(*it)->thread.join();
+		delete *it;
+	}
+	mPostViewWorkers.clear();
+}
+
+void ofxSonyRemoteCamera::notifyPostViews()
+{
+	std::map<int, PostViewProgress> progresses;
+	std::deque<PostViewResult> results;
+	{
+		ofMutex::ScopedLock postViewLock(mPostViewMutex);
+		progresses.swap(mPostViewProgresses);
+		results.swap(mPostViewResults);
+	}
+	for (std::map<int, PostViewProgress>::iterator it=progresses.begin(); it!=progresses.end(); ++it) {
+		ofNotifyEvent(postViewProgress, it->second);
+	}
+	for (std::deque<PostViewResult>::iterator it=results.begin(); it!=results.end(); ++it) {
+		ofNotifyEvent(postViewFetched, *it);
+	}
+}
+
+void ofxSonyRemoteCamera::PostViewWorker::run()
+{
+	PostViewJob job;
+	while (mCamera.nextPostViewJob(job)) {
+		mCamera.downloadPostView(mSession, job);
+	}
+}
+
+void ofxSonyRemoteCamera::PostViewWorker::abort()
+{
+	try {
+		mSession.abort();
+	} catch (Poco::Exception&) {
+	}
+}
+
+void ofxSonyRemoteCamera::BurstWorker::run()
+{
+	while (mCamera.beginBurstShot()) {
+		int captureId(-1);
+		int awaitCalls(0);
+		// a busy camera is handled by endBurstShot(), not by the retries of the call
+		const SRCError err(mCamera.takePictureOn(channel, captureId, awaitCalls, CallOptions(0, &token, 0)));
+		mCamera.endBurstShot(err, captureId, awaitCalls);
+	}
+	mCamera.finishBurst();
+}
+
+void ofxSonyRemoteCamera::BurstWorker::abort()
+{
+	token.cancel();
+}
+
+bool ofxSonyRemoteCamera::beginBurstShot()
+{
+	ofMutex::ScopedLock burstLock(mBurstMutex);
+	while (true) {
+		if (mIsBurstStopping) return false;
+		if (mBurstOptions.shotCount > 0 && mBurstStartedShots >= mBurstOptions.shotCount) return false;
+		if (mBurstInFlight < mBurstReport.inFlightLimit) {
+			// the first shot does not wait for the interval
+			Poco::Timestamp::TimeDiff waitMicros(mBurstStartedShots == 0 ? 0 :
+				static_cast<Poco::Timestamp::TimeDiff>(mBurstOptions.minIntervalMillis) * 1000 - mLastBurstShotTime.elapsed());
+			waitMicros = std::max(waitMicros, mBurstResendTime - Poco::Timestamp());
+			if (waitMicros <= 0) {
+				++mBurstStartedShots;
+				++mBurstInFlight;
+				mLastBurstShotTime.update();
+				return true;
+			}
+			mBurstCondition.tryWait(mBurstMutex, std::max(1L, static_cast<long>(waitMicros / 1000)));
+		} else {
+			mBurstCondition.wait(mBurstMutex);
+		}
+	}
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::takePictureOn(Channel& channel, int& captureId, int& awaitCalls, const CallOptions& options/*=CallOptions()*/)
+{
+	Response response;
+	SRCError err(SRC_ERROR_UNKNOWN);
+	try {
+		err = invokeOn<method::actTakePicture>(channel.session, channel.writer, response, options);
+		// the capture takes longer than the camera waits for, the picture is received by awaitTakePicture
+		while (err == SRC_ERROR_STILL_CAPTURING_NOT_FINISHED && awaitCalls < MAX_AWAIT_CALLS) {
+			++awaitCalls;
+			err = invokeOn<method::awaitTakePicture>(channel.session, channel.writer, response, options);
+		}
+	} catch (Poco::Exception& e) {
+		ofLogError("actTakePicture: " + e.displayText());
+		err = SRC_ERROR_UNKNOWN;
+		channel.session.reset();
+	}
+	// the postview is downloaded by the postview workers while the next shots are taken
+	if (err == SRC_OK) captureId = takePictureResult(response);
+	return err;
+}
+
+void ofxSonyRemoteCamera::endBurstShot(SRCError err, int captureId, int awaitCalls)
+{
+	ofMutex::ScopedLock burstLock(mBurstMutex);
+	--mBurstInFlight;
+	mBurstReport.awaitCalls += awaitCalls;
+	if (err == SRC_OK) {
+		++mBurstReport.shots;
+		mBurstReport.captureIds.push_back(captureId);
+		mBurstShotTimes.push_back(Poco::Timestamp());
+		mBurstNotReadyInRow = 0;
+	} else if (err == SRC_ERROR_CAMERA_NOT_READY && mBurstNotReadyInRow < MAX_BURST_NOT_READY) {
+		// the camera takes fewer pictures at once than requested or is still busy, the shot is sent again a little later
+		++mBurstReport.notReadyCount;
+		++mBurstNotReadyInRow;
+		if (mBurstReport.inFlightLimit > 1) --mBurstReport.inFlightLimit;
+		--mBurstStartedShots;
+		mBurstResendTime.update();
+		mBurstResendTime += static_cast<Poco::Timestamp::TimeDiff>(BURST_NOT_READY_WAIT) * 1000;
+	} else {
+		++mBurstReport.failures;
+		mBurstReport.lastError = err;
+	}
+	mBurstCondition.broadcast();
+}
+
+void ofxSonyRemoteCamera::finishBurst()
+{
+	ofMutex::ScopedLock burstLock(mBurstMutex);
+	if (--mBurstRunningWorkers > 0) return;
+
+	BurstReport& report(mBurstReport);
+	report.elapsedMicros = mBurstStartTime.elapsed();
+	if (report.elapsedMicros > 0) report.shotsPerSecond = report.shots * 1000000.0f / report.elapsedMicros;
+	if (mBurstShotTimes.size() > 1) {
+		// the workers finish out of order
+		std::sort(mBurstShotTimes.begin(), mBurstShotTimes.end());
+		unsigned long long totalMicros(0);
+		report.minIntervalMicros = (std::numeric_limits<unsigned long long>::max)();
+		for (size_t i(1); i<mBurstShotTimes.size(); ++i) {
+			const unsigned long long interval(mBurstShotTimes[i] - mBurstShotTimes[i - 1]);
+			report.minIntervalMicros = std::min(report.minIntervalMicros, interval);
+			report.maxIntervalMicros = std::max(report.maxIntervalMicros, interval);
+			totalMicros += interval;
+		}
+		report.meanIntervalMicros = totalMicros / (mBurstShotTimes.size() - 1);
+	}
+	report.isFinished = true;
+	mIsBurstFinished = true;
+}
+
+void ofxSonyRemoteCamera::joinBurstWorkers()
+{
+	std::vector<BurstWorker*> workers;
+	{
+		ofMutex::ScopedLock burstLock(mBurstMutex);
+		workers.swap(mBurstWorkers);
+	}
+	for (std::vector<BurstWorker*>::iterator it=workers.begin(); it!=workers.end(); ++it) {
+		(*it)->thread.join();
+		delete *it;
+	}
+}
+
+void ofxSonyRemoteCamera::runIntervalCapture()
+{
+	IntervalOptions options;
+	{
+		ofMutex::ScopedLock intervalLock(mIntervalMutex);
+		options = mIntervalOptions;
+	}
+	if (options.isLatencyCompensated) measureIntervalLatency();
+
+	const Poco::Timestamp::TimeDiff interval(static_cast<Poco::Timestamp::TimeDiff>(options.intervalMillis) * 1000);
+	{
+		ofMutex::ScopedLock intervalLock(mIntervalMutex);
+		mIntervalStartTime.update();
+	}
+	const Poco::Timestamp startTime(mIntervalStartTime);
+	// slots are computed from the start time, so errors of one shot do not carry over to the next
+	int slot(0);
+	int shotsSinceProbe(0);
+	while (options.shotCount <= 0 || slot < options.shotCount) {
+		long long latency(0);
+		{
+			ofMutex::ScopedLock intervalLock(mIntervalMutex);
+			latency = mIntervalReport.latencyMicros;
+		}
+		const Poco::Timestamp scheduledTime(startTime + interval * slot);
+		IntervalShot shot;
+		shot.index = slot;
+		shot.scheduledMicros = interval * slot;
+		shot.isCatchUp = (scheduledTime + (-latency)) < Poco::Timestamp();
+		if (!waitForInterval(scheduledTime + (-latency))) break;
+
+		// sent once, a retry would be taken after the trigger time recorded here
+		shot.triggerErrorMicros = (Poco::Timestamp() - scheduledTime) + latency;
+		int awaitCalls(0);
+		shot.err = takePictureOn(mIntervalChannel, shot.captureId, awaitCalls, CallOptions(0, &mIntervalToken, 0));
+		if (mIsVerbose) {
+			ofLogNotice("interval: slot " + ofToString(slot) + " scheduled at " + ofToString(shot.scheduledMicros / 1000) + "ms, trigger error "
+				+ ofToString(shot.triggerErrorMicros) + "us, " + getErrorString(shot.err));
+		}
+		addIntervalShot(shot);
+		if (shot.err == SRC_ERROR_CANCELLED) break;
+		++slot;
+
+		// the camera was busy beyond the next slots
+		const Poco::Timestamp::TimeDiff late(Poco::Timestamp() - (startTime + interval * slot));
+		if (late > 0 && options.missPolicy == INTERVAL_MISS_SKIP) {
+			int skipped(static_cast<int>(late / interval) + 1);
+			if (options.shotCount > 0) skipped = std::min(skipped, options.shotCount - slot);
+			slot += skipped;
+			ofMutex::ScopedLock intervalLock(mIntervalMutex);
+			mIntervalReport.skipped += skipped;
+		}
+		if (options.isLatencyCompensated && ++shotsSinceProbe >= INTERVAL_LATENCY_PROBE_PERIOD) {
+			shotsSinceProbe = 0;
+			measureIntervalLatency();
+		}
+	}
+
+	ofMutex::ScopedLock intervalLock(mIntervalMutex);
+	mIntervalReport.elapsedMicros = mIntervalStartTime.elapsed();
+	mIntervalReport.isFinished = true;
+	mIsIntervalRunning = false;
+	mIsIntervalFinished = true;
+}
+
+long long ofxSonyRemoteCamera::measureRoundTrip(Channel& channel, CancellationToken* pToken)
+{
+	long long roundTrip(-1);
+	for (int i(0); i<LATENCY_PROBES; ++i) {
+		Response response;
+		const Poco::Timestamp sendTime;
+		try {
+			if (invokeOn<method::getVersions>(channel.session, channel.writer, response, CallOptions(0, pToken)) != SRC_OK) continue;
+		} catch (Poco::Exception&) {
+			channel.session.reset();
+			continue;
+		}
+		const long long elapsed(sendTime.elapsed());
+		if (roundTrip < 0 || elapsed < roundTrip) roundTrip = elapsed;
+	}
+	return roundTrip;
+}
+
+void ofxSonyRemoteCamera::measureIntervalLatency()
+{
+	// half of the shortest round trip of a cheap call, smoothed over the measurements
+	const long long roundTrip(measureRoundTrip(mIntervalChannel, &mIntervalToken));
+	if (roundTrip < 0) return;
+
+	ofMutex::ScopedLock intervalLock(mIntervalMutex);
+	long long& latency(mIntervalReport.latencyMicros);
+	latency = (latency == 0) ? roundTrip / 2 : static_cast<long long>(latency + INTERVAL_LATENCY_SMOOTHING * (roundTrip / 2 - latency));
+}
+
+bool ofxSonyRemoteCamera::waitForInterval(const Poco::Timestamp& time)
+{
+	ofMutex::ScopedLock intervalLock(mIntervalMutex);
+	while (!mIsIntervalStopping) {
+		const Poco::Timestamp::TimeDiff remaining(time - Poco::Timestamp());
+		if (remaining <= 0) return true;
+		// wakes up before the time and waits the rest in short steps, tryWait is not precise
+		if (remaining > 2000) {
+			mIntervalCondition.tryWait(mIntervalMutex, static_cast<long>((remaining - 1000) / 1000));
+		} else {
+			mIntervalMutex.unlock();
+			Poco::Thread::sleep(remaining > 1000 ? 1 : 0);
+			mIntervalMutex.lock();
+		}
+	}
+	return false;
+}
+
+void ofxSonyRemoteCamera::addIntervalShot(const IntervalShot& shot)
+{
+	ofMutex::ScopedLock intervalLock(mIntervalMutex);
+	IntervalReport& report(mIntervalReport);
+	if (shot.err == SRC_OK) {
+		++report.shots;
+		if (shot.isCatchUp) ++report.caughtUp;
+		const long long absError(shot.triggerErrorMicros < 0 ? -shot.triggerErrorMicros : shot.triggerErrorMicros);
+		mIntervalTotalAbsErrorMicros += absError;
+		report.meanAbsErrorMicros = mIntervalTotalAbsErrorMicros / report.shots;
+		report.maxAbsErrorMicros = std::max(report.maxAbsErrorMicros, absError);
+		report.lastErrorMicros = shot.triggerErrorMicros;
+	} else if (shot.err != SRC_ERROR_CANCELLED) {
+		++report.failures;
+	}
+	mIntervalShots.push_back(shot);
+}
+
+void ofxSonyRemoteCamera::runZoom()
+{
+	ZoomOptions options;
+	ZoomReport report;
+	{
+		ofMutex::ScopedLock zoomLock(mZoomMutex);
+		options = mZoomOptions;
+		report = mZoomReport;
+	}
+	const Poco::Timestamp startTime;
+	const Poco::Timestamp::TimeDiff timeout(static_cast<Poco::Timestamp::TimeDiff>(options.timeoutMillis) * 1000);
+	report.latencyMicros = measureRoundTrip(mZoomChannel, &mZoomToken);
+	report.speed = mZoomSpeed;
+	report.err = SRC_OK;
+
+	int position(-1);
+	{
+		ofMutex::ScopedLock eventLock(mEventMutex);
+		position = mCameraState.zoomPosition;
+	}
+	// the first getEvent may not have arrived yet
+	if (position < 0) position = waitForZoomPosition(position, static_cast<long>(options.timeoutMillis));
+	report.startPosition = position;
+	if (position < 0) report.err = SRC_ERROR_ILLEGAL_STATE;
+
+	int lastDirection(0);
+	int reversals(0);
+	int stuckSteps(0);
+	while (report.err == SRC_OK) {
+		{
+			ofMutex::ScopedLock zoomLock(mZoomMutex);
+			if (mIsZoomStopping) {
+				report.err = SRC_ERROR_CANCELLED;
+				break;
+			}
+		}
+		if (startTime.isElapsed(timeout)) {
+			report.err = SRC_ERROR_TIMEOUT;
+			break;
+		}
+		const int distance(report.target - position);
+		if (std::abs(distance) <= options.tolerance) {
+			report.isSettled = true;
+			report.settleMicros = startTime.elapsed();
+			break;
+		}
+		const int direction(distance > 0 ? 1 : -1);
+		if (lastDirection != 0 && direction != lastDirection && ++reversals > ZOOM_MAX_REVERSALS) {
+			// the steps are larger than the tolerance
+			break;
+		}
+		lastDirection = direction;
+
+		// continuous zoom keeps moving for about one round trip after stop is decided
+		const float coast(mZoomSpeed * report.latencyMicros / 1000000.0f);
+		const int lastPosition(position);
+		if (std::abs(distance) > std::max(2.0f * coast, static_cast<float>(ZOOM_MIN_CONTINUOUS_DISTANCE))) {
+			moveZoomContinuously(direction, position, report);
+		} else {
+			moveZoomOneShot(direction, position, report);
+		}
+		report.overshoot = std::max(report.overshoot, (position - report.target) * direction);
+		// the zoom is at the end of its range
+		stuckSteps = (position == lastPosition) ? stuckSteps + 1 : 0;
+		if (stuckSteps >= ZOOM_MAX_STUCK_STEPS) break;
+		report.speed = mZoomSpeed;
+		report.finalPosition = position;
+		publishZoomReport(report);
+	}
+	report.finalPosition = position;
+	if (mIsVerbose) {
+		ofLogNotice("zoom: " + ofToString(report.startPosition) + " -> " + ofToString(report.finalPosition) + " (target " + ofToString(report.target)
+			+ "), overshoot " + ofToString(report.overshoot) + ", settle " + ofToString(report.settleMicros / 1000) + "ms, " + getErrorString(report.err));
+	}
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::stopIntervalStillRec()
-{
-	const std::string json(httpPost(createJson("stopIntervalStillRec"), mSessionCameraPath));
-	return checkError(json);
+	report.isFinished = true;
+	publishZoomReport(report);
+	ofMutex::ScopedLock zoomLock(mZoomMutex);
+	mIsZoomRunning = false;
+	mIsZoomFinished = true;
 }
 
-
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSupportedViewAngle( std::string& json )
+void ofxSonyRemoteCamera::moveZoomContinuously(int direction, int& position, ZoomReport& report)
 {
-	json = httpPost(createJson("getSupportedViewAngle"), mSessionCameraPath);
-	return checkError(json);
+	if (sendZoomCommand(direction, "start", report) != SRC_OK) return;
+	++report.continuousMoves;
+
+	// stops when the remaining distance is covered during one round trip
+	const Poco::Timestamp startTime;
+	const int startPosition(position);
+	const long feedbackTimeout(std::max(ZOOM_SETTLE_WINDOW, static_cast<long>(2 * report.latencyMicros / 1000)));
+	while (true) {
+		const int lastPosition(position);
+		position = waitForZoomPosition(position, feedbackTimeout);
+		if (position != startPosition) {
+			const float speed(std::abs(position - startPosition) * 1000000.0f / std::max(static_cast<Poco::Timestamp::TimeDiff>(1), startTime.elapsed()));
+			mZoomSpeed += ZOOM_SMOOTHING * (speed - mZoomSpeed);
+		}
+		const float coast(mZoomSpeed * report.latencyMicros / 1000000.0f);
+		const int remaining((report.target - position) * direction);
+		if (remaining <= coast + 0.5f || position == lastPosition) break;
+		ofMutex::ScopedLock zoomLock(mZoomMutex);
+		if (mIsZoomStopping) break;
+	}
+	// stop is sent even if the controller is stopped
+	sendZoomCommand(direction, "stop", report, false);
+	position = waitForZoomSettled(position, report);
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableViewAngle( std::string& json )
+void ofxSonyRemoteCamera::moveZoomOneShot(int direction, int& position, ZoomReport& report)
 {
-	json = httpPost(createJson("getAvailableViewAngle"), mSessionCameraPath);
-	return checkError(json);
+	if (sendZoomCommand(direction, "1shot", report) != SRC_OK) return;
+	++report.oneShotSteps;
+	position = waitForZoomSettled(position, report);
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getViewAngle( int& angle )
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::sendZoomCommand(int direction, const char* movement, ZoomReport& report, bool isCancellable/*=true*/)
 {
-	const std::string json(httpPost(createJson("getViewAngle"), mSessionCameraPath));
-	SRCError err(checkError(json));
-	if (err != SRC_OK) return err;
+	// limits the command rate
+	{
+		ofMutex::ScopedLock zoomLock(mZoomMutex);
+		const Poco::Timestamp::TimeDiff interval(static_cast<Poco::Timestamp::TimeDiff>(1000000 / mZoomOptions.maxCommandsPerSecond));
+		while (!(isCancellable && mIsZoomStopping)) {
+			const Poco::Timestamp::TimeDiff remaining(interval - mLastZoomCommandTime.elapsed());
+			if (remaining <= 0) break;
+			mZoomCondition.tryWait(mZoomMutex, std::max(1L, static_cast<long>(remaining / 1000)));
+		}
+		if (isCancellable && mIsZoomStopping) return SRC_ERROR_CANCELLED;
+		mLastZoomCommandTime.update();
+	}
+	Response response;
+	const Poco::Timestamp sendTime;
+	SRCError err(SRC_ERROR_UNKNOWN);
+	try {
+		err = invokeOn<method::actZoom>(mZoomChannel.session, mZoomChannel.writer, direction > 0 ? "in" : "out", movement, response,
+			CallOptions(0, isCancellable ? &mZoomToken : 0));
+	} catch (Poco::Exception& e) {
+		ofLogError("actZoom: " + e.displayText());
+		mZoomChannel.session.reset();
+	}
+	++report.commands;
+	if (err == SRC_OK) {
+		const long long roundTrip(sendTime.elapsed());
+		report.latencyMicros = (report.latencyMicros <= 0) ? roundTrip : static_cast<long long>(report.latencyMicros + ZOOM_SMOOTHING * (roundTrip - report.latencyMicros));
+	} else if (err != SRC_ERROR_CANCELLED) {
+		report.err = err;
+	}
+	return err;
+}
 
-	picojson::array resultArray;
-	if (getJsonResultArray(resultArray, json)) {
-		angle = resultArray[0].get<double>();
-		return SRC_OK;
+int ofxSonyRemoteCamera::waitForZoomPosition(int lastPosition, long timeoutMillis)
+{
+	ofMutex::ScopedLock eventLock(mEventMutex);
+	const Poco::Timestamp startTime;
+	while (mCameraState.zoomPosition == lastPosition) {
+		const long remaining(timeoutMillis - static_cast<long>(startTime.elapsed() / 1000));
+		if (remaining <= 0 || !mEventCondition.tryWait(mEventMutex, remaining)) break;
 	}
-	return SRC_ERROR_UNKNOWN;	
+	return mCameraState.zoomPosition;
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::setViewAngle(int angle)
+int ofxSonyRemoteCamera::waitForZoomSettled(int position, ZoomReport& report)
 {
-	std::vector<picojson::value> params(1);
-	params[0] = static_cast<picojson::value>(static_cast<double>(angle));
-	const std::string json(httpPost(createJson("setViewAngle", params), mSessionCameraPath));
-	return checkError(json);
+	// the position is final when it did not change for a while
+	const long window(std::max(ZOOM_SETTLE_WINDOW, static_cast<long>(2 * report.latencyMicros / 1000)));
+	while (true) {
+		const int nextPosition(waitForZoomPosition(position, window));
+		if (nextPosition == position) return position;
+		position = nextPosition;
+	}
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSupportedMovieQuality( std::string& json )
+void ofxSonyRemoteCamera::publishZoomReport(const ZoomReport& report)
 {
-	json = httpPost(createJson("getSupportedMovieQuality"), mSessionCameraPath);
-	return checkError(json);
+	ofMutex::ScopedLock zoomLock(mZoomMutex);
+	mZoomReport = report;
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableMovieQuality( std::string& json )
+void ofxSonyRemoteCamera::SnapshotWorker::run()
 {
-	json = httpPost(createJson("getAvailableMovieQuality"), mSessionCameraPath);
-	return checkError(json);
+	for (int field(mCamera.nextSnapshotField()); field<SNAPSHOT_FIELD_NUM; field=mCamera.nextSnapshotField()) {
+		mCamera.fetchSnapshotField(mChannel.session, mChannel.writer, mChannel.arena, field, mSnapshot);
+	}
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getMovieQuality( std::string& json )
+int ofxSonyRemoteCamera::nextSnapshotField()
 {
-	json = httpPost(createJson("getMovieQuality"), mSessionCameraPath);
-	return checkError(json);
+	ofMutex::ScopedLock snapshotLock(mSnapshotMutex);
+	return mNextSnapshotField++;
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::setMovieQuality( const std::string& quality )
+void ofxSonyRemoteCamera::fetchSnapshotField(Poco::Net::HTTPClientSession& session, RequestWriter& writer, JsonArena& arena, int field, SettingsSnapshot& snapshot)
 {
-	std::vector<picojson::value> params(1);
-	params[0] = static_cast<picojson::value>(static_cast<std::string>(quality));
-	const std::string json(httpPost(createJson("setMovieQuality", params), mSessionCameraPath));
-	return checkError(json);
+	// each field is written by one thread only
+	Response response(&arena);
+	SRCError& err(snapshot.errors[field]);
+	try {
+		switch (field) {
+		case SNAPSHOT_SHOOT_MODE:
+			{
+				std::string mode;
+				err = invokeOn<method::getShootMode>(session, writer, response);
+				if (err == SRC_OK && !(response.getString(0, mode) && cvtShootMode(mode, snapshot.shootMode))) err = SRC_ERROR_ILLEGAL_RESPONSE;
+				if (err == SRC_OK) writeCache(mSettingsCache.shootMode, snapshot.shootMode);
+			}
+			break;
+		case SNAPSHOT_SELF_TIMER:
+			err = invokeOn<method::getSelfTimer>(session, writer, response);
+			if (err == SRC_OK && !response.getInt(0, snapshot.selfTimer)) err = SRC_ERROR_ILLEGAL_RESPONSE;
+			if (err == SRC_OK) writeCache(mSettingsCache.selfTimer, snapshot.selfTimer);
+			break;
+		case SNAPSHOT_VIEW_ANGLE:
+			err = invokeOn<method::getViewAngle>(session, writer, response);
+			if (err == SRC_OK && !response.getInt(0, snapshot.viewAngle)) err = SRC_ERROR_ILLEGAL_RESPONSE;
+			if (err == SRC_OK) writeCache(mSettingsCache.viewAngle, snapshot.viewAngle);
+			break;
+		case SNAPSHOT_MOVIE_QUALITY:
+			err = invokeOn<method::getMovieQuality>(session, writer, response);
+			if (err == SRC_OK && !response.getString(0, snapshot.movieQuality)) err = SRC_ERROR_ILLEGAL_RESPONSE;
+			if (err == SRC_OK) writeCache(mSettingsCache.movieQuality, snapshot.movieQuality);
+			break;
+		case SNAPSHOT_POST_VIEW_IMAGE_SIZE:
+			{
+				std::string size;
+				err = invokeOn<method::getPostviewImageSize>(session, writer, response);
+				if (err == SRC_OK && !(response.getString(0, size) && cvtPostViewImageSize(size, snapshot.postViewImageSize))) err = SRC_ERROR_ILLEGAL_RESPONSE;
+				if (err == SRC_OK) writeCache(mSettingsCache.postViewImageSize, snapshot.postViewImageSize);
+			}
+			break;
+		case SNAPSHOT_STEADY_MODE:
+			err = invokeOn<method::getSteadyMode>(session, writer, response);
+			if (err == SRC_OK && !response.getString(0, snapshot.steadyMode)) err = SRC_ERROR_ILLEGAL_RESPONSE;
+			break;
+		case SNAPSHOT_STORAGE_INFORMATION:
+			err = invokeOn<method::getStorageInformation>(session, writer, response);
+			if (err == SRC_OK) parseStorageInformation(response.getResultNode()[0], snapshot.storageInformation);
+			break;
+		case SNAPSHOT_AVAILABLE_API_LIST:
+			{
+				err = invokeOn<method::getAvailableApiList>(session, writer, response);
+				if (err != SRC_OK) break;
+				const JsonArena::Node names(response.getResultNode()[0]);
+				JsonArena::Node name(names.getFirstChild());
+				for (size_t i(0); i<names.size(); ++i, name=name.getNextSibling()) {
+					if (name.is(JsonArena::TYPE_STRING)) snapshot.availableApiList.push_back(name.getString());
+				}
+			}
+			break;
+		case SNAPSHOT_APPLICATION_INFO:
+			err = invokeOn<method::getApplicationInfo>(session, writer, response);
+			if (err == SRC_OK && !(response.getString(0, snapshot.applicationName) && response.getString(1, snapshot.applicationVersion))) err = SRC_ERROR_ILLEGAL_RESPONSE;
+			break;
+		case SNAPSHOT_VERSIONS:
+			{
+				err = invokeOn<method::getVersions>(session, writer, response);
+				if (err != SRC_OK) break;
+				const JsonArena::Node versions(response.getResultNode()[0]);
+				JsonArena::Node version(versions.getFirstChild());
+				for (size_t i(0); i<versions.size(); ++i, version=version.getNextSibling()) {
+					if (version.is(JsonArena::TYPE_STRING)) snapshot.versions.push_back(version.getString());
+				}
+			}
+			break;
+		}
+	} catch (Poco::TimeoutException& e) {
+		ofLogError(e.displayText());
+		err = SRC_ERROR_TIMEOUT;
+		session.reset();
+	} catch (Poco::Exception& e) {
+		ofLogError(e.displayText());
+		err = SRC_ERROR_UNKNOWN;
+		session.reset();
+	}
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getSupportedSteadyMode( std::string& json )
+void ofxSonyRemoteCamera::resetChannels()
 {
-	json = httpPost(createJson("getSupportedSteadyMode"), mSessionCameraPath);
-	return checkError(json);
+	ofMutex::ScopedLock snapshotRunLock(mSnapshotRunMutex);
+	while (static_cast<int>(mChannels.size()) > mSnapshotConcurrency) {
+		delete mChannels.back();
+		mChannels.pop_back();
+	}
+	while (static_cast<int>(mChannels.size()) < mSnapshotConcurrency) {
+		mChannels.push_back(new Channel());
+	}
+	for (std::vector<Channel*>::iterator it=mChannels.begin(); it!=mChannels.end(); ++it) {
+		(*it)->session.reset();
+		(*it)->session.setHost(mSession.getHost());
+		(*it)->session.setPort(mSession.getPort());
+		(*it)->session.setKeepAlive(true);
+	}
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableSteadyMode( std::string& json )
+void ofxSonyRemoteCamera::parseStorageInformation(const JsonArena::Node& storageArray, std::vector<StorageInformation>& storages) const
 {
-	json = httpPost(createJson("getAvailableSteadyMode"), mSessionCameraPath);
-	return checkError(json);
+	JsonArena::Node obj(storageArray.getFirstChild());
+	for (size_t i(0); i<storageArray.size(); ++i, obj=obj.getNextSibling()) {
+		if (!obj.get("type").equals("storageInformation")) continue;
+		StorageInformation storage;
+		storage.storageId = obj.get("storageID").getString();
+		storage.storageDescription = obj.get("storageDescription").getString();
+		storage.isRecordTarget = obj.get("recordTarget").getBool();
+		if (obj.get("numberOfRecordableImages").is(JsonArena::TYPE_NUMBER)) storage.numberOfRecordableImages = obj.get("numberOfRecordableImages").getInt();
+		if (obj.get("recordableTime").is(JsonArena::TYPE_NUMBER)) storage.recordableTime = obj.get("recordableTime").getInt();
+		storages.push_back(storage);
+	}
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getStorageInformation( std::string& json )
+ofxSonyRemoteCamera::Response::Response(JsonArena* pArena/*=0*/)
+	: mpArena(pArena)
 {
-	json = httpPost(createJson("getStorageInformation"), mSessionCameraPath);
-	return checkError(json);
+	clear();
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::getAvailableCameraFunction( std::string& json )
+void ofxSonyRemoteCamera::Response::clear()
 {
-	json = httpPost(createJson("getAvailableCameraFunction"), mSessionCameraPath);
-	return checkError(json);
+	mResultArray.clear();
+	if (mpArena) mpArena->clear();
+	mHasResult = false;
+	mId = 0;
+	mErrorCode = 0;
+	mErrorMessage.clear();
+	mParseError.clear();
 }
 
-//////////////////////////////////////////////////////////////////////////
-// Helper Functions
-//////////////////////////////////////////////////////////////////////////
-std::string ofxSonyRemoteCamera::getErrorString(SRCError err) const
+bool ofxSonyRemoteCamera::Response::parse(const char* begin, const char* end)
 {
-	switch (err) {
-	case SRC_OK:
-		return "OK";
-	case SRC_ERROR_ANY:
-		return "ERROR_ANY";
-	case SRC_ERROR_TIMEOUT:
-		return "ERROR_TIMEOUT";
-	case SRC_ERROR_ILLEGAL_ARGUMENT:
-		return "ERROR_ILLEGAL_ARGUMENT";
-	case SRC_ERROR_ILLEGAL_DATA_FORMAT:
-		return "ERROR_ILLEGAL_DATA_FORMAT";
-	case SRC_ERROR_ILLEGAL_REQUEST:
-		return "ERROR_ILLEGAL_REQUEST";
-	case SRC_ERROR_ILLEGAL_RESPONSE:
-		return "ERROR_ILLEGAL_RESPONSE";
-	case SRC_ERROR_ILLEGAL_STATE:
-		return "ERROR_ILLEGAL_STATE";
-	case SRC_ERROR_ILLEGAL_TYPE:
-		return "ERROR_ILLEGAL_TYPE";
-	case SRC_ERROR_INDEX_OUT_OF_BOUNDS:
-		return "ERROR_INDEX_OUT_OF_BOUNDS";
-	case SRC_ERROR_NO_SUCH_ELEMENT:
-		return "ERROR_NO_SUCH_ELEMENT";
-	case SRC_ERROR_NO_SUCH_FIELD:
-		return "ERROR_NO_SUCH_FIELD";
-	case SRC_ERROR_NO_SUCH_METHOD:
-		return "ERROR_NO_SUCH_METHOD";
-	case SRC_ERROR_NULL_POINTER:
-		return "ERROR_NULL_POINTER";
-	case SRC_ERROR_UNSUPPORTED_VERSION:
-		return "ERROR_UNSUPPORTED_VERSION";
-	case SRC_ERROR_UNSUPPORTED_OPERATION:
-		return "ERROR_UNSUPPORTED_OPERATION";
-	case SRC_ERROR_SHOOTING_FAIL:
-		return "ERROR_SHOOTING_FAIL";
-	case SRC_ERROR_CAMERA_NOT_READY:
-		return "ERROR_CAMERA_NOT_READY";
-	case SRC_ERROR_ALREADY_RUNNING_POLLING_API:
-		return "ERROR_ALREADY_RUNNING_POLLING_API";
-	case SRC_ERROR_STILL_CAPTURING_NOT_FINISHED:
-		return "ERROR_STILL_CAPTURING_NOT_FINISHED";
-	}
-	return "ERROR_UNKNOWN";
+	picojson::input<const char*> in(begin, end);
+	return parse(in);
 }
 
-std::string ofxSonyRemoteCamera::getShootModeString(ShootMode mode) const
+bool ofxSonyRemoteCamera::Response::read(std::istream& stream)
 {
-	switch (mode) {
-	case SHOOT_MODE_MOVIE:
-		return "MOVIE";
-	case SHOOT_MODE_STILL:
-		return "STILL";
-	case SHOOT_MODE_INTERVAL_STILL:
-		return "INTERVAL STILL";
-	}
-	return "UNKNOWN";
+	picojson::input<std::istreambuf_iterator<char> > in(std::istreambuf_iterator<char>(stream.rdbuf()), std::istreambuf_iterator<char>());
+	return parse(in);
 }
 
-//////////////////////////////////////////////////////////////////////////
-// private functions
-//////////////////////////////////////////////////////////////////////////
-void ofxSonyRemoteCamera::threadedFunction()
+template <typename Iter>
+bool ofxSonyRemoteCamera::Response::parseMemberName(picojson::input<Iter>& in)
 {
-	while (isThreadRunning()) {
-		if (!updateLiveView()) {
-			this->sleep(1);
+	// the same decoding as picojson::_parse_string, which allocates a new string for every name
+	mMemberName.clear();
+	while (true) {
+		int ch(in.getc());
+		if (ch < ' ') {
+			in.ungetc();
+			return false;
+		} else if (ch == '"') {
+			return true;
+		} else if (ch == '\\') {
+			if ((ch = in.getc()) == -1) return false;
+			switch (ch) {
+			case '"': mMemberName.push_back('"'); break;
+			case '\\': mMemberName.push_back('\\'); break;
+			case '/': mMemberName.push_back('/'); break;
+			case 'b': mMemberName.push_back('\b'); break;
+			case 'f': mMemberName.push_back('\f'); break;
+			case 'n': mMemberName.push_back('\n'); break;
+			case 'r': mMemberName.push_back('\r'); break;
+			case 't': mMemberName.push_back('\t'); break;
+			case 'u':
+				if (!picojson::_parse_codepoint(mMemberName, in)) return false;
+				break;
+			default:
+				return false;
+			}
+		} else {
+			mMemberName.push_back(static_cast<char>(ch));
 		}
-		//updateRequest();
 	}
+	return false;
 }
 
-bool ofxSonyRemoteCamera::openLiveViewSession( const std::string& host, int port )
+template <typename Iter>
+bool ofxSonyRemoteCamera::Response::parse(picojson::input<Iter>& in)
 {
-	mLiveViewSession.reset();
-	mLiveViewSession.setHost(host);
-	mLiveViewSession.setPort(port);
-	mLiveViewSession.setKeepAlive(true);
+	clear();
+	if (!in.expect('{')) {
+		mParseError = "response is not an object";
+		return false;
+	}
+	if (in.expect('}')) return true;
 
-	Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, mLiveViewPath, Poco::Net::HTTPMessage::HTTP_1_1);
-	Poco::Net::HTTPResponse response;
-	mLiveViewSession.sendRequest(request);
-	istream& res = mLiveViewSession.receiveResponse(response);
-	if (response.getStatus() == Poco::Net::HTTPResponse::HTTP_OK)
-	{
-		mpLiveViewStream = &res;
-		return true;
+	do {
+		if (!in.expect('"') || !parseMemberName(in) || !in.expect(':')) {
+			mParseError = "syntax error at line " + ofToString(in.line());
+			return false;
+		}
+		const std::string& keyStr(mMemberName);
+		bool isParsed(false);
+		// getMethodTypes reports its table as "results"
+		const bool isResult(keyStr.compare("result") == 0 || keyStr.compare("results") == 0);
+		if (isResult && mpArena) {
+			isParsed = mpArena->parse(in) && mpArena->getRoot().is(JsonArena::TYPE_ARRAY);
+			mHasResult = isParsed;
+		} else if (isResult) {
+			// elements are parsed into the result array directly
+			if (in.expect('[')) {
+				mHasResult = true;
+				isParsed = in.expect(']');
+				if (!isParsed) {
+					do {
+						mResultArray.push_back(picojson::value());
+						isParsed = picojson::_parse(mResultArray.back(), in);
+					} while (isParsed && in.expect(','));
+					isParsed = isParsed && in.expect(']');
+				}
+			}
+		} else if (keyStr.compare("error") == 0) {
+			// [code, message]
+			picojson::value code, message;
+			isParsed = in.expect('[') && picojson::_parse(code, in);
+			if (isParsed && in.expect(',')) {
+				isParsed = picojson::_parse(message, in);
+			}
+			isParsed = isParsed && in.expect(']');
+			mErrorCode = code.is<double>() ? static_cast<int>(code.get<double>()) : SRC_ERROR_UNKNOWN;
+			if (message.is<std::string>()) mErrorMessage = message.get<std::string>();
+		} else {
+			picojson::value value;
+			isParsed = picojson::_parse(value, in);
+			if (isParsed && keyStr.compare("id") == 0 && value.is<double>()) {
+				mId = static_cast<int>(value.get<double>());
+			}
+		}
+		if (!isParsed) {
+			mParseError = "syntax error at line " + ofToString(in.line()) + " in " + keyStr;
+			return false;
+		}
+	} while (in.expect(','));
+
+	if (!in.expect('}')) {
+		mParseError = "syntax error at line " + ofToString(in.line());
+		return false;
 	}
-	return false;;
+	return true;
 }
 
-void ofxSonyRemoteCamera::closeLiveViewSession()
+const picojson::array& ofxSonyRemoteCamera::Response::getResultArray() const
 {
-	mpLiveViewStream = 0;
-	mLiveViewSession.reset();
+	return mResultArray;
 }
 
-bool ofxSonyRemoteCamera::updateLiveView()
+ofxSonyRemoteCamera::JsonArena::Node ofxSonyRemoteCamera::Response::getResultNode() const
 {
-	if (!updateCommonHeader()) return false;
-	if (!updatePayloadHeader()) return false;
-	if (!updatePayloadData()) return false;
-	if (lock()) {
-		mLiveViewTimestamp = mCommonHeader.timestamp;
-		unlock();
-	}
-	//++mLiveViewFrameId;
-	return true;
+	if (!mpArena || !mHasResult) return JsonArena::Node();
+	return mpArena->getRoot();
 }
 
-bool ofxSonyRemoteCamera::updateCommonHeader()
+std::string ofxSonyRemoteCamera::Response::getBody() const
 {
-	if (mpLiveViewStream == 0) return false;
-
-	BYTE commonHeaderBytes[COMMON_HEADER_SIZE];
-	mpLiveViewStream->read((char*)commonHeaderBytes, COMMON_HEADER_SIZE);
-	// check header
-	if ((mpLiveViewStream->gcount() != COMMON_HEADER_SIZE) ||
-		(commonHeaderBytes[0] != COMMON_HEADER_START_BYTE)
-		) {
-			return false;	
+	std::string body("{");
+	if (mHasResult && mpArena) {
+		body += "\"result\":";
+		mpArena->getRoot().serialize(body);
+		body += ",";
+	} else if (mHasResult) {
+		body += "\"result\":" + picojson::value(mResultArray).serialize() + ",";
 	}
-	if (lock()) {
-		mCommonHeader.payLoadType = bytesToInt(commonHeaderBytes, 1, 1);
-		mCommonHeader.frameId = bytesToInt(commonHeaderBytes, 2, 2);
-		mCommonHeader.timestamp = bytesToInt(commonHeaderBytes, 4, 4);
-		unlock();
+	if (mErrorCode != 0) {
+		body += "\"error\":[" + ofToString(mErrorCode) + "," + picojson::value(mErrorMessage).serialize() + "],";
 	}
-	/*
-	std::cout << "startByte: " << (int)commonHeaderBytes[0] << std::endl;
-	std::cout << "payLoadType: " << mCommonHeader.payLoadType << std::endl;
-	std::cout << "sequenceNumber: " << mCommonHeader.frameId << std::endl;
-	std::cout << "timestamp: " << mCommonHeader.timestamp << std::endl;
-	*/
-	return true;
+	body += "\"id\":" + ofToString(mId) + "}";
+	return body;
 }
 
-bool ofxSonyRemoteCamera::updatePayloadHeader()
+bool ofxSonyRemoteCamera::Response::getString(size_t index, std::string& value) const
 {
-	if (mpLiveViewStream == 0) return false;
-
-	BYTE payloadHeaderBytes[PAYLOAD_HEADER_SIZE];
-	mpLiveViewStream->read((char*)payloadHeaderBytes, PAYLOAD_HEADER_SIZE);
-	// check header
-	if ((mpLiveViewStream->gcount() != PAYLOAD_HEADER_SIZE) ||
-		(payloadHeaderBytes[0] != PAYLOAD_HEADER_START_BYTES[0]) ||
-		(payloadHeaderBytes[1] != PAYLOAD_HEADER_START_BYTES[1]) ||
-		(payloadHeaderBytes[2] != PAYLOAD_HEADER_START_BYTES[2]) ||
-		(payloadHeaderBytes[3] != PAYLOAD_HEADER_START_BYTES[3])
-		) {
-			return false;	
-	}
-	if (lock()) {
-		mPayloadHeader.jpegSize = bytesToInt(payloadHeaderBytes,4,3);
-		mPayloadHeader.paddingSize = bytesToInt(payloadHeaderBytes,7,1);
-		unlock();
+	if (mpArena) {
+		const JsonArena::Node node(getResultNode()[index]);
+		if (!node.is(JsonArena::TYPE_STRING)) return false;
+		value = node.getString();
+		return true;
 	}
+	if (index >= mResultArray.size() || !mResultArray[index].is<std::string>()) return false;
+	value = mResultArray[index].get<std::string>();
 	return true;
 }
 
-bool ofxSonyRemoteCamera::updatePayloadData()
+bool ofxSonyRemoteCamera::Response::getInt(size_t index, int& value) const
 {
-	if (mpLiveViewStream == 0) return false;
-	
-	int jpegSize(0);
-	if (lock()) {
-		jpegSize = mPayloadHeader.jpegSize;
-		unlock();
-	}
-	BYTE* apJpegBytes = new BYTE[jpegSize];
-	mpLiveViewStream->read((char*)apJpegBytes, jpegSize);
-	if (mpLiveViewStream->gcount() != jpegSize) {
-		delete [] apJpegBytes;
-		return false;
-	}
-	ofBuffer buf((char*)apJpegBytes, jpegSize);
-	// cvt jpeg to bitmap
-	if (lock()) {
-		ofLoadImage(mLiveViewPixels, buf);
-		if ( (mLiveViewPixels.getWidth() != mImageSize.width) || (mLiveViewPixels.getHeight() != mImageSize.height)) {
-			mImageSize.width = mLiveViewPixels.getWidth();
-			mImageSize.height = mLiveViewPixels.getHeight();
-			mIsImageSizeUpdated = true;
-		}
-		unlock();
-	} else if (mIsVerbose) {
-		std::cout << "cannot lock" << std::endl;
+	if (mpArena) {
+		const JsonArena::Node node(getResultNode()[index]);
+		if (!node.is(JsonArena::TYPE_NUMBER)) return false;
+		value = node.getInt();
+		return true;
 	}
-	delete [] apJpegBytes;
+	if (index >= mResultArray.size() || !mResultArray[index].is<double>()) return false;
+	value = static_cast<int>(mResultArray[index].get<double>());
 	return true;
 }
 
-void ofxSonyRemoteCamera::updateRequest()
+bool ofxSonyRemoteCamera::Response::getBool(size_t index, bool& value) const
 {
-	lock();
-	mHttpPostList = mHttpPostListEntry;
-	mHttpPostListEntry.clear();
-	unlock();
-	while (mHttpPostList.size()) {
-		const std::string json(httpPost(mHttpPostList.front().json, mHttpPostList.front().path));
-		std::cout << json << std::endl;
-		mHttpPostList.pop_front();
+	if (mpArena) {
+		const JsonArena::Node node(getResultNode()[index]);
+		if (!node.is(JsonArena::TYPE_BOOL)) return false;
+		value = node.getBool();
+		return true;
 	}
-	
+	if (index >= mResultArray.size() || !mResultArray[index].is<bool>()) return false;
+	value = mResultArray[index].get<bool>();
+	return true;
 }
 
-std::string ofxSonyRemoteCamera::httpPost( const std::string& json, const std::string& path )
+void ofxSonyRemoteCamera::RequestWriter::begin(const char* method)
 {
-	Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_POST, path, Poco::Net::HTTPMessage::HTTP_1_1);
-	request.setContentLength(json.length());
-	request.setContentType("application/json");
-	mSession.sendRequest(request) << json;
+	mSize = 0;
+	mParamCount = 0;
+	mIsOverflow = false;
+	append("{\"method\":\"");
+	appendEscaped(method);
+	append("\",\"params\":[");
+}
 
-	Poco::Net::HTTPResponse response;
-	std::istream& rs = mSession.receiveResponse(response);
-	if (response.getStatus() != Poco::Net::HTTPResponse::HTTP_UNAUTHORIZED)
-	{
-		std::string responseStr;
-		Poco::StreamCopier::copyToString(rs, responseStr);
-		return responseStr;
-		// TODO
-	}
-	return "";
+void ofxSonyRemoteCamera::RequestWriter::param(int value)
+{
+	if (mParamCount++ > 0) append(',');
+	appendInt(value);
 }
 
-std::string ofxSonyRemoteCamera::httpPostAsync( const std::string& json, const std::string& path )
+void ofxSonyRemoteCamera::RequestWriter::appendInt(int value)
 {
-	MyHttpPostRequest r(json, path);
-	lock();
-	mHttpPostListEntry.push_back(r);
-	unlock();
-	return "";
+	char digits[16];
+	int count(0);
+	unsigned int u(value < 0 ? -static_cast<unsigned int>(value) : value);
+	do {
+		digits[count++] = '0' + (u % 10);
+		u /= 10;
+	} while (u > 0);
+	if (value < 0) append('-');
+	while (count > 0) append(digits[--count]);
 }
 
-picojson::value ofxSonyRemoteCamera::parse(const std::string& json) const
+void ofxSonyRemoteCamera::RequestWriter::param(bool value)
 {
-	picojson::value v;
-	const char* m(json.c_str());
-	std::string err;
-	picojson::parse(v, m, m+strlen(m), &err);
-	if (!err.empty()) {
-		ofLogError("JSON parse error: " + err);
-	}
-	return v;
+	if (mParamCount++ > 0) append(',');
+	append(value ? "true" : "false");
+}
+
+void ofxSonyRemoteCamera::RequestWriter::param(const char* value)
+{
+	if (mParamCount++ > 0) append(',');
+	append('"');
+	appendEscaped(value);
+	append('"');
 }
 
-std::string ofxSonyRemoteCamera::createJson(const std::string& method, const std::vector<picojson::value>& params ) const
+void ofxSonyRemoteCamera::RequestWriter::param(const picojson::value& value)
 {
-	picojson::object obj;
-	obj["method"] = (picojson::value)(std::string)(method);
-	obj["id"] = (picojson::value)(double)(mId);
-	obj["version"] = (picojson::value)(std::string)(VERSION);
-	picojson::array paramArray;
-	for (std::vector<picojson::value>::const_iterator it=params.begin(); it!=params.end(); ++it) {
-		paramArray.push_back(*it);
+	if (mParamCount++ > 0) append(',');
+	appendValue(value);
+}
+
+void ofxSonyRemoteCamera::RequestWriter::end(int id, const char* version)
+{
+	append("],\"id\":");
+	appendInt(id);
+	append(",\"version\":\"");
+	appendEscaped(version);
+	append("\"}");
+}
+
+void ofxSonyRemoteCamera::RequestWriter::append(const char* str)
+{
+	while (*str) append(*str++);
+}
+
+void ofxSonyRemoteCamera::RequestWriter::append(char c)
+{
+	if (mSize >= BUFFER_SIZE) {
+		mIsOverflow = true;
+		return;
 	}
-	obj.insert(make_pair("params", paramArray));
-	return (static_cast<picojson::value>(obj)).serialize();
+	mBuffer[mSize++] = c;
 }
 
-bool ofxSonyRemoteCamera::getJsonResultArray(picojson::array& outArray, const std::string& json) const
+void ofxSonyRemoteCamera::RequestWriter::appendEscaped(const char* str)
 {
-	const picojson::value v = parse(json);
-	const picojson::value::object& obj(v.get<picojson::object>());
-	for (picojson::value::object::const_iterator it=obj.begin(); it!=obj.end(); ++it) {
-		if ( (it->first).compare("result") == 0) {
-			outArray = it->second.get<picojson::array>();
-			return true;
+	static const char HEX[] = "0123456789abcdef";
+	for (; *str; ++str) {
+		const unsigned char c(*str);
+		if (c == '"' || c == '\\') {
+			append('\\');
+			append(static_cast<char>(c));
+		} else if (c < 0x20) {
+			append("\\u00");
+			append(HEX[c >> 4]);
+			append(HEX[c & 0x0f]);
+		} else {
+			append(static_cast<char>(c));
 		}
 	}
-	return false;
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::checkError( const std::string& json ) const
+void ofxSonyRemoteCamera::RequestWriter::appendValue(const picojson::value& value)
 {
-	const picojson::value v = parse(json);
-	const picojson::value::object& obj(v.get<picojson::object>());
-	
-	int errcode(0);
-	for (picojson::value::object::const_iterator it=obj.begin(); it!=obj.end(); ++it) {
-		//std::cout << it->first << ": " <<  it->second.to_str() << std::endl;
-		if ( (it->first).compare("error") == 0) {
-		picojson::array a(it->second.get<picojson::array>());
-		errcode = a[0].get<double>();		
+	if (value.is<bool>()) {
+		append(value.get<bool>() ? "true" : "false");
+	} else if (value.is<double>()) {
+		// integers like stIdx and cnt are written without a fraction
+		const double number(value.get<double>());
+		if (number == static_cast<double>(static_cast<int>(number))) {
+			appendInt(static_cast<int>(number));
+		} else {
+			char digits[32];
+			sprintf(digits, "%.17g", number);
+			append(digits);
 		}
+	} else if (value.is<std::string>()) {
+		append('"');
+		appendEscaped(value.get<std::string>().c_str());
+		append('"');
+	} else if (value.is<picojson::array>()) {
+		const picojson::array& values(value.get<picojson::array>());
+		append('[');
+		for (picojson::array::const_iterator it=values.begin(); it!=values.end(); ++it) {
+			if (it != values.begin()) append(',');
+			appendValue(*it);
+		}
+		append(']');
+	} else if (value.is<picojson::object>()) {
+		const picojson::object& members(value.get<picojson::object>());
+		append('{');
+		for (picojson::object::const_iterator it=members.begin(); it!=members.end(); ++it) {
+			if (it != members.begin()) append(',');
+			append('"');
+			appendEscaped(it->first.c_str());
+			append("\":");
+			appendValue(it->second);
+		}
+		append('}');
+	} else {
+		append("null");
 	}
-	if (errcode == 0) return SRC_OK;
-	if (mIsVerbose) {
-		//ofLogError(json);
-		std::cout << json << std::endl;
-	}
-	return cvtError(errcode);
 }
 
-ofxSonyRemoteCamera::SRCError ofxSonyRemoteCamera::cvtError(int errorcode) const {
+bool ofxSonyRemoteCamera::StorageInformation::operator==(const StorageInformation& rhs) const
+{
+	return (storageId == rhs.storageId) &&
+		(storageDescription == rhs.storageDescription) &&
+		(isRecordTarget == rhs.isRecordTarget) &&
+		(numberOfRecordableImages == rhs.numberOfRecordableImages) &&
+		(recordableTime == rhs.recordableTime);
+}
 
-	if (SRC_OK <= errorcode && errorcode <= SRC_ERROR_UNSUPPORTED_OPERATION) {
-		return static_cast<SRCError>(errorcode);
-	}
-	if (SRC_ERROR_SHOOTING_FAIL <= errorcode && errorcode <= SRC_ERROR_STILL_CAPTURING_NOT_FINISHED) {
-		return static_cast<SRCError>(errorcode);
+ofxSonyRemoteCamera::SettingsSnapshot::SettingsSnapshot()
+	: shootMode(SHOOT_MODE_STILL)
+	, selfTimer(0)
+	, viewAngle(0)
+	, postViewImageSize(POST_VIEW_IMG_SIZE_ORIGINAL)
+	, elapsedMicros(0)
+{
+	for (int field(0); field<SNAPSHOT_FIELD_NUM; ++field) {
+		errors[field] = SRC_ERROR_UNKNOWN;
 	}
-	if (mIsVerbose) {
-		ofLogError("Error code: " + ofToString(errorcode));
-		ofLogError("Error code is HTTP status code or Unknown.");
+}
 
+ofxSonyRemoteCamera::BurstReport::BurstReport()
+	: shots(0)
+	, failures(0)
+	, awaitCalls(0)
+	, notReadyCount(0)
+	, inFlightLimit(0)
+	, lastError(SRC_OK)
+	, elapsedMicros(0)
+	, shotsPerSecond(0)
+	, minIntervalMicros(0)
+	, maxIntervalMicros(0)
+	, meanIntervalMicros(0)
+	, isFinished(false)
+{
+}
+
+ofxSonyRemoteCamera::ZoomReport::ZoomReport()
+	: target(0)
+	, startPosition(-1)
+	, finalPosition(-1)
+	, overshoot(0)
+	, commands(0)
+	, continuousMoves(0)
+	, oneShotSteps(0)
+	, latencyMicros(0)
+	, speed(0)
+	, settleMicros(0)
+	, err(SRC_ERROR_UNKNOWN)
+	, isSettled(false)
+	, isFinished(false)
+{
+}
+
+ofxSonyRemoteCamera::IntervalReport::IntervalReport()
+	: shots(0)
+	, failures(0)
+	, skipped(0)
+	, caughtUp(0)
+	, latencyMicros(0)
+	, meanAbsErrorMicros(0)
+	, maxAbsErrorMicros(0)
+	, lastErrorMicros(0)
+	, elapsedMicros(0)
+	, isFinished(false)
+{
+}
+
+ofxSonyRemoteCamera::StartUpReport::StartUpReport()
+	: totalMicros(0)
+	, isFinished(false)
+{
+	for (int phase(0); phase<STARTUP_PHASE_NUM; ++phase) {
+		errors[phase] = SRC_ERROR_UNKNOWN;
+		beginMicros[phase] = 0;
+		endMicros[phase] = 0;
 	}
-	return SRC_ERROR_UNKNOWN;
 }
 
 int ofxSonyRemoteCamera::bytesToInt(BYTE byteData[], int startIndex, int count) const
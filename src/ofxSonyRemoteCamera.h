@@ -6,17 +6,32 @@
 
 #include "ofMain.h"
 #include "picojson.h"
+#include "ofxSonyRemoteCameraJsonArena.h"
 
 #include "Poco/URI.h" 
+#include "Poco/Exception.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/RunnableAdapter.h"
+#include "Poco/Condition.h"
 #include "Poco/File.h"
+#include "Poco/Path.h"
 #include "Poco/StreamCopier.h" 
 #include "Poco/Net/HTTPClientSession.h"
 #include "Poco/Net/HTTPRequest.h"
 #include "Poco/Net/HTTPResponse.h"
 
+#include <deque>
+
+class ofxSonyRemoteCameraReactor;
+
 class ofxSonyRemoteCamera : public ofThread
 {
+	friend class ofxSonyRemoteCameraReactor;
 public:
+	typedef ofxSonyRemoteCameraJsonArena JsonArena;
+
 	/*!
 	 *	Error codes. Please refer following documents.
 	 *	https://camera.developer.sony.com/pages/documents/view/?id=camera_api
@@ -41,6 +56,8 @@ public:
 		SRC_ERROR_UNSUPPORTED_OPERATION = 15,
 
 		SRC_ERROR_UNKNOWN               = 16,	//!< my error code
+		SRC_ERROR_CANCELLED             = 17,	//!< my error code, see CancellationToken
+		SRC_ERROR_CONNECTION_FAILED     = 18,	//!< my error code, socket error or connection closed
 
 		SRC_ERROR_SHOOTING_FAIL                 = 40400,
 		SRC_ERROR_CAMERA_NOT_READY              = 40401,
@@ -68,18 +85,80 @@ public:
 		POST_VIEW_IMG_SIZE_ORIGINAL,
 		POST_VIEW_IMG_SIZE_2M
 	};
+	enum PayloadType
+	{
+		PAYLOAD_TYPE_IMAGE = 0x01,
+		PAYLOAD_TYPE_FRAME_INFORMATION = 0x02
+	};
 	struct CommonHeader
 	{
 		CommonHeader(): payLoadType(0), frameId(0), timestamp(0) {}
-		int payLoadType;
+		int payLoadType;			//!< PayloadType
 		int frameId;
 		int timestamp;
 	};
 	struct PayloadHeader
 	{
-		PayloadHeader(): jpegSize(0), paddingSize(0) {}
-		int jpegSize;
+		PayloadHeader(): jpegSize(0), paddingSize(0), frameCount(0), frameDataSize(0) {}
+		int jpegSize;				//!< size of the payload data, JPEG or frame information
 		int paddingSize;
+		int frameCount;				//!< of frame information
+		int frameDataSize;			//!< of each frame of frame information
+	};
+	enum FocusFrameCategory
+	{
+		FOCUS_FRAME_CATEGORY_INVALID = 0x00,
+		FOCUS_FRAME_CATEGORY_CONTRAST_AF = 0x01,
+		FOCUS_FRAME_CATEGORY_PHASE_DETECTION_AF = 0x02,
+		FOCUS_FRAME_CATEGORY_FACE = 0x04,
+		FOCUS_FRAME_CATEGORY_TRACKING = 0x05
+	};
+	enum FocusFrameStatus
+	{
+		FOCUS_FRAME_STATUS_INVALID = 0x00,
+		FOCUS_FRAME_STATUS_NORMAL = 0x01,
+		FOCUS_FRAME_STATUS_MAIN = 0x02,
+		FOCUS_FRAME_STATUS_SUB = 0x03,
+		FOCUS_FRAME_STATUS_FOCUSED = 0x04
+	};
+	/*!
+		Frame of a frame information payload, the position is 0-10000 across the liveview image.
+	*/
+	struct FocusFrame
+	{
+		FocusFrame(): left(0), top(0), right(0), bottom(0), category(FOCUS_FRAME_CATEGORY_INVALID), status(FOCUS_FRAME_STATUS_INVALID), additionalStatus(0) {}
+		//! @return position in an image of width x height
+		ofRectangle getRect(float width, float height) const { return ofRectangle(left * width / 10000, top * height / 10000, (right - left) * width / 10000, (bottom - top) * height / 10000); }
+		int left;
+		int top;
+		int right;
+		int bottom;
+		int category;				//!< FocusFrameCategory
+		int status;					//!< FocusFrameStatus
+		int additionalStatus;
+	};
+	//! focus and face frames of a liveview image, sent by newer cameras with the same frameId
+	struct FrameInformation
+	{
+		FrameInformation(): frameId(-1), timestamp(0) {}
+		int frameId;				//!< of the image the frames were sent with, -1 before the first frame information
+		int timestamp;
+		std::vector<FocusFrame> frames;	//!< empty if the camera sent none for the image
+	};
+	//! file on the camera, see getContentList()
+	struct Content
+	{
+		Content(): isBrowsable(false) {}
+		std::string uri;			//!< e.g. image:content?contentId=...
+		std::string title;
+		std::string contentKind;	//!< e.g. "still", "movie_mp4", "directory"
+		std::string createdTime;	//!< ISO 8601
+		std::string fileName;		//!< of the original
+		std::string url;			//!< of the original, see ofxSonyRemoteCameraTransfer
+		std::string largeUrl;		//!< 2M image
+		std::string smallUrl;		//!< VGA image
+		std::string thumbnailUrl;
+		bool isBrowsable;			//!< a directory, its uri lists its files
 	};
 	struct ImageSize
 	{
@@ -87,20 +166,573 @@ public:
 		int width;
 		int height;
 	};
+	/*!
+		A camera setting held on the client side.
+		updatedTime is ofGetElapsedTimeMillis() when the value was received from the camera.
+	*/
+	template <typename T>
+	struct CachedSetting
+	{
+		CachedSetting(): value(), isValid(false), updatedTime(0) {}
+		T value;
+		bool isValid;
+		unsigned long long updatedTime;
+	};
+	struct StorageInformation
+	{
+		StorageInformation(): isRecordTarget(false), numberOfRecordableImages(-1), recordableTime(-1) {}
+		bool operator==(const StorageInformation& rhs) const;
+		bool operator!=(const StorageInformation& rhs) const { return !(*this == rhs); }
+		std::string storageId;
+		std::string storageDescription;
+		bool isRecordTarget;
+		int numberOfRecordableImages;	//!< -1 if unknown
+		int recordableTime;				//!< minutes, -1 if unknown
+	};
+	/*!
+		Decodes liveview frames outside of the liveview thread, see setLiveViewDecoder().
+		decode() is called from the liveview thread and should return quickly,
+		the decoded frame is handed back with setLiveViewFrame().
+	*/
+	class LiveViewDecoder
+	{
+	public:
+		virtual ~LiveViewDecoder() {}
+		//! frameId is handed back with the frame, the frame information is matched by it
+		virtual void decode(ofxSonyRemoteCamera& camera, const ofBuffer& jpeg, int timestamp, int frameId) = 0;
+	};
+	/*!
+		Receives every liveview frame still compressed, before it is decoded, see setLiveViewRecorder().
+		record() is called from the liveview thread, jpeg is only valid during the call.
+	*/
+	class LiveViewRecorder
+	{
+	public:
+		virtual ~LiveViewRecorder() {}
+		virtual void record(ofxSonyRemoteCamera& camera, const CommonHeader& header, const char* jpeg, int size) = 0;
+	};
+	/*!
+		Camera state reported by getEvent.
+	*/
+	struct CameraState
+	{
+		CameraState(): shootMode(SHOOT_MODE_STILL), hasShootMode(false), zoomPosition(-1) {}
+		std::string cameraStatus;	//!< e.g. "IDLE", "StillCapturing", "MovieRecording"
+		ShootMode shootMode;
+		bool hasShootMode;
+		int zoomPosition;			//!< 0-100, -1 if unknown
+		std::vector<std::string> availableApiList;
+		std::vector<StorageInformation> storageInformation;
+	};
+	/*!
+		Statistics of a JSON-RPC method. times are microseconds.
+	*/
+	struct MethodStats
+	{
+		MethodStats(): calls(0), errors(0), timeouts(0), retries(0), totalRoundTripMicros(0), totalRetryMicros(0) {}
+		int calls;
+		int errors;		//!< calls which failed after all retries
+		int timeouts;	//!< attempts which exceeded the deadline or got a timeout from the camera
+		int retries;
+		unsigned long long totalRoundTripMicros;	//!< request, receiving and parsing the response, including retries
+		unsigned long long totalRetryMicros;		//!< latency added by retries and their backoff
+	};
+	/*!
+		Cancels calls from another thread.
+		A call which is waiting for the camera is aborted and returns SRC_ERROR_CANCELLED.
+		The token stays cancelled until reset(), so calls made with it return immediately.
+	*/
+	class CancellationToken
+	{
+	public:
+		CancellationToken(): mIsCancelled(false), mpSession(0) {}
+		void cancel();
+		bool isCancelled();
+		void reset();
+	private:
+		friend class ofxSonyRemoteCamera;
+		//! @return false if already cancelled
+		bool attach(Poco::Net::HTTPClientSession* pSession);
+		void detach();
+		ofMutex mMutex;
+		bool mIsCancelled;
+		Poco::Net::HTTPClientSession* mpSession;
+	};
+	/*!
+		Retries of failed calls. The n-th retry waits initialBackoffMillis * 2^(n-1), at most maxBackoffMillis,
+		scaled by a random factor in [1-jitter, 1+jitter].
+	*/
+	struct RetryPolicy
+	{
+		RetryPolicy(): maxRetries(3), initialBackoffMillis(100), maxBackoffMillis(2000), jitter(0.5f) {}
+		int maxRetries;		//!< 0 disables retries
+		unsigned long long initialBackoffMillis;
+		unsigned long long maxBackoffMillis;
+		float jitter;
+	};
+	/*!
+		Where the services of the camera are, e.g. found by ofxSonyRemoteCameraDiscovery.
+		Empty paths use /sony/<service>.
+	*/
+	struct Endpoints
+	{
+		Endpoints(): host("10.0.0.1"), port(10000) {}
+		std::string host;
+		int port;
+		std::string cameraPath;
+		std::string guidePath;
+		std::string accessControlPath;
+		std::string avContentPath;
+	};
+	/*!
+		Options of a call. timeoutMillis 0 uses the timeout of the method, see setMethodTimeout().
+		maxRetries -1 uses the retry policy, see setRetryPolicy(). 0 returns the first error, e.g. for schedulers which handle a busy camera themselves.
+	*/
+	struct CallOptions
+	{
+		CallOptions(unsigned long long timeoutMillis=0, CancellationToken* pCancellationToken=0, int maxRetries=-1)
+			: timeoutMillis(timeoutMillis), pCancellationToken(pCancellationToken), maxRetries(maxRetries) {}
+		unsigned long long timeoutMillis;
+		CancellationToken* pCancellationToken;
+		int maxRetries;
+	};
+	/*!
+		JSON-RPC response, {"result":[...],"id":n} or {"error":[code,msg],"id":n}.
+		id and error are read while streaming, only the elements of result are stored as JSON values.
+		If an arena is given, result is stored in the arena instead of picojson values.
+		The arena is cleared for every response, so it should be reused for large responses like getEvent.
+	*/
+	class Response
+	{
+	public:
+		Response(JsonArena* pArena=0);
+		/*!
+			@return false if the input is not a JSON object
+		*/
+		bool parse(const char* begin, const char* end);
+		bool read(std::istream& stream);
+
+		int getId() const { return mId; }
+		int getErrorCode() const { return mErrorCode; }
+		const std::string& getErrorMessage() const { return mErrorMessage; }
+		bool hasResult() const { return mHasResult; }
+		//! empty if an arena is used
+		const picojson::array& getResultArray() const;
+		//! invalid if no arena is used
+		JsonArena::Node getResultNode() const;
+		bool getString(size_t index, std::string& value) const;
+		bool getInt(size_t index, int& value) const;
+		bool getBool(size_t index, bool& value) const;
+
+		/*!
+			serializes the response again. the body is not kept while reading.
+		*/
+		std::string getBody() const;
+		const std::string& getParseError() const { return mParseError; }
+	private:
+		template <typename Iter> bool parse(picojson::input<Iter>& in);
+		//! reads a member name after its opening quote into mMemberName
+		template <typename Iter> bool parseMemberName(picojson::input<Iter>& in);
+		void clear();
+		picojson::array mResultArray;
+		JsonArena* mpArena;
+		bool mHasResult;
+		int mId;
+		int mErrorCode;
+		std::string mErrorMessage;
+		std::string mParseError;
+		std::string mMemberName;	//!< keeps its capacity, so member names do not allocate
+	};
+	/*!
+		Writes a JSON-RPC request into a fixed buffer without heap allocations.
+	*/
+	class RequestWriter
+	{
+	public:
+		enum { BUFFER_SIZE = 512 };
+		RequestWriter(): mSize(0), mParamCount(0), mIsOverflow(false) {}
+		void begin(const char* method);
+		void param(int value);
+		void param(bool value);
+		void param(const char* value);
+		//! objects, e.g. the parameters of avContent methods
+		void param(const picojson::value& value);
+		void end(int id, const char* version);
+
+		const char* data() const { return mBuffer; }
+		size_t size() const { return mSize; }
+		bool isOverflow() const { return mIsOverflow; }
+	private:
+		void append(const char* str);
+		void append(char c);
+		void appendInt(int value);
+		void appendEscaped(const char* str);
+		//! like picojson::value::serialize(), without building a string
+		void appendValue(const picojson::value& value);
+		char mBuffer[BUFFER_SIZE];
+		size_t mSize;
+		int mParamCount;
+		bool mIsOverflow;
+	};
+	//! web API service of a method
+	enum Service
+	{
+		SERVICE_CAMERA,
+		SERVICE_AV_CONTENT
+	};
+	/*!
+		JSON-RPC methods with their parameter types.
+		invoke<method::setSelfTimer>(10) is checked at compile time.
+		Methods are version 1.0 of the camera service unless they are declared with a service and a version.
+	*/
+	struct method
+	{
+		struct Method { static const char* version() { return "1.0"; } static Service service() { return SERVICE_CAMERA; } };
+		struct Params0 : Method {};
+		template <typename T1> struct Params1 : Method { typedef T1 Arg1; };
+		template <typename T1, typename T2> struct Params2 : Method { typedef T1 Arg1; typedef T2 Arg2; };
+
+#define OFX_SRC_METHOD0(NAME) struct NAME : Params0 { static const char* name() { return #NAME; } };
+#define OFX_SRC_METHOD1(NAME, T1) struct NAME : Params1<T1> { static const char* name() { return #NAME; } };
+#define OFX_SRC_METHOD2(NAME, T1, T2) struct NAME : Params2<T1, T2> { static const char* name() { return #NAME; } };
+#define OFX_SRC_SERVICE_METHOD1(SERVICE, NAME, T1, VERSION) struct NAME : Params1<T1> { static const char* name() { return #NAME; } \
+	static const char* version() { return VERSION; } static Service service() { return SERVICE; } };
+		OFX_SRC_METHOD0(startLiveview)
+		OFX_SRC_METHOD0(stopLiveview)
+		OFX_SRC_METHOD1(startLiveviewWithSize, const char*)
+		OFX_SRC_METHOD0(getSupportedLiveviewSize)
+		OFX_SRC_METHOD0(getLiveviewSize)
+		OFX_SRC_METHOD0(actTakePicture)
+		OFX_SRC_METHOD0(awaitTakePicture)
+		OFX_SRC_METHOD0(startMovieRec)
+		OFX_SRC_METHOD0(stopMovieRec)
+		OFX_SRC_METHOD2(actZoom, const char*, const char*)
+		OFX_SRC_METHOD0(getSupportedSelfTimer)
+		OFX_SRC_METHOD0(getAvailableSelfTimer)
+		OFX_SRC_METHOD0(getSelfTimer)
+		OFX_SRC_METHOD1(setSelfTimer, int)
+		OFX_SRC_METHOD0(getSupportedPostviewImageSize)
+		OFX_SRC_METHOD0(getAvailablePostviewImageSize)
+		OFX_SRC_METHOD0(getPostviewImageSize)
+		OFX_SRC_METHOD1(setPostviewImageSize, const char*)
+		OFX_SRC_METHOD0(getSupportedShootMode)
+		OFX_SRC_METHOD0(getAvailableShootMode)
+		OFX_SRC_METHOD0(getShootMode)
+		OFX_SRC_METHOD1(setShootMode, const char*)
+		OFX_SRC_METHOD1(getEvent, bool)
+		OFX_SRC_METHOD0(startRecMode)
+		OFX_SRC_METHOD0(stopRecMode)
+		OFX_SRC_METHOD0(getAvailableApiList)
+		OFX_SRC_METHOD1(getMethodTypes, const char*)
+		OFX_SRC_METHOD0(getVersions)
+		OFX_SRC_METHOD0(getApplicationInfo)
+		OFX_SRC_METHOD0(startIntervalStillRec)
+		OFX_SRC_METHOD0(stopIntervalStillRec)
+		OFX_SRC_METHOD0(getSupportedViewAngle)
+		OFX_SRC_METHOD0(getAvailableViewAngle)
+		OFX_SRC_METHOD0(getViewAngle)
+		OFX_SRC_METHOD1(setViewAngle, int)
+		OFX_SRC_METHOD0(getSupportedMovieQuality)
+		OFX_SRC_METHOD0(getAvailableMovieQuality)
+		OFX_SRC_METHOD0(getMovieQuality)
+		OFX_SRC_METHOD1(setMovieQuality, const char*)
+		OFX_SRC_METHOD0(getSupportedSteadyMode)
+		OFX_SRC_METHOD0(getAvailableSteadyMode)
+		OFX_SRC_METHOD0(getSteadyMode)
+		OFX_SRC_METHOD0(getAvailableCameraFunction)
+		OFX_SRC_METHOD0(getStorageInformation)
+		OFX_SRC_METHOD1(setCameraFunction, const char*)
+		OFX_SRC_METHOD0(getCameraFunction)
+		OFX_SRC_SERVICE_METHOD1(SERVICE_AV_CONTENT, getSourceList, const picojson::value&, "1.0")
+		OFX_SRC_SERVICE_METHOD1(SERVICE_AV_CONTENT, getContentCount, const picojson::value&, "1.2")
+		OFX_SRC_SERVICE_METHOD1(SERVICE_AV_CONTENT, getContentList, const picojson::value&, "1.3")
+#undef OFX_SRC_METHOD0
+#undef OFX_SRC_METHOD1
+#undef OFX_SRC_METHOD2
+#undef OFX_SRC_SERVICE_METHOD1
+	};
+	enum SnapshotField
+	{
+		SNAPSHOT_SHOOT_MODE,
+		SNAPSHOT_SELF_TIMER,
+		SNAPSHOT_VIEW_ANGLE,
+		SNAPSHOT_MOVIE_QUALITY,
+		SNAPSHOT_POST_VIEW_IMAGE_SIZE,
+		SNAPSHOT_STEADY_MODE,
+		SNAPSHOT_STORAGE_INFORMATION,
+		SNAPSHOT_AVAILABLE_API_LIST,
+		SNAPSHOT_APPLICATION_INFO,
+		SNAPSHOT_VERSIONS,
+		SNAPSHOT_FIELD_NUM
+	};
+	/*!
+		Camera settings fetched at once by getSettingsSnapshot().
+		errors[field] is the result of each request, the value is valid only if it is SRC_OK.
+	*/
+	struct SettingsSnapshot
+	{
+		SettingsSnapshot();
+		ShootMode shootMode;
+		int selfTimer;
+		int viewAngle;
+		std::string movieQuality;
+		PostViewImageSize postViewImageSize;
+		std::string steadyMode;
+		std::vector<StorageInformation> storageInformation;
+		std::vector<std::string> availableApiList;
+		std::string applicationName;
+		std::string applicationVersion;
+		std::vector<std::string> versions;
+
+		SRCError errors[SNAPSHOT_FIELD_NUM];
+		unsigned long long elapsedMicros;	//!< wall time of the whole snapshot
+	};
+	/*!
+		Method table of the camera, read with getVersions and getMethodTypes.
+		The table is identified by the name and version reported by getApplicationInfo.
+	*/
+	struct Capabilities
+	{
+		Capabilities(): isValid(false) {}
+		std::string applicationName;
+		std::string applicationVersion;
+		std::vector<std::string> versions;
+		std::vector<std::string> methods;	//!< sorted
+		bool isValid;
+	};
+	enum StartUpPhase
+	{
+		STARTUP_CAPABILITIES,			//!< loadCapabilities, skipped if the table is loaded
+		STARTUP_REC_MODE,
+		STARTUP_LIVEVIEW_REQUEST,		//!< startLiveview
+		STARTUP_LIVEVIEW_CONNECTION,	//!< GET of the liveview url
+		STARTUP_FIRST_FRAME,
+		STARTUP_SETTINGS,				//!< getSettingsSnapshot, runs in parallel with the liveview phases
+		STARTUP_PHASE_NUM
+	};
+	/*!
+		Result of beginStartUp(). times are microseconds since beginStartUp() was called.
+	*/
+	struct StartUpReport
+	{
+		StartUpReport();
+		SRCError errors[STARTUP_PHASE_NUM];
+		unsigned long long beginMicros[STARTUP_PHASE_NUM];
+		unsigned long long endMicros[STARTUP_PHASE_NUM];
+		unsigned long long totalMicros;
+		bool isFinished;
+		SettingsSnapshot settings;
+	};
+	/*!
+		Postview downloads. see setPostViewOptions().
+	*/
+	struct PostViewOptions
+	{
+		PostViewOptions(): isAutoFetch(true), isDecode(false), maxConcurrency(2), timeoutMillis(30000) {}
+		bool isAutoFetch;			//!< fetch the postview of every actTakePicture() and awaitTakePicture()
+		std::string directory;		//!< saved to <directory>/<file name of the url> if not empty, otherwise kept in memory
+		bool isDecode;				//!< decode into PostViewResult::pixels
+		int maxConcurrency;			//!< number of simultaneous downloads
+		unsigned long long timeoutMillis;
+	};
+	struct PostViewProgress
+	{
+		int captureId;
+		size_t bytesReceived;
+		long long contentLength;	//!< -1 if unknown
+	};
+	struct PostViewResult
+	{
+		PostViewResult(): captureId(-1), err(SRC_ERROR_UNKNOWN), isDecoded(false), elapsedMicros(0) {}
+		int captureId;				//!< returned by actTakePicture() or fetchPostView()
+		std::string url;
+		SRCError err;
+		ofBuffer data;				//!< empty if saved to a file or not complete
+		std::string filePath;
+		ofPixels pixels;
+		bool isDecoded;
+		unsigned long long elapsedMicros;
+	};
+	/*!
+		Burst capture. see startBurst().
+	*/
+	struct BurstOptions
+	{
+		BurstOptions(): shotCount(10), maxInFlight(1), minIntervalMillis(0) {}
+		int shotCount;				//!< 0 shoots until stopBurst()
+		int maxInFlight;			//!< capture requests sent at the same time, lowered while the camera is not ready
+		unsigned long long minIntervalMillis;	//!< between the starts of two shots
+	};
+	struct BurstReport
+	{
+		BurstReport();
+		int shots;					//!< successful captures
+		int failures;
+		int awaitCalls;				//!< awaitTakePicture calls after SRC_ERROR_STILL_CAPTURING_NOT_FINISHED
+		int notReadyCount;			//!< shots sent again after SRC_ERROR_CAMERA_NOT_READY
+		int inFlightLimit;			//!< in-flight limit at the end
+		SRCError lastError;
+		std::vector<int> captureIds;	//!< postview of each shot, see postViewFetched
+		unsigned long long elapsedMicros;
+		float shotsPerSecond;
+		unsigned long long minIntervalMicros;	//!< between the ends of two successful shots
+		unsigned long long maxIntervalMicros;
+		unsigned long long meanIntervalMicros;
+		bool isFinished;
+	};
+	/*!
+		Interval capture. see startIntervalCapture().
+	*/
+	enum IntervalMissPolicy
+	{
+		INTERVAL_MISS_SKIP,		//!< slots which passed while the camera was busy are dropped
+		INTERVAL_MISS_CATCH_UP,	//!< slots which passed while the camera was busy are shot at once
+	};
+	struct IntervalOptions
+	{
+		IntervalOptions(): intervalMillis(5000), shotCount(0), missPolicy(INTERVAL_MISS_SKIP), isLatencyCompensated(true) {}
+		unsigned long long intervalMillis;
+		int shotCount;				//!< 0 shoots until stopIntervalCapture()
+		IntervalMissPolicy missPolicy;
+		bool isLatencyCompensated;	//!< send each request early by the measured one-way latency
+	};
+	struct IntervalShot
+	{
+		IntervalShot(): index(0), err(SRC_ERROR_UNKNOWN), captureId(-1), scheduledMicros(0), triggerErrorMicros(0), isCatchUp(false) {}
+		int index;					//!< slot of the schedule
+		SRCError err;
+		int captureId;
+		long long scheduledMicros;	//!< since startIntervalCapture()
+		long long triggerErrorMicros;	//!< estimated arrival at the camera minus scheduled time
+		bool isCatchUp;
+	};
+	struct IntervalReport
+	{
+		IntervalReport();
+		int shots;
+		int failures;
+		int skipped;				//!< slots dropped by INTERVAL_MISS_SKIP
+		int caughtUp;				//!< late shots by INTERVAL_MISS_CATCH_UP
+		long long latencyMicros;	//!< estimated one-way latency
+		long long meanAbsErrorMicros;
+		long long maxAbsErrorMicros;
+		long long lastErrorMicros;
+		unsigned long long elapsedMicros;
+		bool isFinished;
+	};
+	/*!
+		Zoom positioning. see startZoomTo().
+	*/
+	struct ZoomOptions
+	{
+		ZoomOptions(): tolerance(0), maxCommandsPerSecond(4), timeoutMillis(15000) {}
+		int tolerance;				//!< accepted distance from the target position
+		float maxCommandsPerSecond;	//!< actZoom calls
+		unsigned long long timeoutMillis;
+	};
+	struct ZoomReport
+	{
+		ZoomReport();
+		int target;
+		int startPosition;
+		int finalPosition;
+		int overshoot;				//!< largest distance beyond the target
+		int commands;				//!< actZoom calls
+		int continuousMoves;		//!< start/stop pairs
+		int oneShotSteps;
+		long long latencyMicros;	//!< measured actZoom round trip
+		float speed;				//!< estimated continuous zoom speed, positions per second
+		unsigned long long settleMicros;	//!< until the position stayed within the tolerance
+		SRCError err;
+		bool isSettled;
+		bool isFinished;
+	};
+	/*!
+		Synchronized trigger over several cameras. see prepareTrigger().
+	*/
+	enum TriggerMethod
+	{
+		TRIGGER_TAKE_PICTURE,
+		TRIGGER_START_MOVIE_REC,
+		TRIGGER_STOP_MOVIE_REC
+	};
+	struct SettingsCache
+	{
+		CachedSetting<ShootMode> shootMode;
+		CachedSetting<int> selfTimer;
+		CachedSetting<int> viewAngle;
+		CachedSetting<PostViewImageSize> postViewImageSize;
+		CachedSetting<std::string> movieQuality;
+	};
 public:
 	ofxSonyRemoteCamera();
 	~ofxSonyRemoteCamera();
 	bool setup(const std::string& host="10.0.0.1", int port=10000);
+	bool setup(const Endpoints& endpoints);
 	void exit();
 	void update();
 
 	ofEvent<ImageSize> imageSizeUpdated;
 
+	/*!
+		Reads the liveview stream and polls getEvent on the sockets of pReactor instead of own threads.
+		Set it before startLiveView() and startEventPolling(), 0 uses own threads again.
+	*/
+	void setReactor(ofxSonyRemoteCameraReactor* pReactor);
+
+	//-----------------------------------------------------------------
+	// Start up
+	//-----------------------------------------------------------------
+	/*!
+		Brings the camera up to the first liveview frame on a background thread:
+		loading the method table if it is not loaded, startRecMode, then startLiveview, opening the liveview connection and waiting for the first frame,
+		while the settings snapshot is fetched over the snapshot connections at the same time.
+		Do not call other apis until startUpFinished is notified from update().
+		@return false if the start up is already running
+	*/
+	bool beginStartUp();
+	bool isStartUpRunning();
+	void waitForStartUp();
+	void getStartUpReport(StartUpReport& report);
+
+	ofEvent<StartUpReport> startUpFinished;
+
+	//-----------------------------------------------------------------
+	// Event polling
+	//-----------------------------------------------------------------
+	/*!
+		Calls getEvent with polling=true on a background thread and keeps the camera state up to date.
+		Change events are notified from update() for the fields that actually changed.
+		While polling is running, getEvent() returns the last received response instead of sending a request,
+		so that two polling calls never collide (SRC_ERROR_ALREADY_RUNNING_POLLING_API).
+	*/
+	bool startEventPolling();
+	void stopEventPolling();
+	bool isEventPolling();
+	void getCameraState(CameraState& state);
+	/*!
+		Calls getEvent with polling=false and updates the camera state, for callers which poll without the background thread.
+		Does nothing while event polling is running.
+	*/
+	SRCError refreshCameraState(const CallOptions& options=CallOptions());
+
+	ofEvent<std::string> cameraStatusChanged;
+	ofEvent<ShootMode> shootModeChanged;
+	ofEvent<int> zoomPositionChanged;
+	ofEvent<std::vector<std::string> > availableApiListChanged;
+	ofEvent<std::vector<StorageInformation> > storageInformationChanged;
+
 	//-----------------------------------------------------------------
 	// Liveview
 	//-----------------------------------------------------------------
 	SRCError startLiveView();
+	/*!
+		Restarts the liveview with size, e.g. "L" (XGA) or "M" (VGA), if the camera supports startLiveviewWithSize.
+	*/
+	SRCError startLiveViewWithSize(const std::string& size);
 	SRCError stopLiveView();
+	SRCError getSupportedLiveViewSize(std::vector<std::string>& sizes);
+	SRCError getLiveViewSize(std::string& size);
 	bool isLiveViewFrameNew();
 	bool isLiveViewSessionConnected();
 	/*!
@@ -108,6 +740,13 @@ public:
 	*/
 	void getLiveViewImage(unsigned char* pImg, int& timestamp);
 	void getLiveViewImage(ofPixels& pixels, int& timestamp);
+	//! with the frame information of the same image
+	void getLiveViewImage(ofPixels& pixels, int& timestamp, FrameInformation& information);
+	/*!
+		of the image returned by getLiveViewImage().
+		The frames are kept until an image with new frame information is shown, frameId tells which image sent them.
+	*/
+	void getLiveViewFrameInformation(FrameInformation& information);
 	/*!
 		this api cannot be used untill live view is updated. 
 	*/
@@ -119,12 +758,149 @@ public:
 
 	void getCommonHeader(CommonHeader& header);
 	void getPayloadHeader(PayloadHeader& header);
+	//! frames received since the liveview was connected
+	unsigned int getLiveViewFrameCount();
+	/*!
+		Hands the JPEG of each frame to pDecoder instead of decoding it on the liveview thread.
+		Set it before startLiveView(), 0 decodes on the liveview thread again.
+	*/
+	void setLiveViewDecoder(LiveViewDecoder* pDecoder);
+	LiveViewDecoder* getLiveViewDecoder();
+	//! called by LiveViewDecoder
+	void setLiveViewFrame(ofPixels& pixels, int timestamp, int frameId);
+	//! hands each frame to pRecorder as well, e.g. ofxSonyRemoteCameraPreRoll. 0 stops recording.
+	void setLiveViewRecorder(LiveViewRecorder* pRecorder);
+	/*!
+		Reads the frames of a frame information payload.
+		@return false if data is shorter than header tells
+	*/
+	static bool parseFrameInformation(const PayloadHeader& header, const char* data, int size, std::vector<FocusFrame>& frames);
+
+	//-----------------------------------------------------------------
+	// Settings cache
+	//-----------------------------------------------------------------
+	/*!
+		getShootMode(), getSelfTimer(), getViewAngle(), getPostViewImageSize() and getMovieQuality()
+		return the cached value when it is valid, unless forceRefresh is true.
+		The cache is updated by set* calls and by camera change notifications received via getEvent().
+		@params millis cached values older than this are fetched again. 0 means no limit.
+	*/
+	void setSettingsCacheMaxAge(unsigned long long millis);
+	void invalidateSettingsCache();
+	void getSettingsCache(SettingsCache& cache);
+
+	//-----------------------------------------------------------------
+	// Settings snapshot
+	//-----------------------------------------------------------------
+	/*!
+		Fetches the settings listed in SnapshotField with one call.
+		If isConcurrent is true, the requests are sent in parallel over getSnapshotConcurrency() extra connections,
+		otherwise one after another over the first of them.
+		@return SRC_OK if all fields are fetched, otherwise the first error. see snapshot.errors for each field.
+	*/
+	SRCError getSettingsSnapshot(SettingsSnapshot& snapshot, bool isConcurrent=true);
+	void setSnapshotConcurrency(int connections);
+	int getSnapshotConcurrency() const;
+
+	//-----------------------------------------------------------------
+	// Capabilities
+	//-----------------------------------------------------------------
+	/*!
+		beginStartUp() or loadCapabilities() loads the method table and saves it as <directory>/capabilities_<name>_<version>.json.
+		On the next start the file is read instead of calling getVersions and getMethodTypes.
+		setup() does not touch the network, until the table is loaded all methods are sent to the camera.
+		Calls to methods which are not in the table return SRC_ERROR_NO_SUCH_METHOD without a request.
+		@params directory relative to the data folder. empty disables the file. call before setup().
+	*/
+	void setCapabilityCacheDirectory(const std::string& directory);
+	bool loadCapabilities(bool forceRefresh=false);
+	void getCapabilities(Capabilities& capabilities);
+	//! true if the table is not loaded
+	bool isMethodSupported(const char* method);
 
 	//-----------------------------------------------------------------
 	// Still capture
 	//-----------------------------------------------------------------
-	SRCError actTakePicture();
-	SRCError awaitTakePicture();
+	SRCError actTakePicture(const CallOptions& options=CallOptions());
+	SRCError awaitTakePicture(const CallOptions& options=CallOptions());
+	/*!
+		@params captureId identifies the postview of this shot in postViewFetched, -1 if no postview url is returned.
+	*/
+	SRCError actTakePicture(int& captureId, const CallOptions& options=CallOptions());
+	SRCError awaitTakePicture(int& captureId, const CallOptions& options=CallOptions());
+
+	//-----------------------------------------------------------------
+	// Burst capture
+	//-----------------------------------------------------------------
+	/*!
+		Takes pictures as fast as the camera allows on background threads.
+		Up to maxInFlight actTakePicture requests are sent over their own connections,
+		awaitTakePicture is called when a capture is not finished, and the postviews are downloaded meanwhile
+		if PostViewOptions::isAutoFetch is set. burstFinished is notified from update().
+		The shots are not retried by the retry policy: when the camera is not ready, the in-flight limit is lowered
+		and the shot is sent again after 100 ms, up to 20 times in a row.
+		@return false if a burst is already running
+	*/
+	bool startBurst(const BurstOptions& options=BurstOptions());
+	//! the shots in flight are aborted and reported as SRC_ERROR_CANCELLED, the camera may still take them
+	void stopBurst();
+	bool isBurstRunning();
+	void getBurstReport(BurstReport& report);
+
+	ofEvent<BurstReport> burstFinished;
+
+	//-----------------------------------------------------------------
+	// Interval capture
+	//-----------------------------------------------------------------
+	/*!
+		Takes a picture every intervalMillis on a background thread, unlike startIntervalStillRec() the interval is timed by the host.
+		Slots are fixed to the start time so latency does not accumulate, and each request is sent early by the one-way latency
+		measured with getVersions. intervalShotTaken is notified for every slot from update().
+		The shots are not retried by the retry policy, a shot refused by the camera is reported as failed instead of being taken late.
+		@return false if an interval capture is already running
+	*/
+	bool startIntervalCapture(const IntervalOptions& options=IntervalOptions());
+	void stopIntervalCapture();
+	bool isIntervalCaptureRunning();
+	void getIntervalReport(IntervalReport& report);
+
+	ofEvent<IntervalShot> intervalShotTaken;
+	ofEvent<IntervalReport> intervalCaptureFinished;
+
+	//-----------------------------------------------------------------
+	// Synchronized trigger
+	//-----------------------------------------------------------------
+	/*!
+		Splits a call into preparing and sending, so that the requests of several cameras can be released at once,
+		see ofxSonyRemoteCameraManager::trigger(). prepareTrigger() opens the trigger connection, measures its round trip
+		with getVersions and builds the request, sendTrigger() only writes it and waits for the response.
+		A prepared trigger is sent once.
+	*/
+	SRCError prepareTrigger(TriggerMethod triggerMethod, long long& roundTripMicros);
+	/*!
+		@param sentTime when the request was written to the socket
+		@param ackTime when the response of the camera arrived
+		@param captureId of the postview with TRIGGER_TAKE_PICTURE, -1 otherwise
+	*/
+	SRCError sendTrigger(Poco::Timestamp& sentTime, Poco::Timestamp& ackTime, int& captureId);
+
+	//-----------------------------------------------------------------
+	// Postview
+	//-----------------------------------------------------------------
+	/*!
+		Postview images are downloaded on worker threads, capturing can continue meanwhile.
+		postViewProgress and postViewFetched are notified from update().
+	*/
+	void setPostViewOptions(const PostViewOptions& options);
+	void getPostViewOptions(PostViewOptions& options);
+	//! @return captureId of the download
+	int fetchPostView(const std::string& url);
+	//! drops the downloads which have not started
+	void cancelPendingPostViews();
+	int getPendingPostViewCount();
+
+	ofEvent<PostViewProgress> postViewProgress;
+	ofEvent<PostViewResult> postViewFetched;
 
 	//-----------------------------------------------------------------
 	// Movie recording
@@ -141,13 +917,31 @@ public:
 		@return SRCError SRC_OK is ok, others are error
 	*/
 	SRCError actZoom(const std::string& direction, const std::string& movement);
+	/*!
+		Moves the zoom to position (0-100) on a background thread, using the zoomPosition reported by getEvent as feedback.
+		Far targets are approached by continuous zoom which is stopped early by the distance it travels in one round trip,
+		near targets by 1shot steps. Event polling is started if it is not running. zoomFinished is notified from update().
+		@return false if the zoom is already moving
+	*/
+	bool startZoomTo(int position, const ZoomOptions& options=ZoomOptions());
+	void stopZoom();
+	bool isZooming();
+	void getZoomReport(ZoomReport& report);
+
+	ofEvent<ZoomReport> zoomFinished;
 
 	//-----------------------------------------------------------------
 	// Self-timer
 	//-----------------------------------------------------------------
+	/*!
+		The getters which return json (getSupported*, getAvailable*, getEvent, the server information and getStorageInformation)
+		do not return the body the camera sent. The response is streamed into the parser, and json is serialized again from it
+		as {"result":[...],"error":[code,"message"],"id":n}: other members of the body are dropped, getMethodTypes reports "result"
+		instead of "results", members of result objects may be reordered and numbers may be written differently.
+	*/
 	SRCError getSupportedSelfTimer(std::string& json);
 	SRCError getAvailableSelfTimer(std::string& json);
-	SRCError getSelfTimer(int& second);
+	SRCError getSelfTimer(int& second, bool forceRefresh=false);
 	SRCError setSelfTimer(int second);
 	
 	//-----------------------------------------------------------------
@@ -155,7 +949,7 @@ public:
 	//-----------------------------------------------------------------
 	SRCError getSupportedPostViewImageSize(std::string& json);
 	SRCError getAvailablePostViewImageSize(std::string& json);
-	SRCError getPostViewImageSize(PostViewImageSize& size);
+	SRCError getPostViewImageSize(PostViewImageSize& size, bool forceRefresh=false);
 	SRCError setPostViewImageSize(PostViewImageSize size);	
 
 	//-----------------------------------------------------------------
@@ -163,8 +957,8 @@ public:
 	//-----------------------------------------------------------------
 	SRCError getSupportedShootMode(std::string& json);
 	SRCError getAvailableShootMode(std::string& json);
-	SRCError getShootMode(ShootMode& mode);
-	SRCError setShootMode(ShootMode mode);
+	SRCError getShootMode(ShootMode& mode, bool forceRefresh=false);
+	SRCError setShootMode(ShootMode mode, const CallOptions& options=CallOptions());
 
 	//-----------------------------------------------------------------
 	// Event notification
@@ -172,13 +966,13 @@ public:
 	/*!
 		@params pollingFlag true: Callback when timeout or change point detection, false: Callback immediately
 	*/
-	SRCError getEvent(std::string& json, bool pollingFlag);
+	SRCError getEvent(std::string& json, bool pollingFlag, const CallOptions& options=CallOptions());
 
 	//-----------------------------------------------------------------
 	// Camera setup
 	//-----------------------------------------------------------------
-	SRCError startRecMode();
-	SRCError stopRecMode();
+	SRCError startRecMode(const CallOptions& options=CallOptions());
+	SRCError stopRecMode(const CallOptions& options=CallOptions());
 
 	//-----------------------------------------------------------------
 	// Server information
@@ -196,12 +990,12 @@ public:
 
 	SRCError getSupportedViewAngle(std::string& json);
 	SRCError getAvailableViewAngle(std::string& json);
-	SRCError getViewAngle(int& angle);
+	SRCError getViewAngle(int& angle, bool forceRefresh=false);
 	SRCError setViewAngle(int angle);
 
 	SRCError getSupportedMovieQuality(std::string& json);
 	SRCError getAvailableMovieQuality(std::string& json);
-	SRCError getMovieQuality(std::string& json);
+	SRCError getMovieQuality(std::string& quality, bool forceRefresh=false);
 	SRCError setMovieQuality(const std::string& quality); // TODO create arg
 	
 	SRCError getSupportedSteadyMode(std::string& json);
@@ -210,6 +1004,95 @@ public:
 	SRCError getAvailableCameraFunction(std::string& json);
 	SRCError getStorageInformation(std::string& json);
 
+	//-----------------------------------------------------------------
+	// Contents
+	//-----------------------------------------------------------------
+	/*!
+		Most cameras list their contents only in the "Contents Transfer" function, where the liveview stops.
+		@params function "Remote Shooting" or "Contents Transfer"
+	*/
+	SRCError setCameraFunction(const std::string& function);
+	SRCError getCameraFunction(std::string& function);
+	//! @params sources e.g. "storage:memoryCard1"
+	SRCError getSourceList(std::vector<std::string>& sources, const std::string& scheme="storage");
+	//! number of files under uri, e.g. "storage:memoryCard1"
+	SRCError getContentCount(const std::string& uri, int& count);
+	/*!
+		Lists count files from startIndex, the camera returns 100 at most.
+		@params contents the files are appended
+	*/
+	SRCError getContentList(const std::string& uri, int startIndex, int count, std::vector<Content>& contents);
+	//! pages through all files under uri with getContentList
+	SRCError listContents(const std::string& uri, std::vector<Content>& contents, int pageSize=100);
+
+	//-----------------------------------------------------------------
+	// JSON-RPC
+	//-----------------------------------------------------------------
+	/*!
+		Calls a method declared in ofxSonyRemoteCamera::method.
+		e.g. invoke<method::setSelfTimer>(10), invoke<method::getShootMode>(response)
+	*/
+	template <typename M> SRCError invoke()
+	{
+		Response response;
+		return invoke<M>(response);
+	}
+	template <typename M> SRCError invoke(Response& response, const CallOptions& options=CallOptions())
+	{
+		return invokeOn<M>(mSession, mRequestWriter, response, options);
+	}
+	template <typename M> SRCError invoke(typename M::Arg1 arg1)
+	{
+		Response response;
+		return invoke<M>(arg1, response);
+	}
+	template <typename M> SRCError invoke(typename M::Arg1 arg1, Response& response, const CallOptions& options=CallOptions())
+	{
+		return invokeOn<M>(mSession, mRequestWriter, arg1, response, options);
+	}
+	template <typename M> SRCError invoke(typename M::Arg1 arg1, typename M::Arg2 arg2)
+	{
+		Response response;
+		return invoke<M>(arg1, arg2, response);
+	}
+	template <typename M> SRCError invoke(typename M::Arg1 arg1, typename M::Arg2 arg2, Response& response, const CallOptions& options=CallOptions())
+	{
+		return invokeOn<M>(mSession, mRequestWriter, arg1, arg2, response, options);
+	}
+
+	//-----------------------------------------------------------------
+	// Timeouts
+	//-----------------------------------------------------------------
+	/*!
+		Deadline of a call, from sending the request to the end of the response, including its retries and their backoff.
+		A call which exceeds it returns SRC_ERROR_TIMEOUT and the connection is reset.
+		No retry is sent if its backoff would end after the deadline.
+		CallOptions::timeoutMillis overrides it for one call.
+	*/
+	void setDefaultTimeout(unsigned long long millis);
+	void setMethodTimeout(const std::string& method, unsigned long long millis);
+	unsigned long long getMethodTimeout(const std::string& method);
+
+	//-----------------------------------------------------------------
+	// Retries
+	//-----------------------------------------------------------------
+	/*!
+		SRC_ERROR_CAMERA_NOT_READY is retried for every method, the camera did not act on the request.
+		Idempotent methods are also retried on SRC_ERROR_TIMEOUT, SRC_ERROR_CONNECTION_FAILED and SRC_ERROR_STILL_CAPTURING_NOT_FINISHED.
+		By default get*, set*, awaitTakePicture, start/stopRecMode and start/stopLiveview are idempotent,
+		act*, start/stopMovieRec, start/stopIntervalStillRec and getEvent (a long poll) are not.
+	*/
+	void setRetryPolicy(const RetryPolicy& policy);
+	void getRetryPolicy(RetryPolicy& policy);
+	void setMethodIdempotent(const std::string& method, bool isIdempotent);
+	bool isMethodIdempotent(const std::string& method);
+
+	//-----------------------------------------------------------------
+	// Statistics
+	//-----------------------------------------------------------------
+	void getMethodStats(std::map<std::string, MethodStats>& stats);
+	void resetMethodStats();
+
 	//-----------------------------------------------------------------
 	// My Helper Functions
 	//-----------------------------------------------------------------
@@ -219,22 +1102,223 @@ public:
 private:
 	virtual void threadedFunction();
 	bool updateLiveView();
-	bool updateCommonHeader();
-	bool updatePayloadHeader();
-	bool updatePayloadData();
+	bool updateCommonHeader(CommonHeader& header);
+	bool updatePayloadHeader(PayloadHeader& header);
+	bool updatePayloadData(const CommonHeader& commonHeader, const PayloadHeader& payloadHeader);
+	/*!
+		pDefaultDecoder is used if no LiveViewDecoder is set, without both the frame is decoded on the calling thread.
+		@return false if the frame was not decoded
+	*/
+	bool decodeLiveViewFrame(const ofBuffer& jpeg, const CommonHeader& commonHeader, LiveViewDecoder* pDefaultDecoder=0);
+	void recordLiveViewFrame(const CommonHeader& commonHeader, const ofBuffer& jpeg);
+	//! liveview frame parsed by the reactor
+	void receiveLiveViewFrame(const CommonHeader& commonHeader, const PayloadHeader& payloadHeader, const ofBuffer& jpeg, LiveViewDecoder* pDefaultDecoder=0);
+	void receiveFrameInformation(const CommonHeader& commonHeader, const PayloadHeader& payloadHeader, const char* data, int size);
+	//! called with the lock, when the image of frameId becomes mLiveViewPixels
+	void publishFrameInformation(int frameId);
+	void readPayloadHeader(BYTE bytes[], PayloadHeader& header) const;
 	void updateRequest();
 	bool openLiveViewSession(const std::string& host, int port);
 	void closeLiveViewSession();
+	//! @params pSize calls startLiveviewWithSize if not 0
+	SRCError requestLiveView(std::string& url, const char* pSize=0);
+	SRCError connectLiveView(const std::string& url);
 
-	std::string httpPost(const std::string& json, const std::string& path);
+	// start up
+	void runStartUp();
+	void runStartUpSettings();
+	void beginStartUpPhase(StartUpPhase phase);
+	void endStartUpPhase(StartUpPhase phase, SRCError err);
+
+	/*!
+		Reads a response body within a deadline. The socket timeout only limits a single read,
+		so a body which trickles in would never time out. Each read from the socket gets the rest of the time
+		and throws Poco::TimeoutException once the deadline has passed.
+	*/
+	class DeadlineStreamBuf : public std::streambuf
+	{
+	public:
+		DeadlineStreamBuf(std::istream& source, Poco::Net::HTTPClientSession& session, const Poco::Timestamp& deadline);
+		//! skips the rest of the body, so that the session can be reused
+		void drain();
+	protected:
+		virtual int_type underflow();
+	private:
+		std::streambuf* mpSource;
+		Poco::Net::HTTPClientSession& mSession;
+		Poco::Timestamp mDeadline;
+		char mBuffer[4096];
+	};
+	bool httpPost(Poco::Net::HTTPClientSession& session, const char* data, size_t size, const std::string& path, Response& response, const Poco::Timestamp& deadline);
 	std::string httpPostAsync(const std::string& json, const std::string& path);
 
 	//json	
-	std::string createJson(const std::string& method, const std::vector<picojson::value>& params=std::vector<picojson::value>()) const;
-	picojson::value parse(const std::string& json)  const;
-	bool getJsonResultArray(picojson::array&  outArray, const std::string& json) const;
-	SRCError checkError(const std::string& json) const;
+	template <typename M> SRCError invokeOn(Poco::Net::HTTPClientSession& session, RequestWriter& writer, Response& response, const CallOptions& options=CallOptions())
+	{
+		const method::Params0* signature(static_cast<M*>(0));
+		(void)signature;
+		writer.begin(M::name());
+		writer.end(mId, M::version());
+		return send(session, M::name(), M::service(), writer, response, options);
+	}
+	template <typename M> SRCError invokeOn(Poco::Net::HTTPClientSession& session, RequestWriter& writer, typename M::Arg1 arg1, Response& response, const CallOptions& options=CallOptions())
+	{
+		const method::Params1<typename M::Arg1>* signature(static_cast<M*>(0));
+		(void)signature;
+		writer.begin(M::name());
+		writer.param(arg1);
+		writer.end(mId, M::version());
+		return send(session, M::name(), M::service(), writer, response, options);
+	}
+	template <typename M> SRCError invokeOn(Poco::Net::HTTPClientSession& session, RequestWriter& writer, typename M::Arg1 arg1, typename M::Arg2 arg2, Response& response, const CallOptions& options=CallOptions())
+	{
+		const method::Params2<typename M::Arg1, typename M::Arg2>* signature(static_cast<M*>(0));
+		(void)signature;
+		writer.begin(M::name());
+		writer.param(arg1);
+		writer.param(arg2);
+		writer.end(mId, M::version());
+		return send(session, M::name(), M::service(), writer, response, options);
+	}
+	SRCError send(Poco::Net::HTTPClientSession& session, const char* method, Service service, const RequestWriter& request, Response& response, const CallOptions& options);
+	//! one attempt, which ends at deadline, the deadline of the whole call
+	SRCError sendOnce(Poco::Net::HTTPClientSession& session, const char* method, Service service, const RequestWriter& request, Response& response,
+		const Poco::Timestamp& deadline, CancellationToken* pToken);
+	bool isRetryable(SRCError err, bool isIdempotent) const;
+	/*!
+		Waits for the backoff of a retry.
+		@return SRC_ERROR_TIMEOUT without waiting if the retry would start after deadline, SRC_ERROR_CANCELLED if cancelled
+	*/
+	SRCError waitForRetry(int retry, const RetryPolicy& policy, const Poco::Timestamp& deadline, CancellationToken* pToken);
+	static void setSessionTimeout(Poco::Net::HTTPClientSession& session, const Poco::Timestamp& deadline);
 	SRCError cvtError(int errorcode) const;
+	bool cvtShootMode(const std::string& str, ShootMode& mode) const;
+	bool cvtPostViewImageSize(const std::string& str, PostViewImageSize& size) const;
+
+	// settings cache
+	template <typename T> bool readCache(const CachedSetting<T>& setting, T& value);
+	template <typename T> void writeCache(CachedSetting<T>& setting, const T& value);
+	void updateSettingsCache(const JsonArena::Node& eventArray);
+
+	// capabilities
+	bool fetchCapabilities(Capabilities& capabilities);
+	bool readCapabilities(const std::string& path, Capabilities& capabilities) const;
+	bool writeCapabilities(const std::string& path, const Capabilities& capabilities) const;
+	std::string getCapabilityCachePath(const Capabilities& capabilities) const;
+
+	// settings snapshot
+	struct Channel
+	{
+		Poco::Net::HTTPClientSession session;
+		RequestWriter writer;
+		JsonArena arena;
+	};
+	class SnapshotWorker : public Poco::Runnable
+	{
+	public:
+		SnapshotWorker(ofxSonyRemoteCamera& camera, Channel& channel, SettingsSnapshot& snapshot) : mCamera(camera), mChannel(channel), mSnapshot(snapshot) {}
+		virtual void run();
+		Poco::Thread thread;
+	private:
+		ofxSonyRemoteCamera& mCamera;
+		Channel& mChannel;
+		SettingsSnapshot& mSnapshot;
+	};
+	int nextSnapshotField();
+	void fetchSnapshotField(Poco::Net::HTTPClientSession& session, RequestWriter& writer, JsonArena& arena, int field, SettingsSnapshot& snapshot);
+	void resetChannels();
+	void parseStorageInformation(const JsonArena::Node& storageArray, std::vector<StorageInformation>& storages) const;
+
+	// event polling
+	enum StateField
+	{
+		STATE_CAMERA_STATUS         = 1 << 0,
+		STATE_SHOOT_MODE            = 1 << 1,
+		STATE_ZOOM_POSITION         = 1 << 2,
+		STATE_AVAILABLE_API_LIST    = 1 << 3,
+		STATE_STORAGE_INFORMATION   = 1 << 4,
+	};
+	// burst
+	class BurstWorker : public Poco::Runnable
+	{
+	public:
+		BurstWorker(ofxSonyRemoteCamera& camera): mCamera(camera) {}
+		virtual void run();
+		//! cancels the shot in flight, also its retries and awaitTakePicture calls
+		void abort();
+		Poco::Thread thread;
+		Channel channel;
+		CancellationToken token;
+	private:
+		ofxSonyRemoteCamera& mCamera;
+	};
+	bool beginBurstShot();
+	SRCError takePictureOn(Channel& channel, int& captureId, int& awaitCalls, const CallOptions& options=CallOptions());
+	void endBurstShot(SRCError err, int captureId, int awaitCalls);
+	void finishBurst();
+	void joinBurstWorkers();
+
+	// interval
+	//! @return the shortest round trip of a few getVersions calls in microseconds, -1 if all failed
+	long long measureRoundTrip(Channel& channel, CancellationToken* pToken);
+	void runIntervalCapture();
+	void measureIntervalLatency();
+	bool waitForInterval(const Poco::Timestamp& time);
+	void addIntervalShot(const IntervalShot& shot);
+
+	// zoom
+	void runZoom();
+	void moveZoomContinuously(int direction, int& position, ZoomReport& report);
+	void moveZoomOneShot(int direction, int& position, ZoomReport& report);
+	SRCError sendZoomCommand(int direction, const char* movement, ZoomReport& report, bool isCancellable=true);
+	int waitForZoomPosition(int lastPosition, long timeoutMillis);
+	int waitForZoomSettled(int position, ZoomReport& report);
+	void publishZoomReport(const ZoomReport& report);
+
+	// postview
+	struct PostViewJob
+	{
+		int captureId;
+		std::string url;
+	};
+	class PostViewWorker : public Poco::Runnable
+	{
+	public:
+		PostViewWorker(ofxSonyRemoteCamera& camera): mCamera(camera) {}
+		virtual void run();
+		void abort();
+		Poco::Thread thread;
+	private:
+		ofxSonyRemoteCamera& mCamera;
+		Poco::Net::HTTPClientSession mSession;
+	};
+	int takePictureResult(const Response& response);
+	int enqueuePostView(const std::string& url);
+	bool nextPostViewJob(PostViewJob& job);
+	void downloadPostView(Poco::Net::HTTPClientSession& session, const PostViewJob& job);
+	void setPostViewProgress(const PostViewProgress& progress);
+	void startPostViewWorkers();
+	void stopPostViewWorkers();
+	void notifyPostViews();
+
+	class EventPoller : public ofThread
+	{
+	public:
+		EventPoller(ofxSonyRemoteCamera& camera) : mCamera(camera) {}
+		void setup(const std::string& host, int port);
+		void abort();
+	private:
+		virtual void threadedFunction();
+		ofxSonyRemoteCamera& mCamera;
+		Poco::Net::HTTPClientSession mSession;
+		RequestWriter mRequestWriter;
+		JsonArena mJsonArena;
+	};
+	SRCError pollEvent(Poco::Net::HTTPClientSession& session, RequestWriter& writer, JsonArena& arena, bool pollingFlag, const CallOptions& options=CallOptions());
+	//! updates the camera state with a getEvent response parsed into arena
+	SRCError applyEvent(const Response& response, JsonArena& arena);
+	void parseCameraState(const JsonArena::Node& eventArray, CameraState& state) const;
+	void notifyCameraStateChanges();
 	//
 	int bytesToInt(BYTE byteData[], int startIndex, int count) const;
 
@@ -247,16 +1331,24 @@ private:
 	};
 private:
 
+	static const char* VERSION;
+
 	std::string mHost;
 	int mPort;
 	int mId;
+	RequestWriter mRequestWriter;
+	JsonArena mJsonArena;
 
 	bool mIsVerbose;
 
 	int mLiveViewTimestamp;
 	int mLastLiveViewTimestamp;
+	unsigned int mLiveViewFrameCount;
+	Poco::Condition mLiveViewFrameCondition;	//!< broadcast with the thread mutex when a frame is received
 	bool mIsLiveViewStreaming;
 	ofPixels mLiveViewPixels;
+	LiveViewDecoder* mpLiveViewDecoder;
+	LiveViewRecorder* mpLiveViewRecorder;
 
 	bool mIsImageSizeUpdated;
 	ImageSize mImageSize;
@@ -268,11 +1360,118 @@ private:
 	std::string mSessionCameraPath;
 	std::string mSessionGuidePath;
 	std::string mSessionAccessControlPath;
+	std::string mSessionAvContentPath;
 
 	std::istream* mpLiveViewStream;
 
-	CommonHeader mCommonHeader;
+	CommonHeader mCommonHeader;		//!< of the latest image
 	PayloadHeader mPayloadHeader;
+	ofBuffer mPayloadData;			//!< read by updateLiveView(), handed to the decoder without a copy
+	std::deque<FrameInformation> mRecentFrameInformation;	//!< received lately, by frameId, until their image is shown
+	FrameInformation mLiveViewFrameInformation;	//!< of mLiveViewPixels or an earlier image
+	int mLiveViewFrameId;			//!< of mLiveViewPixels, -1 before the first image
+
+	ofMutex mStatsMutex;
+	std::map<std::string, MethodStats> mMethodStats;
+
+	ofMutex mTimeoutMutex;
+	unsigned long long mDefaultTimeout;
+	std::map<std::string, unsigned long long> mMethodTimeouts;
+
+	ofMutex mRetryMutex;
+	RetryPolicy mRetryPolicy;
+	std::map<std::string, bool> mMethodIdempotency;
+
+	ofMutex mCacheMutex;
+	SettingsCache mSettingsCache;
+	unsigned long long mSettingsCacheMaxAge;
+
+	Capabilities mCapabilities;
+	ofMutex mCapabilityMutex;
+	std::string mCapabilityCacheDirectory;
+
+	std::vector<Channel*> mChannels;
+	ofMutex mSnapshotRunMutex;	//!< held through a whole snapshot, so that snapshots do not share the channels
+	ofMutex mSnapshotMutex;
+	int mNextSnapshotField;		//!< of the running snapshot
+	int mSnapshotConcurrency;
+
+	ofMutex mPostViewMutex;
+	Poco::Condition mPostViewCondition;
+	PostViewOptions mPostViewOptions;
+	std::deque<PostViewJob> mPostViewJobs;
+	std::vector<PostViewWorker*> mPostViewWorkers;
+	bool mIsPostViewRunning;
+	int mNextCaptureId;
+	std::map<int, PostViewProgress> mPostViewProgresses;	//!< latest progress of each download, notified in update()
+	std::deque<PostViewResult> mPostViewResults;
+
+	ofMutex mBurstMutex;
+	Poco::Condition mBurstCondition;
+	BurstOptions mBurstOptions;
+	BurstReport mBurstReport;
+	std::vector<BurstWorker*> mBurstWorkers;
+	std::vector<Poco::Timestamp> mBurstShotTimes;
+	Poco::Timestamp mBurstStartTime;
+	Poco::Timestamp mLastBurstShotTime;
+	Poco::Timestamp mBurstResendTime;	//!< no shot is sent before it after SRC_ERROR_CAMERA_NOT_READY
+	int mBurstNotReadyInRow;
+	int mBurstStartedShots;
+	int mBurstInFlight;
+	int mBurstRunningWorkers;
+	bool mIsBurstStopping;
+	bool mIsBurstFinished;
+
+	Poco::Thread mIntervalThread;
+	Poco::RunnableAdapter<ofxSonyRemoteCamera> mIntervalRunnable;
+	Channel mIntervalChannel;
+	CancellationToken mIntervalToken;
+	ofMutex mIntervalMutex;
+	Poco::Condition mIntervalCondition;
+	IntervalOptions mIntervalOptions;
+	IntervalReport mIntervalReport;
+	std::deque<IntervalShot> mIntervalShots;	//!< notified from update()
+	Poco::Timestamp mIntervalStartTime;
+	unsigned long long mIntervalTotalAbsErrorMicros;
+	bool mIsIntervalRunning;
+	bool mIsIntervalStopping;
+	bool mIsIntervalFinished;
+
+	Poco::Thread mZoomThread;
+	Poco::RunnableAdapter<ofxSonyRemoteCamera> mZoomRunnable;
+	Channel mZoomChannel;
+	CancellationToken mZoomToken;
+	ofMutex mZoomMutex;
+	Poco::Condition mZoomCondition;
+	ZoomOptions mZoomOptions;
+	ZoomReport mZoomReport;
+	Poco::Timestamp mLastZoomCommandTime;
+	float mZoomSpeed;		//!< learned over the moves
+	bool mIsZoomRunning;
+	bool mIsZoomStopping;
+	bool mIsZoomFinished;
+
+	Channel mTriggerChannel;
+	Poco::Net::HTTPRequest mTriggerRequest;
+	const char* mpTriggerMethodName;	//!< of the prepared trigger, 0 if none
+
+	Poco::Thread mStartUpThread;
+	Poco::Thread mStartUpSettingsThread;
+	Poco::RunnableAdapter<ofxSonyRemoteCamera> mStartUpRunnable;
+	Poco::RunnableAdapter<ofxSonyRemoteCamera> mStartUpSettingsRunnable;
+	ofMutex mStartUpMutex;
+	Poco::Timestamp mStartUpTime;
+	StartUpReport mStartUpReport;
+	bool mIsStartUpFinished;
+
+	EventPoller mEventPoller;
+	ofxSonyRemoteCameraReactor* mpReactor;
+	bool mIsReactorEventPolling;
+	ofMutex mEventMutex;
+	Poco::Condition mEventCondition;	//!< broadcast when mCameraState is updated
+	CameraState mCameraState;
+	JsonArena mLastEventArena;
+	int mChangedStateFields;
 
 	// test
 	std::list<MyHttpPostRequest> mHttpPostList;
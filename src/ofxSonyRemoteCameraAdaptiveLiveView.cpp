@@ -0,0 +1,381 @@
+//
+//  ofxSonyRemoteCameraAdaptiveLiveView.cpp
+//
+#include "ofxSonyRemoteCameraAdaptiveLiveView.h"
+
+#include "FreeImage.h"
+
+static const float SMOOTHING(0.2f);
+//! doubling the decode resolution or stepping the size up gives about four times the pixels
+static const float STEP_UP_DECODE_FACTOR(4.0f);
+//! liveview sizes of startLiveviewWithSize, largest first
+static const char* SIZE_ORDER[] = {"L", "M"};
+
+ofxSonyRemoteCameraAdaptiveLiveView::ofxSonyRemoteCameraAdaptiveLiveView()
+	: mpCamera(0)
+	, mpPreviousDecoder(0)
+	, mWorkerRunnable(*this, &ofxSonyRemoteCameraAdaptiveLiveView::runWorker)
+	, mIsRunning(false)
+	, mHasFrame(false)
+	, mIsResizing(false)
+	, mHasDecodedFrame(false)
+	, mDecodedFrames(0)
+	, mMinTransportOffset(0)
+	, mHasTransportOffset(false)
+	, mReceivedFrames(0)
+	, mDroppedFrames(0)
+	, mIsOver(false)
+	, mIsUnder(false)
+{
+}
+
+ofxSonyRemoteCameraAdaptiveLiveView::~ofxSonyRemoteCameraAdaptiveLiveView()
+{
+	stop();
+}
+
+void ofxSonyRemoteCameraAdaptiveLiveView::setup(ofxSonyRemoteCamera& camera)
+{
+	stop();
+	mpCamera = &camera;
+}
+
+bool ofxSonyRemoteCameraAdaptiveLiveView::start(const Settings& settings/*=Settings()*/)
+{
+	stop();
+	if (!mpCamera) return false;
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		mSettings = settings;
+		mSettings.maxDecodeScale = std::min(8, std::max(1, settings.maxDecodeScale));
+		mHasFrame = false;
+		mRequestedSize.clear();
+		mSizes.clear();
+		mIsResizing = false;
+		mHasDecodedFrame = false;
+		mDecodedFrames = 0;
+		mHasTransportOffset = false;
+		mReceivedFrames = 0;
+		mDroppedFrames = 0;
+		mWindowStartTime.update();
+		mState = State();
+		mNotifiedState = mState;
+		mIsOver = false;
+		mIsUnder = false;
+		mLastStepTime.update();
+		mIsRunning = true;
+	}
+	mpPreviousDecoder = mpCamera->getLiveViewDecoder();
+	mpCamera->setLiveViewDecoder(this);
+	mWorkerThread.start(mWorkerRunnable);
+	return true;
+}
+
+void ofxSonyRemoteCameraAdaptiveLiveView::stop()
+{
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		if (!mIsRunning) return;
+		mIsRunning = false;
+		mTaskCondition.broadcast();
+	}
+	mWorkerThread.join();
+	mpCamera->setLiveViewDecoder(mpPreviousDecoder);
+	mpPreviousDecoder = 0;
+}
+
+bool ofxSonyRemoteCameraAdaptiveLiveView::isRunning()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return mIsRunning;
+}
+
+void ofxSonyRemoteCameraAdaptiveLiveView::getState(State& state)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	state = mState;
+}
+
+void ofxSonyRemoteCameraAdaptiveLiveView::update()
+{
+	bool isChanged(false);
+	State state;
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		if (!mIsRunning) return;
+		if (mHasDecodedFrame) {
+			// frames decoded since the last update() but the newest one were never seen by the app
+			mState.lagMillis += SMOOTHING * (mDecodedTime.elapsed() / 1000.0f - mState.lagMillis);
+			mDroppedFrames += mDecodedFrames - 1;
+			mHasDecodedFrame = false;
+			mDecodedFrames = 0;
+		}
+		if (mWindowStartTime.elapsed() >= static_cast<Poco::Timestamp::TimeDiff>(mSettings.windowMillis) * 1000) {
+			mState.dropRate = (mReceivedFrames > 0) ? std::min(1.0f, static_cast<float>(mDroppedFrames) / mReceivedFrames) : 0;
+			mReceivedFrames = 0;
+			mDroppedFrames = 0;
+			mWindowStartTime.update();
+		}
+		mState.latencyMillis = mState.queueMillis + mState.decodeMillis + mState.lagMillis + mState.transportMillis;
+
+		// a step needs the condition to hold for degradeMillis or recoverMillis, and the cooldown after the last step
+		const float target(mSettings.targetLatencyMillis);
+		const bool isOver(mState.latencyMillis > target || mState.dropRate > mSettings.maxDropRate);
+		const bool canStepUp(mState.decodeScale > 1 || (!mIsResizing && getSizeIndex() > 0));
+		const float predictedMillis(mState.latencyMillis + (STEP_UP_DECODE_FACTOR - 1) * mState.decodeMillis);
+		const bool isUnder(!isOver && canStepUp && predictedMillis < target * mSettings.recoverRatio
+			&& mState.dropRate <= mSettings.maxDropRate / 2);
+		if (isOver && !mIsOver) mOverSince.update();
+		if (isUnder && !mIsUnder) mUnderSince.update();
+		mIsOver = isOver;
+		mIsUnder = isUnder;
+		const bool isCooledDown(mLastStepTime.elapsed() >= static_cast<Poco::Timestamp::TimeDiff>(mSettings.cooldownMillis) * 1000);
+		if (isCooledDown && mIsOver && mOverSince.elapsed() >= static_cast<Poco::Timestamp::TimeDiff>(mSettings.degradeMillis) * 1000) {
+			Reason reason(REASON_DECODE);
+			if (mState.latencyMillis <= target) {
+				reason = REASON_DROPS;
+			} else if (mState.transportMillis > mState.queueMillis + mState.decodeMillis + mState.lagMillis) {
+				reason = REASON_TRANSPORT;
+			}
+			stepDown(reason);
+		} else if (isCooledDown && mIsUnder && mUnderSince.elapsed() >= static_cast<Poco::Timestamp::TimeDiff>(mSettings.recoverMillis) * 1000) {
+			stepUp();
+		}
+
+		if (mState.decodeScale != mNotifiedState.decodeScale || mState.liveViewSize != mNotifiedState.liveViewSize) {
+			mNotifiedState = mState;
+			state = mState;
+			isChanged = true;
+		}
+	}
+	if (isChanged) ofNotifyEvent(stateChanged, state);
+}
+
+void ofxSonyRemoteCameraAdaptiveLiveView::decode(ofxSonyRemoteCamera& camera, const ofBuffer& jpeg, int timestamp, int frameId)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	if (!mIsRunning) return;
+	// only the latest frame is decoded, a frame replaced in the mailbox is dropped
+	++mReceivedFrames;
+	if (mHasFrame) ++mDroppedFrames;
+	mMailbox.jpeg.assign(jpeg.getBinaryBuffer(), jpeg.getBinaryBuffer() + jpeg.size());
+	mMailbox.timestamp = timestamp;
+	mMailbox.frameId = frameId;
+	mMailbox.arrivalTime.update();
+	mHasFrame = true;
+
+	// the clocks differ by an unknown offset, the lowest one seen is taken as no delay
+	const long long offset(mMailbox.arrivalTime.epochMicroseconds() / 1000 - static_cast<unsigned int>(timestamp));
+	if (!mHasTransportOffset || offset < mMinTransportOffset) {
+		mMinTransportOffset = offset;
+		mHasTransportOffset = true;
+	}
+	mState.transportMillis += SMOOTHING * ((offset - mMinTransportOffset) - mState.transportMillis);
+	mTaskCondition.signal();
+}
+
+bool ofxSonyRemoteCameraAdaptiveLiveView::readJpegSize(const char* jpeg, size_t size, int& width, int& height)
+{
+	const unsigned char* pData(reinterpret_cast<const unsigned char*>(jpeg));
+	if (size < 4 || pData[0] != 0xff || pData[1] != 0xd8) return false;
+	size_t i(2);
+	while (i + 4 <= size) {
+		if (pData[i] != 0xff) return false;
+		const unsigned char marker(pData[i + 1]);
+		if (marker == 0xff) {
+			// fill byte
+			++i;
+			continue;
+		}
+		if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd8)) {
+			i += 2;
+			continue;
+		}
+		if (marker == 0xda || marker == 0xd9) return false;
+		const bool isSof(marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc);
+		if (isSof) {
+			if (i + 9 > size) return false;
+			height = (pData[i + 5] << 8) | pData[i + 6];
+			width = (pData[i + 7] << 8) | pData[i + 8];
+			return true;
+		}
+		i += 2 + ((pData[i + 2] << 8) | pData[i + 3]);
+	}
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Controller
+//////////////////////////////////////////////////////////////////////////
+int ofxSonyRemoteCameraAdaptiveLiveView::getSizeIndex() const
+{
+	std::vector<std::string>::const_iterator it(std::find(mSizes.begin(), mSizes.end(), mState.liveViewSize));
+	return (it != mSizes.end()) ? it - mSizes.begin() : 0;
+}
+
+void ofxSonyRemoteCameraAdaptiveLiveView::stepDown(Reason reason)
+{
+	const int sizeIndex(getSizeIndex());
+	const bool canResize(!mIsResizing && sizeIndex + 1 < static_cast<int>(mSizes.size()));
+	const bool canScale(mState.decodeScale < mSettings.maxDecodeScale);
+	// a late transport is helped only by a smaller liveview, the rest by decoding less
+	if (reason == REASON_TRANSPORT && canResize) {
+		mRequestedSize = mSizes[sizeIndex + 1];
+		mIsResizing = true;
+		mTaskCondition.signal();
+	} else if (canScale) {
+		mState.decodeScale *= 2;
+	} else if (canResize) {
+		mRequestedSize = mSizes[sizeIndex + 1];
+		mIsResizing = true;
+		mTaskCondition.signal();
+	} else {
+		return;
+	}
+	mState.reason = reason;
+	mIsOver = false;
+	mLastStepTime.update();
+}
+
+void ofxSonyRemoteCameraAdaptiveLiveView::stepUp()
+{
+	// the decode resolution comes back first, it costs no round trip
+	if (mState.decodeScale > 1) {
+		mState.decodeScale /= 2;
+	} else {
+		mRequestedSize = mSizes[getSizeIndex() - 1];
+		mIsResizing = true;
+		mTaskCondition.signal();
+	}
+	mState.reason = REASON_RECOVERED;
+	mIsUnder = false;
+	mLastStepTime.update();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Worker
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraAdaptiveLiveView::runWorker()
+{
+	// frames wait in the mailbox meanwhile
+	std::vector<std::string> sizes;
+	std::string currentSize;
+	if (mSettings.isSizeAdapted && mpCamera->isMethodSupported("startLiveviewWithSize")) {
+		std::vector<std::string> supportedSizes;
+		if (mpCamera->getSupportedLiveViewSize(supportedSizes) == ofxSonyRemoteCamera::SRC_OK) {
+			for (size_t i(0); i<sizeof(SIZE_ORDER)/sizeof(SIZE_ORDER[0]); ++i) {
+				if (std::find(supportedSizes.begin(), supportedSizes.end(), SIZE_ORDER[i]) != supportedSizes.end()) sizes.push_back(SIZE_ORDER[i]);
+			}
+		}
+		if (!sizes.empty() && (mpCamera->getLiveViewSize(currentSize) != ofxSonyRemoteCamera::SRC_OK
+			|| std::find(sizes.begin(), sizes.end(), currentSize) == sizes.end())) {
+			currentSize = sizes.front();
+		}
+	}
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		mSizes.swap(sizes);
+		mState.liveViewSize = currentSize;
+		mNotifiedState.liveViewSize = currentSize;
+	}
+
+	Frame frame;
+	std::string size;
+	ofPixels pixels;
+	while (waitForTask(frame, size)) {
+		if (!size.empty()) {
+			resizeLiveView(size);
+			size.clear();
+			continue;
+		}
+		const Poco::Timestamp startTime;
+		const float queueMillis((startTime - frame.arrivalTime) / 1000.0f);
+		if (!decodeFrame(frame, pixels)) continue;
+		const float decodeMillis(startTime.elapsed() / 1000.0f);
+		mpCamera->setLiveViewFrame(pixels, frame.timestamp, frame.frameId);
+
+		ofMutex::ScopedLock lock(mMutex);
+		mState.queueMillis += SMOOTHING * (queueMillis - mState.queueMillis);
+		mState.decodeMillis += SMOOTHING * (decodeMillis - mState.decodeMillis);
+		mHasDecodedFrame = true;
+		mDecodedTime.update();
+		++mDecodedFrames;
+	}
+}
+
+bool ofxSonyRemoteCameraAdaptiveLiveView::waitForTask(Frame& frame, std::string& size)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	while (mIsRunning && !mHasFrame && mRequestedSize.empty()) {
+		mTaskCondition.wait(mMutex);
+	}
+	if (!mIsRunning) return false;
+	if (!mRequestedSize.empty()) {
+		size.swap(mRequestedSize);
+		mRequestedSize.clear();
+		return true;
+	}
+	frame.jpeg.swap(mMailbox.jpeg);
+	frame.timestamp = mMailbox.timestamp;
+	frame.frameId = mMailbox.frameId;
+	frame.arrivalTime = mMailbox.arrivalTime;
+	frame.decodeScale = mState.decodeScale;
+	mHasFrame = false;
+	return true;
+}
+
+void ofxSonyRemoteCameraAdaptiveLiveView::resizeLiveView(const std::string& size)
+{
+	// reconnects the liveview, the camera thread is joined without holding the lock
+	const ofxSonyRemoteCamera::SRCError err(mpCamera->startLiveViewWithSize(size));
+	if (err != ofxSonyRemoteCamera::SRC_OK) {
+		ofLogError("adaptive liveview: startLiveviewWithSize " + size + " " + mpCamera->getErrorString(err));
+	}
+	ofMutex::ScopedLock lock(mMutex);
+	mIsResizing = false;
+	if (err == ofxSonyRemoteCamera::SRC_OK) {
+		mState.liveViewSize = size;
+		// the delay of the new stream is measured from scratch
+		mHasTransportOffset = false;
+		mState.transportMillis = 0;
+	}
+}
+
+bool ofxSonyRemoteCameraAdaptiveLiveView::decodeFrame(const Frame& frame, ofPixels& pixels)
+{
+	if (frame.jpeg.empty()) return false;
+	// the size in the upper 16 bits lets libjpeg decode at 1/2, 1/4 or 1/8 scale
+	int flags(JPEG_DEFAULT);
+	int width(0), height(0);
+	if (frame.decodeScale > 1 && readJpegSize(&frame.jpeg[0], frame.jpeg.size(), width, height)) {
+		flags = JPEG_FAST | ((std::max(width, height) / frame.decodeScale) << 16);
+	}
+	FIMEMORY* pMemory(FreeImage_OpenMemory(reinterpret_cast<BYTE*>(const_cast<char*>(&frame.jpeg[0])), frame.jpeg.size()));
+	FIBITMAP* pBitmap(FreeImage_LoadFromMemory(FIF_JPEG, pMemory, flags));
+	FreeImage_CloseMemory(pMemory);
+	if (pBitmap == 0) return false;
+	if (FreeImage_GetBPP(pBitmap) != 24) {
+		FIBITMAP* pConverted(FreeImage_ConvertTo24Bits(pBitmap));
+		FreeImage_Unload(pBitmap);
+		pBitmap = pConverted;
+		if (pBitmap == 0) return false;
+	}
+
+	// FreeImage rows are bottom up and BGR
+	width = FreeImage_GetWidth(pBitmap);
+	height = FreeImage_GetHeight(pBitmap);
+	if (pixels.getWidth() != width || pixels.getHeight() != height || pixels.getNumChannels() != 3) {
+		pixels.allocate(width, height, OF_IMAGE_COLOR);
+	}
+	unsigned char* pDestination(pixels.getPixels());
+	for (int y(0); y<height; ++y) {
+		const BYTE* pSource(FreeImage_GetScanLine(pBitmap, height - 1 - y));
+		for (int x(0); x<width; ++x, pSource+=3, pDestination+=3) {
+			pDestination[0] = pSource[FI_RGBA_RED];
+			pDestination[1] = pSource[FI_RGBA_GREEN];
+			pDestination[2] = pSource[FI_RGBA_BLUE];
+		}
+	}
+	FreeImage_Unload(pBitmap);
+	return true;
+}
@@ -0,0 +1,140 @@
+//
+//  ofxSonyRemoteCameraAdaptiveLiveView.h
+//
+//  Keeps the liveview latency of a camera under a target when the host is overloaded.
+//  Frames are decoded on a worker thread from a one frame mailbox, so a slow decode drops frames instead of queueing them.
+//  The decode time, the wait in the mailbox, the lag until the app picks the frame up, the transport delay and the
+//  drop rate are measured, and the controller steps the decode scale (1/2, 1/4, 1/8 by libjpeg) and, where the camera
+//  supports startLiveviewWithSize, the liveview size down and back up, with hysteresis.
+//  e.g. adaptive.setup(remoteCam); adaptive.start(); ... adaptive.update();
+//
+#pragma once
+
+#include "ofxSonyRemoteCamera.h"
+
+class ofxSonyRemoteCameraAdaptiveLiveView : public ofxSonyRemoteCamera::LiveViewDecoder
+{
+public:
+	struct Settings
+	{
+		Settings()
+			: targetLatencyMillis(150)
+			, maxDropRate(0.25f)
+			, degradeMillis(1000)
+			, recoverMillis(3000)
+			, cooldownMillis(2000)
+			, recoverRatio(0.6f)
+			, maxDecodeScale(8)
+			, isSizeAdapted(true)
+			, windowMillis(1000)
+		{}
+		float targetLatencyMillis;	//!< from the camera timestamp to the pickup by update()
+		float maxDropRate;			//!< of the frames received in a window
+		unsigned long long degradeMillis;	//!< over the target until a step down
+		unsigned long long recoverMillis;	//!< under the target until a step up
+		unsigned long long cooldownMillis;	//!< after each step
+		float recoverRatio;			//!< a step up needs the predicted latency under targetLatencyMillis * recoverRatio
+		int maxDecodeScale;			//!< 1, 2, 4 or 8
+		bool isSizeAdapted;			//!< steps the liveview size if the camera supports it
+		unsigned long long windowMillis;	//!< of the drop rate
+	};
+	enum Reason
+	{
+		REASON_START,
+		REASON_DECODE,				//!< decoding or the app is too slow
+		REASON_TRANSPORT,			//!< frames arrive late
+		REASON_DROPS,
+		REASON_RECOVERED
+	};
+	struct State
+	{
+		State(): decodeScale(1), reason(REASON_START), latencyMillis(0), decodeMillis(0), queueMillis(0), lagMillis(0), transportMillis(0), dropRate(0) {}
+		int decodeScale;			//!< the frames are decoded at 1 / decodeScale
+		std::string liveViewSize;	//!< e.g. "L", empty if the camera does not support startLiveviewWithSize
+		Reason reason;				//!< of the last step
+		float latencyMillis;		//!< sum of the ones below, smoothed
+		float decodeMillis;
+		float queueMillis;			//!< in the mailbox until decoded
+		float lagMillis;			//!< decoded until picked up by update()
+		float transportMillis;		//!< above the lowest delay seen from the camera
+		float dropRate;
+	};
+
+	ofxSonyRemoteCameraAdaptiveLiveView();
+	~ofxSonyRemoteCameraAdaptiveLiveView();
+
+	//! the controller becomes the LiveViewDecoder of camera on start()
+	void setup(ofxSonyRemoteCamera& camera);
+	bool start(const Settings& settings=Settings());
+	//! gives the camera back the decoder it had before start()
+	void stop();
+	bool isRunning();
+	//! measures the lag and steps the state, notifies stateChanged
+	void update();
+	void getState(State& state);
+
+	ofEvent<State> stateChanged;
+
+	// LiveViewDecoder
+	virtual void decode(ofxSonyRemoteCamera& camera, const ofBuffer& jpeg, int timestamp, int frameId);
+
+	//! reads the size from the SOF marker. @return false if jpeg has none
+	static bool readJpegSize(const char* jpeg, size_t size, int& width, int& height);
+
+private:
+	struct Frame
+	{
+		Frame(): timestamp(0), frameId(-1), decodeScale(1) {}
+		std::vector<char> jpeg;
+		int timestamp;
+		int frameId;
+		Poco::Timestamp arrivalTime;
+		int decodeScale;			//!< at the time it is taken from the mailbox
+	};
+
+	void runWorker();
+	/*!
+		Takes the frame from the mailbox, or a size to resize to.
+		@return false when stopped
+	*/
+	bool waitForTask(Frame& frame, std::string& size);
+	bool decodeFrame(const Frame& frame, ofPixels& pixels);
+	void resizeLiveView(const std::string& size);
+	void stepDown(Reason reason);
+	void stepUp();
+	int getSizeIndex() const;
+
+	ofxSonyRemoteCamera* mpCamera;
+	ofxSonyRemoteCamera::LiveViewDecoder* mpPreviousDecoder;	//!< restored by stop()
+	Settings mSettings;
+	Poco::Thread mWorkerThread;
+	Poco::RunnableAdapter<ofxSonyRemoteCameraAdaptiveLiveView> mWorkerRunnable;
+
+	ofMutex mMutex;
+	Poco::Condition mTaskCondition;
+	bool mIsRunning;
+	// mailbox
+	Frame mMailbox;
+	bool mHasFrame;
+	std::string mRequestedSize;	//!< resized by the worker
+	// worker
+	std::vector<std::string> mSizes;	//!< supported, largest first
+	bool mIsResizing;
+	bool mHasDecodedFrame;		//!< since the last update()
+	Poco::Timestamp mDecodedTime;
+	int mDecodedFrames;			//!< since the last update()
+	// measurements
+	long long mMinTransportOffset;	//!< lowest arrival - timestamp, ms
+	bool mHasTransportOffset;
+	unsigned int mReceivedFrames;	//!< in the window
+	unsigned int mDroppedFrames;
+	Poco::Timestamp mWindowStartTime;
+	State mState;
+	State mNotifiedState;
+	// hysteresis
+	Poco::Timestamp mOverSince;
+	Poco::Timestamp mUnderSince;
+	Poco::Timestamp mLastStepTime;
+	bool mIsOver;
+	bool mIsUnder;
+};
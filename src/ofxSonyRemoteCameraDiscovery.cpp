@@ -0,0 +1,477 @@
+//
+//  ofxSonyRemoteCameraDiscovery.cpp
+//
+#include "ofxSonyRemoteCameraDiscovery.h"
+
+#include "Poco/String.h"
+#include "Poco/Net/DatagramSocket.h"
+#include "Poco/Net/SocketAddress.h"
+
+#include <fstream>
+
+static const unsigned long long RECEIVE_SLICE_MILLIS(20);	//!< how often the search checks for enough devices
+static const int MAX_SEARCH_RESPONSE_SIZE(2048);
+
+/*!
+	Finds the element localName after offset, with or without a namespace prefix.
+	@params offset is moved behind the end tag
+	@params text content of the element, trimmed
+*/
+static bool findElement(const std::string& xml, const std::string& localName, size_t& offset, std::string& text)
+{
+	for (size_t pos(xml.find(localName, offset)); pos!=std::string::npos; pos=xml.find(localName, pos + 1)) {
+		const size_t nameEnd(pos + localName.size());
+		if (nameEnd >= xml.size() || (xml[nameEnd] != '>' && !isspace(static_cast<unsigned char>(xml[nameEnd])))) continue;
+		// <name or <prefix:name, not an end tag or a longer name
+		const size_t open(xml.rfind('<', pos));
+		if (open == std::string::npos) continue;
+		const std::string prefix(xml.substr(open + 1, pos - open - 1));
+		if (!prefix.empty() && (prefix[prefix.size() - 1] != ':' || prefix.find_first_of("/ \t\r\n<>") != std::string::npos)) continue;
+		const size_t tagEnd(xml.find('>', nameEnd));
+		if (tagEnd == std::string::npos) return false;
+		if (xml[tagEnd - 1] == '/') {
+			text.clear();
+			offset = tagEnd + 1;
+			return true;
+		}
+		const std::string endTag("</" + prefix + localName + ">");
+		const size_t close(xml.find(endTag, tagEnd + 1));
+		if (close == std::string::npos) return false;
+		text = Poco::trim(xml.substr(tagEnd + 1, close - tagEnd - 1));
+		offset = close + endTag.size();
+		return true;
+	}
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Probe workers
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraDiscovery::ProbeWorker::run()
+{
+	Probe probe;
+	while (mDiscovery.nextProbe(probe)) {
+		Device device;
+		const bool isFound(mDiscovery.fetchDescription(session, probe.location, mDiscovery.mProbeTimeoutMillis, device));
+		device.isCached = probe.isCached;
+		mDiscovery.finishProbe(isFound ? &device : 0);
+	}
+}
+
+void ofxSonyRemoteCameraDiscovery::ProbeWorker::abort()
+{
+	try {
+		session.abort();
+	} catch (Poco::Exception&) {
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Discovery
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCameraDiscovery::ofxSonyRemoteCameraDiscovery()
+	: mExpectedDevices(0)
+	, mIsProbing(false)
+	, mProbeTimeoutMillis(0)
+{
+}
+
+ofxSonyRemoteCameraDiscovery::~ofxSonyRemoteCameraDiscovery()
+{
+	stopProbes(true);
+}
+
+int ofxSonyRemoteCameraDiscovery::discover(std::vector<Device>& devices, const Settings& settings/*=Settings()*/)
+{
+	devices.clear();
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		mProbes.clear();
+		mProbedLocations.clear();
+		mFoundDevices.clear();
+		mExpectedDevices = settings.expectedDevices;
+		mProbeTimeoutMillis = settings.probeTimeoutMillis;
+		mIsProbing = true;
+	}
+	if (settings.isCacheProbed) {
+		std::vector<Device> cachedDevices;
+		getCachedDevices(cachedDevices);
+		for (std::vector<Device>::iterator it=cachedDevices.begin(); it!=cachedDevices.end(); ++it) {
+			enqueueProbe(it->location, true);
+		}
+	}
+	startProbes(std::max(1, settings.probeThreads));
+	search(settings, Poco::Timestamp() + static_cast<Poco::Timestamp::TimeDiff>(settings.timeoutMillis) * 1000);
+	// descriptions of late answers are still fetched, unless enough devices are found
+	stopProbes(isEnoughFound());
+
+	std::string cacheFile;
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		for (std::map<std::string, Device>::iterator it=mFoundDevices.begin(); it!=mFoundDevices.end(); ++it) {
+			devices.push_back(it->second);
+			mCache[it->first] = it->second;
+		}
+		cacheFile = mCacheFile;
+	}
+	if (!cacheFile.empty() && !writeCache(cacheFile)) {
+		ofLogWarning("cannot write " + cacheFile);
+	}
+	return devices.size();
+}
+
+bool ofxSonyRemoteCameraDiscovery::reconnect(const std::string& uuid, Device& device, unsigned long long timeoutMillis/*=2000*/)
+{
+	std::string location;
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		std::map<std::string, Device>::const_iterator it(mCache.find(uuid));
+		if (it == mCache.end()) return false;
+		location = it->second.location;
+	}
+	Poco::Net::HTTPClientSession session;
+	if (!fetchDescription(session, location, timeoutMillis, device)) return false;
+	device.isCached = true;
+
+	ofMutex::ScopedLock lock(mMutex);
+	mCache[device.uuid] = device;
+	return true;
+}
+
+void ofxSonyRemoteCameraDiscovery::getCachedDevices(std::vector<Device>& devices)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	devices.clear();
+	for (std::map<std::string, Device>::iterator it=mCache.begin(); it!=mCache.end(); ++it) {
+		devices.push_back(it->second);
+	}
+}
+
+void ofxSonyRemoteCameraDiscovery::clearCache()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	mCache.clear();
+}
+
+void ofxSonyRemoteCameraDiscovery::setCacheFile(const std::string& path)
+{
+	const std::string cacheFile(path.empty() ? "" : ofToDataPath(path, true));
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		mCacheFile = cacheFile;
+	}
+	if (!cacheFile.empty()) readCache(cacheFile);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Parsing
+//////////////////////////////////////////////////////////////////////////
+bool ofxSonyRemoteCameraDiscovery::parseDescription(const std::string& xml, const std::string& location, Device& device)
+{
+	device = Device();
+	device.location = location;
+	std::string text;
+	size_t offset(0);
+	if (findElement(xml, "UDN", offset, text)) device.uuid = text;
+	offset = 0;
+	if (findElement(xml, "friendlyName", offset, text)) device.friendlyName = text;
+	offset = 0;
+	if (findElement(xml, "modelName", offset, text)) device.modelName = text;
+	offset = 0;
+	std::string imagingDevice;
+	device.hasLiveView = findElement(xml, "X_ScalarWebAPI_ImagingDevice", offset, imagingDevice);
+	offset = 0;
+	if (device.hasLiveView && findElement(imagingDevice, "X_ScalarWebAPI_LiveView_URL", offset, text)) device.liveViewUrl = text;
+
+	// <X_ScalarWebAPI_Service><X_ScalarWebAPI_ServiceType>camera</...><X_ScalarWebAPI_ActionList_URL>http://10.0.0.1:10000/sony</...>
+	bool hasCamera(false);
+	std::string service;
+	offset = 0;
+	while (findElement(xml, "X_ScalarWebAPI_Service", offset, service)) {
+		std::string type, url;
+		size_t serviceOffset(0);
+		if (!findElement(service, "X_ScalarWebAPI_ServiceType", serviceOffset, type)) continue;
+		serviceOffset = 0;
+		if (!findElement(service, "X_ScalarWebAPI_ActionList_URL", serviceOffset, url)) continue;
+		std::string path;
+		try {
+			const Poco::URI uri(url);
+			path = uri.getPath();
+			if (type == "camera") {
+				device.endpoints.host = uri.getHost();
+				device.endpoints.port = uri.getPort();
+			}
+		} catch (Poco::Exception& e) {
+			ofLogWarning("discovery: " + url + ": " + e.displayText());
+			continue;
+		}
+		if (!path.empty() && path[path.size() - 1] == '/') path.erase(path.size() - 1);
+		path += "/" + type;
+		if (type == "camera") {
+			device.endpoints.cameraPath = path;
+			hasCamera = true;
+		} else if (type == "guide") {
+			device.endpoints.guidePath = path;
+		} else if (type == "accessControl") {
+			device.endpoints.accessControlPath = path;
+		} else if (type == "avContent") {
+			device.endpoints.avContentPath = path;
+		}
+	}
+	if (device.uuid.empty()) device.uuid = location;
+	return hasCamera;
+}
+
+bool ofxSonyRemoteCameraDiscovery::parseSearchResponse(const std::string& response, std::string& location, std::string& usn)
+{
+	// HTTP/1.1 200 OK\r\nLOCATION: http://10.0.0.1:64321/DmsRmtDesc.xml\r\nUSN: uuid:...::urn:...\r\n...
+	if (response.compare(0, 5, "HTTP/") != 0) return false;
+	const size_t statusEnd(response.find_first_of("\r\n"));
+	if (response.substr(0, statusEnd).find(" 200") == std::string::npos) return false;
+	location.clear();
+	usn.clear();
+	size_t lineStart(statusEnd);
+	while (lineStart < response.size()) {
+		lineStart = response.find_first_not_of("\r\n", lineStart);
+		if (lineStart == std::string::npos) break;
+		size_t lineEnd(response.find_first_of("\r\n", lineStart));
+		if (lineEnd == std::string::npos) lineEnd = response.size();
+		const std::string line(response.substr(lineStart, lineEnd - lineStart));
+		lineStart = lineEnd;
+		const size_t colon(line.find(':'));
+		if (colon == std::string::npos) continue;
+		const std::string name(Poco::trim(line.substr(0, colon)));
+		if (Poco::icompare(name, "LOCATION") == 0) {
+			location = Poco::trim(line.substr(colon + 1));
+		} else if (Poco::icompare(name, "USN") == 0) {
+			usn = Poco::trim(line.substr(colon + 1));
+		}
+	}
+	return !location.empty();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Search and probes
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraDiscovery::search(const Settings& settings, const Poco::Timestamp& deadline)
+{
+	std::vector<Poco::Net::SocketAddress> addresses;
+	for (std::vector<std::string>::const_iterator it=settings.searchAddresses.begin(); it!=settings.searchAddresses.end(); ++it) {
+		try {
+			addresses.push_back(Poco::Net::SocketAddress(*it));
+		} catch (Poco::Exception& e) {
+			ofLogError("discovery: " + *it + ": " + e.displayText());
+		}
+	}
+	Poco::Net::DatagramSocket socket;
+	try {
+		socket.bind(Poco::Net::SocketAddress("0.0.0.0", 0));
+	} catch (Poco::Exception& e) {
+		ofLogError("discovery: " + e.displayText());
+		return;
+	}
+
+	// sent again halfway, an M-SEARCH or its answers may be dropped
+	const Poco::Timestamp resendTime(deadline - (deadline - Poco::Timestamp()) / 2);
+	char buffer[MAX_SEARCH_RESPONSE_SIZE];
+	for (int sends(0); !isEnoughFound(); ) {
+		const Poco::Timestamp now;
+		if (now >= deadline) break;
+		if (sends == 0 || (sends == 1 && now >= resendTime)) {
+			for (std::vector<Poco::Net::SocketAddress>::iterator it=addresses.begin(); it!=addresses.end(); ++it) {
+				const std::string request("M-SEARCH * HTTP/1.1\r\nHOST: " + it->toString() + "\r\nMAN: \"ssdp:discover\"\r\nMX: 1\r\nST: "
+					+ settings.searchTarget + "\r\n\r\n");
+				try {
+					socket.sendTo(request.data(), request.size(), *it);
+				} catch (Poco::Exception& e) {
+					ofLogWarning("discovery: " + it->toString() + ": " + e.displayText());
+				}
+			}
+			++sends;
+		}
+		const Poco::Timestamp::TimeDiff sliceMicros(static_cast<Poco::Timestamp::TimeDiff>(RECEIVE_SLICE_MILLIS) * 1000);
+		socket.setReceiveTimeout(Poco::Timespan(std::min(sliceMicros, deadline - now)));
+		try {
+			Poco::Net::SocketAddress sender;
+			const int size(socket.receiveFrom(buffer, sizeof(buffer), sender));
+			std::string location, usn;
+			if (size > 0 && parseSearchResponse(std::string(buffer, size), location, usn)) {
+				enqueueProbe(location, false);
+			}
+		} catch (Poco::TimeoutException&) {
+		} catch (Poco::Exception& e) {
+			ofLogError("discovery: " + e.displayText());
+			break;
+		}
+	}
+}
+
+bool ofxSonyRemoteCameraDiscovery::isEnoughFound()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return mExpectedDevices > 0 && static_cast<int>(mFoundDevices.size()) >= mExpectedDevices;
+}
+
+bool ofxSonyRemoteCameraDiscovery::fetchDescription(Poco::Net::HTTPClientSession& session, const std::string& location, unsigned long long timeoutMillis, Device& device)
+{
+	const Poco::Timestamp startTime;
+	try {
+		const Poco::URI uri(location);
+		session.reset();
+		session.setHost(uri.getHost());
+		session.setPort(uri.getPort());
+		session.setTimeout(Poco::Timespan(static_cast<Poco::Timespan::TimeDiff>(timeoutMillis) * 1000));
+		Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, uri.getPathAndQuery(), Poco::Net::HTTPMessage::HTTP_1_1);
+		session.sendRequest(request);
+		Poco::Net::HTTPResponse response;
+		std::istream& stream(session.receiveResponse(response));
+		if (response.getStatus() != Poco::Net::HTTPResponse::HTTP_OK) {
+			ofLogWarning("discovery: " + location + ": " + ofToString(response.getStatus()));
+			return false;
+		}
+		std::string xml;
+		Poco::StreamCopier::copyToString(stream, xml);
+		if (!parseDescription(xml, location, device)) return false;
+	} catch (Poco::Exception& e) {
+		ofLogWarning("discovery: " + location + ": " + e.displayText());
+		return false;
+	}
+	device.probeMicros = startTime.elapsed();
+	return true;
+}
+
+void ofxSonyRemoteCameraDiscovery::enqueueProbe(const std::string& location, bool isCached)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	// every device answers each M-SEARCH, and twice per search
+	if (!mProbedLocations.insert(location).second) return;
+	Probe probe;
+	probe.location = location;
+	probe.isCached = isCached;
+	mProbes.push_back(probe);
+	mProbeCondition.signal();
+}
+
+bool ofxSonyRemoteCameraDiscovery::nextProbe(Probe& probe)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	while (mProbes.empty()) {
+		if (!mIsProbing) return false;
+		mProbeCondition.wait(mMutex);
+	}
+	probe = mProbes.front();
+	mProbes.pop_front();
+	return true;
+}
+
+void ofxSonyRemoteCameraDiscovery::finishProbe(const Device* pDevice)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	if (pDevice == 0) return;
+	std::map<std::string, Device>::iterator it(mFoundDevices.find(pDevice->uuid));
+	if (it == mFoundDevices.end()) {
+		mFoundDevices[pDevice->uuid] = *pDevice;
+	} else if (it->second.isCached && !pDevice->isCached) {
+		// moved to another address since it was cached
+		it->second = *pDevice;
+	}
+}
+
+void ofxSonyRemoteCameraDiscovery::startProbes(int threads)
+{
+	for (int i(0); i<threads; ++i) {
+		ProbeWorker* pWorker(new ProbeWorker(*this));
+		mWorkers.push_back(pWorker);
+		pWorker->thread.start(*pWorker);
+	}
+}
+
+void ofxSonyRemoteCameraDiscovery::stopProbes(bool isAborted)
+{
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		mIsProbing = false;
+		if (isAborted) mProbes.clear();
+		mProbeCondition.broadcast();
+	}
+	for (std::vector<ProbeWorker*>::iterator it=mWorkers.begin(); it!=mWorkers.end(); ++it) {
+		if (isAborted) (*it)->abort();
+		(*it)->thread.join();
+		delete *it;
+	}
+	mWorkers.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Cache file
+//////////////////////////////////////////////////////////////////////////
+bool ofxSonyRemoteCameraDiscovery::readCache(const std::string& path)
+{
+	std::ifstream file(path.c_str());
+	if (!file) return false;
+	picojson::value root;
+	const std::string err(picojson::parse(root, file));
+	if (!err.empty() || !root.get("devices").is<picojson::array>()) {
+		ofLogWarning("cannot parse " + path + ": " + err);
+		return false;
+	}
+	const picojson::array& devices(root.get("devices").get<picojson::array>());
+	ofMutex::ScopedLock lock(mMutex);
+	for (picojson::array::const_iterator it=devices.begin(); it!=devices.end(); ++it) {
+		if (!it->get("uuid").is<std::string>() || !it->get("location").is<std::string>()) continue;
+		Device device;
+		device.uuid = it->get("uuid").get<std::string>();
+		device.location = it->get("location").get<std::string>();
+		if (it->get("friendlyName").is<std::string>()) device.friendlyName = it->get("friendlyName").get<std::string>();
+		if (it->get("modelName").is<std::string>()) device.modelName = it->get("modelName").get<std::string>();
+		if (it->get("host").is<std::string>()) device.endpoints.host = it->get("host").get<std::string>();
+		if (it->get("port").is<double>()) device.endpoints.port = static_cast<int>(it->get("port").get<double>());
+		if (it->get("cameraPath").is<std::string>()) device.endpoints.cameraPath = it->get("cameraPath").get<std::string>();
+		if (it->get("guidePath").is<std::string>()) device.endpoints.guidePath = it->get("guidePath").get<std::string>();
+		if (it->get("accessControlPath").is<std::string>()) device.endpoints.accessControlPath = it->get("accessControlPath").get<std::string>();
+		if (it->get("avContentPath").is<std::string>()) device.endpoints.avContentPath = it->get("avContentPath").get<std::string>();
+		if (it->get("liveViewUrl").is<std::string>()) device.liveViewUrl = it->get("liveViewUrl").get<std::string>();
+		if (it->get("hasLiveView").is<bool>()) device.hasLiveView = it->get("hasLiveView").get<bool>();
+		device.isCached = true;
+		mCache[device.uuid] = device;
+	}
+	return true;
+}
+
+bool ofxSonyRemoteCameraDiscovery::writeCache(const std::string& path)
+{
+	picojson::array devices;
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		for (std::map<std::string, Device>::const_iterator it=mCache.begin(); it!=mCache.end(); ++it) {
+			const Device& device(it->second);
+			picojson::object object;
+			object["uuid"] = picojson::value(device.uuid);
+			object["location"] = picojson::value(device.location);
+			object["friendlyName"] = picojson::value(device.friendlyName);
+			object["modelName"] = picojson::value(device.modelName);
+			object["host"] = picojson::value(device.endpoints.host);
+			object["port"] = picojson::value(static_cast<double>(device.endpoints.port));
+			object["cameraPath"] = picojson::value(device.endpoints.cameraPath);
+			object["guidePath"] = picojson::value(device.endpoints.guidePath);
+			object["accessControlPath"] = picojson::value(device.endpoints.accessControlPath);
+			object["avContentPath"] = picojson::value(device.endpoints.avContentPath);
+			object["liveViewUrl"] = picojson::value(device.liveViewUrl);
+			object["hasLiveView"] = picojson::value(device.hasLiveView);
+			devices.push_back(picojson::value(object));
+		}
+	}
+	picojson::object root;
+	root["devices"] = picojson::value(devices);
+
+	try {
+		Poco::File(Poco::Path(path).parent()).createDirectories();
+	} catch (Poco::Exception& e) {
+		ofLogError(e.displayText());
+		return false;
+	}
+	std::ofstream file(path.c_str());
+	if (!file) return false;
+	file << picojson::value(root).serialize();
+	return file.good();
+}
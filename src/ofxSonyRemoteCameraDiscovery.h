@@ -0,0 +1,126 @@
+//
+//  ofxSonyRemoteCameraDiscovery.h
+//
+//  Finds cameras with SSDP M-SEARCH and reads their device descriptions for the service endpoints.
+//  The descriptions are fetched in parallel while the search is still running,
+//  and known devices are probed at their cached location at once, so a reconnect does not wait for SSDP.
+//  e.g. std::vector<ofxSonyRemoteCameraDiscovery::Device> devices; discovery.discover(devices);
+//      remoteCam.setup(devices[0].endpoints);
+//
+#pragma once
+
+#include "ofxSonyRemoteCamera.h"
+
+#include <set>
+
+class ofxSonyRemoteCameraDiscovery
+{
+public:
+	struct Device
+	{
+		Device(): hasLiveView(false), isCached(false), probeMicros(0) {}
+		std::string uuid;				//!< UDN, e.g. uuid:00000000-0000-1010-8000-...
+		std::string friendlyName;
+		std::string modelName;
+		std::string location;			//!< url of the device description
+		ofxSonyRemoteCamera::Endpoints endpoints;
+		std::string liveViewUrl;		//!< X_ScalarWebAPI_LiveView_URL, empty on most cameras
+		bool hasLiveView;				//!< the description lists an imaging device
+		bool isCached;					//!< probed at its cached location before the search answered
+		unsigned long long probeMicros;	//!< fetching and parsing the description
+	};
+	struct Settings
+	{
+		Settings()
+			: searchTarget("urn:schemas-sony-com:service:ScalarWebAPI:1")
+			, timeoutMillis(3000)
+			, probeTimeoutMillis(2000)
+			, probeThreads(8)
+			, expectedDevices(0)
+			, isCacheProbed(true)
+		{
+			searchAddresses.push_back("239.255.255.250:1900");
+		}
+		std::vector<std::string> searchAddresses;	//!< M-SEARCH is sent to each, e.g. 127.0.0.1:1900 for a simulator
+		std::string searchTarget;		//!< ST of M-SEARCH
+		unsigned long long timeoutMillis;	//!< of the search
+		unsigned long long probeTimeoutMillis;	//!< of fetching a description
+		int probeThreads;
+		int expectedDevices;			//!< discover() returns as soon as as many devices are found, 0 waits for the timeout
+		bool isCacheProbed;				//!< the cached devices are probed before the search answers
+	};
+
+	ofxSonyRemoteCameraDiscovery();
+	~ofxSonyRemoteCameraDiscovery();
+
+	/*!
+		Searches for cameras and fetches their descriptions, blocking until timeoutMillis or expectedDevices.
+		The cache is updated with the found devices.
+		@return number of devices
+	*/
+	int discover(std::vector<Device>& devices, const Settings& settings=Settings());
+	/*!
+		Fetches the description at the cached location of uuid without searching.
+		@return false if the device is not cached or does not answer
+	*/
+	bool reconnect(const std::string& uuid, Device& device, unsigned long long timeoutMillis=2000);
+
+	void getCachedDevices(std::vector<Device>& devices);
+	void clearCache();
+	/*!
+		The cache is read from path and written after each discover().
+		@params path relative to the data folder. empty keeps the cache in memory only.
+	*/
+	void setCacheFile(const std::string& path);
+
+	/*!
+		Reads the device description of a camera.
+		@return false if it has no camera service
+	*/
+	static bool parseDescription(const std::string& xml, const std::string& location, Device& device);
+	//! @return false if response is not an answer to M-SEARCH
+	static bool parseSearchResponse(const std::string& response, std::string& location, std::string& usn);
+
+private:
+	struct Probe
+	{
+		Probe(): isCached(false) {}
+		std::string location;
+		bool isCached;
+	};
+	class ProbeWorker : public Poco::Runnable
+	{
+	public:
+		ProbeWorker(ofxSonyRemoteCameraDiscovery& discovery): mDiscovery(discovery) {}
+		virtual void run();
+		void abort();
+		Poco::Thread thread;
+		Poco::Net::HTTPClientSession session;
+	private:
+		ofxSonyRemoteCameraDiscovery& mDiscovery;
+	};
+
+	bool fetchDescription(Poco::Net::HTTPClientSession& session, const std::string& location, unsigned long long timeoutMillis, Device& device);
+	//! @return false when the probes are stopped
+	bool nextProbe(Probe& probe);
+	void finishProbe(const Device* pDevice);
+	void enqueueProbe(const std::string& location, bool isCached);
+	void startProbes(int threads);
+	void stopProbes(bool isAborted);
+	void search(const Settings& settings, const Poco::Timestamp& deadline);
+	bool isEnoughFound();
+	bool readCache(const std::string& path);
+	bool writeCache(const std::string& path);
+
+	ofMutex mMutex;
+	Poco::Condition mProbeCondition;
+	std::vector<ProbeWorker*> mWorkers;
+	std::deque<Probe> mProbes;
+	std::set<std::string> mProbedLocations;		//!< of this discover()
+	std::map<std::string, Device> mFoundDevices;	//!< of this discover(), by uuid
+	int mExpectedDevices;
+	bool mIsProbing;
+	unsigned long long mProbeTimeoutMillis;
+	std::map<std::string, Device> mCache;		//!< by uuid
+	std::string mCacheFile;
+};
@@ -0,0 +1,140 @@
+//
+//  ofxSonyRemoteCameraJsonArena.cpp
+//
+#include "ofxSonyRemoteCameraJsonArena.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+
+//////////////////////////////////////////////////////////////////////////
+// Node
+//////////////////////////////////////////////////////////////////////////
+std::string ofxSonyRemoteCameraJsonArena::Node::getString() const
+{
+	if (!is(TYPE_STRING) || entry().valueLength == 0) return "";
+	return std::string(&mpArena->mChars[entry().valueOffset], entry().valueLength);
+}
+
+bool ofxSonyRemoteCameraJsonArena::Node::equals(const char* str) const
+{
+	if (!is(TYPE_STRING)) return false;
+	const size_t length(strlen(str));
+	return (entry().valueLength == length) && (length == 0 || memcmp(&mpArena->mChars[entry().valueOffset], str, length) == 0);
+}
+
+std::string ofxSonyRemoteCameraJsonArena::Node::getKey() const
+{
+	if (!isValid() || entry().keyLength == 0) return "";
+	return std::string(&mpArena->mChars[entry().keyOffset], entry().keyLength);
+}
+
+bool ofxSonyRemoteCameraJsonArena::Node::keyEquals(const char* key) const
+{
+	if (!isValid()) return false;
+	const size_t length(strlen(key));
+	return (entry().keyLength == length) && (length == 0 || memcmp(&mpArena->mChars[entry().keyOffset], key, length) == 0);
+}
+
+ofxSonyRemoteCameraJsonArena::Node ofxSonyRemoteCameraJsonArena::Node::getFirstChild() const
+{
+	if (size() == 0) return Node();
+	return Node(mpArena, mIndex + 1);
+}
+
+ofxSonyRemoteCameraJsonArena::Node ofxSonyRemoteCameraJsonArena::Node::getNextSibling() const
+{
+	// the caller iterates at most childCount siblings, the arena does not store the parent
+	if (!isValid()) return Node();
+	const size_t next(mIndex + entry().subtreeSize);
+	if (next >= mpArena->mEntries.size()) return Node();
+	return Node(mpArena, next);
+}
+
+ofxSonyRemoteCameraJsonArena::Node ofxSonyRemoteCameraJsonArena::Node::operator[](size_t index) const
+{
+	if (index >= size()) return Node();
+	Node child(getFirstChild());
+	for (size_t i(0); i<index; ++i) {
+		child = child.getNextSibling();
+	}
+	return child;
+}
+
+ofxSonyRemoteCameraJsonArena::Node ofxSonyRemoteCameraJsonArena::Node::get(const char* key) const
+{
+	if (!is(TYPE_OBJECT)) return Node();
+	Node child(getFirstChild());
+	for (size_t i(0); i<size(); ++i) {
+		if (child.keyEquals(key)) return child;
+		child = child.getNextSibling();
+	}
+	return Node();
+}
+
+void ofxSonyRemoteCameraJsonArena::Node::serialize(std::string& out) const
+{
+	switch (getType()) {
+	case TYPE_NULL:
+		out += "null";
+		break;
+	case TYPE_BOOL:
+		out += getBool() ? "true" : "false";
+		break;
+	case TYPE_NUMBER:
+		{
+			const double number(getNumber());
+			if (std::floor(number) == number && std::fabs(number) < 1e15) {
+				char buf[32];
+				sprintf(buf, "%.0f", number);
+				out += buf;
+			} else {
+				out += picojson::value(number).to_str();
+			}
+		}
+		break;
+	case TYPE_STRING:
+		picojson::serialize_str(getString(), std::back_inserter(out));
+		break;
+	case TYPE_ARRAY:
+	case TYPE_OBJECT:
+		{
+			const bool isObject(is(TYPE_OBJECT));
+			out += isObject ? '{' : '[';
+			Node child(getFirstChild());
+			for (size_t i(0); i<size(); ++i) {
+				if (i > 0) out += ',';
+				if (isObject) {
+					picojson::serialize_str(child.getKey(), std::back_inserter(out));
+					out += ':';
+				}
+				child.serialize(out);
+				child = child.getNextSibling();
+			}
+			out += isObject ? '}' : ']';
+		}
+		break;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Arena
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraJsonArena::clear()
+{
+	mEntries.clear();
+	mChars.clear();
+}
+
+void ofxSonyRemoteCameraJsonArena::swap(ofxSonyRemoteCameraJsonArena& other)
+{
+	mEntries.swap(other.mEntries);
+	mChars.swap(other.mChars);
+	mScratch.swap(other.mScratch);
+}
+
+ofxSonyRemoteCameraJsonArena::Node ofxSonyRemoteCameraJsonArena::getRoot() const
+{
+	if (mEntries.empty()) return Node();
+	return Node(this, 0);
+}
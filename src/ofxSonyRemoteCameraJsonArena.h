@@ -0,0 +1,246 @@
+//
+//  ofxSonyRemoteCameraJsonArena.h
+//
+//  JSON values stored in flat buffers which are reused for every response.
+//  Once the buffers have grown to the size of the largest response, parsing does not allocate.
+//
+#pragma once
+
+#include "picojson.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class ofxSonyRemoteCameraJsonArena
+{
+public:
+	enum Type
+	{
+		TYPE_NULL,
+		TYPE_BOOL,
+		TYPE_NUMBER,
+		TYPE_STRING,
+		TYPE_ARRAY,
+		TYPE_OBJECT,
+	};
+private:
+	struct Entry
+	{
+		Entry(): type(TYPE_NULL), keyOffset(0), keyLength(0), valueOffset(0), valueLength(0), number(0), childCount(0), subtreeSize(1) {}
+		Type type;
+		size_t keyOffset;	//!< member name, if the parent is an object
+		size_t keyLength;
+		size_t valueOffset;	//!< string value
+		size_t valueLength;
+		double number;		//!< number or bool value
+		size_t childCount;
+		size_t subtreeSize;	//!< number of entries including this one and its descendants
+	};
+public:
+	/*!
+		View of a value in the arena. It is valid until the arena is cleared.
+	*/
+	class Node
+	{
+	public:
+		Node(): mpArena(0), mIndex(0) {}
+		Node(const ofxSonyRemoteCameraJsonArena* pArena, size_t index): mpArena(pArena), mIndex(index) {}
+
+		bool isValid() const { return mpArena != 0; }
+		Type getType() const { return isValid() ? entry().type : TYPE_NULL; }
+		bool is(Type type) const { return isValid() && entry().type == type; }
+
+		bool getBool() const { return is(TYPE_BOOL) && entry().number != 0; }
+		double getNumber() const { return is(TYPE_NUMBER) ? entry().number : 0; }
+		int getInt() const { return static_cast<int>(getNumber()); }
+		std::string getString() const;
+		bool equals(const char* str) const;
+		std::string getKey() const;
+		bool keyEquals(const char* key) const;
+
+		size_t size() const { return isValid() ? entry().childCount : 0; }
+		Node getFirstChild() const;
+		Node getNextSibling() const;
+		Node operator[](size_t index) const;
+		//! member of an object
+		Node get(const char* key) const;
+
+		void serialize(std::string& out) const;
+	private:
+		const Entry& entry() const { return mpArena->mEntries[mIndex]; }
+		const ofxSonyRemoteCameraJsonArena* mpArena;
+		size_t mIndex;
+	};
+
+	ofxSonyRemoteCameraJsonArena() {}
+
+	//! keeps the capacity of the buffers
+	void clear();
+	void swap(ofxSonyRemoteCameraJsonArena& other);
+	Node getRoot() const;
+	size_t getNodeCount() const { return mEntries.size(); }
+	size_t getCapacityBytes() const { return mEntries.capacity() * sizeof(Entry) + mChars.capacity() + mScratch.capacity(); }
+
+	/*!
+		parses one value into the arena. the arena is cleared first.
+	*/
+	template <typename Iter> bool parse(picojson::input<Iter>& in)
+	{
+		clear();
+		return parseValue(in, 0, 0);
+	}
+
+private:
+	template <typename Iter> bool parseValue(picojson::input<Iter>& in, size_t keyOffset, size_t keyLength);
+	template <typename Iter> bool parseString(picojson::input<Iter>& in, size_t& offset, size_t& length);
+	template <typename Iter> bool matchLiteral(picojson::input<Iter>& in, const char* literal);
+
+	std::vector<Entry> mEntries;	//!< values in document order
+	std::vector<char> mChars;		//!< decoded strings and member names
+	std::string mScratch;
+};
+
+template <typename Iter>
+bool ofxSonyRemoteCameraJsonArena::parseValue(picojson::input<Iter>& in, size_t keyOffset, size_t keyLength)
+{
+	in.skip_ws();
+	const size_t index(mEntries.size());
+	mEntries.push_back(Entry());
+	mEntries[index].keyOffset = keyOffset;
+	mEntries[index].keyLength = keyLength;
+
+	const int ch(in.getc());
+	switch (ch) {
+	case 'n':
+		if (!matchLiteral(in, "ull")) return false;
+		break;
+	case 'f':
+		if (!matchLiteral(in, "alse")) return false;
+		mEntries[index].type = TYPE_BOOL;
+		break;
+	case 't':
+		if (!matchLiteral(in, "rue")) return false;
+		mEntries[index].type = TYPE_BOOL;
+		mEntries[index].number = 1;
+		break;
+	case '"':
+		{
+			size_t offset(0), length(0);
+			if (!parseString(in, offset, length)) return false;
+			mEntries[index].type = TYPE_STRING;
+			mEntries[index].valueOffset = offset;
+			mEntries[index].valueLength = length;
+		}
+		break;
+	case '[':
+		{
+			size_t count(0);
+			if (!in.expect(']')) {
+				do {
+					if (!parseValue(in, 0, 0)) return false;
+					++count;
+				} while (in.expect(','));
+				if (!in.expect(']')) return false;
+			}
+			mEntries[index].type = TYPE_ARRAY;
+			mEntries[index].childCount = count;
+		}
+		break;
+	case '{':
+		{
+			size_t count(0);
+			if (!in.expect('}')) {
+				do {
+					size_t offset(0), length(0);
+					if (!in.expect('"') || !parseString(in, offset, length) || !in.expect(':') || !parseValue(in, offset, length)) return false;
+					++count;
+				} while (in.expect(','));
+				if (!in.expect('}')) return false;
+			}
+			mEntries[index].type = TYPE_OBJECT;
+			mEntries[index].childCount = count;
+		}
+		break;
+	default:
+		{
+			if (!(('0' <= ch && ch <= '9') || ch == '-')) {
+				in.ungetc();
+				return false;
+			}
+			char num[64];
+			size_t length(0);
+			num[length++] = static_cast<char>(ch);
+			while (true) {
+				const int c(in.getc());
+				if (('0' <= c && c <= '9') || c == '+' || c == '-' || c == '.' || c == 'e' || c == 'E') {
+					if (length + 1 >= sizeof(num)) return false;
+					num[length++] = static_cast<char>(c);
+				} else {
+					in.ungetc();
+					break;
+				}
+			}
+			num[length] = '\0';
+			char* endp(0);
+			mEntries[index].type = TYPE_NUMBER;
+			mEntries[index].number = strtod(num, &endp);
+			if (endp != num + length) return false;
+		}
+		break;
+	}
+	mEntries[index].subtreeSize = mEntries.size() - index;
+	return true;
+}
+
+template <typename Iter>
+bool ofxSonyRemoteCameraJsonArena::parseString(picojson::input<Iter>& in, size_t& offset, size_t& length)
+{
+	// the opening quote has been read
+	offset = mChars.size();
+	while (true) {
+		int ch(in.getc());
+		if (ch < ' ') {
+			in.ungetc();
+			return false;
+		} else if (ch == '"') {
+			length = mChars.size() - offset;
+			return true;
+		} else if (ch == '\\') {
+			if ((ch = in.getc()) == -1) return false;
+			switch (ch) {
+			case '"': mChars.push_back('"'); break;
+			case '\\': mChars.push_back('\\'); break;
+			case '/': mChars.push_back('/'); break;
+			case 'b': mChars.push_back('\b'); break;
+			case 'f': mChars.push_back('\f'); break;
+			case 'n': mChars.push_back('\n'); break;
+			case 'r': mChars.push_back('\r'); break;
+			case 't': mChars.push_back('\t'); break;
+			case 'u':
+				mScratch.clear();
+				if (!picojson::_parse_codepoint(mScratch, in)) return false;
+				mChars.insert(mChars.end(), mScratch.begin(), mScratch.end());
+				break;
+			default:
+				return false;
+			}
+		} else {
+			mChars.push_back(static_cast<char>(ch));
+		}
+	}
+	return false;
+}
+
+template <typename Iter>
+bool ofxSonyRemoteCameraJsonArena::matchLiteral(picojson::input<Iter>& in, const char* literal)
+{
+	for (; *literal; ++literal) {
+		if (in.getc() != *literal) {
+			in.ungetc();
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,694 @@
+//
+//  ofxSonyRemoteCameraManager.cpp
+//
+#include "ofxSonyRemoteCameraManager.h"
+
+static const unsigned long long FPS_INTERVAL(1000000);	//!< us
+
+ofxSonyRemoteCameraManager::ofxSonyRemoteCameraManager()
+	: mNextBroadcastId(0)
+	, mNextScriptId(0)
+	, mNextIoCamera(0)
+	, mNextDecodeCamera(0)
+	, mIsRunning(false)
+{
+}
+
+ofxSonyRemoteCameraManager::~ofxSonyRemoteCameraManager()
+{
+	exit();
+	for (std::vector<Entry*>::iterator it=mCameras.begin(); it!=mCameras.end(); ++it) {
+		delete (*it)->pCamera;
+		delete *it;
+	}
+}
+
+void ofxSonyRemoteCameraManager::setup(const Settings& settings/*=Settings()*/)
+{
+	stopWorkers();
+	mSettings = settings;
+	mSettings.ioThreads = std::max(1, settings.ioThreads);
+	mSettings.decodeThreads = std::max(0, settings.decodeThreads);
+
+	// outside of the lock, closing a liveview waits for the reactor thread which may be decoding
+	if (mSettings.isReactor) mReactor.start();
+	for (std::vector<Entry*>::iterator it=mCameras.begin(); it!=mCameras.end(); ++it) {
+		(*it)->pCamera->setReactor(mSettings.isReactor ? &mReactor : 0);
+	}
+	if (!mSettings.isReactor) mReactor.stop();
+
+	ofMutex::ScopedLock lock(mMutex);
+	for (std::vector<Entry*>::iterator it=mCameras.begin(); it!=mCameras.end(); ++it) {
+		(*it)->pCamera->setLiveViewDecoder(mSettings.decodeThreads > 0 ? this : 0);
+	}
+	mIsRunning = true;
+	for (int i(0); i<mSettings.ioThreads; ++i) {
+		mWorkers.push_back(new Worker(*this, &ofxSonyRemoteCameraManager::runIo));
+	}
+	for (int i(0); i<mSettings.decodeThreads; ++i) {
+		mWorkers.push_back(new Worker(*this, &ofxSonyRemoteCameraManager::runDecode));
+	}
+	for (std::vector<Worker*>::iterator it=mWorkers.begin(); it!=mWorkers.end(); ++it) {
+		(*it)->thread.start(**it);
+	}
+}
+
+void ofxSonyRemoteCameraManager::exit()
+{
+	// the running commands are finished first, they use the sessions of the cameras
+	stopWorkers();
+	for (std::vector<Entry*>::iterator it=mCameras.begin(); it!=mCameras.end(); ++it) {
+		(*it)->pCamera->exit();
+		(*it)->jobs.clear();
+	}
+	mReactor.stop();
+	// broadcasts which did not finish are dropped without notification
+	for (std::map<int, Broadcast*>::iterator it=mBroadcasts.begin(); it!=mBroadcasts.end(); ++it) {
+		delete it->second->pCommand;
+		delete it->second;
+	}
+	mBroadcasts.clear();
+	mFinishedBroadcasts.clear();
+	for (std::map<int, ScriptRun*>::iterator it=mScripts.begin(); it!=mScripts.end(); ++it) {
+		delete it->second->pScript;
+		delete it->second;
+	}
+	mScripts.clear();
+	mFinishedScripts.clear();
+}
+
+void ofxSonyRemoteCameraManager::update()
+{
+	std::vector<Entry*> entries;
+	getEntries(entries);
+	for (std::vector<Entry*>::iterator it=entries.begin(); it!=entries.end(); ++it) {
+		(*it)->pCamera->update();
+	}
+
+	std::deque<BroadcastResult> results;
+	std::deque<ScriptResult> scriptResults;
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		for (std::vector<Entry*>::iterator it=mCameras.begin(); it!=mCameras.end(); ++it) {
+			Entry& entry(**it);
+			const Poco::Timestamp::TimeDiff elapsed(entry.fpsTime.elapsed());
+			if (elapsed < static_cast<Poco::Timestamp::TimeDiff>(FPS_INTERVAL)) continue;
+			entry.liveViewFps = (entry.decodedFrames - entry.fpsFrames) * 1000000.0f / elapsed;
+			entry.fpsFrames = entry.decodedFrames;
+			entry.fpsTime.update();
+		}
+		results.swap(mFinishedBroadcasts);
+		scriptResults.swap(mFinishedScripts);
+		for (std::deque<BroadcastResult>::iterator it=results.begin(); it!=results.end(); ++it) {
+			std::map<int, Broadcast*>::iterator broadcastIt(mBroadcasts.find(it->id));
+			if (broadcastIt == mBroadcasts.end()) continue;
+			delete broadcastIt->second;
+			mBroadcasts.erase(broadcastIt);
+		}
+	}
+	for (std::deque<BroadcastResult>::iterator it=results.begin(); it!=results.end(); ++it) {
+		ofNotifyEvent(broadcastFinished, *it);
+	}
+	for (std::deque<ScriptResult>::iterator it=scriptResults.begin(); it!=scriptResults.end(); ++it) {
+		ofNotifyEvent(scriptFinished, *it);
+	}
+}
+
+int ofxSonyRemoteCameraManager::addCamera(const std::string& host, int port/*=10000*/)
+{
+	ofxSonyRemoteCamera::Endpoints endpoints;
+	endpoints.host = host;
+	endpoints.port = port;
+	return addCamera(endpoints);
+}
+
+int ofxSonyRemoteCameraManager::addCamera(const ofxSonyRemoteCamera::Endpoints& endpoints)
+{
+	Entry* pEntry(new Entry());
+	pEntry->host = endpoints.host;
+	pEntry->port = endpoints.port;
+	pEntry->pCamera = new ofxSonyRemoteCamera();
+	pEntry->pCamera->setup(endpoints);
+	pEntry->pCamera->setLiveViewDecoder(mSettings.decodeThreads > 0 ? this : 0);
+	if (mSettings.isReactor) pEntry->pCamera->setReactor(&mReactor);
+
+	ofMutex::ScopedLock lock(mMutex);
+	mCameras.push_back(pEntry);
+	const int index(mCameras.size() - 1);
+	mCameraIndices[pEntry->pCamera] = index;
+	mIoCondition.broadcast();
+	return index;
+}
+
+int ofxSonyRemoteCameraManager::getCameraCount()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return mCameras.size();
+}
+
+ofxSonyRemoteCamera& ofxSonyRemoteCameraManager::getCamera(int index)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return *mCameras[index]->pCamera;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Broadcast
+//////////////////////////////////////////////////////////////////////////
+int ofxSonyRemoteCameraManager::broadcast(Command* pCommand)
+{
+	std::vector<int> cameraIndices;
+	const int count(getCameraCount());
+	for (int i(0); i<count; ++i) {
+		cameraIndices.push_back(i);
+	}
+	return broadcast(pCommand, cameraIndices);
+}
+
+int ofxSonyRemoteCameraManager::broadcast(Command* pCommand, const std::vector<int>& cameraIndices)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	Broadcast* pBroadcast(new Broadcast());
+	pBroadcast->pCommand = pCommand;
+	pBroadcast->result.id = mNextBroadcastId++;
+	for (std::vector<int>::const_iterator it=cameraIndices.begin(); it!=cameraIndices.end(); ++it) {
+		if (*it < 0 || *it >= static_cast<int>(mCameras.size())) continue;
+		Job job;
+		job.broadcastId = pBroadcast->result.id;
+		job.slot = pBroadcast->result.cameraIndices.size();
+		mCameras[*it]->jobs.push_back(job);
+		pBroadcast->result.cameraIndices.push_back(*it);
+		pBroadcast->result.errors.push_back(ofxSonyRemoteCamera::SRC_ERROR_UNKNOWN);
+		pBroadcast->result.elapsedMicros.push_back(0);
+	}
+	pBroadcast->remaining = pBroadcast->result.cameraIndices.size();
+	mBroadcasts[pBroadcast->result.id] = pBroadcast;
+	if (pBroadcast->remaining == 0) {
+		pBroadcast->result.isFinished = true;
+		delete pBroadcast->pCommand;
+		pBroadcast->pCommand = 0;
+		mFinishedBroadcasts.push_back(pBroadcast->result);
+	}
+	mIoCondition.broadcast();
+	return pBroadcast->result.id;
+}
+
+bool ofxSonyRemoteCameraManager::waitForBroadcast(int id, long timeoutMillis, BroadcastResult& result)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	const Poco::Timestamp startTime;
+	while (true) {
+		std::map<int, Broadcast*>::iterator it(mBroadcasts.find(id));
+		if (it == mBroadcasts.end()) return false;
+		if (it->second->result.isFinished) {
+			result = it->second->result;
+			return true;
+		}
+		const long remaining(timeoutMillis - static_cast<long>(startTime.elapsed() / 1000));
+		if (remaining <= 0) return false;
+		mBroadcastCondition.tryWait(mMutex, remaining);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Scripts
+//////////////////////////////////////////////////////////////////////////
+int ofxSonyRemoteCameraManager::runScript(int cameraIndex, ofxSonyRemoteCameraScript* pScript)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	if (cameraIndex < 0 || cameraIndex >= static_cast<int>(mCameras.size())) {
+		delete pScript;
+		return -1;
+	}
+	ScriptRun* pRun(new ScriptRun());
+	pRun->pScript = pScript;
+	pRun->cameraIndex = cameraIndex;
+	pScript->getContext().pCancellationToken = &pRun->token;
+	const int id(mNextScriptId++);
+	mScripts[id] = pRun;
+	mIoCondition.signal();
+	return id;
+}
+
+void ofxSonyRemoteCameraManager::cancelScript(int id)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	std::map<int, ScriptRun*>::iterator it(mScripts.find(id));
+	if (it == mScripts.end()) return;
+	it->second->token.cancel();
+	// a yielding script is resumed at once to finish
+	mIoCondition.broadcast();
+}
+
+int ofxSonyRemoteCameraManager::getRunningScriptCount()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return mScripts.size();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Synchronized trigger
+//////////////////////////////////////////////////////////////////////////
+bool ofxSonyRemoteCameraManager::trigger(ofxSonyRemoteCamera::TriggerMethod method, TriggerResult& result, const TriggerOptions& options/*=TriggerOptions()*/)
+{
+	std::vector<int> cameraIndices;
+	const int count(getCameraCount());
+	for (int i(0); i<count; ++i) {
+		cameraIndices.push_back(i);
+	}
+	return trigger(method, cameraIndices, result, options);
+}
+
+bool ofxSonyRemoteCameraManager::trigger(ofxSonyRemoteCamera::TriggerMethod method, const std::vector<int>& cameraIndices, TriggerResult& result, const TriggerOptions& options/*=TriggerOptions()*/)
+{
+	result = TriggerResult();
+	TriggerRelease release;
+	std::vector<TriggerSender*> senders;
+	std::vector<Entry*> entries;
+	getEntries(entries);
+	for (std::vector<int>::const_iterator it=cameraIndices.begin(); it!=cameraIndices.end(); ++it) {
+		if (*it < 0 || *it >= static_cast<int>(entries.size())) continue;
+		result.cameraIndices.push_back(*it);
+		senders.push_back(new TriggerSender(release, *entries[*it]->pCamera, method, options.spinMicros));
+	}
+	const Poco::Timestamp startTime;
+	for (std::vector<TriggerSender*>::iterator it=senders.begin(); it!=senders.end(); ++it) {
+		(*it)->thread.start(**it);
+	}
+
+	{
+		ofMutex::ScopedLock lock(release.mutex);
+		while (release.prepared < static_cast<int>(senders.size())) {
+			release.condition.wait(release.mutex);
+		}
+		result.prepareMicros = startTime.elapsed();
+		// the slowest connection is sent to first
+		long long maxLatency(0);
+		for (std::vector<TriggerSender*>::iterator it=senders.begin(); it!=senders.end(); ++it) {
+			if ((*it)->err == ofxSonyRemoteCamera::SRC_OK) maxLatency = std::max(maxLatency, (*it)->roundTripMicros / 2);
+		}
+		for (std::vector<TriggerSender*>::iterator it=senders.begin(); it!=senders.end(); ++it) {
+			if (options.isLatencyCompensated && (*it)->err == ofxSonyRemoteCamera::SRC_OK) {
+				(*it)->offsetMicros = maxLatency - (*it)->roundTripMicros / 2;
+			}
+		}
+		release.time = Poco::Timestamp() + options.releaseDelayMicros;
+		release.isReleased = true;
+		release.condition.broadcast();
+	}
+
+	bool isSucceeded(true);
+	bool hasSkew(false);
+	long long minSendSkew(0), maxSendSkew(0), minAckSkew(0), maxAckSkew(0);
+	for (std::vector<TriggerSender*>::iterator it=senders.begin(); it!=senders.end(); ++it) {
+		TriggerSender& sender(**it);
+		sender.thread.join();
+		const bool isOk(sender.err == ofxSonyRemoteCamera::SRC_OK);
+		const long long sendSkew(isOk ? sender.sentTime - release.time : 0);
+		const long long ackSkew(isOk ? sender.ackTime - release.time : 0);
+		result.errors.push_back(sender.err);
+		result.captureIds.push_back(sender.captureId);
+		result.roundTripMicros.push_back(sender.roundTripMicros);
+		result.sendSkewMicros.push_back(sendSkew);
+		result.ackSkewMicros.push_back(ackSkew);
+		delete *it;
+		if (!isOk) {
+			isSucceeded = false;
+			continue;
+		}
+		minSendSkew = hasSkew ? std::min(minSendSkew, sendSkew) : sendSkew;
+		maxSendSkew = hasSkew ? std::max(maxSendSkew, sendSkew) : sendSkew;
+		minAckSkew = hasSkew ? std::min(minAckSkew, ackSkew) : ackSkew;
+		maxAckSkew = hasSkew ? std::max(maxAckSkew, ackSkew) : ackSkew;
+		hasSkew = true;
+	}
+	result.sendSpreadMicros = maxSendSkew - minSendSkew;
+	result.ackSpreadMicros = maxAckSkew - minAckSkew;
+	return isSucceeded;
+}
+
+void ofxSonyRemoteCameraManager::TriggerSender::run()
+{
+	err = mCamera.prepareTrigger(mMethod, roundTripMicros);
+	Poco::Timestamp sendTime;
+	{
+		ofMutex::ScopedLock lock(mRelease.mutex);
+		++mRelease.prepared;
+		mRelease.condition.broadcast();
+		while (!mRelease.isReleased) {
+			mRelease.condition.wait(mRelease.mutex);
+		}
+		sendTime = mRelease.time + offsetMicros;
+	}
+	if (err != ofxSonyRemoteCamera::SRC_OK) return;
+
+	// sleep most of the wait and spin the rest, so that the senders do not depend on how fast they are woken up
+	for (;;) {
+		const long long remaining(sendTime - Poco::Timestamp());
+		if (remaining <= 0) break;
+		if (remaining - mSpinMicros >= 1000) Poco::Thread::sleep(static_cast<long>((remaining - mSpinMicros) / 1000));
+	}
+	err = mCamera.sendTrigger(sentTime, ackTime, captureId);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Health
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraManager::getCameraHealth(int index, CameraHealth& health)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	if (index < 0 || index >= static_cast<int>(mCameras.size())) return;
+	const Entry& entry(*mCameras[index]);
+	health.index = index;
+	health.host = entry.host;
+	health.port = entry.port;
+	health.consecutiveFailures = entry.consecutiveFailures;
+	health.isHealthy = entry.consecutiveFailures < mSettings.unhealthyFailures;
+	health.isLiveViewStreaming = entry.pCamera->isThreadRunning();
+	health.lastError = entry.lastError;
+	health.lastEventMicros = entry.lastEventTime.elapsed();
+	health.pendingCommands = entry.jobs.size() + (entry.isBusy ? 1 : 0);
+	health.liveViewFps = entry.liveViewFps;
+	health.decodedFrames = entry.decodedFrames;
+	health.droppedFrames = entry.droppedFrames;
+}
+
+void ofxSonyRemoteCameraManager::getHealth(Health& health)
+{
+	health = Health();
+	std::vector<Entry*> entries;
+	getEntries(entries);
+	for (int i(0); i<static_cast<int>(entries.size()); ++i) {
+		CameraHealth cameraHealth;
+		getCameraHealth(i, cameraHealth);
+		++health.cameras;
+		if (cameraHealth.isHealthy) ++health.healthy;
+		if (cameraHealth.isLiveViewStreaming) ++health.streaming;
+		health.pendingCommands += cameraHealth.pendingCommands;
+		health.liveViewFps += cameraHealth.liveViewFps;
+		health.decodedFrames += cameraHealth.decodedFrames;
+		health.droppedFrames += cameraHealth.droppedFrames;
+
+		std::map<std::string, ofxSonyRemoteCamera::MethodStats> stats;
+		entries[i]->pCamera->getMethodStats(stats);
+		for (std::map<std::string, ofxSonyRemoteCamera::MethodStats>::iterator it=stats.begin(); it!=stats.end(); ++it) {
+			ofxSonyRemoteCamera::MethodStats& total(health.methodStats[it->first]);
+			total.calls += it->second.calls;
+			total.errors += it->second.errors;
+			total.timeouts += it->second.timeouts;
+			total.retries += it->second.retries;
+			total.totalRoundTripMicros += it->second.totalRoundTripMicros;
+			total.totalRetryMicros += it->second.totalRetryMicros;
+		}
+	}
+	mReactor.getStats(health.reactorStats);
+	const bool isReactor(mReactor.isRunning());
+	ofMutex::ScopedLock lock(mMutex);
+	// the reactor reads on one thread and decodes on another
+	health.threads = mWorkers.size() + (isReactor ? 2 : health.streaming);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Liveview decoding
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraManager::decode(ofxSonyRemoteCamera& camera, const ofBuffer& jpeg, int timestamp, int frameId)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	std::map<const ofxSonyRemoteCamera*, int>::iterator it(mCameraIndices.find(&camera));
+	if (it == mCameraIndices.end()) return;
+	// only the latest frame of each camera is decoded
+	Entry& entry(*mCameras[it->second]);
+	if (entry.hasFrame) ++entry.droppedFrames;
+	entry.frame.jpeg = jpeg;
+	entry.frame.timestamp = timestamp;
+	entry.frame.frameId = frameId;
+	entry.hasFrame = true;
+	mDecodeCondition.signal();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// private functions
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraManager::runIo()
+{
+	Job job;
+	bool isEvent(false);
+	Entry* pEntry(0);
+	for (int index(nextIoTask(job, isEvent, pEntry)); index>=0; index=nextIoTask(job, isEvent, pEntry)) {
+		ofxSonyRemoteCamera& camera(*pEntry->pCamera);
+		if (isEvent) {
+			finishEvent(index, camera.refreshCameraState());
+			continue;
+		}
+		if (job.scriptId >= 0) {
+			resumeScript(camera, index, job.scriptId);
+			continue;
+		}
+		Command* pCommand(0);
+		{
+			ofMutex::ScopedLock lock(mMutex);
+			pCommand = mBroadcasts[job.broadcastId]->pCommand;
+		}
+		SRCError err(ofxSonyRemoteCamera::SRC_ERROR_UNKNOWN);
+		try {
+			err = pCommand->execute(camera);
+		} catch (Poco::Exception& e) {
+			ofLogError("broadcast: " + e.displayText());
+		}
+		finishJob(index, job, err);
+	}
+}
+
+void ofxSonyRemoteCameraManager::runDecode()
+{
+	Frame frame;
+	Entry* pEntry(0);
+	while (nextDecodeTask(frame, pEntry) >= 0) {
+		ofPixels pixels;
+		const bool isDecoded(ofLoadImage(pixels, frame.jpeg));
+		if (isDecoded) pEntry->pCamera->setLiveViewFrame(pixels, frame.timestamp, frame.frameId);
+
+		ofMutex::ScopedLock lock(mMutex);
+		Entry& entry(*pEntry);
+		entry.isDecoding = false;
+		if (isDecoded) ++entry.decodedFrames;
+		if (entry.hasFrame) mDecodeCondition.signal();
+	}
+}
+
+int ofxSonyRemoteCameraManager::nextIoTask(Job& job, bool& isEvent, Entry*& pEntry)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	const Poco::Timestamp::TimeDiff eventInterval(static_cast<Poco::Timestamp::TimeDiff>(mSettings.eventIntervalMillis) * 1000);
+	while (mIsRunning) {
+		// commands first, round robin so that one camera does not hold the threads
+		const size_t count(mCameras.size());
+		for (size_t i(0); i<count; ++i) {
+			const size_t index((mNextIoCamera + i) % count);
+			Entry& entry(*mCameras[index]);
+			if (entry.isBusy || entry.jobs.empty()) continue;
+			job = entry.jobs.front();
+			entry.jobs.pop_front();
+			entry.isBusy = true;
+			isEvent = false;
+			mNextIoCamera = index + 1;
+			pEntry = &entry;
+			return index;
+		}
+		// then the scripts which are due
+		long waitMillis(-1);
+		const Poco::Timestamp now;
+		for (std::map<int, ScriptRun*>::iterator it=mScripts.begin(); it!=mScripts.end(); ++it) {
+			ScriptRun& run(*it->second);
+			Entry& entry(*mCameras[run.cameraIndex]);
+			if (entry.isBusy) continue;
+			if (run.resumeTime <= now || run.token.isCancelled()) {
+				job = Job();
+				job.scriptId = it->first;
+				entry.isBusy = true;
+				isEvent = false;
+				pEntry = &entry;
+				return run.cameraIndex;
+			}
+			const long millis(static_cast<long>((run.resumeTime - now) / 1000) + 1);
+			if (waitMillis < 0 || millis < waitMillis) waitMillis = millis;
+		}
+		// getEvent of the camera which is most overdue
+		if (eventInterval > 0) {
+			int dueIndex(-1);
+			for (size_t i(0); i<count; ++i) {
+				Entry& entry(*mCameras[i]);
+				if (entry.isBusy) continue;
+				if (entry.nextEventTime <= now) {
+					if (dueIndex < 0 || entry.nextEventTime < mCameras[dueIndex]->nextEventTime) dueIndex = i;
+				} else {
+					const long millis(static_cast<long>((entry.nextEventTime - now) / 1000) + 1);
+					if (waitMillis < 0 || millis < waitMillis) waitMillis = millis;
+				}
+			}
+			if (dueIndex >= 0) {
+				Entry& entry(*mCameras[dueIndex]);
+				entry.isBusy = true;
+				entry.nextEventTime = now + eventInterval;
+				isEvent = true;
+				pEntry = &entry;
+				return dueIndex;
+			}
+		}
+		if (waitMillis < 0) {
+			mIoCondition.wait(mMutex);
+		} else {
+			mIoCondition.tryWait(mMutex, waitMillis);
+		}
+	}
+	return -1;
+}
+
+void ofxSonyRemoteCameraManager::finishJob(int index, const Job& job, SRCError err)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	Entry& entry(*mCameras[index]);
+	entry.isBusy = false;
+	countResult(entry, err);
+
+	Broadcast& broadcast(*mBroadcasts[job.broadcastId]);
+	broadcast.result.errors[job.slot] = err;
+	broadcast.result.elapsedMicros[job.slot] = broadcast.startTime.elapsed();
+	if (--broadcast.remaining == 0) {
+		broadcast.result.totalMicros = broadcast.startTime.elapsed();
+		broadcast.result.isFinished = true;
+		delete broadcast.pCommand;
+		broadcast.pCommand = 0;
+		mFinishedBroadcasts.push_back(broadcast.result);
+		mBroadcastCondition.broadcast();
+	}
+	// the next command of this camera can run
+	mIoCondition.signal();
+}
+
+void ofxSonyRemoteCameraManager::resumeScript(ofxSonyRemoteCamera& camera, int index, int id)
+{
+	ScriptRun* pRun(0);
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		pRun = mScripts[id];
+	}
+	// the run is only removed by this thread while the camera is busy
+	ofxSonyRemoteCameraScript& script(*pRun->pScript);
+	ofxSonyRemoteCameraScript::Context& context(script.getContext());
+	if (pRun->step >= script.getStepCount()) {
+		finishScriptStep(index, id, ofxSonyRemoteCamera::SRC_OK, true);
+		return;
+	}
+	ofxSonyRemoteCameraScript::Step& step(script.getStep(pRun->step));
+	if (pRun->token.isCancelled()) {
+		if (context.stepResumes > 0) step.cancel(camera);
+		finishScriptStep(index, id, ofxSonyRemoteCamera::SRC_ERROR_CANCELLED, true);
+		return;
+	}
+
+	context.isYielding = false;
+	context.resumeMillis = 0;
+	SRCError err(ofxSonyRemoteCamera::SRC_ERROR_UNKNOWN);
+	try {
+		err = step.resume(camera, context);
+	} catch (Poco::Exception& e) {
+		ofLogError("script: " + e.displayText());
+	}
+	++pRun->resumes;
+	if (err != ofxSonyRemoteCamera::SRC_OK) {
+		finishScriptStep(index, id, err, true);
+	} else if (context.isYielding) {
+		++context.stepResumes;
+		finishScriptStep(index, id, err, false);
+	} else {
+		++pRun->step;
+		context.stepResumes = 0;
+		finishScriptStep(index, id, err, pRun->step >= script.getStepCount());
+	}
+}
+
+void ofxSonyRemoteCameraManager::finishScriptStep(int index, int id, SRCError err, bool isFinished)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	Entry& entry(*mCameras[index]);
+	entry.isBusy = false;
+	ScriptRun* pRun(mScripts[id]);
+	if (isFinished) {
+		ScriptResult result;
+		result.id = id;
+		result.cameraIndex = index;
+		result.err = err;
+		result.failedStep = (err == ofxSonyRemoteCamera::SRC_OK) ? -1 : pRun->step;
+		result.resumes = pRun->resumes;
+		result.elapsedMicros = pRun->startTime.elapsed();
+		result.captureIds = pRun->pScript->getContext().captureIds;
+		mFinishedScripts.push_back(result);
+		delete pRun->pScript;
+		delete pRun;
+		mScripts.erase(id);
+	} else {
+		pRun->resumeTime = Poco::Timestamp() + static_cast<Poco::Timestamp::TimeDiff>(pRun->pScript->getContext().resumeMillis) * 1000;
+	}
+	// the next command or script of this camera can run
+	mIoCondition.signal();
+}
+
+void ofxSonyRemoteCameraManager::finishEvent(int index, SRCError err)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	Entry& entry(*mCameras[index]);
+	entry.isBusy = false;
+	countResult(entry, err);
+	if (err == ofxSonyRemoteCamera::SRC_OK) entry.lastEventTime.update();
+	if (!entry.jobs.empty()) mIoCondition.signal();
+}
+
+int ofxSonyRemoteCameraManager::nextDecodeTask(Frame& frame, Entry*& pEntry)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	while (mIsRunning) {
+		const size_t count(mCameras.size());
+		for (size_t i(0); i<count; ++i) {
+			const size_t index((mNextDecodeCamera + i) % count);
+			Entry& entry(*mCameras[index]);
+			// frames of one camera are decoded in order
+			if (entry.isDecoding || !entry.hasFrame) continue;
+			std::swap(frame, entry.frame);
+			entry.hasFrame = false;
+			entry.isDecoding = true;
+			mNextDecodeCamera = index + 1;
+			pEntry = &entry;
+			return index;
+		}
+		mDecodeCondition.wait(mMutex);
+	}
+	return -1;
+}
+
+void ofxSonyRemoteCameraManager::getEntries(std::vector<Entry*>& entries)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	entries = mCameras;
+}
+
+void ofxSonyRemoteCameraManager::countResult(Entry& entry, SRCError err)
+{
+	entry.lastError = err;
+	entry.consecutiveFailures = (err == ofxSonyRemoteCamera::SRC_OK) ? 0 : entry.consecutiveFailures + 1;
+}
+
+void ofxSonyRemoteCameraManager::stopWorkers()
+{
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		mIsRunning = false;
+		mIoCondition.broadcast();
+		mDecodeCondition.broadcast();
+	}
+	for (std::vector<Worker*>::iterator it=mWorkers.begin(); it!=mWorkers.end(); ++it) {
+		(*it)->thread.join();
+		delete *it;
+	}
+	mWorkers.clear();
+}
@@ -0,0 +1,360 @@
+//
+//  ofxSonyRemoteCameraManager.h
+//
+//  Owns many cameras and runs their commands, getEvent polling and liveview decoding on shared thread pools,
+//  instead of one event polling thread and one decoding liveview thread per camera.
+//  The liveview connections keep one reading thread per streaming camera, or share one reactor thread with Settings::isReactor.
+//
+#pragma once
+
+#include "ofxSonyRemoteCamera.h"
+#include "ofxSonyRemoteCameraReactor.h"
+#include "ofxSonyRemoteCameraScript.h"
+
+#include <deque>
+
+class ofxSonyRemoteCameraManager : public ofxSonyRemoteCamera::LiveViewDecoder
+{
+public:
+	typedef ofxSonyRemoteCamera::SRCError SRCError;
+
+	/*!
+		Command run on each camera of a broadcast, on an I/O thread.
+		Commands of one camera are run one at a time in the order they were broadcast.
+	*/
+	class Command
+	{
+	public:
+		virtual ~Command() {}
+		virtual SRCError execute(ofxSonyRemoteCamera& camera) = 0;
+	};
+	class TakePictureCommand : public Command
+	{
+	public:
+		virtual SRCError execute(ofxSonyRemoteCamera& camera) { return camera.actTakePicture(); }
+	};
+	class RecModeCommand : public Command
+	{
+	public:
+		RecModeCommand(bool isStart): mIsStart(isStart) {}
+		virtual SRCError execute(ofxSonyRemoteCamera& camera) { return mIsStart ? camera.startRecMode() : camera.stopRecMode(); }
+	private:
+		bool mIsStart;
+	};
+	class LiveViewCommand : public Command
+	{
+	public:
+		LiveViewCommand(bool isStart): mIsStart(isStart) {}
+		virtual SRCError execute(ofxSonyRemoteCamera& camera) { return mIsStart ? camera.startLiveView() : camera.stopLiveView(); }
+	private:
+		bool mIsStart;
+	};
+	class MovieRecCommand : public Command
+	{
+	public:
+		MovieRecCommand(bool isStart): mIsStart(isStart) {}
+		virtual SRCError execute(ofxSonyRemoteCamera& camera) { return mIsStart ? camera.startMovieRec() : camera.stopMovieRec(); }
+	private:
+		bool mIsStart;
+	};
+	class ShootModeCommand : public Command
+	{
+	public:
+		ShootModeCommand(ofxSonyRemoteCamera::ShootMode mode): mMode(mode) {}
+		virtual SRCError execute(ofxSonyRemoteCamera& camera) { return camera.setShootMode(mMode); }
+	private:
+		ofxSonyRemoteCamera::ShootMode mMode;
+	};
+	class ZoomCommand : public Command
+	{
+	public:
+		ZoomCommand(const std::string& direction, const std::string& movement): mDirection(direction), mMovement(movement) {}
+		virtual SRCError execute(ofxSonyRemoteCamera& camera) { return camera.actZoom(mDirection, mMovement); }
+	private:
+		std::string mDirection;
+		std::string mMovement;
+	};
+
+	struct Settings
+	{
+		Settings(): ioThreads(4), decodeThreads(2), eventIntervalMillis(1000), unhealthyFailures(3), isReactor(false) {}
+		int ioThreads;			//!< commands and getEvent of all cameras
+		int decodeThreads;		//!< liveview JPEG decoding of all cameras
+		unsigned long long eventIntervalMillis;	//!< getEvent polling=false of each camera, 0 disables it
+		int unhealthyFailures;	//!< consecutive failures until a camera is reported unhealthy
+		bool isReactor;			//!< reads the liveview streams of all cameras on one thread, see ofxSonyRemoteCameraReactor
+	};
+	struct BroadcastResult
+	{
+		BroadcastResult(): id(-1), totalMicros(0), isFinished(false) {}
+		int id;
+		std::vector<int> cameraIndices;
+		std::vector<SRCError> errors;	//!< of each camera in cameraIndices
+		std::vector<unsigned long long> elapsedMicros;	//!< since the broadcast, when each camera finished
+		unsigned long long totalMicros;
+		bool isFinished;
+	};
+	struct CameraHealth
+	{
+		CameraHealth(): index(-1), port(0), isHealthy(false), isLiveViewStreaming(false), consecutiveFailures(0), lastError(ofxSonyRemoteCamera::SRC_OK),
+			lastEventMicros(0), pendingCommands(0), liveViewFps(0), decodedFrames(0), droppedFrames(0) {}
+		int index;
+		std::string host;
+		int port;
+		bool isHealthy;				//!< fewer consecutive failures than Settings::unhealthyFailures
+		bool isLiveViewStreaming;
+		int consecutiveFailures;	//!< of commands and getEvent
+		SRCError lastError;
+		unsigned long long lastEventMicros;	//!< since the last successful getEvent
+		int pendingCommands;
+		float liveViewFps;			//!< decoded frames
+		unsigned int decodedFrames;
+		unsigned int droppedFrames;	//!< replaced by a newer frame before decoding
+	};
+	struct Health
+	{
+		Health(): cameras(0), healthy(0), streaming(0), pendingCommands(0), liveViewFps(0), decodedFrames(0), droppedFrames(0), threads(0) {}
+		int cameras;
+		int healthy;
+		int streaming;
+		int pendingCommands;
+		float liveViewFps;			//!< sum of all cameras
+		unsigned int decodedFrames;
+		unsigned int droppedFrames;
+		int threads;				//!< owned by the manager and the liveview connections
+		std::map<std::string, ofxSonyRemoteCamera::MethodStats> methodStats;	//!< sum of all cameras
+		ofxSonyRemoteCameraReactor::Stats reactorStats;	//!< with Settings::isReactor
+	};
+	struct ScriptResult
+	{
+		ScriptResult(): id(-1), cameraIndex(-1), err(ofxSonyRemoteCamera::SRC_OK), failedStep(-1), resumes(0), elapsedMicros(0) {}
+		int id;
+		int cameraIndex;
+		SRCError err;				//!< SRC_ERROR_CANCELLED after cancelScript()
+		int failedStep;				//!< -1 if all steps succeeded
+		int resumes;				//!< of all steps
+		unsigned long long elapsedMicros;
+		std::vector<int> captureIds;
+	};
+	struct TriggerOptions
+	{
+		TriggerOptions(): releaseDelayMicros(2000), spinMicros(1000), isLatencyCompensated(false) {}
+		long long releaseDelayMicros;	//!< from the moment all cameras are prepared until the release
+		long long spinMicros;			//!< busy wait instead of sleeping before the release
+		bool isLatencyCompensated;		//!< send over faster connections later by half of the round trip difference, so that the requests arrive together
+	};
+	struct TriggerResult
+	{
+		TriggerResult(): prepareMicros(0), sendSpreadMicros(0), ackSpreadMicros(0) {}
+		std::vector<int> cameraIndices;
+		std::vector<SRCError> errors;	//!< of each camera in cameraIndices
+		std::vector<int> captureIds;	//!< with TRIGGER_TAKE_PICTURE
+		std::vector<long long> roundTripMicros;	//!< of the connection, measured while preparing
+		std::vector<long long> sendSkewMicros;	//!< from the release until the request was written
+		std::vector<long long> ackSkewMicros;	//!< from the release until the camera responded
+		unsigned long long prepareMicros;	//!< until all cameras were prepared
+		long long sendSpreadMicros;		//!< largest minus smallest send skew of the cameras without error
+		long long ackSpreadMicros;		//!< largest minus smallest ack skew of the cameras without error
+	};
+
+	ofxSonyRemoteCameraManager();
+	~ofxSonyRemoteCameraManager();
+
+	void setup(const Settings& settings=Settings());
+	void exit();
+	/*!
+		notifies broadcastFinished and the events of the cameras.
+	*/
+	void update();
+
+	/*!
+		Cameras may be added while the manager runs, setup() of the camera does not wait for the network.
+		@return index of the camera, which is set up with host and port
+	*/
+	int addCamera(const std::string& host, int port=10000);
+	//! for cameras found by ofxSonyRemoteCameraDiscovery
+	int addCamera(const ofxSonyRemoteCamera::Endpoints& endpoints);
+	int getCameraCount();
+	/*!
+		Do not call the apis of a camera from other threads while its commands are running.
+	*/
+	ofxSonyRemoteCamera& getCamera(int index);
+
+	/*!
+		Runs command on all cameras, the command is deleted when all cameras finished.
+		@return id of the broadcast, see broadcastFinished
+	*/
+	int broadcast(Command* pCommand);
+	//! runs command on the cameras in cameraIndices
+	int broadcast(Command* pCommand, const std::vector<int>& cameraIndices);
+	/*!
+		@return false if the broadcast is unknown or timeoutMillis passed
+	*/
+	bool waitForBroadcast(int id, long timeoutMillis, BroadcastResult& result);
+
+	ofEvent<BroadcastResult> broadcastFinished;
+
+	/*!
+		Runs the steps of pScript on the I/O threads, one step of a camera at a time between its commands.
+		A yielding step holds no thread until it is resumed, so many scripts can wait at once.
+		Only ofxSonyRemoteCameraScript::ZoomStep keeps the zoom thread of its camera busy while it yields.
+		The script is deleted when it finished, scriptFinished is notified from update().
+		@return id of the script, -1 if cameraIndex is invalid
+	*/
+	int runScript(int cameraIndex, ofxSonyRemoteCameraScript* pScript);
+	//! aborts the running call of the script, the script finishes with SRC_ERROR_CANCELLED
+	void cancelScript(int id);
+	int getRunningScriptCount();
+
+	ofEvent<ScriptResult> scriptFinished;
+
+	/*!
+		Sends the same call to all cameras at once, for multi-angle capture.
+		Every camera gets its own sender thread and a warmed connection with the request built in advance,
+		then all requests are released at the same moment and the skew of each camera is measured.
+		Blocks until every camera responded, the commands of broadcast() may run meanwhile on other connections.
+		@return false if a camera failed, see TriggerResult::errors
+	*/
+	bool trigger(ofxSonyRemoteCamera::TriggerMethod method, TriggerResult& result, const TriggerOptions& options=TriggerOptions());
+	//! triggers the cameras in cameraIndices
+	bool trigger(ofxSonyRemoteCamera::TriggerMethod method, const std::vector<int>& cameraIndices, TriggerResult& result, const TriggerOptions& options=TriggerOptions());
+
+	void getCameraHealth(int index, CameraHealth& health);
+	void getHealth(Health& health);
+
+	// LiveViewDecoder
+	virtual void decode(ofxSonyRemoteCamera& camera, const ofBuffer& jpeg, int timestamp, int frameId);
+
+private:
+	struct Broadcast
+	{
+		Broadcast(): pCommand(0), remaining(0) {}
+		Command* pCommand;
+		BroadcastResult result;
+		Poco::Timestamp startTime;
+		int remaining;
+	};
+	struct Job
+	{
+		Job(): broadcastId(-1), slot(0), scriptId(-1) {}
+		int broadcastId;
+		int slot;			//!< index in BroadcastResult
+		int scriptId;		//!< resumes a script instead of a broadcast if not -1
+	};
+	struct ScriptRun
+	{
+		ScriptRun(): pScript(0), cameraIndex(-1), step(0), resumes(0) {}
+		ofxSonyRemoteCameraScript* pScript;
+		int cameraIndex;
+		int step;
+		int resumes;
+		Poco::Timestamp startTime;
+		Poco::Timestamp resumeTime;
+		ofxSonyRemoteCamera::CancellationToken token;
+	};
+	struct Frame
+	{
+		Frame(): timestamp(0), frameId(-1) {}
+		ofBuffer jpeg;
+		int timestamp;
+		int frameId;
+	};
+	struct Entry
+	{
+		Entry(): port(0), pCamera(0), isBusy(false), isDecoding(false), hasFrame(false), consecutiveFailures(0),
+			lastError(ofxSonyRemoteCamera::SRC_OK), decodedFrames(0), droppedFrames(0), fpsFrames(0), liveViewFps(0) {}
+		std::string host;
+		int port;
+		ofxSonyRemoteCamera* pCamera;
+		std::deque<Job> jobs;
+		bool isBusy;			//!< an I/O thread is running a job of the camera
+		Poco::Timestamp nextEventTime;
+		Poco::Timestamp lastEventTime;
+		Frame frame;			//!< latest frame waiting for decoding
+		bool isDecoding;
+		bool hasFrame;
+		int consecutiveFailures;
+		SRCError lastError;
+		unsigned int decodedFrames;
+		unsigned int droppedFrames;
+		unsigned int fpsFrames;	//!< decoded frames at fpsTime
+		Poco::Timestamp fpsTime;
+		float liveViewFps;
+	};
+	struct TriggerRelease
+	{
+		TriggerRelease(): prepared(0), isReleased(false) {}
+		ofMutex mutex;
+		Poco::Condition condition;
+		int prepared;			//!< senders waiting for the release
+		bool isReleased;
+		Poco::Timestamp time;
+	};
+	class TriggerSender : public Poco::Runnable
+	{
+	public:
+		TriggerSender(TriggerRelease& release, ofxSonyRemoteCamera& camera, ofxSonyRemoteCamera::TriggerMethod method, long long spinMicros)
+			: err(ofxSonyRemoteCamera::SRC_ERROR_UNKNOWN), roundTripMicros(-1), offsetMicros(0), captureId(-1)
+			, mRelease(release), mCamera(camera), mMethod(method), mSpinMicros(spinMicros) {}
+		virtual void run();
+		Poco::Thread thread;
+		SRCError err;
+		long long roundTripMicros;
+		long long offsetMicros;		//!< after the release time, set before the release
+		int captureId;
+		Poco::Timestamp sentTime;
+		Poco::Timestamp ackTime;
+	private:
+		TriggerRelease& mRelease;
+		ofxSonyRemoteCamera& mCamera;
+		ofxSonyRemoteCamera::TriggerMethod mMethod;
+		long long mSpinMicros;
+	};
+	class Worker : public Poco::Runnable
+	{
+	public:
+		typedef void (ofxSonyRemoteCameraManager::*Function)();
+		Worker(ofxSonyRemoteCameraManager& manager, Function function): mManager(manager), mFunction(function) {}
+		virtual void run() { (mManager.*mFunction)(); }
+		Poco::Thread thread;
+	private:
+		ofxSonyRemoteCameraManager& mManager;
+		Function mFunction;
+	};
+
+	void runIo();
+	void runDecode();
+	/*!
+		The entries are resolved under the lock, mCameras may grow meanwhile. entries are never removed before exit().
+		@return index of the camera, -1 if stopped
+	*/
+	int nextIoTask(Job& job, bool& isEvent, Entry*& pEntry);
+	void finishJob(int index, const Job& job, SRCError err);
+	void finishEvent(int index, SRCError err);
+	void resumeScript(ofxSonyRemoteCamera& camera, int index, int id);
+	void finishScriptStep(int index, int id, SRCError err, bool isFinished);
+	int nextDecodeTask(Frame& frame, Entry*& pEntry);
+	//! copies mCameras under the lock
+	void getEntries(std::vector<Entry*>& entries);
+	void countResult(Entry& entry, SRCError err);
+	void stopWorkers();
+
+	Settings mSettings;
+	ofxSonyRemoteCameraReactor mReactor;
+	std::vector<Entry*> mCameras;
+	std::map<const ofxSonyRemoteCamera*, int> mCameraIndices;
+	std::vector<Worker*> mWorkers;
+	std::map<int, Broadcast*> mBroadcasts;
+	std::deque<BroadcastResult> mFinishedBroadcasts;	//!< notified from update()
+	int mNextBroadcastId;
+	std::map<int, ScriptRun*> mScripts;
+	std::deque<ScriptResult> mFinishedScripts;		//!< notified from update()
+	int mNextScriptId;
+	size_t mNextIoCamera;		//!< round robin over the cameras
+	size_t mNextDecodeCamera;
+	bool mIsRunning;
+	ofMutex mMutex;
+	Poco::Condition mIoCondition;
+	Poco::Condition mDecodeCondition;
+	Poco::Condition mBroadcastCondition;
+};
@@ -0,0 +1,308 @@
+//
+//  ofxSonyRemoteCameraMosaic.cpp
+//
+#include "ofxSonyRemoteCameraMosaic.h"
+
+#include "FreeImage.h"
+
+#include <cmath>
+
+static const int STALLED_FRAME_WIDTH(4);	//!< pixels
+static const unsigned char STALLED_COLOR[] = {255, 0, 0};
+
+ofxSonyRemoteCameraMosaic::ofxSonyRemoteCameraMosaic()
+	: mColumns(0)
+	, mRows(0)
+	, mPendingTasks(0)
+	, mIsRunning(false)
+	, mIsFrameNew(false)
+{
+}
+
+ofxSonyRemoteCameraMosaic::~ofxSonyRemoteCameraMosaic()
+{
+	stop();
+	for (std::vector<Tile*>::iterator it=mTiles.begin(); it!=mTiles.end(); ++it) {
+		delete *it;
+	}
+}
+
+int ofxSonyRemoteCameraMosaic::addCamera(ofxSonyRemoteCamera& camera)
+{
+	if (isRunning()) {
+		ofLogError("ofxSonyRemoteCameraMosaic: cameras are added before start()");
+		return -1;
+	}
+	Tile* pTile(new Tile());
+	pTile->pCamera = &camera;
+	mTiles.push_back(pTile);
+	const int index(mTiles.size() - 1);
+	mTileIndices[&camera] = index;
+	return index;
+}
+
+bool ofxSonyRemoteCameraMosaic::start(const Settings& settings/*=Settings()*/)
+{
+	stop();
+	if (mTiles.empty()) return false;
+	mSettings = settings;
+	mSettings.tileWidth = std::max(1, settings.tileWidth);
+	mSettings.tileHeight = std::max(1, settings.tileHeight);
+	mSettings.fps = std::max(0.1f, settings.fps);
+	mSettings.threads = std::max(1, settings.threads);
+	const int count(mTiles.size());
+	mColumns = (settings.columns > 0) ? std::min(settings.columns, count) : static_cast<int>(ceil(sqrt(static_cast<float>(count))));
+	mRows = (count + mColumns - 1) / mColumns;
+
+	mCanvas.allocate(getWidth(), getHeight(), OF_IMAGE_COLOR);
+	mCanvas.set(0);
+	mFrame = mCanvas;
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		for (std::vector<Tile*>::iterator it=mTiles.begin(); it!=mTiles.end(); ++it) {
+			(*it)->jpeg.clear();
+			(*it)->hasJpeg = false;
+			(*it)->lastFrameTime.update();
+			(*it)->state = TileState();
+		}
+		mTasks.clear();
+		mPendingTasks = 0;
+		mStats = Stats();
+		mIsFrameNew = false;
+		mIsRunning = true;
+	}
+	for (std::vector<Tile*>::iterator it=mTiles.begin(); it!=mTiles.end(); ++it) {
+		(*it)->pPreviousDecoder = (*it)->pCamera->getLiveViewDecoder();
+		(*it)->pCamera->setLiveViewDecoder(this);
+	}
+
+	mWorkers.push_back(new Worker(*this, &ofxSonyRemoteCameraMosaic::runTicker));
+	for (int i(0); i<mSettings.threads; ++i) {
+		mWorkers.push_back(new Worker(*this, &ofxSonyRemoteCameraMosaic::runDecode));
+	}
+	for (std::vector<Worker*>::iterator it=mWorkers.begin(); it!=mWorkers.end(); ++it) {
+		(*it)->thread.start(**it);
+	}
+	return true;
+}
+
+void ofxSonyRemoteCameraMosaic::stop()
+{
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		if (!mIsRunning) return;
+		mIsRunning = false;
+		mTaskCondition.broadcast();
+		mDoneCondition.broadcast();
+		mStopCondition.broadcast();
+	}
+	for (std::vector<Worker*>::iterator it=mWorkers.begin(); it!=mWorkers.end(); ++it) {
+		(*it)->thread.join();
+		delete *it;
+	}
+	mWorkers.clear();
+	for (std::vector<Tile*>::iterator it=mTiles.begin(); it!=mTiles.end(); ++it) {
+		(*it)->pCamera->setLiveViewDecoder((*it)->pPreviousDecoder);
+		(*it)->pPreviousDecoder = 0;
+	}
+}
+
+bool ofxSonyRemoteCameraMosaic::isRunning()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return mIsRunning;
+}
+
+ofRectangle ofxSonyRemoteCameraMosaic::getTileRect(int index) const
+{
+	if (mColumns <= 0) return ofRectangle();
+	return ofRectangle((index % mColumns) * mSettings.tileWidth, (index / mColumns) * mSettings.tileHeight, mSettings.tileWidth, mSettings.tileHeight);
+}
+
+bool ofxSonyRemoteCameraMosaic::isFrameNew()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return mIsFrameNew;
+}
+
+void ofxSonyRemoteCameraMosaic::getFrame(ofPixels& pixels)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	pixels = mFrame;
+	mIsFrameNew = false;
+}
+
+void ofxSonyRemoteCameraMosaic::getTileState(int index, TileState& state)
+{
+	if (index < 0 || index >= static_cast<int>(mTiles.size())) return;
+	ofMutex::ScopedLock lock(mMutex);
+	const Tile& tile(*mTiles[index]);
+	state = tile.state;
+	state.lastFrameMicros = tile.lastFrameTime.elapsed();
+}
+
+void ofxSonyRemoteCameraMosaic::getStats(Stats& stats)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	stats = mStats;
+}
+
+void ofxSonyRemoteCameraMosaic::decode(ofxSonyRemoteCamera& camera, const ofBuffer& jpeg, int timestamp, int frameId)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	std::map<const ofxSonyRemoteCamera*, int>::const_iterator it(mTileIndices.find(&camera));
+	if (it == mTileIndices.end()) return;
+	// only the latest frame of a tick is decoded
+	Tile& tile(*mTiles[it->second]);
+	if (tile.hasJpeg) ++tile.state.droppedFrames;
+	tile.jpeg.assign(jpeg.getBinaryBuffer(), jpeg.getBinaryBuffer() + jpeg.size());
+	tile.hasJpeg = true;
+	tile.timestamp = timestamp;
+	tile.lastFrameTime.update();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// private functions
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraMosaic::runTicker()
+{
+	const Poco::Timestamp::TimeDiff interval(static_cast<Poco::Timestamp::TimeDiff>(1000000 / mSettings.fps));
+	const Poco::Timestamp::TimeDiff stallMicros(static_cast<Poco::Timestamp::TimeDiff>(mSettings.stallMillis) * 1000);
+	Poco::Timestamp nextTick;
+	while (waitForTick(nextTick)) {
+		const Poco::Timestamp tickTime;
+		nextTick += interval;
+		const bool isLate(nextTick < tickTime);
+		// ticks which passed are dropped, the mosaic keeps its rate instead of catching up
+		if (isLate) nextTick = tickTime + interval;
+
+		ofMutex::ScopedLock lock(mMutex);
+		for (size_t i(0); i<mTiles.size(); ++i) {
+			Tile& tile(*mTiles[i]);
+			tile.state.isStalled = (tile.lastFrameTime.elapsed() > stallMicros);
+			if (!tile.hasJpeg) continue;
+			mTasks.push_back(i);
+			++mPendingTasks;
+		}
+		mTaskCondition.broadcast();
+		while (mIsRunning && mPendingTasks > 0) {
+			mDoneCondition.wait(mMutex);
+		}
+		if (!mIsRunning) break;
+
+		// the workers are idle until the next tick
+		for (size_t i(0); i<mTiles.size(); ++i) {
+			if (mTiles[i]->state.isStalled) drawStalledFrame(i);
+		}
+		mFrame = mCanvas;
+		mIsFrameNew = true;
+		++mStats.frames;
+		if (isLate) ++mStats.lateTicks;
+		mStats.lastTickMicros = tickTime.elapsed();
+		mStats.maxTickMicros = std::max(mStats.maxTickMicros, mStats.lastTickMicros);
+	}
+}
+
+bool ofxSonyRemoteCameraMosaic::waitForTick(Poco::Timestamp& nextTick)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	while (mIsRunning) {
+		const Poco::Timestamp::TimeDiff remaining(nextTick - Poco::Timestamp());
+		if (remaining <= 0) return true;
+		mStopCondition.tryWait(mMutex, std::max(1L, static_cast<long>(remaining / 1000)));
+	}
+	return false;
+}
+
+void ofxSonyRemoteCameraMosaic::runDecode()
+{
+	std::vector<char> jpeg;
+	for (int index(nextDecodeTask(jpeg)); index>=0; index=nextDecodeTask(jpeg)) {
+		// tiles are disjoint regions of the canvas, they are written without the lock
+		const bool isDecoded(decodeTile(index, jpeg));
+
+		ofMutex::ScopedLock lock(mMutex);
+		TileState& state(mTiles[index]->state);
+		if (isDecoded) {
+			++state.decodedFrames;
+		} else {
+			++state.failedFrames;
+		}
+		--mPendingTasks;
+		if (mPendingTasks == 0) mDoneCondition.signal();
+	}
+}
+
+int ofxSonyRemoteCameraMosaic::nextDecodeTask(std::vector<char>& jpeg)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	while (mIsRunning && mTasks.empty()) {
+		mTaskCondition.wait(mMutex);
+	}
+	if (!mIsRunning) return -1;
+	const int index(mTasks.front());
+	mTasks.pop_front();
+	Tile& tile(*mTiles[index]);
+	jpeg.swap(tile.jpeg);
+	tile.hasJpeg = false;
+	tile.state.timestamp = tile.timestamp;
+	return index;
+}
+
+bool ofxSonyRemoteCameraMosaic::decodeTile(int index, std::vector<char>& jpeg)
+{
+	if (jpeg.empty()) return false;
+	// the size in the upper 16 bits lets libjpeg decode at 1/2, 1/4 or 1/8 scale, not smaller than the tile
+	const int tileWidth(mSettings.tileWidth);
+	const int tileHeight(mSettings.tileHeight);
+	FIMEMORY* pMemory(FreeImage_OpenMemory(reinterpret_cast<BYTE*>(&jpeg[0]), jpeg.size()));
+	FIBITMAP* pBitmap(FreeImage_LoadFromMemory(FIF_JPEG, pMemory, JPEG_FAST | (std::max(tileWidth, tileHeight) << 16)));
+	FreeImage_CloseMemory(pMemory);
+	if (pBitmap == 0) return false;
+	if (FreeImage_GetBPP(pBitmap) != 24) {
+		FIBITMAP* pConverted(FreeImage_ConvertTo24Bits(pBitmap));
+		FreeImage_Unload(pBitmap);
+		pBitmap = pConverted;
+		if (pBitmap == 0) return false;
+	}
+
+	// nearest neighbour into the region of the tile, FreeImage rows are bottom up and BGR
+	const int width(FreeImage_GetWidth(pBitmap));
+	const int height(FreeImage_GetHeight(pBitmap));
+	const ofRectangle rect(getTileRect(index));
+	const int stride(mCanvas.getWidth() * 3);
+	unsigned char* pTile(mCanvas.getPixels() + static_cast<int>(rect.y) * stride + static_cast<int>(rect.x) * 3);
+	for (int y(0); y<tileHeight; ++y) {
+		const BYTE* pSourceRow(FreeImage_GetScanLine(pBitmap, height - 1 - y * height / tileHeight));
+		unsigned char* pDestination(pTile + y * stride);
+		for (int x(0); x<tileWidth; ++x, pDestination+=3) {
+			const BYTE* pSource(pSourceRow + (x * width / tileWidth) * 3);
+			pDestination[0] = pSource[FI_RGBA_RED];
+			pDestination[1] = pSource[FI_RGBA_GREEN];
+			pDestination[2] = pSource[FI_RGBA_BLUE];
+		}
+	}
+	FreeImage_Unload(pBitmap);
+	jpeg.clear();
+	return true;
+}
+
+void ofxSonyRemoteCameraMosaic::drawStalledFrame(int index)
+{
+	const ofRectangle rect(getTileRect(index));
+	const int stride(mCanvas.getWidth() * 3);
+	const int border(std::min(STALLED_FRAME_WIDTH, std::min(mSettings.tileWidth, mSettings.tileHeight) / 2));
+	unsigned char* pTile(mCanvas.getPixels() + static_cast<int>(rect.y) * stride + static_cast<int>(rect.x) * 3);
+	for (int y(0); y<mSettings.tileHeight; ++y) {
+		const bool isEdgeRow(y < border || y >= mSettings.tileHeight - border);
+		unsigned char* pRow(pTile + y * stride);
+		for (int x(0); x<mSettings.tileWidth; ++x) {
+			if (!isEdgeRow && x >= border && x < mSettings.tileWidth - border) {
+				// skip the inside of the tile
+				x = mSettings.tileWidth - border - 1;
+				continue;
+			}
+			std::copy(STALLED_COLOR, STALLED_COLOR + 3, pRow + x * 3);
+		}
+	}
+}
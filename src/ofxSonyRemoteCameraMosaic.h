@@ -0,0 +1,128 @@
+//
+//  ofxSonyRemoteCameraMosaic.h
+//
+//  Composes the liveview of many cameras into one grid image at a fixed rate.
+//  Each JPEG is decoded at a reduced scale by libjpeg (through FreeImage) and sampled straight into its tile,
+//  on a pool of worker threads, so no full size frame is kept per camera.
+//  e.g. mosaic.addCamera(remoteCam); mosaic.start(); ... if (mosaic.isFrameNew()) mosaic.getFrame(pixels);
+//
+#pragma once
+
+#include "ofxSonyRemoteCamera.h"
+
+#include <deque>
+
+class ofxSonyRemoteCameraMosaic : public ofxSonyRemoteCamera::LiveViewDecoder
+{
+public:
+	struct Settings
+	{
+		Settings(): columns(0), tileWidth(320), tileHeight(180), fps(15), threads(2), stallMillis(1000) {}
+		int columns;				//!< 0 makes the grid as square as possible
+		int tileWidth;				//!< frames are stretched to the tile
+		int tileHeight;
+		float fps;					//!< of the mosaic
+		int threads;				//!< decoding the tiles
+		unsigned long long stallMillis;	//!< without a frame until a tile is marked stalled
+	};
+	struct TileState
+	{
+		TileState(): isStalled(true), timestamp(0), decodedFrames(0), droppedFrames(0), failedFrames(0), lastFrameMicros(0) {}
+		bool isStalled;				//!< a red frame is drawn around the tile
+		int timestamp;				//!< of the frame in the tile
+		unsigned int decodedFrames;
+		unsigned int droppedFrames;	//!< replaced by a newer frame before the tick
+		unsigned int failedFrames;
+		unsigned long long lastFrameMicros;	//!< since the last received frame
+	};
+	struct Stats
+	{
+		Stats(): frames(0), lateTicks(0), lastTickMicros(0), maxTickMicros(0) {}
+		unsigned int frames;		//!< mosaic frames composed
+		unsigned int lateTicks;		//!< ticks which started after the next tick was due
+		unsigned long long lastTickMicros;	//!< decoding and composing of the last tick
+		unsigned long long maxTickMicros;
+	};
+
+	ofxSonyRemoteCameraMosaic();
+	~ofxSonyRemoteCameraMosaic();
+
+	/*!
+		Cameras are added before start(), the mosaic becomes their LiveViewDecoder.
+		With ofxSonyRemoteCameraManager, add them after its setup() which sets its own decoder.
+		@return index of the tile
+	*/
+	int addCamera(ofxSonyRemoteCamera& camera);
+	int getTileCount() const { return mTiles.size(); }
+
+	bool start(const Settings& settings=Settings());
+	//! gives the cameras back the decoders they had before start()
+	void stop();
+	bool isRunning();
+
+	int getWidth() const { return mColumns * mSettings.tileWidth; }
+	int getHeight() const { return mRows * mSettings.tileHeight; }
+	//! @return position of the tile in the mosaic
+	ofRectangle getTileRect(int index) const;
+
+	//! @return true if a mosaic was composed since the last getFrame()
+	bool isFrameNew();
+	void getFrame(ofPixels& pixels);
+	void getTileState(int index, TileState& state);
+	void getStats(Stats& stats);
+
+	// LiveViewDecoder
+	virtual void decode(ofxSonyRemoteCamera& camera, const ofBuffer& jpeg, int timestamp, int frameId);
+
+private:
+	struct Tile
+	{
+		Tile(): pCamera(0), pPreviousDecoder(0), hasJpeg(false), timestamp(0) {}
+		ofxSonyRemoteCamera* pCamera;
+		ofxSonyRemoteCamera::LiveViewDecoder* pPreviousDecoder;	//!< restored by stop()
+		std::vector<char> jpeg;		//!< latest frame waiting for the tick
+		bool hasJpeg;
+		int timestamp;
+		Poco::Timestamp lastFrameTime;
+		TileState state;
+	};
+	class Worker : public Poco::Runnable
+	{
+	public:
+		typedef void (ofxSonyRemoteCameraMosaic::*Function)();
+		Worker(ofxSonyRemoteCameraMosaic& mosaic, Function function): mMosaic(mosaic), mFunction(function) {}
+		virtual void run() { (mMosaic.*mFunction)(); }
+		Poco::Thread thread;
+	private:
+		ofxSonyRemoteCameraMosaic& mMosaic;
+		Function mFunction;
+	};
+
+	void runTicker();
+	void runDecode();
+	//! @return false when stopped
+	bool waitForTick(Poco::Timestamp& nextTick);
+	//! @return index of the tile, -1 if stopped
+	int nextDecodeTask(std::vector<char>& jpeg);
+	bool decodeTile(int index, std::vector<char>& jpeg);
+	void drawStalledFrame(int index);
+
+	Settings mSettings;
+	std::vector<Tile*> mTiles;
+	std::map<const ofxSonyRemoteCamera*, int> mTileIndices;
+	std::vector<Worker*> mWorkers;
+	int mColumns;
+	int mRows;
+	ofPixels mCanvas;			//!< tiles are decoded into it during a tick
+	ofPixels mFrame;			//!< copied from mCanvas at the end of a tick
+
+	ofMutex mMutex;
+	Poco::Condition mTaskCondition;
+	Poco::Condition mDoneCondition;
+	Poco::Condition mStopCondition;
+	std::deque<int> mTasks;
+	int mPendingTasks;			//!< of the current tick, queued or decoding
+	bool mIsRunning;
+	bool mIsFrameNew;
+	Stats mStats;
+};
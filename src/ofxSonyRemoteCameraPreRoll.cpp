@@ -0,0 +1,260 @@
+//
+//  ofxSonyRemoteCameraPreRoll.cpp
+//
+#include "ofxSonyRemoteCameraPreRoll.h"
+
+#include <fstream>
+
+ofxSonyRemoteCameraPreRoll::ofxSonyRemoteCameraPreRoll()
+	: mFirstFrame(0)
+	, mFrameCount(0)
+	, mWriteOffset(0)
+	, mBytes(0)
+	, mNextSequence(0)
+	, mDumpSequence(0)
+	, mDumpEndSequence(0)
+	, mDumpRunnable(*this, &ofxSonyRemoteCameraPreRoll::runDump)
+	, mIsDumpThreadStarted(false)
+	, mIsRunning(false)
+	, mIsDumping(false)
+{
+}
+
+ofxSonyRemoteCameraPreRoll::~ofxSonyRemoteCameraPreRoll()
+{
+	stop();
+}
+
+bool ofxSonyRemoteCameraPreRoll::start(const Settings& settings/*=Settings()*/)
+{
+	stop();
+	if (settings.maxBytes == 0) return false;
+	ofMutex::ScopedLock lock(mMutex);
+	mSettings = settings;
+	mMemory.resize(mSettings.maxBytes);
+	mFrames.assign(std::max<size_t>(1, mSettings.maxBytes / std::max<size_t>(1, mSettings.minFrameBytes)), Frame());
+	mFirstFrame = 0;
+	mFrameCount = 0;
+	mWriteOffset = 0;
+	mBytes = 0;
+	mStats = Stats();
+	mIsRunning = true;
+	return true;
+}
+
+void ofxSonyRemoteCameraPreRoll::stop()
+{
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		if (!mIsRunning) return;
+		mIsRunning = false;
+	}
+	// the dump reads mMemory
+	joinDumpThread();
+	ofMutex::ScopedLock lock(mMutex);
+	std::vector<char>().swap(mMemory);
+	mFrameCount = 0;
+	mBytes = 0;
+}
+
+bool ofxSonyRemoteCameraPreRoll::isRunning()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return mIsRunning;
+}
+
+void ofxSonyRemoteCameraPreRoll::update()
+{
+	std::deque<DumpReport> reports;
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		reports.swap(mFinishedDumps);
+	}
+	for (std::deque<DumpReport>::iterator it=reports.begin(); it!=reports.end(); ++it) {
+		ofNotifyEvent(dumpFinished, *it);
+	}
+}
+
+bool ofxSonyRemoteCameraPreRoll::dumpPreRoll(const std::string& directory)
+{
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		if (!mIsRunning || mIsDumping) return false;
+		mIsDumping = true;
+		mDumpSequence = (mFrameCount > 0) ? getFrame(0).sequence : mNextSequence;
+		mDumpEndSequence = mNextSequence;
+		mDumpReport = DumpReport();
+		mDumpReport.directory = ofToDataPath(directory, true);
+		mDumpReport.frames = mFrameCount;
+	}
+	// the previous dump has finished, its thread may not be joined yet
+	joinDumpThread();
+	mDumpThread.start(mDumpRunnable);
+	mIsDumpThreadStarted = true;
+	return true;
+}
+
+void ofxSonyRemoteCameraPreRoll::joinDumpThread()
+{
+	if (!mIsDumpThreadStarted) return;
+	mDumpThread.join();
+	mIsDumpThreadStarted = false;
+}
+
+bool ofxSonyRemoteCameraPreRoll::isDumping()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return mIsDumping;
+}
+
+void ofxSonyRemoteCameraPreRoll::getStats(Stats& stats)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	stats = mStats;
+	stats.frames = mFrameCount;
+	stats.bytes = mBytes;
+	stats.durationMillis = (mFrameCount > 1) ? (getFrame(mFrameCount - 1).receivedTime - getFrame(0).receivedTime) / 1000 : 0;
+}
+
+void ofxSonyRemoteCameraPreRoll::clear()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	// frames held by a dump stay until they are written
+	while (evictOldest()) {}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Ring
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraPreRoll::record(ofxSonyRemoteCamera& camera, const ofxSonyRemoteCamera::CommonHeader& header, const char* jpeg, int size)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	if (!mIsRunning) return;
+	const size_t frameSize(std::max(0, size));
+	if (frameSize == 0 || frameSize > mMemory.size()) {
+		++mStats.droppedFrames;
+		return;
+	}
+	// a frame is never split, the end of the memory is skipped if it does not fit
+	const size_t offset((mWriteOffset + frameSize > mMemory.size()) ? 0 : mWriteOffset);
+	if (mFrameCount == static_cast<int>(mFrames.size()) && !evictOldest()) {
+		++mStats.droppedFrames;
+		return;
+	}
+	while (!isFree(offset, frameSize)) {
+		if (!evictOldest()) {
+			++mStats.droppedFrames;
+			return;
+		}
+	}
+
+	memcpy(&mMemory[offset], jpeg, frameSize);
+	Frame& frame(getFrame(mFrameCount));
+	frame.header = header;
+	frame.offset = offset;
+	frame.size = frameSize;
+	frame.sequence = mNextSequence++;
+	frame.receivedTime.update();
+	++mFrameCount;
+	mBytes += frameSize;
+	mWriteOffset = offset + frameSize;
+	++mStats.recordedFrames;
+
+	if (mSettings.maxMillis > 0) {
+		const Poco::Timestamp::TimeDiff maxMicros(static_cast<Poco::Timestamp::TimeDiff>(mSettings.maxMillis) * 1000);
+		while (mFrameCount > 1 && frame.receivedTime - getFrame(0).receivedTime > maxMicros && evictOldest()) {}
+	}
+}
+
+bool ofxSonyRemoteCameraPreRoll::isFree(size_t offset, size_t size) const
+{
+	if (mFrameCount == 0) return true;
+	// the frames lie from the oldest to mWriteOffset, wrapping at the end of the memory
+	const size_t begin(getFrame(0).offset);
+	const size_t end(mWriteOffset);
+	if (begin < end) return offset >= end || offset + size <= begin;
+	return offset >= end && offset + size <= begin;
+}
+
+bool ofxSonyRemoteCameraPreRoll::evictOldest()
+{
+	if (mFrameCount == 0) return false;
+	const Frame& oldest(getFrame(0));
+	if (mIsDumping && oldest.sequence - mDumpSequence < mDumpEndSequence - mDumpSequence) return false;
+	mBytes -= oldest.size;
+	mFirstFrame = (mFirstFrame + 1) % mFrames.size();
+	--mFrameCount;
+	++mStats.evictedFrames;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Dump
+//////////////////////////////////////////////////////////////////////////
+bool ofxSonyRemoteCameraPreRoll::nextDumpFrame(Frame& frame)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	if (mDumpSequence == mDumpEndSequence || mFrameCount == 0) return false;
+	// the held frames are the oldest ones, the frames before them may still be in the ring
+	frame = getFrame(mDumpSequence - getFrame(0).sequence);
+	return true;
+}
+
+void ofxSonyRemoteCameraPreRoll::runDump()
+{
+	const Poco::Timestamp startTime;
+	DumpReport report;
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		report = mDumpReport;
+	}
+	bool isSucceeded(true);
+	try {
+		Poco::File(report.directory).createDirectories();
+	} catch (Poco::Exception& e) {
+		ofLogError("pre-roll: " + e.displayText());
+		isSucceeded = false;
+	}
+
+	picojson::array index;
+	Frame frame;
+	while (nextDumpFrame(frame)) {
+		if (isSucceeded) {
+			// the frame is not overwritten until it is released below
+			const std::string name(ofToString(frame.header.frameId) + "_" + ofToString(frame.header.timestamp) + ".jpg");
+			std::ofstream file((report.directory + "/" + name).c_str(), std::ios::binary);
+			file.write(&mMemory[frame.offset], frame.size);
+			if (file.good()) {
+				picojson::object entry;
+				entry["file"] = picojson::value(name);
+				entry["frameId"] = picojson::value(static_cast<double>(frame.header.frameId));
+				entry["timestamp"] = picojson::value(static_cast<double>(frame.header.timestamp));
+				entry["payloadType"] = picojson::value(static_cast<double>(frame.header.payLoadType));
+				entry["size"] = picojson::value(static_cast<double>(frame.size));
+				entry["receivedMicros"] = picojson::value(static_cast<double>(frame.receivedTime.epochMicroseconds()));
+				index.push_back(picojson::value(entry));
+				++report.writtenFrames;
+				report.bytes += frame.size;
+			} else {
+				ofLogError("pre-roll: cannot write " + report.directory + "/" + name);
+				isSucceeded = false;
+			}
+		}
+		ofMutex::ScopedLock lock(mMutex);
+		++mDumpSequence;
+	}
+
+	if (isSucceeded) {
+		picojson::object root;
+		root["frames"] = picojson::value(index);
+		std::ofstream file((report.directory + "/index.json").c_str());
+		file << picojson::value(root).serialize();
+		isSucceeded = file.good();
+	}
+	report.isSucceeded = isSucceeded;
+	report.elapsedMicros = startTime.elapsed();
+
+	ofMutex::ScopedLock lock(mMutex);
+	mIsDumping = false;
+	mFinishedDumps.push_back(report);
+}
@@ -0,0 +1,115 @@
+//
+//  ofxSonyRemoteCameraPreRoll.h
+//
+//  Keeps the last seconds of liveview as compressed frames, for an instant replay of what happened before a trigger.
+//  The frames are copied into one block of memory allocated by start(), the oldest frames are dropped to make room,
+//  so recording does not allocate. dumpPreRoll() writes the buffered frames on a background thread straight from
+//  that memory, while new frames keep arriving.
+//  e.g. preRoll.start(); remoteCam.setLiveViewRecorder(&preRoll); ... preRoll.dumpPreRoll("replay");
+//
+#pragma once
+
+#include "ofxSonyRemoteCamera.h"
+
+class ofxSonyRemoteCameraPreRoll : public ofxSonyRemoteCamera::LiveViewRecorder
+{
+public:
+	struct Settings
+	{
+		Settings(): maxBytes(32 * 1024 * 1024), maxMillis(5000), minFrameBytes(4096) {}
+		size_t maxBytes;			//!< memory of the frames, allocated by start()
+		unsigned long long maxMillis;	//!< older frames are dropped, 0 keeps as many as fit in maxBytes
+		size_t minFrameBytes;		//!< expected size of the smallest frame, bounds the frame table to maxBytes / minFrameBytes
+	};
+	struct Stats
+	{
+		Stats(): frames(0), bytes(0), durationMillis(0), recordedFrames(0), evictedFrames(0), droppedFrames(0) {}
+		int frames;					//!< in the ring
+		size_t bytes;
+		unsigned long long durationMillis;	//!< between the oldest and the newest frame
+		unsigned int recordedFrames;
+		unsigned int evictedFrames;	//!< dropped as the oldest
+		unsigned int droppedFrames;	//!< not recorded, too large or the ring is held by a dump
+	};
+	struct DumpReport
+	{
+		DumpReport(): frames(0), writtenFrames(0), bytes(0), elapsedMicros(0), isSucceeded(false) {}
+		std::string directory;
+		int frames;					//!< in the ring when dumpPreRoll() was called
+		int writtenFrames;
+		size_t bytes;
+		unsigned long long elapsedMicros;
+		bool isSucceeded;
+	};
+
+	ofxSonyRemoteCameraPreRoll();
+	~ofxSonyRemoteCameraPreRoll();
+
+	bool start(const Settings& settings=Settings());
+	//! waits for a running dump
+	void stop();
+	bool isRunning();
+	//! notifies dumpFinished
+	void update();
+
+	/*!
+		Writes the frames in the ring as <directory>/<frameId>_<timestamp>.jpg, with index.json of their headers.
+		The frames are held until they are written, new frames which do not fit meanwhile are dropped.
+		@params directory relative to the data folder
+		@return false if a dump is running
+	*/
+	bool dumpPreRoll(const std::string& directory);
+	bool isDumping();
+	void getStats(Stats& stats);
+	void clear();
+
+	ofEvent<DumpReport> dumpFinished;
+
+	// LiveViewRecorder
+	virtual void record(ofxSonyRemoteCamera& camera, const ofxSonyRemoteCamera::CommonHeader& header, const char* jpeg, int size);
+
+private:
+	struct Frame
+	{
+		Frame(): offset(0), size(0), sequence(0) {}
+		ofxSonyRemoteCamera::CommonHeader header;
+		size_t offset;				//!< in mMemory
+		size_t size;
+		unsigned int sequence;		//!< of recording
+		Poco::Timestamp receivedTime;
+	};
+
+	//! @return true if [offset, offset + size) does not overlap a frame
+	bool isFree(size_t offset, size_t size) const;
+	//! @return false if the oldest frame is held by the dump
+	bool evictOldest();
+	Frame& getFrame(int age) { return mFrames[(mFirstFrame + age) % mFrames.size()]; }
+	const Frame& getFrame(int age) const { return mFrames[(mFirstFrame + age) % mFrames.size()]; }
+
+	void joinDumpThread();
+	// thread
+	void runDump();
+	//! @return false when the dump is done
+	bool nextDumpFrame(Frame& frame);
+
+	Settings mSettings;
+	std::vector<char> mMemory;
+	std::vector<Frame> mFrames;	//!< ring of the frame table
+	int mFirstFrame;			//!< oldest
+	int mFrameCount;
+	size_t mWriteOffset;		//!< behind the newest frame
+	size_t mBytes;
+	unsigned int mNextSequence;
+	unsigned int mDumpSequence;	//!< frames from here to mDumpEndSequence are held by the dump
+	unsigned int mDumpEndSequence;
+
+	Poco::Thread mDumpThread;
+	Poco::RunnableAdapter<ofxSonyRemoteCameraPreRoll> mDumpRunnable;
+	bool mIsDumpThreadStarted;	//!< only used by the caller of dumpPreRoll() and stop()
+	ofMutex mMutex;
+	bool mIsRunning;
+	bool mIsDumping;
+	DumpReport mDumpReport;
+	std::deque<DumpReport> mFinishedDumps;	//!< notified from update()
+	Stats mStats;
+};
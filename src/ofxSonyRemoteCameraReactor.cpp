@@ -0,0 +1,712 @@
+//
+//  ofxSonyRemoteCameraReactor.cpp
+//
+#include "ofxSonyRemoteCameraReactor.h"
+
+#include "Poco/String.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+static const int READ_BUFFER_SIZE(64*1024);
+static const size_t COMPACT_BODY_SIZE(64*1024);	//!< consumed liveview data which is dropped from the front of the body at once
+static const int COMMON_HEADER_SIZE(1+1+2+4);
+static const int PAYLOAD_HEADER_SIZE(4+3+1+4+1+115);
+static const BYTE COMMON_HEADER_START_BYTE(0xff);
+static const BYTE PAYLOAD_HEADER_START_BYTES[] = {0x24, 0x35, 0x68, 0x79};
+static const size_t MAX_LINE_SIZE(8*1024);
+static const Poco::Timestamp::TimeDiff MAX_WAIT(1000*1000);			//!< us of select without any deadline
+static const Poco::Timestamp::TimeDiff CONNECT_TIMEOUT(5000*1000);		//!< us
+static const Poco::Timestamp::TimeDiff LIVE_VIEW_TIMEOUT(5000*1000);	//!< us without liveview data
+static const Poco::Timestamp::TimeDiff EVENT_TIMEOUT(70000*1000);		//!< us, long enough for getEvent with polling=true
+static const Poco::Timestamp::TimeDiff RETRY_INTERVAL(1000*1000);		//!< us until reconnecting or polling again after an error
+
+ofxSonyRemoteCameraReactor::ofxSonyRemoteCameraReactor()
+	: mRunnable(*this, &ofxSonyRemoteCameraReactor::run)
+	, mNextSequence(0)
+	, mDoneSequence(0)
+	, mIsRunning(false)
+	, mDecodeRunnable(*this, &ofxSonyRemoteCameraReactor::runDecode)
+	, mpDecodingCamera(0)
+	, mIsDecodeRunning(false)
+{
+}
+
+ofxSonyRemoteCameraReactor::~ofxSonyRemoteCameraReactor()
+{
+	stop();
+}
+
+bool ofxSonyRemoteCameraReactor::start()
+{
+	if (isRunning()) return true;
+	try {
+		// select wakes up on a datagram to itself when an operation is posted
+		mWakeUpReceiver = Poco::Net::DatagramSocket();
+		mWakeUpReceiver.bind(Poco::Net::SocketAddress("127.0.0.1", 0));
+		mWakeUpSender = Poco::Net::DatagramSocket();
+		mWakeUpSender.connect(mWakeUpReceiver.address());
+	} catch (Poco::Exception& e) {
+		ofLogError("reactor: " + e.displayText());
+		return false;
+	}
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		mIsRunning = true;
+		mThreadStats = Stats();
+		mStats = Stats();
+	}
+	mThread.start(mRunnable);
+	{
+		ofMutex::ScopedLock decodeLock(mDecodeMutex);
+		mIsDecodeRunning = true;
+	}
+	mDecodeThread.start(mDecodeRunnable);
+	return true;
+}
+
+void ofxSonyRemoteCameraReactor::stop()
+{
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		if (!mIsRunning) return;
+		mIsRunning = false;
+	}
+	wakeUp();
+	mThread.join();
+	mWakeUpReceiver.close();
+	mWakeUpSender.close();
+	{
+		ofMutex::ScopedLock decodeLock(mDecodeMutex);
+		mIsDecodeRunning = false;
+		mFrames.clear();
+		mDecodeCondition.broadcast();
+	}
+	mDecodeThread.join();
+
+	// nobody waits for the operations which were not run
+	ofMutex::ScopedLock lock(mMutex);
+	mOperations.clear();
+	mDoneSequence = mNextSequence;
+	mOperationCondition.broadcast();
+}
+
+bool ofxSonyRemoteCameraReactor::isRunning()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return mIsRunning;
+}
+
+bool ofxSonyRemoteCameraReactor::openLiveView(ofxSonyRemoteCamera& camera, const std::string& url)
+{
+	Operation operation;
+	operation.type = OPERATION_OPEN_LIVE_VIEW;
+	operation.pCamera = &camera;
+	operation.url = url;
+	return post(operation, false);
+}
+
+void ofxSonyRemoteCameraReactor::closeLiveView(ofxSonyRemoteCamera& camera)
+{
+	Operation operation;
+	operation.type = OPERATION_CLOSE_LIVE_VIEW;
+	operation.pCamera = &camera;
+	post(operation, true);
+
+	// the camera may be deleted after this, its frame must not be decoded any more
+	ofMutex::ScopedLock decodeLock(mDecodeMutex);
+	mFrames.erase(&camera);
+	while (mpDecodingCamera == &camera) {
+		mDecodeCondition.wait(mDecodeMutex);
+	}
+}
+
+bool ofxSonyRemoteCameraReactor::openEventPolling(ofxSonyRemoteCamera& camera)
+{
+	Operation operation;
+	operation.type = OPERATION_OPEN_EVENT;
+	operation.pCamera = &camera;
+	// copied here, the reactor thread does not read the settings of the camera
+	operation.url = "http://" + camera.mHost + ":" + ofToString(camera.mPort) + camera.mSessionCameraPath;
+	return post(operation, false);
+}
+
+void ofxSonyRemoteCameraReactor::closeEventPolling(ofxSonyRemoteCamera& camera)
+{
+	Operation operation;
+	operation.type = OPERATION_CLOSE_EVENT;
+	operation.pCamera = &camera;
+	post(operation, true);
+}
+
+void ofxSonyRemoteCameraReactor::getStats(Stats& stats)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	stats = mStats;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Liveview decoding
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraReactor::decode(ofxSonyRemoteCamera& camera, const ofBuffer& jpeg, int timestamp, int frameId)
+{
+	ofMutex::ScopedLock decodeLock(mDecodeMutex);
+	if (!mIsDecodeRunning) return;
+	// a frame which is still waiting is replaced
+	Frame& frame(mFrames[&camera]);
+	frame.jpeg = jpeg;
+	frame.timestamp = timestamp;
+	frame.frameId = frameId;
+	mDecodeCondition.broadcast();
+}
+
+void ofxSonyRemoteCameraReactor::runDecode()
+{
+	Frame frame;
+	ofxSonyRemoteCamera* pCamera(0);
+	while (nextDecodeTask(frame, pCamera)) {
+		ofPixels pixels;
+		if (ofLoadImage(pixels, frame.jpeg)) pCamera->setLiveViewFrame(pixels, frame.timestamp, frame.frameId);
+
+		ofMutex::ScopedLock decodeLock(mDecodeMutex);
+		mpDecodingCamera = 0;
+		mDecodeCondition.broadcast();
+	}
+}
+
+bool ofxSonyRemoteCameraReactor::nextDecodeTask(Frame& frame, ofxSonyRemoteCamera*& pCamera)
+{
+	ofMutex::ScopedLock decodeLock(mDecodeMutex);
+	while (mIsDecodeRunning) {
+		if (!mFrames.empty()) {
+			// round robin from the last camera, so that a fast camera does not hold the thread
+			std::map<ofxSonyRemoteCamera*, Frame>::iterator it(mFrames.upper_bound(pCamera));
+			if (it == mFrames.end()) it = mFrames.begin();
+			pCamera = it->first;
+			std::swap(frame, it->second);
+			mFrames.erase(it);
+			mpDecodingCamera = pCamera;
+			return true;
+		}
+		mDecodeCondition.wait(mDecodeMutex);
+	}
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Operations
+//////////////////////////////////////////////////////////////////////////
+bool ofxSonyRemoteCameraReactor::post(const Operation& operation, bool isWaiting)
+{
+	unsigned int sequence(0);
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		if (!mIsRunning) return false;
+		mOperations.push_back(operation);
+		sequence = ++mNextSequence;
+		mOperations.back().sequence = sequence;
+	}
+	wakeUp();
+	if (!isWaiting) return true;
+
+	ofMutex::ScopedLock lock(mMutex);
+	while (mDoneSequence < sequence) {
+		mOperationCondition.wait(mMutex);
+	}
+	return true;
+}
+
+void ofxSonyRemoteCameraReactor::runOperations()
+{
+	std::deque<Operation> operations;
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		operations.swap(mOperations);
+	}
+	if (operations.empty()) return;
+	for (std::deque<Operation>::iterator it=operations.begin(); it!=operations.end(); ++it) {
+		runOperation(*it);
+	}
+	ofMutex::ScopedLock lock(mMutex);
+	mDoneSequence = operations.back().sequence;
+	mOperationCondition.broadcast();
+}
+
+void ofxSonyRemoteCameraReactor::runOperation(const Operation& operation)
+{
+	const ConnectionType type((operation.type == OPERATION_OPEN_LIVE_VIEW || operation.type == OPERATION_CLOSE_LIVE_VIEW) ? CONNECTION_LIVE_VIEW : CONNECTION_EVENT);
+	removeConnection(operation.pCamera, type);
+	if (operation.type == OPERATION_CLOSE_LIVE_VIEW || operation.type == OPERATION_CLOSE_EVENT) return;
+
+	const Poco::URI uri(operation.url);
+	Connection* pConnection(new Connection());
+	pConnection->type = type;
+	pConnection->pCamera = operation.pCamera;
+	pConnection->host = uri.getHost();
+	pConnection->port = uri.getPort();
+	pConnection->path = uri.getPathAndQuery();
+	mConnections.push_back(pConnection);
+	connect(*pConnection);
+}
+
+void ofxSonyRemoteCameraReactor::removeConnection(ofxSonyRemoteCamera* pCamera, ConnectionType type)
+{
+	for (std::vector<Connection*>::iterator it=mConnections.begin(); it!=mConnections.end(); ++it) {
+		if ((*it)->pCamera != pCamera || (*it)->type != type) continue;
+		disconnect(**it, false);
+		delete *it;
+		mConnections.erase(it);
+		return;
+	}
+}
+
+void ofxSonyRemoteCameraReactor::wakeUp()
+{
+	const char byte(0);
+	try {
+		mWakeUpSender.sendBytes(&byte, 1);
+	} catch (Poco::Exception& e) {
+		ofLogError("reactor wake up: " + e.displayText());
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Thread
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraReactor::run()
+{
+	std::vector<char> buffer(READ_BUFFER_SIZE);
+	for (;;) {
+		runOperations();
+		{
+			ofMutex::ScopedLock lock(mMutex);
+			if (!mIsRunning) break;
+		}
+
+		// connect, send the next getEvent and time out before waiting
+		Poco::Net::Socket::SocketList readList(1, mWakeUpReceiver);
+		Poco::Net::Socket::SocketList writeList;
+		Poco::Net::Socket::SocketList exceptList;
+		std::map<Poco::Net::Socket, Connection*> connections;
+		const Poco::Timestamp now;
+		Poco::Timestamp wakeUpTime(now + MAX_WAIT);
+		for (std::vector<Connection*>::iterator it=mConnections.begin(); it!=mConnections.end(); ++it) {
+			Connection& connection(**it);
+			expire(connection, now);
+			const bool isIdle(!connection.isOpen || (connection.type == CONNECTION_EVENT && !connection.isRequestPending));
+			wakeUpTime = std::min(wakeUpTime, isIdle ? connection.retryTime : connection.deadline);
+			if (!connection.isOpen) continue;
+			connections[connection.socket] = &connection;
+			if (connection.isConnected) {
+				readList.push_back(connection.socket);
+			} else {
+				exceptList.push_back(connection.socket);
+			}
+			if (!connection.isConnected || connection.outputOffset < connection.output.size()) {
+				writeList.push_back(connection.socket);
+			}
+		}
+
+		const Poco::Timespan timeout(std::max(static_cast<Poco::Timestamp::TimeDiff>(0), wakeUpTime - now));
+		try {
+			Poco::Net::Socket::select(readList, writeList, exceptList, timeout);
+		} catch (Poco::Exception& e) {
+			ofLogError("reactor select: " + e.displayText());
+			Poco::Thread::sleep(10);
+			continue;
+		}
+
+		const Poco::Timestamp loopTime;
+		for (Poco::Net::Socket::SocketList::iterator it=exceptList.begin(); it!=exceptList.end(); ++it) {
+			std::map<Poco::Net::Socket, Connection*>::iterator connectionIt(connections.find(*it));
+			if (connectionIt == connections.end()) continue;
+			disconnect(*connectionIt->second, true);
+		}
+		for (Poco::Net::Socket::SocketList::iterator it=writeList.begin(); it!=writeList.end(); ++it) {
+			std::map<Poco::Net::Socket, Connection*>::iterator connectionIt(connections.find(*it));
+			if (connectionIt == connections.end()) continue;
+			Connection& connection(*connectionIt->second);
+			// closed by an earlier handler of this loop
+			if (!connection.isOpen || !(connection.socket == *it)) continue;
+			if (!connection.isConnected) {
+				connection.isConnected = true;
+				connection.deadline = loopTime + (connection.type == CONNECTION_EVENT ? EVENT_TIMEOUT : LIVE_VIEW_TIMEOUT);
+			}
+			flush(connection);
+		}
+		for (Poco::Net::Socket::SocketList::iterator it=readList.begin(); it!=readList.end(); ++it) {
+			if (*it == mWakeUpReceiver) {
+				char byte;
+				try {
+					mWakeUpReceiver.receiveBytes(&byte, 1);
+				} catch (Poco::Exception&) {
+				}
+				continue;
+			}
+			std::map<Poco::Net::Socket, Connection*>::iterator connectionIt(connections.find(*it));
+			if (connectionIt == connections.end()) continue;
+			Connection& connection(*connectionIt->second);
+			if (!connection.isOpen || !(connection.socket == *it)) continue;
+			receive(connection, &buffer[0], buffer.size());
+		}
+
+		const unsigned long long loopMicros(loopTime.elapsed());
+		++mThreadStats.loops;
+		mThreadStats.maxLoopMicros = std::max(mThreadStats.maxLoopMicros, loopMicros);
+		mThreadStats.connections = connections.size();
+		ofMutex::ScopedLock lock(mMutex);
+		mStats = mThreadStats;
+	}
+
+	for (std::vector<Connection*>::iterator it=mConnections.begin(); it!=mConnections.end(); ++it) {
+		disconnect(**it, false);
+		delete *it;
+	}
+	mConnections.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Connections
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraReactor::connect(Connection& connection)
+{
+	connection.socket = Poco::Net::StreamSocket();
+	connection.isConnected = false;
+	connection.isRequestPending = false;
+	connection.output.clear();
+	connection.outputOffset = 0;
+	connection.http.reset();
+	connection.body.clear();
+	connection.bodyOffset = 0;
+	connection.liveViewState = LIVE_VIEW_COMMON_HEADER;
+	try {
+		connection.socket.connectNB(Poco::Net::SocketAddress(connection.host, connection.port));
+	} catch (Poco::Exception& e) {
+		ofLogError("reactor connect: " + e.displayText());
+		disconnect(connection, true);
+		return;
+	}
+	connection.isOpen = true;
+	if (connection.type == CONNECTION_LIVE_VIEW) {
+		connection.output = "GET " + connection.path + " HTTP/1.1\r\nHost: " + connection.host + ":" + ofToString(connection.port) + "\r\n\r\n";
+		connection.isRequestPending = true;
+	} else {
+		sendEventRequest(connection);
+	}
+	connection.deadline = Poco::Timestamp() + CONNECT_TIMEOUT;
+}
+
+void ofxSonyRemoteCameraReactor::disconnect(Connection& connection, bool isRetry)
+{
+	if (connection.isOpen) {
+		try {
+			connection.socket.close();
+		} catch (Poco::Exception&) {
+		}
+	}
+	connection.socket = Poco::Net::StreamSocket();
+	connection.isOpen = false;
+	connection.isConnected = false;
+	connection.isRequestPending = false;
+	if (!isRetry) return;
+	connection.retryTime = Poco::Timestamp() + RETRY_INTERVAL;
+	connection.isPolling = false;
+	++mThreadStats.reconnects;
+}
+
+void ofxSonyRemoteCameraReactor::sendEventRequest(Connection& connection)
+{
+	const ofxSonyRemoteCamera& camera(*connection.pCamera);
+	connection.writer.begin(ofxSonyRemoteCamera::method::getEvent::name());
+	connection.writer.param(connection.isPolling);
+	connection.writer.end(camera.mId, ofxSonyRemoteCamera::VERSION);
+
+	connection.output = "POST " + connection.path + " HTTP/1.1\r\nHost: " + connection.host + ":" + ofToString(connection.port)
+		+ "\r\nContent-Type: application/json\r\nContent-Length: " + ofToString(connection.writer.size()) + "\r\nConnection: Keep-Alive\r\n\r\n";
+	connection.output.append(connection.writer.data(), connection.writer.size());
+	connection.outputOffset = 0;
+	connection.isRequestPending = true;
+	connection.http.reset();
+	connection.body.clear();
+	if (connection.isConnected) {
+		connection.deadline = Poco::Timestamp() + EVENT_TIMEOUT;
+		flush(connection);
+	}
+}
+
+void ofxSonyRemoteCameraReactor::flush(Connection& connection)
+{
+	try {
+		// requests are small enough for the send buffer of the socket
+		while (connection.outputOffset < connection.output.size()) {
+			const int sent(connection.socket.sendBytes(connection.output.data() + connection.outputOffset, connection.output.size() - connection.outputOffset));
+			if (sent <= 0) break;
+			connection.outputOffset += sent;
+		}
+	} catch (Poco::Exception& e) {
+		ofLogError("reactor send: " + e.displayText());
+		disconnect(connection, true);
+	}
+}
+
+void ofxSonyRemoteCameraReactor::receive(Connection& connection, char* buffer, int size)
+{
+	int received(0);
+	try {
+		received = connection.socket.receiveBytes(buffer, size);
+	} catch (Poco::Exception& e) {
+		ofLogError("reactor receive: " + e.displayText());
+		disconnect(connection, true);
+		return;
+	}
+	if (received <= 0) {
+		// closed by the camera, a response without length ends here
+		if (connection.type == CONNECTION_EVENT && connection.http.close()) {
+			readEvent(connection);
+		}
+		disconnect(connection, connection.type == CONNECTION_LIVE_VIEW || connection.isRequestPending);
+		return;
+	}
+	mThreadStats.bytesReceived += received;
+	if (!connection.http.feed(buffer, received, connection.body)) {
+		ofLogError("reactor: malformed HTTP response from " + connection.host);
+		disconnect(connection, true);
+		return;
+	}
+	if (connection.type == CONNECTION_EVENT) {
+		if (connection.http.isDone()) readEvent(connection);
+		return;
+	}
+	if (connection.http.getStatus() != 0 && connection.http.getStatus() != 200) {
+		ofLogError("reactor: liveview responded " + ofToString(connection.http.getStatus()));
+		disconnect(connection, true);
+		return;
+	}
+	connection.deadline = Poco::Timestamp() + LIVE_VIEW_TIMEOUT;
+	readLiveView(connection);
+	if (connection.http.isDone()) {
+		// the stream does not end while the liveview runs
+		disconnect(connection, true);
+	}
+}
+
+void ofxSonyRemoteCameraReactor::expire(Connection& connection, const Poco::Timestamp& now)
+{
+	if (!connection.isOpen) {
+		if (now >= connection.retryTime) connect(connection);
+	} else if (connection.type == CONNECTION_EVENT && !connection.isRequestPending) {
+		if (now >= connection.retryTime) sendEventRequest(connection);
+	} else if (now >= connection.deadline) {
+		if (connection.type == CONNECTION_LIVE_VIEW || !connection.isConnected) {
+			ofLogError("reactor: timeout of " + connection.host + ":" + ofToString(connection.port));
+		}
+		// a long poll without changes also ends here when the camera does not answer it
+		disconnect(connection, true);
+	}
+}
+
+bool ofxSonyRemoteCameraReactor::readLiveView(Connection& connection)
+{
+	ofxSonyRemoteCamera& camera(*connection.pCamera);
+	size_t offset(connection.bodyOffset);
+	bool isFrame(false);
+	for (;;) {
+		const size_t available(connection.body.size() - offset);
+		if (available == 0) break;
+		BYTE* pBytes(reinterpret_cast<BYTE*>(&connection.body[0]) + offset);
+		if (connection.liveViewState == LIVE_VIEW_COMMON_HEADER) {
+			if (available < static_cast<size_t>(COMMON_HEADER_SIZE)) break;
+			if (pBytes[0] != COMMON_HEADER_START_BYTE) {
+				// find the next frame
+				++offset;
+				continue;
+			}
+			connection.commonHeader.payLoadType = camera.bytesToInt(pBytes, 1, 1);
+			connection.commonHeader.frameId = camera.bytesToInt(pBytes, 2, 2);
+			connection.commonHeader.timestamp = camera.bytesToInt(pBytes, 4, 4);
+			offset += COMMON_HEADER_SIZE;
+			connection.liveViewState = LIVE_VIEW_PAYLOAD_HEADER;
+		} else if (connection.liveViewState == LIVE_VIEW_PAYLOAD_HEADER) {
+			if (available < static_cast<size_t>(PAYLOAD_HEADER_SIZE)) break;
+			if (!std::equal(PAYLOAD_HEADER_START_BYTES, PAYLOAD_HEADER_START_BYTES + 4, pBytes)) {
+				connection.liveViewState = LIVE_VIEW_COMMON_HEADER;
+				continue;
+			}
+			camera.readPayloadHeader(pBytes, connection.payloadHeader);
+			offset += PAYLOAD_HEADER_SIZE;
+			connection.liveViewState = LIVE_VIEW_JPEG;
+		} else if (connection.liveViewState == LIVE_VIEW_JPEG) {
+			const size_t jpegSize(connection.payloadHeader.jpegSize);
+			if (available < jpegSize) break;
+			if (connection.commonHeader.payLoadType == ofxSonyRemoteCamera::PAYLOAD_TYPE_IMAGE) {
+				const ofBuffer jpeg(reinterpret_cast<char*>(pBytes), jpegSize);
+				camera.receiveLiveViewFrame(connection.commonHeader, connection.payloadHeader, jpeg, this);
+				++mThreadStats.liveViewFrames;
+				isFrame = true;
+			} else if (connection.commonHeader.payLoadType == ofxSonyRemoteCamera::PAYLOAD_TYPE_FRAME_INFORMATION) {
+				// parsed in place from the receive buffer
+				camera.receiveFrameInformation(connection.commonHeader, connection.payloadHeader, reinterpret_cast<char*>(pBytes), jpegSize);
+			}
+			offset += jpegSize;
+			connection.liveViewState = LIVE_VIEW_PADDING;
+		} else {
+			const size_t paddingSize(connection.payloadHeader.paddingSize);
+			if (available < paddingSize) break;
+			offset += paddingSize;
+			connection.liveViewState = LIVE_VIEW_COMMON_HEADER;
+		}
+	}
+	// the consumed data is not moved on every receive, only when it is most of the body
+	if (offset == connection.body.size()) {
+		connection.body.clear();
+		offset = 0;
+	} else if (offset >= COMPACT_BODY_SIZE && offset * 2 >= connection.body.size()) {
+		connection.body.erase(connection.body.begin(), connection.body.begin() + offset);
+		offset = 0;
+	}
+	connection.bodyOffset = offset;
+	return isFrame;
+}
+
+void ofxSonyRemoteCameraReactor::readEvent(Connection& connection)
+{
+	ofxSonyRemoteCamera& camera(*connection.pCamera);
+	connection.isRequestPending = false;
+	++mThreadStats.events;
+
+	ofxSonyRemoteCamera::SRCError err(ofxSonyRemoteCamera::SRC_OK);
+	ofxSonyRemoteCamera::Response response(&connection.arena);
+	if (connection.http.getStatus() != 200) {
+		err = ofxSonyRemoteCamera::SRC_ERROR_ILLEGAL_RESPONSE;
+	} else if (connection.body.empty() || !response.parse(&connection.body[0], &connection.body[0] + connection.body.size())) {
+		ofLogError("JSON parse error: " + response.getParseError());
+		err = ofxSonyRemoteCamera::SRC_ERROR_ILLEGAL_RESPONSE;
+	} else if (response.getErrorCode() != 0) {
+		err = camera.cvtError(response.getErrorCode());
+	} else {
+		err = camera.applyEvent(response, connection.arena);
+	}
+	connection.body.clear();
+
+	const Poco::Timestamp now;
+	if (err == ofxSonyRemoteCamera::SRC_OK) {
+		connection.isPolling = true;
+		connection.retryTime = now;
+	} else if (err == ofxSonyRemoteCamera::SRC_ERROR_TIMEOUT) {
+		// only means nothing changed
+		connection.retryTime = now;
+	} else {
+		connection.isPolling = false;
+		connection.retryTime = now + RETRY_INTERVAL;
+	}
+	// the next request is sent from expire(), on a new connection if this one is closed
+	if (!connection.http.isKeepAlive()) disconnect(connection, false);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// HttpParser
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraReactor::HttpParser::reset()
+{
+	mState = STATUS_LINE;
+	mLine.clear();
+	mStatus = 0;
+	mRemaining = -1;
+	mIsChunked = false;
+	mIsKeepAlive = false;
+}
+
+bool ofxSonyRemoteCameraReactor::HttpParser::feed(const char* data, size_t size, std::vector<char>& body)
+{
+	const char* p(data);
+	const char* end(data + size);
+	while (p < end && mState != DONE && mState != PARSE_ERROR) {
+		if (mState == BODY || mState == CHUNK_DATA) {
+			const size_t count(static_cast<size_t>(std::min(mRemaining, static_cast<long long>(end - p))));
+			body.insert(body.end(), p, p + count);
+			p += count;
+			mRemaining -= count;
+			if (mRemaining == 0) mState = (mState == BODY) ? DONE : CHUNK_END;
+		} else if (mState == BODY_UNTIL_CLOSE) {
+			body.insert(body.end(), p, end);
+			p = end;
+		} else {
+			// the other states read lines
+			const char c(*p++);
+			if (c == '\r') continue;
+			if (c != '\n') {
+				if (mLine.size() >= MAX_LINE_SIZE) mState = PARSE_ERROR;
+				mLine += c;
+				continue;
+			}
+			if (!parseLine()) mState = PARSE_ERROR;
+			mLine.clear();
+		}
+	}
+	return mState != PARSE_ERROR;
+}
+
+bool ofxSonyRemoteCameraReactor::HttpParser::close()
+{
+	if (mState != BODY_UNTIL_CLOSE) return false;
+	mState = DONE;
+	return true;
+}
+
+bool ofxSonyRemoteCameraReactor::HttpParser::parseLine()
+{
+	switch (mState) {
+	case STATUS_LINE:
+	{
+		// HTTP/1.1 200 OK
+		if (mLine.compare(0, 5, "HTTP/") != 0) return false;
+		const size_t space(mLine.find(' '));
+		if (space == std::string::npos) return false;
+		mStatus = std::atoi(mLine.c_str() + space + 1);
+		mIsKeepAlive = (mLine.compare(0, space, "HTTP/1.1") == 0);
+		mState = HEADER;
+		return true;
+	}
+	case HEADER:
+	{
+		if (mLine.empty()) {
+			if (mIsChunked) {
+				mState = CHUNK_SIZE;
+			} else if (mRemaining >= 0) {
+				mState = (mRemaining > 0) ? BODY : DONE;
+			} else {
+				mState = BODY_UNTIL_CLOSE;
+				mIsKeepAlive = false;
+			}
+			return true;
+		}
+		const size_t colon(mLine.find(':'));
+		if (colon == std::string::npos) return false;
+		const std::string name(Poco::toLower(Poco::trim(mLine.substr(0, colon))));
+		const std::string value(Poco::trim(mLine.substr(colon + 1)));
+		if (name == "content-length") {
+			mRemaining = std::atol(value.c_str());
+		} else if (name == "transfer-encoding") {
+			mIsChunked = (Poco::icompare(value, "chunked") == 0);
+		} else if (name == "connection") {
+			mIsKeepAlive = (Poco::icompare(value, "close") != 0);
+		}
+		return true;
+	}
+	case CHUNK_SIZE:
+		// extensions after ';' are ignored
+		mRemaining = std::strtol(mLine.c_str(), 0, 16);
+		if (mRemaining < 0) return false;
+		mState = (mRemaining > 0) ? CHUNK_DATA : TRAILER;
+		return true;
+	case CHUNK_END:
+		if (!mLine.empty()) return false;
+		mState = CHUNK_SIZE;
+		return true;
+	case TRAILER:
+		if (mLine.empty()) mState = DONE;
+		return true;
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,210 @@
+//
+//  ofxSonyRemoteCameraReactor.h
+//
+//  Reads the liveview streams and the getEvent long polls of many cameras on one thread.
+//  The sockets are non-blocking and multiplexed with Poco::Net::Socket::select, which uses epoll or poll depending on the Poco build.
+//  Commands are still sent with blocking calls on the threads of the caller.
+//  Frames of cameras without a LiveViewDecoder are decoded on a second thread, so that decoding does not delay the reads.
+//  e.g. reactor.start(); remoteCam.setReactor(&reactor); remoteCam.startLiveView();
+//
+#pragma once
+
+#include "ofxSonyRemoteCamera.h"
+
+#include "Poco/Net/StreamSocket.h"
+#include "Poco/Net/DatagramSocket.h"
+
+#include <deque>
+#include <map>
+
+class ofxSonyRemoteCameraReactor : public ofxSonyRemoteCamera::LiveViewDecoder
+{
+public:
+	struct Stats
+	{
+		Stats(): connections(0), liveViewFrames(0), events(0), bytesReceived(0), reconnects(0), loops(0), maxLoopMicros(0) {}
+		int connections;				//!< open sockets, without the wake up socket
+		unsigned int liveViewFrames;
+		unsigned int events;			//!< getEvent responses
+		unsigned long long bytesReceived;
+		unsigned int reconnects;
+		unsigned int loops;				//!< select calls
+		unsigned long long maxLoopMicros;	//!< handling of one select, without waiting
+	};
+
+	ofxSonyRemoteCameraReactor();
+	~ofxSonyRemoteCameraReactor();
+
+	bool start();
+	void stop();
+	bool isRunning();
+
+	/*!
+		Streams url of startLiveview into the camera, the connection is retried until closeLiveView().
+		Without a LiveViewDecoder the frames are decoded on the decoding thread of the reactor,
+		frames which arrive while the previous one of the camera waits are dropped.
+		@return false if the reactor is not running
+	*/
+	bool openLiveView(ofxSonyRemoteCamera& camera, const std::string& url);
+	//! returns when the connection is closed
+	void closeLiveView(ofxSonyRemoteCamera& camera);
+	//! @return false if the reactor is not running
+	bool openEventPolling(ofxSonyRemoteCamera& camera);
+	//! returns when the connection is closed
+	void closeEventPolling(ofxSonyRemoteCamera& camera);
+
+	void getStats(Stats& stats);
+
+	// LiveViewDecoder
+	virtual void decode(ofxSonyRemoteCamera& camera, const ofBuffer& jpeg, int timestamp, int frameId);
+
+	// thread
+	void run();
+	void runDecode();
+
+private:
+	/*!
+		Incremental HTTP/1.1 response parser, the body is decoded from chunked or Content-Length transfer.
+	*/
+	class HttpParser
+	{
+	public:
+		HttpParser() { reset(); }
+		void reset();
+		/*!
+			appends the body in data to body.
+			@return false if the response is malformed
+		*/
+		bool feed(const char* data, size_t size, std::vector<char>& body);
+		//! @return true if the response ends with the connection
+		bool close();
+		bool isDone() const { return mState == DONE; }
+		int getStatus() const { return mStatus; }
+		bool isKeepAlive() const { return mIsKeepAlive; }
+	private:
+		enum State
+		{
+			STATUS_LINE,
+			HEADER,
+			BODY,
+			CHUNK_SIZE,
+			CHUNK_DATA,
+			CHUNK_END,
+			TRAILER,
+			BODY_UNTIL_CLOSE,
+			DONE,
+			PARSE_ERROR
+		};
+		bool parseLine();
+		State mState;
+		std::string mLine;
+		int mStatus;
+		long long mRemaining;		//!< of the body or the chunk, -1 if unknown
+		bool mIsChunked;
+		bool mIsKeepAlive;
+	};
+	enum ConnectionType
+	{
+		CONNECTION_LIVE_VIEW,
+		CONNECTION_EVENT
+	};
+	enum LiveViewState
+	{
+		LIVE_VIEW_COMMON_HEADER,
+		LIVE_VIEW_PAYLOAD_HEADER,
+		LIVE_VIEW_JPEG,
+		LIVE_VIEW_PADDING
+	};
+	struct Connection
+	{
+		Connection(): type(CONNECTION_LIVE_VIEW), pCamera(0), port(0), isOpen(false), isConnected(false), isRequestPending(false), outputOffset(0),
+			bodyOffset(0), liveViewState(LIVE_VIEW_COMMON_HEADER), isPolling(false) {}
+		ConnectionType type;
+		ofxSonyRemoteCamera* pCamera;
+		std::string host;
+		int port;
+		std::string path;
+		Poco::Net::StreamSocket socket;
+		bool isOpen;
+		bool isConnected;			//!< connectNB finished
+		bool isRequestPending;		//!< sent or sending, waiting for the response
+		std::string output;
+		size_t outputOffset;
+		HttpParser http;
+		std::vector<char> body;		//!< decoded and not consumed yet
+		size_t bodyOffset;			//!< of the liveview data in body, the consumed data before it is dropped in large steps
+		Poco::Timestamp deadline;	//!< of connecting, the response or the next liveview data
+		Poco::Timestamp retryTime;	//!< next connection or getEvent
+		// liveview
+		LiveViewState liveViewState;
+		ofxSonyRemoteCamera::CommonHeader commonHeader;
+		ofxSonyRemoteCamera::PayloadHeader payloadHeader;
+		// getEvent
+		bool isPolling;
+		ofxSonyRemoteCamera::RequestWriter writer;
+		ofxSonyRemoteCamera::JsonArena arena;
+	};
+	enum OperationType
+	{
+		OPERATION_OPEN_LIVE_VIEW,
+		OPERATION_CLOSE_LIVE_VIEW,
+		OPERATION_OPEN_EVENT,
+		OPERATION_CLOSE_EVENT
+	};
+	struct Operation
+	{
+		Operation(): type(OPERATION_OPEN_LIVE_VIEW), pCamera(0), sequence(0) {}
+		OperationType type;
+		ofxSonyRemoteCamera* pCamera;
+		std::string url;
+		unsigned int sequence;
+	};
+	struct Frame
+	{
+		Frame(): timestamp(0), frameId(-1) {}
+		ofBuffer jpeg;
+		int timestamp;
+		int frameId;
+	};
+
+	//! @return false if the reactor is not running
+	bool post(const Operation& operation, bool isWaiting);
+	void runOperations();
+	void runOperation(const Operation& operation);
+	void removeConnection(ofxSonyRemoteCamera* pCamera, ConnectionType type);
+	void wakeUp();
+
+	void connect(Connection& connection);
+	void disconnect(Connection& connection, bool isRetry);
+	void sendEventRequest(Connection& connection);
+	void flush(Connection& connection);
+	void receive(Connection& connection, char* buffer, int size);
+	void expire(Connection& connection, const Poco::Timestamp& now);
+	bool readLiveView(Connection& connection);
+	void readEvent(Connection& connection);
+	//! @return false if stopped
+	bool nextDecodeTask(Frame& frame, ofxSonyRemoteCamera*& pCamera);
+
+	Poco::Thread mThread;
+	Poco::RunnableAdapter<ofxSonyRemoteCameraReactor> mRunnable;
+	Poco::Net::DatagramSocket mWakeUpReceiver;
+	Poco::Net::DatagramSocket mWakeUpSender;
+	std::vector<Connection*> mConnections;		//!< only used by the reactor thread while it runs
+	Stats mThreadStats;							//!< only used by the reactor thread
+
+	ofMutex mMutex;
+	Poco::Condition mOperationCondition;
+	std::deque<Operation> mOperations;
+	unsigned int mNextSequence;
+	unsigned int mDoneSequence;
+	bool mIsRunning;
+	Stats mStats;
+
+	Poco::Thread mDecodeThread;
+	Poco::RunnableAdapter<ofxSonyRemoteCameraReactor> mDecodeRunnable;
+	ofMutex mDecodeMutex;
+	Poco::Condition mDecodeCondition;
+	std::map<ofxSonyRemoteCamera*, Frame> mFrames;	//!< latest frame of each camera waiting for decoding
+	ofxSonyRemoteCamera* mpDecodingCamera;
+	bool mIsDecodeRunning;
+};
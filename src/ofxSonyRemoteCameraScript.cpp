@@ -0,0 +1,67 @@
+//
+//  ofxSonyRemoteCameraScript.cpp
+//
+#include "ofxSonyRemoteCameraScript.h"
+
+static const unsigned long long STEP_POLL_INTERVAL(50);	//!< ms
+
+ofxSonyRemoteCameraScript::~ofxSonyRemoteCameraScript()
+{
+	for (std::vector<Step*>::iterator it=mSteps.begin(); it!=mSteps.end(); ++it) {
+		delete *it;
+	}
+}
+
+ofxSonyRemoteCameraScript& ofxSonyRemoteCameraScript::then(Step* pStep)
+{
+	mSteps.push_back(pStep);
+	return *this;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Steps
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCameraScript::SRCError ofxSonyRemoteCameraScript::WaitForStatusStep::resume(ofxSonyRemoteCamera& camera, Context& context)
+{
+	if (context.stepResumes == 0) mStartTime.update();
+	// getEvent without polling, unless the camera polls it already
+	const SRCError err(camera.refreshCameraState(context.getCallOptions()));
+	if (err != ofxSonyRemoteCamera::SRC_OK) return err;
+	ofxSonyRemoteCamera::CameraState state;
+	camera.getCameraState(state);
+	if (state.cameraStatus == mStatus) return ofxSonyRemoteCamera::SRC_OK;
+	if (mStartTime.elapsed() >= static_cast<Poco::Timestamp::TimeDiff>(mTimeoutMillis) * 1000) return ofxSonyRemoteCamera::SRC_ERROR_TIMEOUT;
+	return context.yield(mPollMillis);
+}
+
+ofxSonyRemoteCameraScript::SRCError ofxSonyRemoteCameraScript::ZoomStep::resume(ofxSonyRemoteCamera& camera, Context& context)
+{
+	if (context.stepResumes == 0) {
+		// the zoom moves on its own thread, the step only watches it
+		if (!camera.startZoomTo(mPosition, mOptions)) return ofxSonyRemoteCamera::SRC_ERROR_ILLEGAL_STATE;
+		return context.yield(STEP_POLL_INTERVAL);
+	}
+	if (camera.isZooming()) return context.yield(STEP_POLL_INTERVAL);
+	ofxSonyRemoteCamera::ZoomReport report;
+	camera.getZoomReport(report);
+	return report.err;
+}
+
+ofxSonyRemoteCameraScript::SRCError ofxSonyRemoteCameraScript::TakePictureStep::resume(ofxSonyRemoteCamera& camera, Context& context)
+{
+	if (context.stepResumes == 0) mShots = 0;
+	int captureId(-1);
+	const SRCError err(camera.actTakePicture(captureId, context.getCallOptions()));
+	if (err != ofxSonyRemoteCamera::SRC_OK) return err;
+	context.captureIds.push_back(captureId);
+	if (++mShots < mCount) return context.yield(mIntervalMillis);
+	return ofxSonyRemoteCamera::SRC_OK;
+}
+
+ofxSonyRemoteCameraScript::SRCError ofxSonyRemoteCameraScript::PostViewStep::resume(ofxSonyRemoteCamera& camera, Context& context)
+{
+	if (context.stepResumes == 0) mStartTime.update();
+	if (camera.getPendingPostViewCount() == 0) return ofxSonyRemoteCamera::SRC_OK;
+	if (mStartTime.elapsed() >= static_cast<Poco::Timestamp::TimeDiff>(mTimeoutMillis) * 1000) return ofxSonyRemoteCamera::SRC_ERROR_TIMEOUT;
+	return context.yield(STEP_POLL_INTERVAL);
+}
@@ -0,0 +1,145 @@
+//
+//  ofxSonyRemoteCameraScript.h
+//
+//  Sequence of camera steps run by ofxSonyRemoteCameraManager::runScript() on its I/O threads.
+//  A step runs until it has to wait, then yields and is resumed later, so a waiting script does not hold a thread.
+//  The exception is ZoomStep, which moves the zoom on the zoom thread of the camera and only watches it from the script.
+//  e.g. ofxSonyRemoteCameraScript* pScript(new ofxSonyRemoteCameraScript());
+//      pScript->then(new ofxSonyRemoteCameraScript::WaitForStatusStep("IDLE")).then(new ofxSonyRemoteCameraScript::TakePictureStep(5));
+//      manager.runScript(0, pScript);
+//
+#pragma once
+
+#include "ofxSonyRemoteCamera.h"
+
+class ofxSonyRemoteCameraScript
+{
+public:
+	typedef ofxSonyRemoteCamera::SRCError SRCError;
+
+	/*!
+		State of a running script, shared by its steps.
+	*/
+	struct Context
+	{
+		Context(): pCancellationToken(0), stepResumes(0), isYielding(false), resumeMillis(0) {}
+		/*!
+			Resumes the step after millis without holding a thread meanwhile.
+			@return SRC_OK, to be returned by the step
+		*/
+		SRCError yield(unsigned long long millis=0) { isYielding = true; resumeMillis = millis; return ofxSonyRemoteCamera::SRC_OK; }
+		bool isCancelled() const { return pCancellationToken && pCancellationToken->isCancelled(); }
+		//! for the calls of a step, so that they are aborted by cancelScript()
+		ofxSonyRemoteCamera::CallOptions getCallOptions(unsigned long long timeoutMillis=0) const { return ofxSonyRemoteCamera::CallOptions(timeoutMillis, pCancellationToken); }
+
+		ofxSonyRemoteCamera::CancellationToken* pCancellationToken;
+		int stepResumes;			//!< earlier resumes of the current step, 0 when it starts
+		bool isYielding;			//!< set by yield()
+		unsigned long long resumeMillis;
+		std::vector<int> captureIds;	//!< of the pictures taken by the script
+	};
+	/*!
+		Step of a script, resumed on an I/O thread until it returns without yielding.
+		Errors end the script, SRC_ERROR_CANCELLED is returned by the calls aborted by cancelScript().
+	*/
+	class Step
+	{
+	public:
+		virtual ~Step() {}
+		virtual SRCError resume(ofxSonyRemoteCamera& camera, Context& context) = 0;
+		//! called instead of resume() when the script is cancelled while the step yields
+		virtual void cancel(ofxSonyRemoteCamera& camera) {}
+	};
+	class ShootModeStep : public Step
+	{
+	public:
+		ShootModeStep(ofxSonyRemoteCamera::ShootMode mode): mMode(mode) {}
+		virtual SRCError resume(ofxSonyRemoteCamera& camera, Context& context) { return camera.setShootMode(mMode, context.getCallOptions()); }
+	private:
+		ofxSonyRemoteCamera::ShootMode mMode;
+	};
+	class RecModeStep : public Step
+	{
+	public:
+		RecModeStep(bool isStart): mIsStart(isStart) {}
+		virtual SRCError resume(ofxSonyRemoteCamera& camera, Context& context) { return mIsStart ? camera.startRecMode(context.getCallOptions()) : camera.stopRecMode(context.getCallOptions()); }
+	private:
+		bool mIsStart;
+	};
+	class WaitStep : public Step
+	{
+	public:
+		WaitStep(unsigned long long millis): mMillis(millis) {}
+		virtual SRCError resume(ofxSonyRemoteCamera& camera, Context& context) { return (context.stepResumes == 0) ? context.yield(mMillis) : ofxSonyRemoteCamera::SRC_OK; }
+	private:
+		unsigned long long mMillis;
+	};
+	//! waits until getEvent reports cameraStatus, e.g. "IDLE"
+	class WaitForStatusStep : public Step
+	{
+	public:
+		WaitForStatusStep(const std::string& status, unsigned long long timeoutMillis=10000, unsigned long long pollMillis=200)
+			: mStatus(status), mTimeoutMillis(timeoutMillis), mPollMillis(pollMillis) {}
+		virtual SRCError resume(ofxSonyRemoteCamera& camera, Context& context);
+	private:
+		std::string mStatus;
+		unsigned long long mTimeoutMillis;
+		unsigned long long mPollMillis;
+		Poco::Timestamp mStartTime;
+	};
+	/*!
+		see ofxSonyRemoteCamera::startZoomTo().
+		Unlike the other steps the move runs on the zoom thread of the camera, which exists once per camera,
+		because the moves are timed by the learned zoom speed and cannot wait for the next resume.
+		The step yields while the zoom thread runs and is resumed to check whether it finished.
+	*/
+	class ZoomStep : public Step
+	{
+	public:
+		ZoomStep(int position, const ofxSonyRemoteCamera::ZoomOptions& options=ofxSonyRemoteCamera::ZoomOptions()): mPosition(position), mOptions(options) {}
+		virtual SRCError resume(ofxSonyRemoteCamera& camera, Context& context);
+		virtual void cancel(ofxSonyRemoteCamera& camera) { camera.stopZoom(); }
+	private:
+		int mPosition;
+		ofxSonyRemoteCamera::ZoomOptions mOptions;
+	};
+	//! takes count pictures, intervalMillis apart, the captureIds are added to Context::captureIds
+	class TakePictureStep : public Step
+	{
+	public:
+		TakePictureStep(int count=1, unsigned long long intervalMillis=0): mCount(count), mIntervalMillis(intervalMillis), mShots(0) {}
+		virtual SRCError resume(ofxSonyRemoteCamera& camera, Context& context);
+	private:
+		int mCount;
+		unsigned long long mIntervalMillis;
+		int mShots;
+	};
+	//! waits until the postviews are downloaded, with PostViewOptions::isAutoFetch
+	class PostViewStep : public Step
+	{
+	public:
+		PostViewStep(unsigned long long timeoutMillis=30000): mTimeoutMillis(timeoutMillis) {}
+		virtual SRCError resume(ofxSonyRemoteCamera& camera, Context& context);
+		virtual void cancel(ofxSonyRemoteCamera& camera) { camera.cancelPendingPostViews(); }
+	private:
+		unsigned long long mTimeoutMillis;
+		Poco::Timestamp mStartTime;
+	};
+
+	ofxSonyRemoteCameraScript() {}
+	//! deletes the steps
+	~ofxSonyRemoteCameraScript();
+
+	//! adds pStep, which is deleted with the script. @return *this
+	ofxSonyRemoteCameraScript& then(Step* pStep);
+	int getStepCount() const { return mSteps.size(); }
+	Step& getStep(int index) { return *mSteps[index]; }
+	Context& getContext() { return mContext; }
+
+private:
+	ofxSonyRemoteCameraScript(const ofxSonyRemoteCameraScript&);
+	ofxSonyRemoteCameraScript& operator=(const ofxSonyRemoteCameraScript&);
+
+	std::vector<Step*> mSteps;
+	Context mContext;
+};
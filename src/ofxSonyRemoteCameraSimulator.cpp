@@ -0,0 +1,811 @@
+//
+//  ofxSonyRemoteCameraSimulator.cpp
+//
+#include "ofxSonyRemoteCameraSimulator.h"
+
+#include "Poco/Exception.h"
+#include "Poco/Thread.h"
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/Net/HTTPServerParams.h"
+
+static const char* SUPPORTED_METHODS[] = {
+	"getVersions", "getMethodTypes", "getApplicationInfo", "getAvailableApiList", "getEvent",
+	"startRecMode", "stopRecMode", "startLiveview", "stopLiveview",
+	"startLiveviewWithSize", "getSupportedLiveviewSize", "getLiveviewSize",
+	"actTakePicture", "awaitTakePicture", "startMovieRec", "stopMovieRec", "actZoom",
+	"getShootMode", "setShootMode", "getSupportedShootMode", "getAvailableShootMode",
+	"getSelfTimer", "setSelfTimer", "getSupportedSelfTimer", "getAvailableSelfTimer",
+	"getPostviewImageSize", "setPostviewImageSize", "getSupportedPostviewImageSize", "getAvailablePostviewImageSize",
+	"getViewAngle", "getMovieQuality", "getSteadyMode", "getStorageInformation",
+	"setCameraFunction", "getCameraFunction",
+};
+static const int SUPPORTED_METHOD_NUM(sizeof(SUPPORTED_METHODS) / sizeof(SUPPORTED_METHODS[0]));
+static const int MAX_SERVER_THREADS(16);
+static const unsigned long long EVENT_POLLING_TIMEOUT(5000);	//!< ms
+static const int LIVEVIEW_PAYLOAD_HEADER_SIZE(128);
+static const int LIVEVIEW_FOCUS_FRAME_SIZE(16);
+static const char* SSDP_MULTICAST_ADDRESS("239.255.255.250");
+static const char* SSDP_SEARCH_TARGET("urn:schemas-sony-com:service:ScalarWebAPI:1");
+static const long SSDP_RECEIVE_TIMEOUT(200);	//!< ms, how often the SSDP thread checks for stop()
+static const int MAX_SSDP_REQUEST_SIZE(2048);
+static const int MAX_CONTENT_LIST_COUNT(100);
+static const size_t CONTENT_CHUNK_SIZE(16 * 1024);
+static const char* CONTENT_SOURCE("storage:memoryCard1");
+
+// JSON-RPC error codes
+static const int ERROR_ANY(1);
+static const int ERROR_TIMEOUT(2);
+static const int ERROR_ILLEGAL_ARGUMENT(3);
+static const int ERROR_NO_SUCH_METHOD(12);
+static const int ERROR_CAMERA_NOT_READY(40401);
+static const int ERROR_STILL_CAPTURING_NOT_FINISHED(40403);
+
+//////////////////////////////////////////////////////////////////////////
+// Handlers
+//////////////////////////////////////////////////////////////////////////
+Poco::Net::HTTPRequestHandler* ofxSonyRemoteCameraSimulator::RequestHandlerFactory::createRequestHandler(const Poco::Net::HTTPServerRequest&)
+{
+	return new RequestHandler(mSimulator);
+}
+
+void ofxSonyRemoteCameraSimulator::RequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+{
+	const std::string& uri(request.getURI());
+	if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_POST && (uri == "/sony/camera" || uri == "/sony/avContent")) {
+		mSimulator.handleCamera(request, response);
+	} else if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_GET && uri.compare(0, 10, "/postview/") == 0) {
+		mSimulator.handlePostView(response);
+	} else if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_GET && uri.compare(0, 10, "/contents/") == 0) {
+		mSimulator.handleContent(request, response);
+	} else if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_GET && uri.compare(0, 10, "/liveview/") == 0) {
+		mSimulator.handleLiveView(uri, response);
+	} else if (request.getMethod() == Poco::Net::HTTPRequest::HTTP_GET && uri == "/dd.xml") {
+		mSimulator.handleDescription(response);
+	} else {
+		response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+		response.send();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Simulator
+//////////////////////////////////////////////////////////////////////////
+ofxSonyRemoteCameraSimulator::ofxSonyRemoteCameraSimulator()
+	: mpServer(0)
+	, mSsdpRunnable(*this, &ofxSonyRemoteCameraSimulator::runSsdp)
+	, mIsSsdpRunning(false)
+	, mIsRecMode(false)
+	, mSelfTimer(0)
+	, mIsCapturing(false)
+	, mCaptureId(-1)
+	, mCaptureCount(0)
+	, mRequestCount(0)
+	, mStateVersion(0)
+	, mZoomPosition(0)
+	, mZoomDirection(0)
+{
+}
+
+ofxSonyRemoteCameraSimulator::~ofxSonyRemoteCameraSimulator()
+{
+	stop();
+}
+
+bool ofxSonyRemoteCameraSimulator::start(const Settings& settings/*=Settings()*/)
+{
+	stop();
+	mSettings = settings;
+	mIsRecMode = false;
+	mShootMode = "still";
+	mSelfTimer = 0;
+	mPostViewImageSize = "2M";
+	mIsCapturing = false;
+	mCaptureId = -1;
+	mCaptureCount = 0;
+	mRequestCount = 0;
+	mStateVersion = 0;
+	mZoomPosition = 0;
+	mZoomDirection = 0;
+	mZoomUpdateTime.update();
+	createJpeg(mSettings.postViewWidth, mSettings.postViewHeight, mPostViewJpeg);
+	createJpeg(mSettings.liveViewWidth, mSettings.liveViewHeight, mLiveViewJpeg);
+	createJpeg(mSettings.liveViewWidth / 2, mSettings.liveViewHeight / 2, mSmallLiveViewJpeg);
+	mLiveViewSize = "L";
+	mCameraFunction = "Remote Shooting";
+
+	try {
+		Poco::Net::HTTPServerParams* pParams(new Poco::Net::HTTPServerParams());
+		pParams->setMaxThreads(MAX_SERVER_THREADS);
+		pParams->setKeepAlive(true);
+		mpServer = new Poco::Net::HTTPServer(new RequestHandlerFactory(*this), Poco::Net::ServerSocket(mSettings.port), pParams);
+		mpServer->start();
+	} catch (Poco::Exception& e) {
+		ofLogError("simulator: " + e.displayText());
+		delete mpServer;
+		mpServer = 0;
+		return false;
+	}
+	if (mSettings.ssdpPort > 0 && !startSsdp()) {
+		stop();
+		return false;
+	}
+	return true;
+}
+
+void ofxSonyRemoteCameraSimulator::stop()
+{
+	stopSsdp();
+	if (mpServer == 0) return;
+	Poco::Net::HTTPServer* pServer(0);
+	{
+		// handlers which are streaming or waiting check mpServer and return
+		ofMutex::ScopedLock lock(mMutex);
+		pServer = mpServer;
+		mpServer = 0;
+	}
+	pServer->stop();
+	while (pServer->currentConnections() > 0) {
+		Poco::Thread::sleep(10);
+	}
+	delete pServer;
+}
+
+std::string ofxSonyRemoteCameraSimulator::getUuid() const
+{
+	char node[16];
+	sprintf(node, "%012X", mSettings.port);
+	return std::string("uuid:00000000-0000-1010-8000-") + node;
+}
+
+int ofxSonyRemoteCameraSimulator::getCaptureCount()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return mCaptureCount;
+}
+
+int ofxSonyRemoteCameraSimulator::getRequestCount()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return mRequestCount;
+}
+
+void ofxSonyRemoteCameraSimulator::handleCamera(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+{
+	picojson::value body;
+	const std::string parseError(picojson::parse(body, request.stream()));
+	if (mSettings.responseLatencyMillis > 0) {
+		Poco::Thread::sleep(static_cast<long>(mSettings.responseLatencyMillis));
+	}
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		++mRequestCount;
+	}
+
+	picojson::object reply;
+	picojson::array result;
+	int errorCode(0);
+	const std::string method(body.get("method").is<std::string>() ? body.get("method").get<std::string>() : "");
+	if (!parseError.empty() || !body.get("params").is<picojson::array>()) {
+		errorCode = ERROR_ILLEGAL_ARGUMENT;
+	} else if (!call(method, body.get("params").get<picojson::array>(), result, errorCode) && errorCode == 0) {
+		errorCode = ERROR_NO_SUCH_METHOD;
+	}
+	if (errorCode != 0) {
+		picojson::array error;
+		error.push_back(picojson::value(static_cast<double>(errorCode)));
+		error.push_back(picojson::value(std::string(errorCode == ERROR_NO_SUCH_METHOD ? "No Such Method" : "Error")));
+		reply["error"] = picojson::value(error);
+	} else {
+		// getMethodTypes is the only method which reports "results"
+		reply[method == "getMethodTypes" ? "results" : "result"] = picojson::value(result);
+	}
+	reply["id"] = body.get("id").is<double>() ? body.get("id") : picojson::value(1.0);
+
+	const std::string json(picojson::value(reply).serialize());
+	response.setContentType("application/json");
+	response.setContentLength(json.size());
+	response.send() << json;
+}
+
+void ofxSonyRemoteCameraSimulator::handlePostView(Poco::Net::HTTPServerResponse& response)
+{
+	response.setContentType("image/jpeg");
+	response.setContentLength(mPostViewJpeg.size());
+	response.send().write(mPostViewJpeg.getBinaryBuffer(), mPostViewJpeg.size());
+}
+
+void ofxSonyRemoteCameraSimulator::handleContent(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response)
+{
+	const size_t size(mPostViewJpeg.size());
+	size_t offset(0);
+	if (request.has("Range")) {
+		// only the open ended form "bytes=N-" which resuming downloads send
+		const std::string& range(request.get("Range"));
+		if (range.compare(0, 6, "bytes=") != 0 || range[range.size() - 1] != '-') {
+			response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_REQUESTED_RANGE_NOT_SATISFIABLE);
+			response.send();
+			return;
+		}
+		offset = static_cast<size_t>(ofToInt(range.substr(6, range.size() - 7)));
+		if (offset >= size) {
+			response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_REQUESTED_RANGE_NOT_SATISFIABLE);
+			response.set("Content-Range", "bytes */" + ofToString(size));
+			response.send();
+			return;
+		}
+		response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_PARTIAL_CONTENT);
+		response.set("Content-Range", "bytes " + ofToString(offset) + "-" + ofToString(size - 1) + "/" + ofToString(size));
+	}
+	response.setContentType("image/jpeg");
+	response.setContentLength(size - offset);
+	std::ostream& out(response.send());
+	const Poco::Timestamp startTime;
+	for (size_t sent(0); offset + sent < size && out.good(); ) {
+		{
+			ofMutex::ScopedLock lock(mMutex);
+			if (mpServer == 0) return;
+		}
+		const size_t chunk(std::min(CONTENT_CHUNK_SIZE, size - offset - sent));
+		out.write(mPostViewJpeg.getBinaryBuffer() + offset + sent, chunk);
+		sent += chunk;
+		if (mSettings.contentBytesPerSecond > 0) {
+			// paced against the start, like a link of that bandwidth
+			const Poco::Timestamp::TimeDiff dueMicros(static_cast<Poco::Timestamp::TimeDiff>(sent) * 1000000 / mSettings.contentBytesPerSecond);
+			const Poco::Timestamp::TimeDiff elapsedMicros(startTime.elapsed());
+			if (dueMicros > elapsedMicros) Poco::Thread::sleep(static_cast<long>((dueMicros - elapsedMicros) / 1000));
+		}
+	}
+	out.flush();
+}
+
+void ofxSonyRemoteCameraSimulator::handleLiveView(const std::string& uri, Poco::Net::HTTPServerResponse& response)
+{
+	// "M" streams frames of half the size
+	const ofBuffer& jpeg((uri.find("size=M") != std::string::npos) ? mSmallLiveViewJpeg : mLiveViewJpeg);
+	response.setContentType("image/jpeg");
+	response.setChunkedTransferEncoding(true);
+	std::ostream& out(response.send());
+
+	const int frameInterval(1000 / std::max(1, mSettings.liveViewFps));
+	const Poco::Timestamp startTime;
+	const unsigned int jpegSize(jpeg.size());
+	for (int frameId(0); out.good(); ++frameId) {
+		{
+			ofMutex::ScopedLock lock(mMutex);
+			if (mpServer == 0) break;
+		}
+		const unsigned int timestamp(static_cast<unsigned int>(startTime.elapsed() / 1000));
+		unsigned char commonHeader[8] = {
+			0xff, 0x01,
+			static_cast<unsigned char>((frameId >> 8) & 0xff), static_cast<unsigned char>(frameId & 0xff),
+			static_cast<unsigned char>((timestamp >> 24) & 0xff), static_cast<unsigned char>((timestamp >> 16) & 0xff),
+			static_cast<unsigned char>((timestamp >> 8) & 0xff), static_cast<unsigned char>(timestamp & 0xff),
+		};
+		unsigned char payloadHeader[LIVEVIEW_PAYLOAD_HEADER_SIZE] = {0};
+		payloadHeader[0] = 0x24;
+		payloadHeader[1] = 0x35;
+		payloadHeader[2] = 0x68;
+		payloadHeader[3] = 0x79;
+		payloadHeader[4] = static_cast<unsigned char>((jpegSize >> 16) & 0xff);
+		payloadHeader[5] = static_cast<unsigned char>((jpegSize >> 8) & 0xff);
+		payloadHeader[6] = static_cast<unsigned char>(jpegSize & 0xff);
+		out.write(reinterpret_cast<const char*>(commonHeader), sizeof(commonHeader));
+		out.write(reinterpret_cast<const char*>(payloadHeader), sizeof(payloadHeader));
+		out.write(jpeg.getBinaryBuffer(), jpegSize);
+		if (mSettings.hasFrameInformation) {
+			// same frameId and timestamp as the image, one face frame sweeping across it
+			commonHeader[1] = 0x02;
+			payloadHeader[4] = 0;
+			payloadHeader[5] = 0;
+			payloadHeader[6] = LIVEVIEW_FOCUS_FRAME_SIZE;
+			payloadHeader[8] = 0x01;	// version 1.0
+			payloadHeader[11] = 1;		// frames
+			payloadHeader[13] = LIVEVIEW_FOCUS_FRAME_SIZE;
+			const int left((frameId * 50) % 8000);
+			const int right(left + 2000);
+			unsigned char focusFrame[LIVEVIEW_FOCUS_FRAME_SIZE] = {
+				static_cast<unsigned char>((left >> 8) & 0xff), static_cast<unsigned char>(left & 0xff),
+				0x0f, 0xa0,	// 4000
+				static_cast<unsigned char>((right >> 8) & 0xff), static_cast<unsigned char>(right & 0xff),
+				0x17, 0x70,	// 6000
+				0x04, static_cast<unsigned char>((frameId / 30) % 2 ? 0x04 : 0x01), 0x01,
+			};
+			out.write(reinterpret_cast<const char*>(commonHeader), sizeof(commonHeader));
+			out.write(reinterpret_cast<const char*>(payloadHeader), sizeof(payloadHeader));
+			out.write(reinterpret_cast<const char*>(focusFrame), sizeof(focusFrame));
+		}
+		out.flush();
+		Poco::Thread::sleep(frameInterval);
+	}
+}
+
+void ofxSonyRemoteCameraSimulator::handleDescription(Poco::Net::HTTPServerResponse& response)
+{
+	const std::string actionListUrl("http://" + getHost() + ":" + ofToString(mSettings.port) + "/sony");
+	std::string services;
+	const char* serviceTypes[] = {"guide", "camera", "accessControl", "avContent"};
+	for (int i(0); i<4; ++i) {
+		services += std::string("      <av:X_ScalarWebAPI_Service>\n")
+			+ "        <av:X_ScalarWebAPI_ServiceType>" + serviceTypes[i] + "</av:X_ScalarWebAPI_ServiceType>\n"
+			+ "        <av:X_ScalarWebAPI_ActionList_URL>" + actionListUrl + "</av:X_ScalarWebAPI_ActionList_URL>\n"
+			+ "        <av:X_ScalarWebAPI_AccessType />\n"
+			+ "      </av:X_ScalarWebAPI_Service>\n";
+	}
+	const std::string xml(std::string("<?xml version=\"1.0\"?>\n")
+		+ "<root xmlns=\"urn:schemas-upnp-org:device-1-0\">\n"
+		+ "  <specVersion><major>1</major><minor>0</minor></specVersion>\n"
+		+ "  <device>\n"
+		+ "    <deviceType>urn:schemas-upnp-org:device:Basic:1</deviceType>\n"
+		+ "    <friendlyName>" + mSettings.applicationName + " " + ofToString(mSettings.port) + "</friendlyName>\n"
+		+ "    <manufacturer>Sony Corporation</manufacturer>\n"
+		+ "    <modelName>" + mSettings.applicationName + "</modelName>\n"
+		+ "    <UDN>" + getUuid() + "</UDN>\n"
+		+ "    <av:X_ScalarWebAPI_DeviceInfo xmlns:av=\"urn:schemas-sony-com:av\">\n"
+		+ "    <av:X_ScalarWebAPI_Version>1.0</av:X_ScalarWebAPI_Version>\n"
+		+ "    <av:X_ScalarWebAPI_ImagingDevice>\n"
+		+ "      <av:X_ScalarWebAPI_LiveView_URL>http://" + getHost() + ":" + ofToString(mSettings.port) + "/liveview/liveviewstream</av:X_ScalarWebAPI_LiveView_URL>\n"
+		+ "      <av:X_ScalarWebAPI_DefaultFunction>RemoteShooting</av:X_ScalarWebAPI_DefaultFunction>\n"
+		+ "    </av:X_ScalarWebAPI_ImagingDevice>\n"
+		+ "    <av:X_ScalarWebAPI_ServiceList>\n"
+		+ services
+		+ "    </av:X_ScalarWebAPI_ServiceList>\n"
+		+ "    </av:X_ScalarWebAPI_DeviceInfo>\n"
+		+ "  </device>\n"
+		+ "</root>\n");
+	response.setContentType("text/xml");
+	response.setContentLength(xml.size());
+	response.send() << xml;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// SSDP
+//////////////////////////////////////////////////////////////////////////
+bool ofxSonyRemoteCameraSimulator::startSsdp()
+{
+	try {
+		// several simulators can share the port, each of them answers multicast searches
+		mSsdpSocket = Poco::Net::MulticastSocket();
+		mSsdpSocket.bind(Poco::Net::SocketAddress("0.0.0.0", mSettings.ssdpPort), true);
+		mSsdpSocket.setReceiveTimeout(Poco::Timespan(SSDP_RECEIVE_TIMEOUT * 1000));
+	} catch (Poco::Exception& e) {
+		ofLogError("simulator: ssdp: " + e.displayText());
+		return false;
+	}
+	try {
+		mSsdpSocket.joinGroup(Poco::Net::IPAddress(SSDP_MULTICAST_ADDRESS));
+	} catch (Poco::Exception& e) {
+		// searches sent to the port directly are still answered
+		ofLogWarning("simulator: ssdp: " + e.displayText());
+	}
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		mIsSsdpRunning = true;
+	}
+	mSsdpThread.start(mSsdpRunnable);
+	return true;
+}
+
+void ofxSonyRemoteCameraSimulator::stopSsdp()
+{
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		if (!mIsSsdpRunning) return;
+		mIsSsdpRunning = false;
+	}
+	mSsdpThread.join();
+	mSsdpSocket.close();
+}
+
+void ofxSonyRemoteCameraSimulator::runSsdp()
+{
+	char buffer[MAX_SSDP_REQUEST_SIZE];
+	while (true) {
+		{
+			ofMutex::ScopedLock lock(mMutex);
+			if (!mIsSsdpRunning) break;
+		}
+		try {
+			Poco::Net::SocketAddress sender;
+			const int size(mSsdpSocket.receiveFrom(buffer, sizeof(buffer), sender));
+			const std::string request(buffer, std::max(0, size));
+			if (request.compare(0, 8, "M-SEARCH") != 0) continue;
+			if (request.find(SSDP_SEARCH_TARGET) == std::string::npos && request.find("ssdp:all") == std::string::npos) continue;
+			const std::string response(std::string("HTTP/1.1 200 OK\r\n")
+				+ "CACHE-CONTROL: max-age=1800\r\n"
+				+ "EXT:\r\n"
+				+ "LOCATION: " + getDescriptionUrl() + "\r\n"
+				+ "SERVER: UPnP/1.0 SonyImagingDevice/1.0\r\n"
+				+ "ST: " + SSDP_SEARCH_TARGET + "\r\n"
+				+ "USN: " + getUuid() + "::" + SSDP_SEARCH_TARGET + "\r\n"
+				+ "\r\n");
+			mSsdpSocket.sendTo(response.data(), response.size(), sender);
+		} catch (Poco::TimeoutException&) {
+		} catch (Poco::Exception& e) {
+			ofLogError("simulator: ssdp: " + e.displayText());
+			break;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Camera service
+//////////////////////////////////////////////////////////////////////////
+bool ofxSonyRemoteCameraSimulator::call(const std::string& method, const picojson::array& params, picojson::array& result, int& errorCode)
+{
+	if (method == "getVersions") {
+		picojson::array versions;
+		versions.push_back(picojson::value(std::string("1.0")));
+		result.push_back(picojson::value(versions));
+	} else if (method == "getMethodTypes") {
+		// [name, parameter types, result types, version]
+		for (int i(0); i<SUPPORTED_METHOD_NUM; ++i) {
+			picojson::array type;
+			type.push_back(picojson::value(std::string(SUPPORTED_METHODS[i])));
+			type.push_back(picojson::value(picojson::array()));
+			type.push_back(picojson::value(picojson::array()));
+			type.push_back(picojson::value(std::string("1.0")));
+			result.push_back(picojson::value(type));
+		}
+	} else if (method == "getApplicationInfo") {
+		result.push_back(picojson::value(mSettings.applicationName));
+		result.push_back(picojson::value(mSettings.applicationVersion));
+	} else if (method == "getAvailableApiList") {
+		picojson::array names;
+		for (int i(0); i<SUPPORTED_METHOD_NUM; ++i) {
+			names.push_back(picojson::value(std::string(SUPPORTED_METHODS[i])));
+		}
+		result.push_back(picojson::value(names));
+	} else if (method == "getEvent") {
+		getEvent(!params.empty() && params[0].is<bool>() && params[0].get<bool>(), result, errorCode);
+	} else if (method == "startRecMode" || method == "stopRecMode") {
+		ofMutex::ScopedLock lock(mMutex);
+		mIsRecMode = (method == "startRecMode");
+		++mStateVersion;
+		result.push_back(picojson::value(0.0));
+	} else if (method == "startLiveview" || method == "startLiveviewWithSize") {
+		ofMutex::ScopedLock lock(mMutex);
+		if (mSettings.isRecModeRequired && !mIsRecMode) {
+			errorCode = ERROR_ANY;
+		} else if (method == "startLiveviewWithSize" && (params.empty() || !params[0].is<std::string>()
+			|| (params[0].get<std::string>() != "L" && params[0].get<std::string>() != "M"))) {
+			errorCode = ERROR_ILLEGAL_ARGUMENT;
+		} else {
+			if (method == "startLiveviewWithSize") mLiveViewSize = params[0].get<std::string>();
+			result.push_back(picojson::value("http://" + getHost() + ":" + ofToString(mSettings.port) + "/liveview/liveviewstream?size=" + mLiveViewSize));
+		}
+	} else if (method == "getSupportedLiveviewSize") {
+		picojson::array sizes;
+		sizes.push_back(picojson::value(std::string("L")));
+		sizes.push_back(picojson::value(std::string("M")));
+		result.push_back(picojson::value(sizes));
+	} else if (method == "getLiveviewSize") {
+		ofMutex::ScopedLock lock(mMutex);
+		result.push_back(picojson::value(mLiveViewSize));
+	} else if (method == "actTakePicture") {
+		return takePicture(false, result, errorCode);
+	} else if (method == "awaitTakePicture") {
+		return takePicture(true, result, errorCode);
+	} else if (method == "actZoom") {
+		if (zoom(params)) {
+			result.push_back(picojson::value(0.0));
+		} else {
+			errorCode = ERROR_ILLEGAL_ARGUMENT;
+		}
+	} else if (method == "stopLiveview" || method == "startMovieRec") {
+		result.push_back(picojson::value(0.0));
+	} else if (method == "stopMovieRec") {
+		result.push_back(picojson::value(std::string("")));
+	} else if (method == "getShootMode") {
+		ofMutex::ScopedLock lock(mMutex);
+		result.push_back(picojson::value(mShootMode));
+	} else if (method == "setShootMode") {
+		if (params.empty() || !params[0].is<std::string>()) {
+			errorCode = ERROR_ILLEGAL_ARGUMENT;
+		} else {
+			ofMutex::ScopedLock lock(mMutex);
+			mShootMode = params[0].get<std::string>();
+			++mStateVersion;
+			result.push_back(picojson::value(0.0));
+		}
+	} else if (method == "getSelfTimer") {
+		ofMutex::ScopedLock lock(mMutex);
+		result.push_back(picojson::value(static_cast<double>(mSelfTimer)));
+	} else if (method == "setSelfTimer") {
+		if (params.empty() || !params[0].is<double>()) {
+			errorCode = ERROR_ILLEGAL_ARGUMENT;
+		} else {
+			ofMutex::ScopedLock lock(mMutex);
+			mSelfTimer = static_cast<int>(params[0].get<double>());
+			++mStateVersion;
+			result.push_back(picojson::value(0.0));
+		}
+	} else if (method == "getPostviewImageSize") {
+		ofMutex::ScopedLock lock(mMutex);
+		result.push_back(picojson::value(mPostViewImageSize));
+	} else if (method == "setPostviewImageSize") {
+		if (params.empty() || !params[0].is<std::string>()) {
+			errorCode = ERROR_ILLEGAL_ARGUMENT;
+		} else {
+			ofMutex::ScopedLock lock(mMutex);
+			mPostViewImageSize = params[0].get<std::string>();
+			++mStateVersion;
+			result.push_back(picojson::value(0.0));
+		}
+	} else if (method == "getViewAngle") {
+		result.push_back(picojson::value(170.0));
+	} else if (method == "getMovieQuality") {
+		result.push_back(picojson::value(std::string("HQ")));
+	} else if (method == "getSteadyMode") {
+		result.push_back(picojson::value(std::string("off")));
+	} else if (method == "getStorageInformation") {
+		picojson::object storage;
+		storage["type"] = picojson::value(std::string("storageInformation"));
+		storage["storageID"] = picojson::value(std::string("Memory Card 1"));
+		storage["recordTarget"] = picojson::value(true);
+		storage["numberOfRecordableImages"] = picojson::value(1000.0);
+		storage["recordableTime"] = picojson::value(120.0);
+		storage["storageDescription"] = picojson::value(std::string("Simulated"));
+		picojson::array storages;
+		storages.push_back(picojson::value(storage));
+		result.push_back(picojson::value(storages));
+	} else if (method == "getCameraFunction") {
+		ofMutex::ScopedLock lock(mMutex);
+		result.push_back(picojson::value(mCameraFunction));
+	} else if (method == "setCameraFunction") {
+		if (params.empty() || !params[0].is<std::string>()
+			|| (params[0].get<std::string>() != "Remote Shooting" && params[0].get<std::string>() != "Contents Transfer")) {
+			errorCode = ERROR_ILLEGAL_ARGUMENT;
+		} else {
+			// the contents are listed in either function, the liveview keeps running
+			ofMutex::ScopedLock lock(mMutex);
+			mCameraFunction = params[0].get<std::string>();
+			++mStateVersion;
+			result.push_back(picojson::value(0.0));
+		}
+	} else if (method == "getSourceList") {
+		picojson::object source;
+		source["source"] = picojson::value(std::string(CONTENT_SOURCE));
+		picojson::array sources;
+		sources.push_back(picojson::value(source));
+		result.push_back(picojson::value(sources));
+	} else if (method == "getContentCount" || method == "getContentList") {
+		return listContents(params, result, errorCode);
+	} else if (method.compare(0, 12, "getSupported") == 0 || method.compare(0, 12, "getAvailable") == 0) {
+		result.push_back(picojson::value(picojson::array()));
+	} else {
+		return false;
+	}
+	return true;
+}
+
+bool ofxSonyRemoteCameraSimulator::listContents(const picojson::array& params, picojson::array& result, int& errorCode)
+{
+	// getContentCount and getContentList take the same uri, only the list has cnt
+	if (params.empty() || !params[0].get("uri").is<std::string>() || params[0].get("uri").get<std::string>() != CONTENT_SOURCE) {
+		errorCode = ERROR_ILLEGAL_ARGUMENT;
+		return true;
+	}
+	const picojson::value& param(params[0]);
+	if (!param.get("cnt").is<double>()) {
+		picojson::object count;
+		count["count"] = picojson::value(static_cast<double>(mSettings.contentCount));
+		result.push_back(picojson::value(count));
+		return true;
+	}
+	const int startIndex(param.get("stIdx").is<double>() ? static_cast<int>(param.get("stIdx").get<double>()) : 0);
+	const int count(static_cast<int>(param.get("cnt").get<double>()));
+	if (startIndex < 0 || count < 0 || count > MAX_CONTENT_LIST_COUNT) {
+		errorCode = ERROR_ILLEGAL_ARGUMENT;
+		return true;
+	}
+	picojson::array contents;
+	for (int i(startIndex); i<std::min(startIndex + count, mSettings.contentCount); ++i) {
+		char fileName[16];
+		sprintf(fileName, "DSC%05d.JPG", i + 1);
+		picojson::object original;
+		original["fileName"] = picojson::value(std::string(fileName));
+		original["stillObject"] = picojson::value(std::string("jpeg"));
+		original["url"] = picojson::value(getContentUrl(i));
+		picojson::array originals;
+		originals.push_back(picojson::value(original));
+		picojson::object files;
+		files["original"] = picojson::value(originals);
+		files["largeUrl"] = picojson::value(getPostViewUrl(i));
+		files["smallUrl"] = picojson::value(getPostViewUrl(i));
+		files["thumbnailUrl"] = picojson::value(getPostViewUrl(i));
+		picojson::object content;
+		content["uri"] = picojson::value("image:content?contentId=" + ofToString(i + 1));
+		content["title"] = picojson::value(std::string(""));
+		content["contentKind"] = picojson::value(std::string("still"));
+		content["createdTime"] = picojson::value(std::string("2014-01-01T00:00:00+09:00"));
+		content["isBrowsable"] = picojson::value(std::string("false"));
+		content["isPlayable"] = picojson::value(std::string("false"));
+		content["content"] = picojson::value(files);
+		contents.push_back(picojson::value(content));
+	}
+	result.push_back(picojson::value(contents));
+	return true;
+}
+
+bool ofxSonyRemoteCameraSimulator::takePicture(bool isAwait, picojson::array& result, int& errorCode)
+{
+	// one capture at a time, like a real camera
+	int captureId(-1);
+	Poco::Timestamp doneTime;
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		if (mSettings.isRecModeRequired && !mIsRecMode) {
+			errorCode = ERROR_ANY;
+			return true;
+		}
+		if (isAwait) {
+			if (!mIsCapturing) {
+				errorCode = ERROR_ANY;
+				return true;
+			}
+		} else {
+			// a capture which nobody awaited is finished once its time has passed
+			if (mIsCapturing && Poco::Timestamp() < mCaptureDoneTime) {
+				errorCode = ERROR_CAMERA_NOT_READY;
+				return true;
+			}
+			mIsCapturing = true;
+			mCaptureId = mCaptureCount++;
+			mCaptureDoneTime.update();
+			mCaptureDoneTime += static_cast<Poco::Timestamp::TimeDiff>(mSettings.captureLatencyMillis) * 1000;
+			++mStateVersion;
+		}
+		captureId = mCaptureId;
+		doneTime = mCaptureDoneTime;
+	}
+
+	// actTakePicture gives up after awaitThresholdMillis, awaitTakePicture waits for the end
+	const Poco::Timestamp now;
+	Poco::Timestamp::TimeDiff waitMicros(doneTime > now ? doneTime - now : 0);
+	const Poco::Timestamp::TimeDiff thresholdMicros(static_cast<Poco::Timestamp::TimeDiff>(mSettings.awaitThresholdMillis) * 1000);
+	const bool isFinished(isAwait || waitMicros <= thresholdMicros);
+	if (!isFinished) waitMicros = thresholdMicros;
+	if (waitMicros > 0) Poco::Thread::sleep(static_cast<long>(waitMicros / 1000));
+
+	if (!isFinished) {
+		errorCode = ERROR_STILL_CAPTURING_NOT_FINISHED;
+		return true;
+	}
+	ofMutex::ScopedLock lock(mMutex);
+	if (mCaptureId == captureId && mIsCapturing) {
+		mIsCapturing = false;
+		++mStateVersion;
+	}
+	picojson::array urls;
+	urls.push_back(picojson::value(getPostViewUrl(captureId)));
+	result.push_back(picojson::value(urls));
+	return true;
+}
+
+void ofxSonyRemoteCameraSimulator::getEvent(bool isPolling, picojson::array& result, int& errorCode)
+{
+	int stateVersion(0);
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		stateVersion = mStateVersion;
+	}
+	if (isPolling) {
+		// returns when the state changes, or with a timeout error
+		const Poco::Timestamp startTime;
+		while (true) {
+			{
+				ofMutex::ScopedLock lock(mMutex);
+				updateZoom();
+				if (mpServer == 0 || mStateVersion != stateVersion) break;
+			}
+			if (startTime.isElapsed(static_cast<Poco::Timestamp::TimeDiff>(EVENT_POLLING_TIMEOUT) * 1000)) {
+				errorCode = ERROR_TIMEOUT;
+				return;
+			}
+			Poco::Thread::sleep(10);
+		}
+	}
+
+	ofMutex::ScopedLock lock(mMutex);
+	updateZoom();
+	picojson::object apiList;
+	picojson::array names;
+	for (int i(0); i<SUPPORTED_METHOD_NUM; ++i) {
+		names.push_back(picojson::value(std::string(SUPPORTED_METHODS[i])));
+	}
+	apiList["type"] = picojson::value(std::string("availableApiList"));
+	apiList["names"] = picojson::value(names);
+	result.push_back(picojson::value(apiList));
+
+	picojson::object status;
+	status["type"] = picojson::value(std::string("cameraStatus"));
+	status["cameraStatus"] = picojson::value(std::string(mIsCapturing ? "StillCapturing" : "IDLE"));
+	result.push_back(picojson::value(status));
+
+	picojson::object shootMode;
+	shootMode["type"] = picojson::value(std::string("shootMode"));
+	shootMode["currentShootMode"] = picojson::value(mShootMode);
+	result.push_back(picojson::value(shootMode));
+
+	picojson::object zoomInformation;
+	zoomInformation["type"] = picojson::value(std::string("zoomInformation"));
+	zoomInformation["zoomPosition"] = picojson::value(static_cast<double>(static_cast<int>(mZoomPosition)));
+	zoomInformation["zoomNumberBox"] = picojson::value(1.0);
+	zoomInformation["zoomIndexCurrentBox"] = picojson::value(0.0);
+	zoomInformation["zoomPositionCurrentBox"] = picojson::value(static_cast<double>(static_cast<int>(mZoomPosition)));
+	result.push_back(picojson::value(zoomInformation));
+
+	picojson::object selfTimer;
+	selfTimer["type"] = picojson::value(std::string("selfTimer"));
+	selfTimer["currentSelfTimer"] = picojson::value(static_cast<double>(mSelfTimer));
+	result.push_back(picojson::value(selfTimer));
+
+	picojson::object postViewImageSize;
+	postViewImageSize["type"] = picojson::value(std::string("postviewImageSize"));
+	postViewImageSize["currentPostviewImageSize"] = picojson::value(mPostViewImageSize);
+	result.push_back(picojson::value(postViewImageSize));
+}
+
+bool ofxSonyRemoteCameraSimulator::zoom(const picojson::array& params)
+{
+	if (params.size() < 2 || !params[0].is<std::string>() || !params[1].is<std::string>()) return false;
+	const std::string& direction(params[0].get<std::string>());
+	const std::string& movement(params[1].get<std::string>());
+	if (direction != "in" && direction != "out") return false;
+	const int sign(direction == "in" ? 1 : -1);
+
+	ofMutex::ScopedLock lock(mMutex);
+	updateZoom();
+	if (movement == "start") {
+		mZoomDirection = sign;
+	} else if (movement == "stop") {
+		mZoomDirection = 0;
+	} else if (movement == "1shot") {
+		const int lastPosition(static_cast<int>(mZoomPosition));
+		mZoomPosition = ofClamp(mZoomPosition + sign * mSettings.zoomStepSize, 0, 100);
+		if (static_cast<int>(mZoomPosition) != lastPosition) ++mStateVersion;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+void ofxSonyRemoteCameraSimulator::updateZoom()
+{
+	// continuous zoom moves with the time since the last update
+	const Poco::Timestamp now;
+	const double seconds((now - mZoomUpdateTime) / 1000000.0);
+	mZoomUpdateTime = now;
+	if (mZoomDirection == 0) return;
+	const int lastPosition(static_cast<int>(mZoomPosition));
+	mZoomPosition = ofClamp(mZoomPosition + mZoomDirection * mSettings.zoomSpeed * seconds, 0, 100);
+	if (static_cast<int>(mZoomPosition) != lastPosition) ++mStateVersion;
+}
+
+std::string ofxSonyRemoteCameraSimulator::getPostViewUrl(int captureId) const
+{
+	return "http://" + getHost() + ":" + ofToString(mSettings.port) + "/postview/pict" + ofToString(captureId) + ".jpg";
+}
+
+std::string ofxSonyRemoteCameraSimulator::getContentUrl(int index) const
+{
+	char fileName[16];
+	sprintf(fileName, "DSC%05d.JPG", index + 1);
+	return "http://" + getHost() + ":" + ofToString(mSettings.port) + "/contents/" + fileName;
+}
+
+void ofxSonyRemoteCameraSimulator::createJpeg(int width, int height, ofBuffer& jpeg) const
+{
+	ofPixels pixels;
+	pixels.allocate(width, height, 3);
+	unsigned char* pPixels(pixels.getPixels());
+	for (int y(0); y<height; ++y) {
+		for (int x(0); x<width; ++x) {
+			unsigned char* pPixel(pPixels + (y * width + x) * 3);
+			pPixel[0] = static_cast<unsigned char>(x * 255 / width);
+			pPixel[1] = static_cast<unsigned char>(y * 255 / height);
+			pPixel[2] = 128;
+		}
+	}
+	ofSaveImage(pixels, jpeg, OF_IMAGE_FORMAT_JPEG, OF_IMAGE_QUALITY_MEDIUM);
+}
@@ -0,0 +1,149 @@
+//
+//  ofxSonyRemoteCameraSimulator.h
+//
+//  Local stand-in for a camera, serving the JSON-RPC camera service, postview images and the liveview stream.
+//  Capture and response latencies are configurable, so that capture scheduling can be checked without a camera.
+//  With ssdpPort, it answers SSDP M-SEARCH and serves a device description like a camera, for ofxSonyRemoteCameraDiscovery.
+//  With contentCount, the avContent service lists that many stills, served with Range requests for ofxSonyRemoteCameraTransfer.
+//  e.g. simulator.start(); remoteCam.setup(simulator.getHost(), simulator.getPort());
+//
+#pragma once
+
+#include "ofMain.h"
+#include "picojson.h"
+
+#include "Poco/Timestamp.h"
+#include "Poco/Thread.h"
+#include "Poco/RunnableAdapter.h"
+#include "Poco/Net/MulticastSocket.h"
+#include "Poco/Net/HTTPServer.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPRequestHandlerFactory.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+
+class ofxSonyRemoteCameraSimulator
+{
+public:
+	struct Settings
+	{
+		Settings()
+			: port(10000)
+			, applicationName("Simulated Camera")
+			, applicationVersion("2.0.0")
+			, responseLatencyMillis(0)
+			, captureLatencyMillis(300)
+			, awaitThresholdMillis(1000)
+			, postViewWidth(1616)
+			, postViewHeight(1080)
+			, liveViewWidth(640)
+			, liveViewHeight(360)
+			, liveViewFps(30)
+			, zoomSpeed(25.0f)
+			, zoomStepSize(2)
+			, isRecModeRequired(false)
+			, ssdpPort(0)
+			, hasFrameInformation(false)
+			, contentCount(0)
+			, contentBytesPerSecond(0)
+		{}
+		int port;
+		std::string applicationName;	//!< reported by getApplicationInfo
+		std::string applicationVersion;
+		unsigned long long responseLatencyMillis;	//!< added to every JSON-RPC response
+		unsigned long long captureLatencyMillis;	//!< time a still capture takes
+		unsigned long long awaitThresholdMillis;	//!< actTakePicture returns 40403 if the capture takes longer
+		int postViewWidth;
+		int postViewHeight;
+		int liveViewWidth;
+		int liveViewHeight;
+		int liveViewFps;
+		float zoomSpeed;	//!< positions per second of continuous zoom
+		int zoomStepSize;	//!< positions per 1shot zoom
+		bool isRecModeRequired;	//!< startLiveview and actTakePicture fail until startRecMode is called
+		int ssdpPort;		//!< M-SEARCH is answered on this UDP port, 1900 like a camera, 0 disables
+		bool hasFrameInformation;	//!< each liveview image is followed by a frame information payload with a moving face frame
+		int contentCount;	//!< stills on the memory card, all of them the postview image
+		size_t contentBytesPerSecond;	//!< of each content download, 0 is unlimited
+	};
+
+	ofxSonyRemoteCameraSimulator();
+	~ofxSonyRemoteCameraSimulator();
+
+	bool start(const Settings& settings=Settings());
+	void stop();
+	bool isRunning() const { return mpServer != 0; }
+
+	std::string getHost() const { return "127.0.0.1"; }
+	int getPort() const { return mSettings.port; }
+	//! LOCATION of the SSDP answers
+	std::string getDescriptionUrl() const { return "http://" + getHost() + ":" + ofToString(mSettings.port) + "/dd.xml"; }
+	//! UDN of the device description, derived from the port
+	std::string getUuid() const;
+	int getCaptureCount();
+	int getRequestCount();
+
+private:
+	class RequestHandler : public Poco::Net::HTTPRequestHandler
+	{
+	public:
+		RequestHandler(ofxSonyRemoteCameraSimulator& simulator): mSimulator(simulator) {}
+		virtual void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+	private:
+		ofxSonyRemoteCameraSimulator& mSimulator;
+	};
+	class RequestHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory
+	{
+	public:
+		RequestHandlerFactory(ofxSonyRemoteCameraSimulator& simulator): mSimulator(simulator) {}
+		virtual Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest& request);
+	private:
+		ofxSonyRemoteCameraSimulator& mSimulator;
+	};
+
+	void handleCamera(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+	void handlePostView(Poco::Net::HTTPServerResponse& response);
+	//! honors "Range: bytes=N-"
+	void handleContent(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response);
+	void handleLiveView(const std::string& uri, Poco::Net::HTTPServerResponse& response);
+	void handleDescription(Poco::Net::HTTPServerResponse& response);
+	bool startSsdp();
+	void stopSsdp();
+	//! thread answering M-SEARCH
+	void runSsdp();
+	bool call(const std::string& method, const picojson::array& params, picojson::array& result, int& errorCode);
+	bool takePicture(bool isAwait, picojson::array& result, int& errorCode);
+	void getEvent(bool isPolling, picojson::array& result, int& errorCode);
+	bool listContents(const picojson::array& params, picojson::array& result, int& errorCode);
+	bool zoom(const picojson::array& params);
+	void updateZoom();
+	std::string getPostViewUrl(int captureId) const;
+	std::string getContentUrl(int index) const;
+	void createJpeg(int width, int height, ofBuffer& jpeg) const;
+
+	Settings mSettings;
+	Poco::Net::HTTPServer* mpServer;
+	Poco::Net::MulticastSocket mSsdpSocket;
+	Poco::Thread mSsdpThread;
+	Poco::RunnableAdapter<ofxSonyRemoteCameraSimulator> mSsdpRunnable;
+	bool mIsSsdpRunning;
+	ofMutex mMutex;
+	bool mIsRecMode;
+	std::string mShootMode;
+	int mSelfTimer;
+	std::string mPostViewImageSize;
+	bool mIsCapturing;
+	int mCaptureId;		//!< capture in progress
+	Poco::Timestamp mCaptureDoneTime;
+	int mCaptureCount;	//!< captures started
+	int mRequestCount;
+	int mStateVersion;	//!< incremented on every change reported by getEvent
+	double mZoomPosition;	//!< 0-100
+	int mZoomDirection;		//!< of continuous zoom, 0 if stopped
+	Poco::Timestamp mZoomUpdateTime;
+	ofBuffer mPostViewJpeg;
+	ofBuffer mLiveViewJpeg;
+	ofBuffer mSmallLiveViewJpeg;	//!< liveview size "M"
+	std::string mLiveViewSize;		//!< of startLiveviewWithSize
+	std::string mCameraFunction;
+};
@@ -0,0 +1,509 @@
+//
+//  ofxSonyRemoteCameraTransfer.cpp
+//
+#include "ofxSonyRemoteCameraTransfer.h"
+
+#include "Poco/NumberParser.h"
+
+#include <fstream>
+#include <limits>
+
+static const double BASELINE_SMOOTHING(0.2);	//!< of the liveview rate per control period
+static const long MAX_RATE_WAIT(100);			//!< ms, how often a worker waiting for bandwidth checks for cancel
+
+ofxSonyRemoteCameraTransfer::ofxSonyRemoteCameraTransfer()
+	: mpCamera(0)
+	, mIsRunning(false)
+	, mNextId(0)
+	, mRateLimit(0)
+	, mTokens(0)
+	, mControlFrames(0)
+	, mControlBytes(0)
+{
+}
+
+ofxSonyRemoteCameraTransfer::~ofxSonyRemoteCameraTransfer()
+{
+	stop();
+}
+
+void ofxSonyRemoteCameraTransfer::setup(ofxSonyRemoteCamera& camera)
+{
+	mpCamera = &camera;
+}
+
+bool ofxSonyRemoteCameraTransfer::start(const Settings& settings/*=Settings()*/)
+{
+	stop();
+	if (settings.threads <= 0 || settings.chunkSize == 0) return false;
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		mSettings = settings;
+		mSettings.maxAttempts = std::max(1, mSettings.maxAttempts);
+		mStats = Stats();
+		mRateLimit = static_cast<double>(mSettings.maxBytesPerSecond);
+		mStats.rateLimit = static_cast<float>(mRateLimit);
+		mTokens = 0;
+		mRefillTime.update();
+		mControlTime.update();
+		mControlFrames = mpCamera ? mpCamera->getLiveViewFrameCount() : 0;
+		mControlBytes = 0;
+		mIsRunning = true;
+	}
+	for (int i(0); i<settings.threads; ++i) {
+		mWorkers.push_back(new Worker(*this));
+		mWorkers.back()->buffer.resize(settings.chunkSize);
+		mWorkers.back()->thread.start(*mWorkers.back());
+	}
+	return true;
+}
+
+void ofxSonyRemoteCameraTransfer::stop()
+{
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		if (!mIsRunning) return;
+		mIsRunning = false;
+		for (std::deque<Job>::iterator it=mJobs.begin(); it!=mJobs.end(); ++it) {
+			Report report;
+			report.id = it->id;
+			report.url = it->url;
+			report.path = it->path;
+			report.err = ofxSonyRemoteCamera::SRC_ERROR_CANCELLED;
+			mReports.push_back(report);
+		}
+		mJobs.clear();
+		for (std::vector<Worker*>::iterator it=mWorkers.begin(); it!=mWorkers.end(); ++it) {
+			(*it)->isCancelled = true;
+		}
+		mJobCondition.broadcast();
+		mRateCondition.broadcast();
+	}
+	// the running transfers report themselves as cancelled
+	for (std::vector<Worker*>::iterator it=mWorkers.begin(); it!=mWorkers.end(); ++it) {
+		(*it)->abort();
+		(*it)->thread.join();
+		delete *it;
+	}
+	mWorkers.clear();
+}
+
+bool ofxSonyRemoteCameraTransfer::isRunning()
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return mIsRunning;
+}
+
+void ofxSonyRemoteCameraTransfer::update()
+{
+	controlRate();
+	std::deque<Report> reports;
+	{
+		ofMutex::ScopedLock lock(mMutex);
+		reports.swap(mReports);
+	}
+	for (std::deque<Report>::iterator it=reports.begin(); it!=reports.end(); ++it) {
+		ofNotifyEvent(transferFinished, *it);
+	}
+}
+
+int ofxSonyRemoteCameraTransfer::download(const std::string& url, const std::string& path)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	if (!mIsRunning) return -1;
+	Job job;
+	job.id = mNextId++;
+	job.url = url;
+	job.path = ofToDataPath(path, true);
+	mJobs.push_back(job);
+	mJobCondition.signal();
+	return job.id;
+}
+
+int ofxSonyRemoteCameraTransfer::download(const ofxSonyRemoteCamera::Content& content, const std::string& directory)
+{
+	if (content.url.empty()) return -1;
+	const std::string fileName(content.fileName.empty() ? Poco::Path(Poco::URI(content.url).getPath()).getFileName() : content.fileName);
+	return download(content.url, directory + "/" + fileName);
+}
+
+bool ofxSonyRemoteCameraTransfer::cancel(int id)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	for (std::deque<Job>::iterator it=mJobs.begin(); it!=mJobs.end(); ++it) {
+		if (it->id != id) continue;
+		Report report;
+		report.id = it->id;
+		report.url = it->url;
+		report.path = it->path;
+		report.err = ofxSonyRemoteCamera::SRC_ERROR_CANCELLED;
+		mReports.push_back(report);
+		mJobs.erase(it);
+		return true;
+	}
+	for (std::vector<Worker*>::iterator it=mWorkers.begin(); it!=mWorkers.end(); ++it) {
+		if ((*it)->jobId != id) continue;
+		(*it)->isCancelled = true;
+		// unblocks a read, under the lock the worker cannot have moved on to the next transfer.
+		// the worker reports the transfer as cancelled
+		(*it)->abort();
+		mRateCondition.broadcast();
+		return true;
+	}
+	return false;
+}
+
+void ofxSonyRemoteCameraTransfer::getProgress(std::vector<Progress>& progress)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	progress.clear();
+	for (std::map<int, Progress>::const_iterator it=mProgresses.begin(); it!=mProgresses.end(); ++it) {
+		progress.push_back(it->second);
+	}
+}
+
+void ofxSonyRemoteCameraTransfer::getStats(Stats& stats)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	stats = mStats;
+	stats.queued = static_cast<int>(mJobs.size());
+	stats.active = static_cast<int>(mProgresses.size());
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Workers
+//////////////////////////////////////////////////////////////////////////
+void ofxSonyRemoteCameraTransfer::Worker::run()
+{
+	Job job;
+	while (mTransfer.nextJob(*this, job)) {
+		mTransfer.transfer(*this, job);
+	}
+}
+
+void ofxSonyRemoteCameraTransfer::Worker::abort()
+{
+	try {
+		session.abort();
+	} catch (Poco::Exception&) {
+	}
+}
+
+bool ofxSonyRemoteCameraTransfer::nextJob(Worker& worker, Job& job)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	worker.jobId = -1;
+	while (mIsRunning && mJobs.empty()) {
+		mJobCondition.wait(mMutex);
+	}
+	if (!mIsRunning) return false;
+	job = mJobs.front();
+	mJobs.pop_front();
+	worker.jobId = job.id;
+	worker.isCancelled = false;
+	Progress& progress(mProgresses[job.id]);
+	progress.id = job.id;
+	progress.url = job.url;
+	progress.path = job.path;
+	return true;
+}
+
+bool ofxSonyRemoteCameraTransfer::isCancelled(Worker& worker)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	return worker.isCancelled;
+}
+
+void ofxSonyRemoteCameraTransfer::transfer(Worker& worker, const Job& job)
+{
+	const Poco::Timestamp startTime;
+	const std::string partPath(job.path + ".part");
+	Report report;
+	report.id = job.id;
+	report.url = job.url;
+	report.path = job.path;
+	Progress progress;
+	progress.id = job.id;
+	progress.url = job.url;
+	progress.path = job.path;
+	try {
+		Poco::File(Poco::Path(job.path).parent()).createDirectories();
+		if (!mSettings.isResumed && Poco::File(partPath).exists()) Poco::File(partPath).remove();
+		if (Poco::File(partPath).exists()) progress.resumedBytes = static_cast<size_t>(Poco::File(partPath).getSize());
+	} catch (Poco::Exception& e) {
+		ofLogError("transfer: " + e.displayText());
+		report.err = ofxSonyRemoteCamera::SRC_ERROR_ANY;
+		finish(worker, report);
+		return;
+	}
+
+	// each attempt resumes the .part file of the previous one
+	ofxSonyRemoteCamera::SRCError err(ofxSonyRemoteCamera::SRC_ERROR_ANY);
+	for (int attempt(1); attempt<=mSettings.maxAttempts && !isCancelled(worker); ++attempt) {
+		progress.attempts = attempt;
+		err = transferOnce(worker, job, progress);
+		// the camera answered but does not have the file
+		if (err == ofxSonyRemoteCamera::SRC_OK || err == ofxSonyRemoteCamera::SRC_ERROR_ILLEGAL_RESPONSE) break;
+		if (attempt < mSettings.maxAttempts) {
+			ofMutex::ScopedLock lock(mMutex);
+			if (!worker.isCancelled) mRateCondition.tryWait(mMutex, static_cast<long>(mSettings.retryMillis));
+		}
+	}
+	if (err != ofxSonyRemoteCamera::SRC_OK && isCancelled(worker)) err = ofxSonyRemoteCamera::SRC_ERROR_CANCELLED;
+	if (err == ofxSonyRemoteCamera::SRC_OK) {
+		try {
+			if (Poco::File(job.path).exists()) Poco::File(job.path).remove();
+			Poco::File(partPath).renameTo(job.path);
+		} catch (Poco::Exception& e) {
+			ofLogError("transfer: " + e.displayText());
+			err = ofxSonyRemoteCamera::SRC_ERROR_ANY;
+		}
+	}
+	report.err = err;
+	report.bytes = progress.bytes;
+	report.resumedBytes = progress.resumedBytes;
+	report.attempts = progress.attempts;
+	report.elapsedMicros = startTime.elapsed();
+	if (report.elapsedMicros > 0 && report.bytes > report.resumedBytes) {
+		report.bytesPerSecond = static_cast<float>((report.bytes - report.resumedBytes) * 1000000.0 / report.elapsedMicros);
+	}
+	finish(worker, report);
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCameraTransfer::transferOnce(Worker& worker, const Job& job, Progress& progress)
+{
+	const std::string partPath(job.path + ".part");
+	Poco::Net::HTTPClientSession& session(worker.session);
+	ofxSonyRemoteCamera::SRCError err(ofxSonyRemoteCamera::SRC_OK);
+	try {
+		size_t offset(Poco::File(partPath).exists() ? static_cast<size_t>(Poco::File(partPath).getSize()) : 0);
+		const Poco::URI uri(job.url);
+		if (session.getHost() != uri.getHost() || session.getPort() != uri.getPort()) {
+			session.reset();
+			session.setHost(uri.getHost());
+			session.setPort(uri.getPort());
+			session.setKeepAlive(true);
+		}
+		session.setTimeout(Poco::Timespan(static_cast<Poco::Timespan::TimeDiff>(mSettings.timeoutMillis) * 1000));
+		Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, uri.getPathAndQuery(), Poco::Net::HTTPMessage::HTTP_1_1);
+		if (offset > 0) request.set("Range", "bytes=" + ofToString(offset) + "-");
+		session.sendRequest(request);
+		Poco::Net::HTTPResponse response;
+		std::istream& rs(session.receiveResponse(response));
+
+		std::ios::openmode mode(std::ios::binary | std::ios::app);
+		if (response.getStatus() == Poco::Net::HTTPResponse::HTTP_REQUESTED_RANGE_NOT_SATISFIABLE && offset > 0) {
+			// the .part file may already have all of it
+			rs.ignore((std::numeric_limits<std::streamsize>::max)());
+			err = checkRangeEnd(response, offset, partPath);
+			if (err != ofxSonyRemoteCamera::SRC_OK) {
+				progress.resumedBytes = 0;
+				return err;
+			}
+			progress.bytes = offset;
+			progress.contentLength = static_cast<long long>(offset);
+			setProgress(progress, 0);
+			return ofxSonyRemoteCamera::SRC_OK;
+		} else if (response.getStatus() == Poco::Net::HTTPResponse::HTTP_OK) {
+			// the camera ignored the range, it starts over
+			mode = std::ios::binary | std::ios::trunc;
+			offset = 0;
+			progress.resumedBytes = 0;
+		} else if (response.getStatus() != Poco::Net::HTTPResponse::HTTP_PARTIAL_CONTENT) {
+			rs.ignore((std::numeric_limits<std::streamsize>::max)());
+			return ofxSonyRemoteCamera::SRC_ERROR_ILLEGAL_RESPONSE;
+		}
+
+		std::ofstream file(partPath.c_str(), mode);
+		if (!file.is_open()) {
+			ofLogError("transfer: cannot write " + partPath);
+			return ofxSonyRemoteCamera::SRC_ERROR_ANY;
+		}
+		const long long contentLength(response.getContentLength());
+		const long long rangeLength(offset > 0 ? getRangeLength(response) : -1);
+		progress.bytes = offset;
+		progress.contentLength = (rangeLength >= 0) ? rangeLength : (contentLength >= 0) ? static_cast<long long>(offset) + contentLength : -1;
+		progress.bytesPerSecond = 0;
+		setProgress(progress, 0);
+		const Poco::Timestamp startTime;
+		size_t receivedBytes(0);
+		// one chunk of the bandwidth is taken before each read, the buffer bounds the memory
+		while (acquire(worker, worker.buffer.size())) {
+			if (!rs.read(&worker.buffer[0], worker.buffer.size()) && rs.gcount() == 0) break;
+			const size_t size(static_cast<size_t>(rs.gcount()));
+			file.write(&worker.buffer[0], size);
+			receivedBytes += size;
+			progress.bytes += size;
+			const Poco::Timestamp::TimeDiff elapsedMicros(startTime.elapsed());
+			if (elapsedMicros > 0) progress.bytesPerSecond = static_cast<float>(receivedBytes * 1000000.0 / elapsedMicros);
+			setProgress(progress, size);
+		}
+		file.close();
+		if (isCancelled(worker)) {
+			err = ofxSonyRemoteCamera::SRC_ERROR_CANCELLED;
+		} else if (file.fail()) {
+			ofLogError("transfer: cannot write " + partPath);
+			err = ofxSonyRemoteCamera::SRC_ERROR_ANY;
+		} else if (rs.bad() || !rs.eof()) {
+			// the stream keeps the exception of a failed read to itself, the next attempt resumes
+			ofLogError("transfer: read error of " + job.url);
+			err = ofxSonyRemoteCamera::SRC_ERROR_CONNECTION_FAILED;
+			session.reset();
+		} else if (progress.contentLength >= 0) {
+			if (static_cast<long long>(progress.bytes) != progress.contentLength) err = ofxSonyRemoteCamera::SRC_ERROR_CONNECTION_FAILED;
+		} else {
+			// a chunked body or a body until close also ends when the connection is cut
+			err = verifyLength(session, uri, progress.bytes, partPath);
+		}
+	} catch (Poco::TimeoutException& e) {
+		ofLogError("transfer: " + e.displayText());
+		err = ofxSonyRemoteCamera::SRC_ERROR_TIMEOUT;
+		session.reset();
+	} catch (Poco::IOException& e) {
+		ofLogError("transfer: " + e.displayText());
+		err = ofxSonyRemoteCamera::SRC_ERROR_CONNECTION_FAILED;
+		session.reset();
+	} catch (Poco::Exception& e) {
+		ofLogError("transfer: " + e.displayText());
+		err = ofxSonyRemoteCamera::SRC_ERROR_UNKNOWN;
+		session.reset();
+	}
+	return err;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCameraTransfer::verifyLength(Poco::Net::HTTPClientSession& session, const Poco::URI& uri, size_t size, const std::string& partPath)
+{
+	// a range from the end of the file is answered with 416 and the length
+	Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, uri.getPathAndQuery(), Poco::Net::HTTPMessage::HTTP_1_1);
+	request.set("Range", "bytes=" + ofToString(size) + "-");
+	session.sendRequest(request);
+	Poco::Net::HTTPResponse response;
+	std::istream& rs(session.receiveResponse(response));
+	if (response.getStatus() == Poco::Net::HTTPResponse::HTTP_REQUESTED_RANGE_NOT_SATISFIABLE) {
+		rs.ignore((std::numeric_limits<std::streamsize>::max)());
+		return checkRangeEnd(response, size, partPath);
+	}
+	// the body is not read, the connection cannot be reused
+	session.reset();
+	if (response.getStatus() == Poco::Net::HTTPResponse::HTTP_PARTIAL_CONTENT) {
+		// the body was cut, the next attempt resumes it
+		return ofxSonyRemoteCamera::SRC_ERROR_CONNECTION_FAILED;
+	}
+	if (response.getStatus() == Poco::Net::HTTPResponse::HTTP_OK && response.getContentLength() >= 0) {
+		return (response.getContentLength() == static_cast<long long>(size)) ? ofxSonyRemoteCamera::SRC_OK : ofxSonyRemoteCamera::SRC_ERROR_CONNECTION_FAILED;
+	}
+	ofLogError("transfer: the length of " + uri.toString() + " is unknown, the file is not complete");
+	return ofxSonyRemoteCamera::SRC_ERROR_ILLEGAL_RESPONSE;
+}
+
+ofxSonyRemoteCamera::SRCError ofxSonyRemoteCameraTransfer::checkRangeEnd(const Poco::Net::HTTPResponse& response, size_t size, const std::string& partPath)
+{
+	const long long length(getRangeLength(response));
+	if (length == static_cast<long long>(size)) return ofxSonyRemoteCamera::SRC_OK;
+	// longer than the file or unknown, the next attempt starts over
+	ofLogError("transfer: " + partPath + " does not match the length " + ofToString(length) + ", it is downloaded again");
+	Poco::File(partPath).remove();
+	return ofxSonyRemoteCamera::SRC_ERROR_ILLEGAL_DATA_FORMAT;
+}
+
+long long ofxSonyRemoteCameraTransfer::getRangeLength(const Poco::Net::HTTPResponse& response)
+{
+	// bytes <first>-<last>/<length> or bytes */<length>
+	if (!response.has("Content-Range")) return -1;
+	const std::string& range(response.get("Content-Range"));
+	const std::string::size_type slash(range.rfind('/'));
+	if (slash == std::string::npos) return -1;
+	Poco::Int64 length(-1);
+	if (!Poco::NumberParser::tryParse64(range.substr(slash + 1), length) || length < 0) return -1;
+	return length;
+}
+
+void ofxSonyRemoteCameraTransfer::setProgress(const Progress& progress, size_t receivedBytes)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	mProgresses[progress.id] = progress;
+	mStats.bytes += receivedBytes;
+}
+
+void ofxSonyRemoteCameraTransfer::finish(Worker& worker, const Report& report)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	mProgresses.erase(report.id);
+	if (report.err == ofxSonyRemoteCamera::SRC_OK) {
+		++mStats.finished;
+	} else if (report.err != ofxSonyRemoteCamera::SRC_ERROR_CANCELLED) {
+		++mStats.failed;
+	}
+	mReports.push_back(report);
+	worker.jobId = -1;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Bandwidth
+//////////////////////////////////////////////////////////////////////////
+bool ofxSonyRemoteCameraTransfer::acquire(Worker& worker, size_t bytes)
+{
+	ofMutex::ScopedLock lock(mMutex);
+	while (!worker.isCancelled) {
+		const Poco::Timestamp now;
+		if (mRateLimit <= 0) {
+			mRefillTime = now;
+			return true;
+		}
+		// a token bucket holding one chunk at most, a chunk may be taken on credit
+		mTokens = std::min(static_cast<double>(bytes), mTokens + mRateLimit * (now - mRefillTime) / 1000000.0);
+		mRefillTime = now;
+		if (mTokens > 0) {
+			mTokens -= bytes;
+			return true;
+		}
+		const long waitMillis(static_cast<long>(-mTokens * 1000.0 / mRateLimit) + 1);
+		mRateCondition.tryWait(mMutex, std::min(waitMillis, MAX_RATE_WAIT));
+	}
+	return false;
+}
+
+void ofxSonyRemoteCameraTransfer::controlRate()
+{
+	const Poco::Timestamp now;
+	const Poco::Timestamp::TimeDiff elapsedMicros(now - mControlTime);
+	if (elapsedMicros < static_cast<Poco::Timestamp::TimeDiff>(mSettings.controlMillis) * 1000) return;
+	const unsigned int frames(mpCamera ? mpCamera->getLiveViewFrameCount() : 0);
+	const bool isLiveView(mpCamera && mpCamera->isLiveViewSessionConnected());
+
+	ofMutex::ScopedLock lock(mMutex);
+	if (!mIsRunning) return;
+	const double seconds(elapsedMicros / 1000000.0);
+	// the frame count starts over when the liveview reconnects
+	const double fps((frames >= mControlFrames) ? (frames - mControlFrames) / seconds : 0);
+	const double bytesPerSecond((mStats.bytes - mControlBytes) / seconds);
+	mControlTime = now;
+	mControlFrames = frames;
+	mControlBytes = mStats.bytes;
+	mStats.liveViewFps = static_cast<float>(fps);
+	mStats.bytesPerSecond = static_cast<float>(bytesPerSecond);
+
+	const double maxRate(static_cast<double>(mSettings.maxBytesPerSecond));
+	const double minRate(static_cast<double>(mSettings.minBytesPerSecond));
+	double baseline(mStats.baselineFps);
+	if (mSettings.liveViewFpsRatio <= 0 || !isLiveView) {
+		// nothing to share with
+		mRateLimit = maxRate;
+	} else if (mProgresses.empty()) {
+		baseline = (baseline <= 0) ? fps : baseline * (1.0 - BASELINE_SMOOTHING) + fps * BASELINE_SMOOTHING;
+	} else if (baseline > 0 && fps < baseline * mSettings.liveViewFpsRatio) {
+		// multiplicative decrease from what the transfers actually got
+		const double rate((mRateLimit > 0) ? std::min(mRateLimit, bytesPerSecond) : bytesPerSecond);
+		if (mRateLimit > 0 && mRateLimit <= minRate) {
+			// throttled as far as allowed, the liveview is slow for another reason
+			baseline = baseline * (1.0 - BASELINE_SMOOTHING) + fps * BASELINE_SMOOTHING;
+		}
+		mRateLimit = std::max(minRate, rate / 2.0);
+	} else if (mRateLimit > 0 && mRateLimit < 2.0 * bytesPerSecond + mSettings.stepBytesPerSecond) {
+		// additive increase while the limit is what holds the transfers back
+		mRateLimit += mSettings.stepBytesPerSecond;
+	}
+	if (maxRate > 0 && (mRateLimit <= 0 || mRateLimit > maxRate)) mRateLimit = maxRate;
+	mStats.baselineFps = static_cast<float>(baseline);
+	mStats.rateLimit = static_cast<float>(mRateLimit);
+}
@@ -0,0 +1,179 @@
+//
+//  ofxSonyRemoteCameraTransfer.h
+//
+//  Downloads files from a camera, e.g. the contents listed by listContents(), on parallel worker threads.
+//  Each file is streamed to <path>.part through a fixed buffer and renamed when complete, so memory does not grow
+//  with the file size. An interrupted download resumes from the size of the .part file with a Range request.
+//  The transfers share the Wi-Fi with the liveview: while the liveview rate drops below its rate before the transfers,
+//  the bandwidth of the transfers is halved, otherwise it grows step by step (AIMD).
+//  e.g. transfer.setup(remoteCam); transfer.start(); transfer.download(contents[0], "camera"); ... transfer.update();
+//
+#pragma once
+
+#include "ofxSonyRemoteCamera.h"
+
+class ofxSonyRemoteCameraTransfer
+{
+public:
+	struct Settings
+	{
+		Settings()
+			: threads(2)
+			, chunkSize(64 * 1024)
+			, timeoutMillis(10000)
+			, maxAttempts(3)
+			, retryMillis(500)
+			, isResumed(true)
+			, maxBytesPerSecond(0)
+			, minBytesPerSecond(128 * 1024)
+			, stepBytesPerSecond(128 * 1024)
+			, liveViewFpsRatio(0.9f)
+			, controlMillis(500)
+		{}
+		int threads;				//!< files transferred at once
+		size_t chunkSize;			//!< buffer of each thread
+		unsigned long long timeoutMillis;	//!< of the connection and each read
+		int maxAttempts;			//!< of a file, each attempt resumes the previous one
+		unsigned long long retryMillis;
+		bool isResumed;				//!< an existing .part file is resumed, otherwise the file is downloaded again
+		size_t maxBytesPerSecond;	//!< of all transfers, 0 is unlimited
+		size_t minBytesPerSecond;	//!< the liveview share never throttles below this
+		size_t stepBytesPerSecond;	//!< added every controlMillis while the liveview keeps its rate
+		float liveViewFpsRatio;		//!< of the liveview rate before the transfers, the transfers are throttled below it. 0 ignores the liveview
+		unsigned long long controlMillis;
+	};
+	struct Progress
+	{
+		Progress(): id(-1), bytes(0), contentLength(-1), resumedBytes(0), attempts(0), bytesPerSecond(0) {}
+		int id;
+		std::string url;
+		std::string path;			//!< absolute
+		size_t bytes;				//!< in the file, including resumedBytes
+		long long contentLength;	//!< of the file, -1 if unknown
+		size_t resumedBytes;		//!< already in the .part file when the transfer started
+		int attempts;
+		float bytesPerSecond;		//!< of the running attempt
+	};
+	struct Report
+	{
+		Report(): id(-1), err(ofxSonyRemoteCamera::SRC_OK), bytes(0), resumedBytes(0), attempts(0), elapsedMicros(0), bytesPerSecond(0) {}
+		int id;
+		std::string url;
+		std::string path;			//!< absolute
+		ofxSonyRemoteCamera::SRCError err;	//!< SRC_ERROR_CANCELLED by cancel() and stop()
+		size_t bytes;				//!< of the file
+		size_t resumedBytes;		//!< not transferred again
+		int attempts;
+		unsigned long long elapsedMicros;
+		float bytesPerSecond;		//!< of the transferred bytes over elapsedMicros
+	};
+	struct Stats
+	{
+		Stats(): queued(0), active(0), finished(0), failed(0), bytes(0), bytesPerSecond(0), rateLimit(0), liveViewFps(0), baselineFps(0) {}
+		int queued;
+		int active;
+		unsigned int finished;
+		unsigned int failed;
+		unsigned long long bytes;	//!< transferred since start()
+		float bytesPerSecond;		//!< of all transfers in the last control period
+		float rateLimit;			//!< bytes per second, 0 is unlimited
+		float liveViewFps;
+		float baselineFps;			//!< liveview rate while no transfer runs
+	};
+
+	ofxSonyRemoteCameraTransfer();
+	~ofxSonyRemoteCameraTransfer();
+
+	//! the liveview of camera is watched for the bandwidth share
+	void setup(ofxSonyRemoteCamera& camera);
+	bool start(const Settings& settings=Settings());
+	//! cancels the queued and running transfers, their .part files are kept for a resume
+	void stop();
+	bool isRunning();
+	//! runs the bandwidth control, notifies transferFinished
+	void update();
+
+	/*!
+		Queues a download.
+		@params path relative to the data folder
+		@return id of the transfer, -1 if not running
+	*/
+	int download(const std::string& url, const std::string& path);
+	//! downloads the original of content to <directory>/<fileName>
+	int download(const ofxSonyRemoteCamera::Content& content, const std::string& directory);
+	//! @return false if the transfer has finished
+	bool cancel(int id);
+	//! of the running transfers
+	void getProgress(std::vector<Progress>& progress);
+	void getStats(Stats& stats);
+
+	ofEvent<Report> transferFinished;
+
+private:
+	struct Job
+	{
+		Job(): id(-1) {}
+		int id;
+		std::string url;
+		std::string path;
+	};
+	class Worker : public Poco::Runnable
+	{
+	public:
+		Worker(ofxSonyRemoteCameraTransfer& transfer): jobId(-1), isCancelled(false), mTransfer(transfer) {}
+		virtual void run();
+		void abort();
+		Poco::Thread thread;
+		Poco::Net::HTTPClientSession session;
+		std::vector<char> buffer;
+		int jobId;					//!< running, guarded by the mutex of the transfer
+		bool isCancelled;
+	private:
+		ofxSonyRemoteCameraTransfer& mTransfer;
+	};
+
+	//! @return false when stopped
+	bool nextJob(Worker& worker, Job& job);
+	void transfer(Worker& worker, const Job& job);
+	ofxSonyRemoteCamera::SRCError transferOnce(Worker& worker, const Job& job, Progress& progress);
+	/*!
+		Asks the camera for the length of the file, after a body without a length ended.
+		@return SRC_OK if size is the length, SRC_ERROR_CONNECTION_FAILED if the camera has more
+	*/
+	ofxSonyRemoteCamera::SRCError verifyLength(Poco::Net::HTTPClientSession& session, const Poco::URI& uri, size_t size, const std::string& partPath);
+	/*!
+		Compares the length in the Content-Range of a 416 response with size. A .part file which does not match is removed.
+		@return SRC_OK if the .part file is complete
+	*/
+	ofxSonyRemoteCamera::SRCError checkRangeEnd(const Poco::Net::HTTPResponse& response, size_t size, const std::string& partPath);
+	//! of the file in Content-Range, -1 if unknown
+	static long long getRangeLength(const Poco::Net::HTTPResponse& response);
+	//! waits for the bandwidth of bytes. @return false if cancelled
+	bool acquire(Worker& worker, size_t bytes);
+	void setProgress(const Progress& progress, size_t receivedBytes);
+	bool isCancelled(Worker& worker);
+	void finish(Worker& worker, const Report& report);
+	void controlRate();
+
+	ofxSonyRemoteCamera* mpCamera;
+	Settings mSettings;
+	std::vector<Worker*> mWorkers;
+
+	ofMutex mMutex;
+	Poco::Condition mJobCondition;
+	Poco::Condition mRateCondition;	//!< wakes the workers waiting for bandwidth on cancel
+	bool mIsRunning;
+	int mNextId;
+	std::deque<Job> mJobs;
+	std::map<int, Progress> mProgresses;	//!< of the running transfers
+	std::deque<Report> mReports;	//!< notified from update()
+	Stats mStats;
+	// bandwidth
+	double mRateLimit;			//!< bytes per second, 0 is unlimited
+	double mTokens;				//!< bytes which may be read now, negative while in debt
+	Poco::Timestamp mRefillTime;
+	// control
+	Poco::Timestamp mControlTime;
+	unsigned int mControlFrames;	//!< liveview frame count at mControlTime
+	unsigned long long mControlBytes;	//!< transferred bytes at mControlTime
+};